@@ -7,6 +7,8 @@ uniform float energy[16];
 uniform float spec;
 uniform mat4 invproj;
 uniform mat4 viewm;
+// View space depth range of the cluster slice being rendered
+uniform vec2 depthrange;
 
 in vec2 uv;
 
@@ -17,6 +19,8 @@ void main() {
 	vec4 xpos = 2.0 * vec4(texc, z, 1.0) - 1.0f;
 	xpos = invproj * xpos;
 	xpos /= xpos.w;
+	if (xpos.z < depthrange.x || xpos.z >= depthrange.y)
+		discard;
 
 	vec3 diffuse = vec3(0.), specular = vec3(0.);
 
@@ -26,8 +30,12 @@ void main() {
 		vec3 light_pos = pseudocenter.xyz;
 		vec3 light_col = col[i].xyz;
 		float d = distance(light_pos, xpos.xyz);
-		float att = energy[i] * 200. / (4. * 3.14 * d * d);
-		float spec_att = (energy[i] + 10.) * 200. / (4. * 3.14 * d * d);
+		// Fade out towards the radius the light was assigned to the
+		// clusters with, so that there is no visible edge
+		float falloff = clamp(1. - pow(d / center[i].w, 4.), 0., 1.);
+		falloff *= falloff;
+		float att = falloff * energy[i] * 200. / (4. * 3.14 * d * d);
+		float spec_att = falloff * (energy[i] + 10.) * 200. / (4. * 3.14 * d * d);
 
 		vec3 norm = texture2D(ntex, texc).xyz;
 		norm = (norm - 0.5) * 2.0;
@@ -65,6 +65,12 @@ enum E_TEXTURE_CREATION_FLAG
 	/** BurningVideo can handle Non-Power-2 Textures in 2D (GUI), but not in 3D. */
 	ETCF_ALLOW_NON_POWER_2 = 0x00000040,
 
+	//! Do not read the image data of textures loaded from files
+	/** Only an empty placeholder texture is created. This is only
+	supported by the null driver, and is used by programs which never
+	render anything (e.g. dedicated servers). */
+	ETCF_NO_IMAGE_DATA = 0x00000080,
+
 	/** This flag is never used, it only forces the compiler to compile
 	these enumeration values to 32 bit. */
 	ETCF_FORCE_32_BIT_DO_NOT_USE = 0x7fffffff
@@ -503,6 +503,11 @@ ITexture* CNullDriver::getTexture(io::IReadFile* file)
 video::ITexture* CNullDriver::loadTextureFromFile(io::IReadFile* file, const io::path& hashName )
 {
 	ITexture* texture = 0;
+
+	// Don't decode images that would never be used anyway
+	if (getTextureCreationFlag(ETCF_NO_IMAGE_DATA))
+		return new SDummyTexture(hashName.size() ? hashName : file->getFileName());
+
 	IImage* image = createImageFromFile(file);
 
 	if (image)
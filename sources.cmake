@@ -30,6 +30,7 @@ src/graphics/callbacks.cpp
 src/graphics/camera.cpp
 src/graphics/CBatchingMesh.cpp
 src/graphics/explosion.cpp
+src/graphics/frustum_culler.cpp
 src/graphics/glow.cpp
 src/graphics/glwrap.cpp
 src/graphics/gpuparticles.cpp
@@ -38,6 +39,7 @@ src/graphics/hit_sfx.cpp
 src/graphics/irr_driver.cpp
 src/graphics/lens_flare.cpp
 src/graphics/light.cpp
+src/graphics/light_cluster.cpp
 src/graphics/lod_node.cpp
 src/graphics/material.cpp
 src/graphics/material_manager.cpp
@@ -62,6 +64,7 @@ src/graphics/slip_stream.cpp
 src/graphics/stars.cpp
 src/graphics/stkmesh.cpp
 src/graphics/sun.cpp
+src/graphics/texture_preloader.cpp
 src/graphics/water.cpp
 src/graphics/wind.cpp
 src/guiengine/abstract_state_manager.cpp
@@ -154,13 +157,17 @@ src/modes/tutorial_world.cpp
 src/modes/world.cpp
 src/modes/world_status.cpp
 src/modes/world_with_rank.cpp
+src/network/bit_packer.cpp
 src/network/client_network_manager.cpp
 src/network/event.cpp
 src/network/game_setup.cpp
+src/network/kart_snapshot.cpp
+src/network/kart_state_buffer.cpp
 src/network/network_interface.cpp
 src/network/network_manager.cpp
 src/network/network_string.cpp
 src/network/network_world.cpp
+src/network/packet_capture.cpp
 src/network/protocol.cpp
 src/network/protocol_manager.cpp
 src/network/protocols/client_lobby_room_protocol.cpp
@@ -310,6 +317,7 @@ src/utils/constants.cpp
 src/utils/crash_reporting.cpp
 src/utils/debug.cpp
 src/utils/helpers.cpp
+src/utils/histogram.cpp
 src/utils/leak_check.cpp
 src/utils/log.cpp
 src/utils/profiler.cpp
@@ -318,6 +326,7 @@ src/utils/string_utils.cpp
 src/utils/time.cpp
 src/utils/translation.cpp
 src/utils/vec3.cpp
+src/utils/worker_pool.cpp
 )
 set(STK_HEADERS
 src/achievements/achievement.hpp
@@ -354,6 +363,7 @@ src/graphics/callbacks.hpp
 src/graphics/camera.hpp
 src/graphics/CBatchingMesh.hpp
 src/graphics/explosion.hpp
+src/graphics/frustum_culler.hpp
 src/graphics/glow.hpp
 src/graphics/glwrap.hpp
 src/graphics/hardware_skinning.hpp
@@ -363,6 +373,7 @@ src/graphics/irr_driver.hpp
 src/graphics/large_mesh_buffer.hpp
 src/graphics/lens_flare.hpp
 src/graphics/light.hpp
+src/graphics/light_cluster.hpp
 src/graphics/lod_node.hpp
 src/graphics/material.hpp
 src/graphics/material_manager.hpp
@@ -387,6 +398,7 @@ src/graphics/slip_stream.hpp
 src/graphics/stars.hpp
 src/graphics/stkmesh.hpp
 src/graphics/sun.hpp
+src/graphics/texture_preloader.hpp
 src/graphics/water.hpp
 src/graphics/wind.hpp
 src/guiengine/abstract_state_manager.hpp
@@ -478,13 +490,17 @@ src/modes/tutorial_world.hpp
 src/modes/world.hpp
 src/modes/world_status.hpp
 src/modes/world_with_rank.hpp
+src/network/bit_packer.hpp
 src/network/client_network_manager.hpp
 src/network/event.hpp
 src/network/game_setup.hpp
+src/network/kart_snapshot.hpp
+src/network/kart_state_buffer.hpp
 src/network/network_interface.hpp
 src/network/network_manager.hpp
 src/network/network_string.hpp
 src/network/network_world.hpp
+src/network/packet_capture.hpp
 src/network/protocol.hpp
 src/network/protocol_manager.hpp
 src/network/protocols/client_lobby_room_protocol.hpp
@@ -637,13 +653,16 @@ src/tracks/track_object_manager.hpp
 src/tracks/track_object_presentation.hpp
 src/tracks/track_sector.hpp
 src/utils/aligned_array.hpp
+src/utils/atomic.hpp
 src/utils/command_line.hpp
 src/utils/constants.hpp
 src/utils/crash_reporting.hpp
 src/utils/debug.hpp
 src/utils/helpers.hpp
+src/utils/histogram.hpp
 src/utils/interpolation_array.hpp
 src/utils/leak_check.hpp
+src/utils/lock_free_queue.hpp
 src/utils/log.hpp
 src/utils/no_copy.hpp
 src/utils/profiler.hpp
@@ -656,4 +675,5 @@ src/utils/translation.hpp
 src/utils/types.hpp
 src/utils/vec3.hpp
 src/utils/vs.hpp
+src/utils/worker_pool.hpp
 )
@@ -21,6 +21,7 @@
 #define HEADER_DUMMY_SFX_HPP
 
 #include "audio/sfx_base.hpp"
+#include "audio/sfx_buffer.hpp"
 
 
 
@@ -30,9 +31,25 @@
  */
 class DummySFX : public SFXBase
 {
+private:
+    SFXBuffer *m_buffer;
+    bool       m_owns_buffer;
+
 public:
-                       DummySFX(SFXBuffer* buffer, bool positional, float gain) {}
-    virtual           ~DummySFX()                     {}
+                       DummySFX(SFXBuffer* buffer, bool positional,
+                                float gain, bool owns_buffer)
+                       {
+                           m_buffer      = buffer;
+                           m_owns_buffer = owns_buffer;
+                       }
+    virtual           ~DummySFX()
+                       {
+                           if (m_owns_buffer && m_buffer)
+                           {
+                               m_buffer->unload();
+                               delete m_buffer;
+                           }
+                       }
 
     /** Late creation, if SFX was initially disabled */
     virtual bool       init() { return true; }
@@ -45,11 +62,12 @@ public:
     virtual void       resume()                       {}
     virtual void       speed(float factor)            {}
     virtual void       volume(float gain)             {}
+    virtual void       masterVolume(float gain)       {}
     virtual SFXManager::SFXStatus  getStatus()        { return SFXManager::SFX_STOPPED; }
     virtual void       onSoundEnabledBack()           {}
     virtual void       setRolloff(float rolloff)      {}
 
-    virtual const SFXBuffer* getBuffer() const        { return NULL; }
+    virtual const SFXBuffer* getBuffer() const        { return m_buffer; }
 
 };   // DummySFX
 
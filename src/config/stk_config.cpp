@@ -137,6 +137,7 @@ void STKConfig::load(const std::string &filename)
     CHECK_NEG(m_replay_delta_pos2,         "replay delta-position"      );
     CHECK_NEG(m_replay_dt,                 "replay delta-t"             );
     CHECK_NEG(m_smooth_angle_limit,        "physics smooth-angle-limit" );
+    CHECK_NEG(m_physics_fps,               "physics fps"                );
 
     // Square distance to make distance checks cheaper (no sqrt)
     m_replay_delta_pos2 *= m_replay_delta_pos2;
@@ -164,6 +165,7 @@ void STKConfig::init_defaults()
     m_shield_restrict_weapos     = false;
     m_max_karts                  = -100;
     m_max_history                = -100;
+    m_physics_fps                = -100;
     m_max_skidmarks              = -100;
     m_min_kart_version           = -100;
     m_max_kart_version           = -100;
@@ -243,6 +245,7 @@ void STKConfig::getAllData(const XMLNode * root)
     {
         physics_node->get("smooth-normals",     &m_smooth_normals    );
         physics_node->get("smooth-angle-limit", &m_smooth_angle_limit);
+        physics_node->get("fps",                &m_physics_fps       );
     }
 
     if (const XMLNode *startup_node= root->getNode("startup"))
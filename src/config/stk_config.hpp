@@ -95,6 +95,9 @@ public:
      *  triangle are more than this value, the physics will use the normal
      *  of the triangle in smoothing normal. */
     float m_smooth_angle_limit;
+    /** Number of simulation time steps per second. The world is always
+     *  simulated with this fixed time step, independent of the frame rate.*/
+    int   m_physics_fps;
     int   m_max_skidmarks;           /**<Maximum number of skid marks/kart.  */
     float m_skid_fadeout_time;       /**<Time till skidmarks fade away.      */
     float m_near_ground;             /**<Determines when a kart is not near
@@ -561,6 +561,11 @@ namespace UserConfigParams
                             "stun.voxgratia.org",
                             "stun.xten.com") );
 
+    PARAM_PREFIX IntUserConfigParam         m_kart_update_rate
+            PARAM_DEFAULT(  IntUserConfigParam(10, "kart_update_rate",
+                                       "Number of kart position updates sent per second "
+                                       "(1-60). A server sends its snapshots at this rate.") );
+
     PARAM_PREFIX StringUserConfigParam m_packets_log_filename
             PARAM_DEFAULT( StringUserConfigParam("packets_log.txt", "packets_log_filename",
                                                  "Where to log received and sent packets.") );
@@ -658,6 +663,11 @@ namespace UserConfigParams
             PARAM_DEFAULT(  BoolUserConfigParam(
             CONSOLE_DEFAULT, "log_errors", "Enable logging to console.") );
 
+    PARAM_PREFIX IntUserConfigParam         m_worker_threads
+            PARAM_DEFAULT(  IntUserConfigParam(-1, "worker_threads",
+            "Number of additional threads used to update the karts in\n"
+            "parallel (-1 = one less than the number of cores, 0 = none).") );
+
     PARAM_PREFIX IntUserConfigParam         m_reverse_look_threshold
             PARAM_DEFAULT(  IntUserConfigParam(0, "reverse_look_threshold",
             "If the kart is driving backwards faster than this value,\n"
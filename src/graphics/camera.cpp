@@ -50,6 +50,7 @@ Camera::Camera(int camera_index, AbstractKart* kart) : m_kart(NULL)
     m_mode          = CM_NORMAL;
     m_index         = camera_index;
     m_rain          = NULL;
+    m_smoothing_offset = core::vector3df(0, 0, 0);
     m_original_kart = kart;
     m_camera        = irr_driver->addCameraSceneNode();
 
@@ -273,6 +274,7 @@ void Camera::reset()
  */
 void Camera::setInitialTransform()
 {
+    m_smoothing_offset = core::vector3df(0, 0, 0);
     Vec3 start_offset(0, 25, -50);
     Vec3 xx = m_kart->getTrans()(start_offset);
     m_camera->setPosition(  xx.toIrrVector());
@@ -434,6 +436,9 @@ void Camera::update(float dt)
     float above_kart, cam_angle, side_way, distance;
     bool  smoothing;
 
+    // Continue from the camera position of the last simulation step
+    setSmoothingOffset(Vec3(0, 0, 0));
+
     // The following settings give a debug camera which shows the track from
     // high above the kart straight down.
     if (UserConfigParams::m_camera_debug==1)
@@ -486,6 +491,25 @@ void Camera::update(float dt)
     }  // UserConfigParams::m_graphical_effects
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Moves the camera by the difference between the interpolated graphical
+ *  position of its kart and the position of the last simulation step (see
+ *  Moveable::interpolateGraphics), so that the camera does not move
+ *  relative to the kart. The end cameras are fixed, so they are not moved.
+ *  \param offset The smoothing offset of the kart.
+ */
+void Camera::setSmoothingOffset(const Vec3 &offset)
+{
+    core::vector3df new_offset = m_mode==CM_FINAL ? core::vector3df(0, 0, 0)
+                                                  : offset.toIrrVector();
+    if(new_offset==m_smoothing_offset)
+        return;
+    core::vector3df delta = new_offset - m_smoothing_offset;
+    m_camera->setPosition(m_camera->getPosition() + delta);
+    m_camera->setTarget  (m_camera->getTarget()   + delta);
+    m_smoothing_offset = new_offset;
+}   // setSmoothingOffset
+
 // ----------------------------------------------------------------------------
 /** Actually sets the camera based on the given parameter.
  *  \param above_kart How far above the camera should aim at.
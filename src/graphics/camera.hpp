@@ -118,6 +118,10 @@ private:
     /** Used to show rain graphical effects. */
     Rain *m_rain;
 
+    /** The offset currently added to position and target of the camera
+     *  so that it follows the interpolated position of the kart. */
+    core::vector3df m_smoothing_offset;
+
 
     /** A class that stores information about the different end cameras
      *  which can be specified in the scene.xml file. */
@@ -241,6 +245,7 @@ public:
     void setInitialTransform();
     void activate();
     void update            (float dt);
+    void setSmoothingOffset(const Vec3 &offset);
     void setKart           (AbstractKart *new_kart);
 
     // ------------------------------------------------------------------------
@@ -0,0 +1,254 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/frustum_culler.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+/** Number of frustums written to a scene file. */
+static const int SCENE_FILE_FRAMES = 2000;
+
+const unsigned int FrustumCuller::BLOCK_SIZE;
+
+FILE *FrustumCuller::m_scene_file   = NULL;
+int   FrustumCuller::m_scene_frames = 0;
+
+// ----------------------------------------------------------------------------
+/** Sets the number of objects. The memory is kept when the number of
+ *  objects decreases. The arrays are padded to a multiple of BLOCK_SIZE,
+ *  so that cull() can always process whole blocks.
+ */
+void FrustumCuller::resize(unsigned int n)
+{
+    m_num_objects = n;
+    const unsigned int size = (n + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    m_center_x.resize(size);
+    m_center_y.resize(size);
+    m_center_z.resize(size);
+    m_extent_x.resize(size);
+    m_extent_y.resize(size);
+    m_extent_z.resize(size);
+    m_pos_x.resize(size);
+    m_pos_y.resize(size);
+    m_pos_z.resize(size);
+    for (unsigned int k = 0; k < MAX_LOD_LEVELS; k++)
+        m_lod_distance2[k].resize(size);
+    m_num_levels.resize(size);
+    m_in_frustum.resize(size);
+    m_level.resize(size);
+}   // resize
+
+// ----------------------------------------------------------------------------
+/** Sets the data of an object.
+ *  \param i Index of the object.
+ *  \param box World space bounding box.
+ *  \param pos World space position used to determine the level of detail.
+ *  \param lod_distance2 Squared distance up to which each level of detail
+ *         is used.
+ */
+void FrustumCuller::setObject(unsigned int i, const core::aabbox3df &box,
+                              const core::vector3df &pos,
+                              const std::vector<int> &lod_distance2)
+{
+    const core::vector3df center = box.getCenter();
+    const core::vector3df extent = box.MaxEdge - center;
+    m_center_x[i] = center.X;
+    m_center_y[i] = center.Y;
+    m_center_z[i] = center.Z;
+    m_extent_x[i] = extent.X;
+    m_extent_y[i] = extent.Y;
+    m_extent_z[i] = extent.Z;
+    m_pos_x[i]    = pos.X;
+    m_pos_y[i]    = pos.Y;
+    m_pos_z[i]    = pos.Z;
+
+    const unsigned int num_levels = lod_distance2.size();
+    m_num_levels[i] = (unsigned char)std::min(num_levels, MAX_LOD_LEVELS+1);
+    for (unsigned int k = 0; k < MAX_LOD_LEVELS; k++)
+    {
+        m_lod_distance2[k][i] = k < num_levels ? (float)lod_distance2[k]
+                                               : -1.0f;
+    }
+}   // setObject
+
+// ----------------------------------------------------------------------------
+/** Tests all objects against a view frustum and selects their level of
+ *  detail, as LODNode would do for each node.
+ *  \param frustum The world space view frustum of the camera.
+ *  \param camera_pos Position of the camera.
+ *  \param orthogonal True for an orthogonal (e.g. shadow) camera, which
+ *         uses the lowest level of detail for objects that are too far away.
+ */
+void FrustumCuller::cull(const scene::SViewFrustum &frustum,
+                         const core::vector3df &camera_pos, bool orthogonal)
+{
+    const unsigned int n = getNumObjects();
+    if (m_scene_file)
+        writeScene(frustum, camera_pos, orthogonal);
+    if (n == 0) return;
+
+    // An object is culled if its box is completely in front of one of the
+    // planes (the plane normals point out of the frustum), i.e. if the
+    // corner of the box furthest behind the plane is in front of it.
+    const unsigned int num_planes = scene::SViewFrustum::VF_PLANE_COUNT;
+    float nx[num_planes], ny[num_planes], nz[num_planes], d[num_planes];
+    float ax[num_planes], ay[num_planes], az[num_planes];
+    for (unsigned int p = 0; p < num_planes; p++)
+    {
+        const core::plane3df &plane = frustum.planes[p];
+        nx[p] = plane.Normal.X;
+        ny[p] = plane.Normal.Y;
+        nz[p] = plane.Normal.Z;
+        d[p]  = plane.D - core::ROUNDING_ERROR_f32;
+        ax[p] = fabsf(nx[p]);
+        ay[p] = fabsf(ny[p]);
+        az[p] = fabsf(nz[p]);
+    }
+
+    // The objects are processed in blocks of a fixed size, and the results
+    // are first written to local arrays. The compiler then knows the number
+    // of iterations, and that the stores do not overwrite the input
+    // arrays, so it can vectorise the loops. The padding at the end of the
+    // arrays is processed too, but its results are never used.
+    float outside[BLOCK_SIZE], distance2[BLOCK_SIZE];
+    int   level[BLOCK_SIZE], num_levels[BLOCK_SIZE];
+    for (unsigned int first = 0; first < n; first += BLOCK_SIZE)
+    {
+        const unsigned int count = std::min(n - first, BLOCK_SIZE);
+        const float *center_x = &m_center_x[first];
+        const float *center_y = &m_center_y[first];
+        const float *center_z = &m_center_z[first];
+        const float *extent_x = &m_extent_x[first];
+        const float *extent_y = &m_extent_y[first];
+        const float *extent_z = &m_extent_z[first];
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+            outside[i] = -1.0f;
+        for (unsigned int p = 0; p < num_planes; p++)
+        {
+            const float px = nx[p], py = ny[p], pz = nz[p], pd = d[p];
+            const float qx = ax[p], qy = ay[p], qz = az[p];
+            for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+            {
+                const float distance = px*center_x[i] + py*center_y[i]
+                                     + pz*center_z[i] + pd
+                                     - (qx*extent_x[i] + qy*extent_y[i]
+                                        + qz*extent_z[i]);
+                outside[i] = distance > outside[i] ? distance : outside[i];
+            }
+        }
+
+        const float *pos_x = &m_pos_x[first];
+        const float *pos_y = &m_pos_y[first];
+        const float *pos_z = &m_pos_z[first];
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+        {
+            const float dx = pos_x[i] - camera_pos.X;
+            const float dy = pos_y[i] - camera_pos.Y;
+            const float dz = pos_z[i] - camera_pos.Z;
+            distance2[i] = dx*dx + dy*dy + dz*dz;
+        }
+
+        // The level is the first level whose distance is larger than the
+        // distance of the object (MAX_LOD_LEVELS if there is none).
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+            level[i] = MAX_LOD_LEVELS;
+        for (int k = MAX_LOD_LEVELS-1; k >= 0; k--)
+        {
+            const float *lod = &m_lod_distance2[k][first];
+            for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+                level[i] = distance2[i] < lod[i] ? k : level[i];
+        }
+
+        const unsigned char *levels = &m_num_levels[first];
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+            num_levels[i] = levels[i];
+        const int too_far = orthogonal ? 1 : 0;
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++)
+        {
+            int l = level[i] >= num_levels[i]
+                  ? too_far*num_levels[i] - 1 : level[i];
+            level[i] = num_levels[i] > (int)MAX_LOD_LEVELS ? LEVEL_UNKNOWN
+                                                           : l;
+        }
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            m_in_frustum[first+i] = outside[i] <= 0.0f;
+            m_level[first+i]      = (signed char)level[i];
+        }
+    }   // for first < n
+}   // cull
+
+// ----------------------------------------------------------------------------
+/** Opens a file to which the objects and the next frustums are written.
+ *  This is used to benchmark the culling with real scenes.
+ *  \return False if the file could not be opened.
+ */
+bool FrustumCuller::openSceneFile(const std::string &filename)
+{
+    m_scene_file = fopen(filename.c_str(), "w");
+    if (!m_scene_file)
+        return false;
+    m_scene_frames = SCENE_FILE_FRAMES;
+    return true;
+}   // openSceneFile
+
+// ----------------------------------------------------------------------------
+/** Writes the objects (the first time it is called) and a frustum to the
+ *  scene file. The file is closed after SCENE_FILE_FRAMES frustums.
+ */
+void FrustumCuller::writeScene(const scene::SViewFrustum &frustum,
+                               const core::vector3df &camera_pos,
+                               bool orthogonal)
+{
+    if (m_scene_frames == SCENE_FILE_FRAMES)
+    {
+        fprintf(m_scene_file, "objects %u\n", getNumObjects());
+        for (unsigned int i = 0; i < getNumObjects(); i++)
+        {
+            fprintf(m_scene_file, "%f %f %f %f %f %f %f %f %f %d",
+                    m_center_x[i], m_center_y[i], m_center_z[i],
+                    m_extent_x[i], m_extent_y[i], m_extent_z[i],
+                    m_pos_x[i], m_pos_y[i], m_pos_z[i], m_num_levels[i]);
+            for (unsigned int k = 0; k < MAX_LOD_LEVELS; k++)
+            {
+                fprintf(m_scene_file, " %f",
+                        m_lod_distance2[k][i]);
+            }
+            fprintf(m_scene_file, "\n");
+        }
+    }
+
+    fprintf(m_scene_file, "frustum %f %f %f %d", camera_pos.X, camera_pos.Y,
+            camera_pos.Z, orthogonal ? 1 : 0);
+    for (unsigned int p = 0; p < scene::SViewFrustum::VF_PLANE_COUNT; p++)
+    {
+        const core::plane3df &plane = frustum.planes[p];
+        fprintf(m_scene_file, " %f %f %f %f", plane.Normal.X, plane.Normal.Y,
+                plane.Normal.Z, plane.D);
+    }
+    fprintf(m_scene_file, "\n");
+
+    m_scene_frames--;
+    if (m_scene_frames == 0)
+    {
+        fclose(m_scene_file);
+        m_scene_file = NULL;
+    }
+}   // writeScene
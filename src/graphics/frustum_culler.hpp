@@ -0,0 +1,117 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_FRUSTUM_CULLER_HPP
+#define HEADER_FRUSTUM_CULLER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <aabbox3d.h>
+#include <SViewFrustum.h>
+#include <vector3d.h>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace irr;
+
+/**
+ * \brief Culls many objects at once against a view frustum.
+ *  The world space bounding boxes, the positions and the (squared) level
+ *  of detail distances of all objects are stored in contiguous arrays.
+ *  cull() tests all boxes against the six planes of a frustum, computes
+ *  the distance of all objects to the camera and selects their level of
+ *  detail in one pass over these arrays without branches, instead of
+ *  visiting each scene node and transforming the frustum into its space.
+ *  This class does not use the scene manager or video driver, so it can
+ *  be used (and benchmarked) on its own. It can write the objects and the
+ *  frustums it culls to a file, which tools/culling_bench can replay.
+ * \ingroup graphics
+ */
+class FrustumCuller : public NoCopy
+{
+public:
+    /** Maximum number of levels of detail handled here. Objects with more
+     *  levels get LEVEL_UNKNOWN as level. */
+    static const unsigned int MAX_LOD_LEVELS = 4;
+    /** Level of an object that has more than MAX_LOD_LEVELS levels. */
+    static const int          LEVEL_UNKNOWN  = -2;
+
+private:
+    /** Number of objects cull() processes at once. */
+    static const unsigned int BLOCK_SIZE = 64;
+
+    /** Number of objects, the arrays are padded to a multiple of
+     *  BLOCK_SIZE. */
+    unsigned int m_num_objects;
+
+    /** World space bounding boxes as centre and half extent. */
+    std::vector<float> m_center_x, m_center_y, m_center_z;
+    std::vector<float> m_extent_x, m_extent_y, m_extent_z;
+
+    /** World space positions used for the level of detail. */
+    std::vector<float> m_pos_x, m_pos_y, m_pos_z;
+
+    /** Squared distance up to which each level of detail is used, one
+     *  array per level; unused levels are -1. */
+    std::vector<float> m_lod_distance2[MAX_LOD_LEVELS];
+
+    /** Number of levels of detail of each object. */
+    std::vector<unsigned char> m_num_levels;
+
+    /** Result of the frustum test of each object. */
+    std::vector<unsigned char> m_in_frustum;
+
+    /** Selected level of detail of each object, -1 if it is too far
+     *  away. */
+    std::vector<signed char> m_level;
+
+    /** File to write the objects and frustums to, NULL if not used. */
+    static FILE *m_scene_file;
+    /** Number of frustums still to be written. */
+    static int   m_scene_frames;
+
+    void writeScene(const scene::SViewFrustum &frustum,
+                    const core::vector3df &camera_pos, bool orthogonal);
+
+public:
+    FrustumCuller() { m_num_objects = 0; }
+    void resize(unsigned int n);
+    void setObject(unsigned int i, const core::aabbox3df &box,
+                   const core::vector3df &pos,
+                   const std::vector<int> &lod_distance2);
+    void cull(const scene::SViewFrustum &frustum,
+              const core::vector3df &camera_pos, bool orthogonal);
+    static bool openSceneFile(const std::string &filename);
+
+    // ------------------------------------------------------------------------
+    /** Returns the number of objects. */
+    unsigned int getNumObjects() const { return m_num_objects; }
+    // ------------------------------------------------------------------------
+    /** Returns if the box of an object intersects the last culled frustum.
+     *  The test is conservative: boxes close to a corner of the frustum
+     *  can be reported as visible. */
+    bool isInFrustum(unsigned int i) const { return m_in_frustum[i] != 0; }
+    // ------------------------------------------------------------------------
+    /** Returns the level of detail of an object for the last camera, -1 if
+     *  it is too far away, or LEVEL_UNKNOWN. */
+    int getLevel(unsigned int i) const { return m_level[i]; }
+};   // FrustumCuller
+
+#endif
@@ -63,7 +63,7 @@ public:
 	virtual void render();
 	void setAlphaAdditive(bool);
 	void setIncreaseFactor(float);
-	void setHeightmap(const std::vector<std::vector<float> >&, float, float, float, float);
+	void setHeightmap(const std::vector<float>&, float, float, float, float);
 	void setFlip();
 };
 
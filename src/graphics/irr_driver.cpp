@@ -21,10 +21,12 @@
 #include "config/user_config.hpp"
 #include "graphics/callbacks.hpp"
 #include "graphics/camera.hpp"
+#include "graphics/glow.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/hardware_skinning.hpp"
 #include "graphics/lens_flare.hpp"
 #include "graphics/light.hpp"
+#include "graphics/lod_node.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/per_camera_node.hpp"
@@ -106,6 +108,7 @@ IrrDriver::IrrDriver()
     m_wind                = new Wind();
     m_mipviz = m_wireframe = m_normals = m_ssaoviz = \
         m_lightviz = m_shadowviz = m_distortviz = 0;
+    m_last_visible_lights = 0;
 }   // IrrDriver
 
 // ----------------------------------------------------------------------------
@@ -511,6 +514,13 @@ void IrrDriver::initDevice()
                        UserConfigParams::m_window_y);
         } // If reinstating window location
     } // If showing graphics
+    else
+    {
+        // Nothing is ever rendered, so don't read and decode the images
+        // of any texture, only create empty placeholder textures.
+        m_video_driver->setTextureCreationFlag(video::ETCF_NO_IMAGE_DATA,
+                                               true);
+    }
 
     // Initialize material2D
     video::SMaterial& material2D = m_video_driver->getMaterial2D();
@@ -1237,7 +1247,9 @@ video::ITexture *IrrDriver::getTexture(const std::string &filename,
                                        bool complain_if_not_found)
 {
     video::ITexture* out;
-    if(!is_premul && !is_prediv)
+    // Without graphics the pixels are never used, so there is no
+    // point in converting them.
+    if((!is_premul && !is_prediv) || ProfileWorld::isNoGraphics())
     {
         if (!complain_if_not_found) m_device->getLogger()->setLogLevel(ELL_NONE);
         out = m_video_driver->getTexture(filename.c_str());
@@ -1481,8 +1493,8 @@ void IrrDriver::displayFPS()
 
     if (UserConfigParams::m_artist_debug_mode)
     {
-        sprintf(buffer, "FPS: %i/%i/%i - %.2f/%.2f/%.2f KTris - LightDst : ~%d",
-                min, fps, max, low, kilotris, high, m_last_light_bucket_distance);
+        sprintf(buffer, "FPS: %i/%i/%i - %.2f/%.2f/%.2f KTris - Lights : %d",
+                min, fps, max, low, kilotris, high, m_last_visible_lights);
     }
     else
     {
@@ -1766,6 +1778,11 @@ void IrrDriver::update(float dt)
 
     m_wind->update();
 
+    // Cameras and nodes have moved since the last frame
+    LODNode::resetCulling();
+    // The draw statistics are counted per frame
+    STKMesh::resetDrawStats();
+
     World *world = World::getWorld();
 
     // Handle cut scenes (which do not have any karts in it)
@@ -2191,6 +2208,22 @@ scene::ISceneNode *IrrDriver::addLight(const core::vector3df &pos, float energy,
     }
 }
 
+// ----------------------------------------------------------------------------
+/** Removes all static glowing nodes and frees the pool of glow
+ *  representations, which belong to the scene of the current track.
+ */
+void IrrDriver::clearGlowingNodes()
+{
+    m_glowing.clear();
+    m_frame_glows.clear();
+    for (unsigned int i = 0; i < m_glow_nodes.size(); i++)
+    {
+        m_glow_nodes[i]->remove();
+        m_glow_nodes[i]->drop();
+    }
+    m_glow_nodes.clear();
+}   // clearGlowingNodes
+
 // ----------------------------------------------------------------------------
 
 void IrrDriver::clearLights()
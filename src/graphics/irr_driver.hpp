@@ -47,6 +47,7 @@ using namespace irr;
 
 class ShadowImportanceProvider;
 
+#include "graphics/light_cluster.hpp"
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/wind.hpp"
@@ -58,6 +59,7 @@ class ShadowImportanceProvider;
 
 class AbstractKart;
 class Camera;
+class GlowNode;
 class PerCameraNode;
 class PostProcessing;
 class LightNode;
@@ -152,7 +154,8 @@ private:
     bool                 m_shadowviz;
     bool                 m_lightviz;
     bool                 m_distortviz;
-    unsigned             m_last_light_bucket_distance;
+    /** Number of point lights that were visible in the last frame. */
+    unsigned             m_last_visible_lights;
     u32                  m_renderpass;
     u32                  m_lensflare_query;
     scene::IMeshSceneNode *m_sun_interposer;
@@ -166,8 +169,20 @@ private:
 
     std::vector<GlowData> m_glowing;
 
+    /** The static glowing nodes plus the visible glowing items of the
+     *  current frame. Kept as member to avoid reallocations each frame. */
+    std::vector<GlowData> m_frame_glows;
+
+    /** Pool of glow representations. They are created on demand, stay
+     *  in the scene graph and are updated in place each frame; unused
+     *  ones are hidden. */
+    std::vector<GlowNode *> m_glow_nodes;
+
     std::vector<LightNode *> m_lights;
 
+    /** The point lights of the current camera, assigned to clusters. */
+    LightCluster m_light_cluster;
+
     std::vector<BloomData> m_forcedbloom;
 
     std::vector<scene::ISceneNode *> m_displacing;
@@ -188,6 +203,7 @@ private:
 
     void renderFixed(float dt);
     void renderGLSL(float dt);
+    void updateGlowNodes();
     void renderShadows(ShadowImportanceProvider * const sicb,
                        scene::ICameraSceneNode * const camnode,
                        video::SOverrideMaterial &overridemat,
@@ -279,7 +295,6 @@ public:
 
     void                  showPointer();
     void                  hidePointer();
-    void                  setLastLightBucketDistance(unsigned d) { m_last_light_bucket_distance = d; }
     bool                  isPointerShown() const { return m_pointer_shown; }
     core::position2di     getMouseLocation();
 
@@ -436,7 +451,7 @@ public:
         m_glowing.push_back(dat);
     }
     // ------------------------------------------------------------------------
-    void clearGlowingNodes() { m_glowing.clear(); }
+    void clearGlowingNodes();
     // ------------------------------------------------------------------------
     void addForcedBloomNode(scene::ISceneNode *n, float power = 1)
     {
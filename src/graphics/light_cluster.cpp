@@ -0,0 +1,338 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/light_cluster.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+/** Lights are ignored where their attenuation (see pointlight.frag) is
+ *  below this value. The shader fades the light out towards this
+ *  distance, so there is no visible edge. */
+static const float MIN_ATTENUATION = 0.02f;
+
+const unsigned int LightCluster::LIGHTS_PER_BATCH;
+
+LightCluster::LightCluster()
+{
+    m_cluster_start.resize(NUM_CLUSTERS+1, 0);
+    m_cluster_fill.resize(NUM_CLUSTERS, 0);
+    m_num_visible = 0;
+    for (unsigned int i = 0; i <= DEPTH_SLICES; i++)
+        m_slice_depth[i] = 0;
+}   // LightCluster
+
+// ----------------------------------------------------------------------------
+/** Removes all lights. The memory is kept to be reused in the next frame.
+ */
+void LightCluster::clearLights()
+{
+    m_pos_x.clear();
+    m_pos_y.clear();
+    m_pos_z.clear();
+    m_radius.clear();
+    m_red.clear();
+    m_green.clear();
+    m_blue.clear();
+    m_energy.clear();
+    m_num_visible = 0;
+}   // clearLights
+
+// ----------------------------------------------------------------------------
+/** Adds a point light. Its index is the number of lights added before.
+ *  \param pos World space position of the light.
+ *  \param radius Radius of influence of the light (see getLightRadius).
+ *  \param color Colour of the light.
+ *  \param energy Energy of the light.
+ */
+void LightCluster::addLight(const core::vector3df &pos, float radius,
+                            const core::vector3df &color, float energy)
+{
+    m_pos_x.push_back(pos.X);
+    m_pos_y.push_back(pos.Y);
+    m_pos_z.push_back(pos.Z);
+    m_radius.push_back(radius);
+    m_red.push_back(color.X);
+    m_green.push_back(color.Y);
+    m_blue.push_back(color.Z);
+    m_energy.push_back(energy);
+}   // addLight
+
+// ----------------------------------------------------------------------------
+/** Returns the distance at which the light of a light with the given
+ *  energy becomes negligible. The specular term of pointlight.frag uses
+ *  energy+10, so it reaches further than the diffuse term, and even a
+ *  light with energy 0 has a specular highlight.
+ */
+float LightCluster::getLightRadius(float energy)
+{
+    return sqrtf((std::max(energy, 0.0f) + 10.0f) * 200.0f
+                 / (4.0f * 3.14f * MIN_ATTENUATION));
+}   // getLightRadius
+
+// ----------------------------------------------------------------------------
+/** Returns the slice that contains the given view space depth.
+ *  \param slice_scale DEPTH_SLICES / log(far/near).
+ */
+unsigned int LightCluster::getSlice(float z, float near_value,
+                                    float slice_scale) const
+{
+    if (z <= near_value) return 0;
+    const int slice = (int)(logf(z / near_value) * slice_scale);
+    return std::min(slice, (int)DEPTH_SLICES - 1);
+}   // getSlice
+
+// ----------------------------------------------------------------------------
+/** Assigns all lights to the clusters of a camera.
+ *  \param view The view matrix of the camera.
+ *  \param projection The (symmetric, perspective) projection matrix.
+ *  \param near_value, far_value Near and far value of the camera.
+ */
+void LightCluster::assignLights(const core::matrix4 &view,
+                                const core::matrix4 &projection,
+                                float near_value, float far_value)
+{
+    const float slice_scale = DEPTH_SLICES / logf(far_value / near_value);
+    for (unsigned int i = 0; i <= DEPTH_SLICES; i++)
+        m_slice_depth[i] = near_value * expf(i / slice_scale);
+
+    const unsigned int num_lights = getNumLights();
+    m_view_x.resize(num_lights);
+    m_view_y.resize(num_lights);
+    m_view_z.resize(num_lights);
+    m_light_range.resize(6*num_lights);
+
+    // Transform all lights into view space. The loops only access
+    // contiguous arrays, so they can be vectorised by the compiler.
+    const float *m = view.pointer();
+    for (unsigned int i = 0; i < num_lights; i++)
+        m_view_x[i] = m_pos_x[i]*m[0] + m_pos_y[i]*m[4] + m_pos_z[i]*m[8]
+                    + m[12];
+    for (unsigned int i = 0; i < num_lights; i++)
+        m_view_y[i] = m_pos_x[i]*m[1] + m_pos_y[i]*m[5] + m_pos_z[i]*m[9]
+                    + m[13];
+    for (unsigned int i = 0; i < num_lights; i++)
+        m_view_z[i] = m_pos_x[i]*m[2] + m_pos_y[i]*m[6] + m_pos_z[i]*m[10]
+                    + m[14];
+
+    // Determine the range of clusters each light overlaps, and count
+    // the lights in each cluster.
+    const float scale_x = projection[0];
+    const float scale_y = projection[5];
+    std::fill(m_cluster_start.begin(), m_cluster_start.end(), 0);
+    m_num_visible = 0;
+    for (unsigned int i = 0; i < num_lights; i++)
+    {
+        unsigned char *range = &m_light_range[6*i];
+        // Mark the light as culled
+        range[0] = 1;
+        range[1] = 0;
+
+        const float r  = m_radius[i];
+        const float z0 = m_view_z[i] - r;
+        const float z1 = m_view_z[i] + r;
+        if (z1 < near_value || z0 > far_value) continue;
+
+        // Screen space extent of the bounding box of the light's sphere.
+        // If the box reaches behind the near plane, use the whole screen.
+        float min_x = -1.0f, max_x = 1.0f, min_y = -1.0f, max_y = 1.0f;
+        if (z0 > near_value)
+        {
+            const float x0 = m_view_x[i] - r, x1 = m_view_x[i] + r;
+            const float y0 = m_view_y[i] - r, y1 = m_view_y[i] + r;
+            min_x = std::min(x0 / z0, x0 / z1) * scale_x;
+            max_x = std::max(x1 / z0, x1 / z1) * scale_x;
+            min_y = std::min(y0 / z0, y0 / z1) * scale_y;
+            max_y = std::max(y1 / z0, y1 / z1) * scale_y;
+            if (max_x < -1.0f || min_x > 1.0f ||
+                max_y < -1.0f || min_y > 1.0f)
+                continue;
+        }
+
+        const int last_x = TILES_X - 1, last_y = TILES_Y - 1;
+        range[0] = (unsigned char)core::clamp(
+                   (int)floorf((min_x + 1.0f)*0.5f*TILES_X), 0, last_x);
+        range[1] = (unsigned char)core::clamp(
+                   (int)floorf((max_x + 1.0f)*0.5f*TILES_X), 0, last_x);
+        range[2] = (unsigned char)core::clamp(
+                   (int)floorf((min_y + 1.0f)*0.5f*TILES_Y), 0, last_y);
+        range[3] = (unsigned char)core::clamp(
+                   (int)floorf((max_y + 1.0f)*0.5f*TILES_Y), 0, last_y);
+        range[4] = getSlice(z0, near_value, slice_scale);
+        range[5] = getSlice(z1, near_value, slice_scale);
+        m_num_visible++;
+
+        for (unsigned int s = range[4]; s <= range[5]; s++)
+            for (unsigned int y = range[2]; y <= range[3]; y++)
+                for (unsigned int x = range[0]; x <= range[1]; x++)
+                    m_cluster_start[getClusterIndex(x, y, s)]++;
+    }   // for i < num_lights
+
+    // Convert the counts into start indices
+    unsigned int total = 0;
+    for (unsigned int c = 0; c < NUM_CLUSTERS; c++)
+    {
+        const unsigned int count = m_cluster_start[c];
+        m_cluster_start[c] = total;
+        m_cluster_fill[c]  = total;
+        total += count;
+    }
+    m_cluster_start[NUM_CLUSTERS] = total;
+    m_light_indices.resize(total);
+
+    // Store the light indices in the clusters
+    for (unsigned int i = 0; i < num_lights; i++)
+    {
+        if (!isVisible(i)) continue;
+        const unsigned char *range = &m_light_range[6*i];
+        for (unsigned int s = range[4]; s <= range[5]; s++)
+            for (unsigned int y = range[2]; y <= range[3]; y++)
+                for (unsigned int x = range[0]; x <= range[1]; x++)
+                {
+                    const unsigned int c = getClusterIndex(x, y, s);
+                    m_light_indices[m_cluster_fill[c]++] = i;
+                }
+    }
+
+    buildBatches();
+}   // assignLights
+
+// ----------------------------------------------------------------------------
+/** Combines the clusters into batches of at most LIGHTS_PER_BATCH lights.
+ *  If all visible lights fit into one batch, a single batch covers the
+ *  whole view frustum. Otherwise consecutive slices of each tile are
+ *  combined as long as the number of different lights allows it; the
+ *  lights of a slice with too many lights are split over several batches.
+ */
+void LightCluster::buildBatches()
+{
+    m_batches.clear();
+    m_batch_lights.clear();
+    if (m_num_visible == 0) return;
+
+    Batch batch;
+    if (m_num_visible <= LIGHTS_PER_BATCH)
+    {
+        batch.m_first_x     = 0;
+        batch.m_last_x      = TILES_X - 1;
+        batch.m_first_y     = 0;
+        batch.m_last_y      = TILES_Y - 1;
+        batch.m_first_slice = 0;
+        batch.m_last_slice  = DEPTH_SLICES - 1;
+        batch.m_first_light = 0;
+        for (unsigned int i = 0; i < getNumLights(); i++)
+        {
+            if (isVisible(i))
+                m_batch_lights.push_back(i);
+        }
+        batch.m_num_lights = m_batch_lights.size();
+        m_batches.push_back(batch);
+        return;
+    }
+
+    m_light_batch.assign(getNumLights(), 0);
+    for (unsigned int y = 0; y < TILES_Y; y++)
+    {
+        for (unsigned int x = 0; x < TILES_X; x++)
+        {
+            batch.m_first_x = batch.m_last_x = x;
+            batch.m_first_y = batch.m_last_y = y;
+            bool open = false;
+            for (unsigned int s = 0; s < DEPTH_SLICES; s++)
+            {
+                const unsigned int cluster = getClusterIndex(x, y, s);
+                const unsigned int count = getNumClusterLights(cluster);
+                if (count == 0) continue;
+
+                if (open &&
+                    batch.m_num_lights + countNewLights(cluster) >
+                    LIGHTS_PER_BATCH)
+                {
+                    m_batches.push_back(batch);
+                    open = false;
+                }
+
+                if (!open && count > LIGHTS_PER_BATCH)
+                {
+                    // Too many lights for one batch: split this slice
+                    const unsigned int *lights = getClusterLights(cluster);
+                    batch.m_first_slice = batch.m_last_slice = s;
+                    for (unsigned int first = 0; first < count;
+                         first += LIGHTS_PER_BATCH)
+                    {
+                        batch.m_first_light = m_batch_lights.size();
+                        batch.m_num_lights  = std::min(count - first,
+                                                       LIGHTS_PER_BATCH);
+                        m_batch_lights.insert(m_batch_lights.end(),
+                                              lights + first,
+                                              lights + first
+                                                     + batch.m_num_lights);
+                        m_batches.push_back(batch);
+                    }
+                    continue;
+                }
+
+                if (!open)
+                {
+                    batch.m_first_slice = s;
+                    batch.m_first_light = m_batch_lights.size();
+                    batch.m_num_lights  = 0;
+                    open = true;
+                }
+                batch.m_last_slice = s;
+                addBatchLights(&batch, cluster);
+            }   // for s < DEPTH_SLICES
+            if (open)
+                m_batches.push_back(batch);
+        }   // for x < TILES_X
+    }   // for y < TILES_Y
+}   // buildBatches
+
+// ----------------------------------------------------------------------------
+/** Returns the number of lights of a cluster that are not yet in the
+ *  batch that is currently being built.
+ */
+unsigned int LightCluster::countNewLights(unsigned int cluster) const
+{
+    const unsigned int *lights = getClusterLights(cluster);
+    const unsigned int batch_id = m_batches.size() + 1;
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < getNumClusterLights(cluster); i++)
+    {
+        if (m_light_batch[lights[i]] != batch_id)
+            count++;
+    }
+    return count;
+}   // countNewLights
+
+// ----------------------------------------------------------------------------
+/** Adds all lights of a cluster that are not yet in the batch that is
+ *  currently being built (which will be stored at the end of m_batches).
+ */
+void LightCluster::addBatchLights(Batch *batch, unsigned int cluster)
+{
+    const unsigned int *lights = getClusterLights(cluster);
+    const unsigned int batch_id = m_batches.size() + 1;
+    for (unsigned int i = 0; i < getNumClusterLights(cluster); i++)
+    {
+        if (m_light_batch[lights[i]] == batch_id) continue;
+        m_light_batch[lights[i]] = batch_id;
+        m_batch_lights.push_back(lights[i]);
+        batch->m_num_lights++;
+    }
+}   // addBatchLights
@@ -0,0 +1,201 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LIGHT_CLUSTER_HPP
+#define HEADER_LIGHT_CLUSTER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <matrix4.h>
+#include <vector3d.h>
+
+#include <vector>
+
+using namespace irr;
+
+/**
+ * \brief Assigns point lights to clusters of the view frustum.
+ *  The view frustum is split into TILES_X * TILES_Y screen tiles and
+ *  DEPTH_SLICES depth slices (exponentially distributed between the near
+ *  and far plane). Each light is assigned to all clusters that its sphere
+ *  of influence overlaps. The clusters are then combined into batches of
+ *  at most LIGHTS_PER_BATCH lights, each of which is rendered with one
+ *  draw call, so no light is dropped however many lights are visible.
+ *  The lights are stored as a structure of arrays which is kept between
+ *  frames, so no memory is allocated once the largest number of lights was
+ *  seen, and the transformation into view space works on contiguous arrays.
+ *  This class does not use the video driver, so it can be used (and
+ *  benchmarked) with the null driver.
+ * \ingroup graphics
+ */
+class LightCluster : public NoCopy
+{
+public:
+    /** Number of screen tiles in x and y direction. */
+    static const unsigned int TILES_X      = 4;
+    static const unsigned int TILES_Y      = 2;
+    /** Number of depth slices. */
+    static const unsigned int DEPTH_SLICES = 8;
+    static const unsigned int NUM_CLUSTERS = TILES_X*TILES_Y*DEPTH_SLICES;
+    /** Maximum number of lights per batch; must match pointlight.frag. */
+    static const unsigned int LIGHTS_PER_BATCH = 16;
+
+    /** A range of screen tiles and depth slices, and the lights (at most
+     *  LIGHTS_PER_BATCH) that are rendered there with one draw call. */
+    struct Batch
+    {
+        unsigned char m_first_x, m_last_x;
+        unsigned char m_first_y, m_last_y;
+        unsigned char m_first_slice, m_last_slice;
+        /** Index of the first light in m_batch_lights. */
+        unsigned int  m_first_light;
+        unsigned int  m_num_lights;
+    };   // Batch
+
+private:
+    /** World space position, radius of influence, colour and energy of
+     *  all lights. */
+    std::vector<float> m_pos_x, m_pos_y, m_pos_z, m_radius;
+    std::vector<float> m_red, m_green, m_blue, m_energy;
+
+    /** View space position of all lights, computed in assignLights. */
+    std::vector<float> m_view_x, m_view_y, m_view_z;
+
+    /** For each light the range of clusters it overlaps (first and last
+     *  tile in x, in y, first and last slice; 6 entries per light). Culled
+     *  lights have an empty x range. */
+    std::vector<unsigned char> m_light_range;
+
+    /** Index of the first entry of each cluster in m_light_indices, with
+     *  an additional entry for the end of the last cluster. */
+    std::vector<unsigned int> m_cluster_start;
+
+    /** Temporary write position for each cluster in assignLights. */
+    std::vector<unsigned int> m_cluster_fill;
+
+    /** The indices of the lights of all clusters. */
+    std::vector<unsigned int> m_light_indices;
+
+    /** All batches, and the indices of the lights of all batches. */
+    std::vector<Batch>        m_batches;
+    std::vector<unsigned int> m_batch_lights;
+
+    /** For each light the last batch it was added to (plus one), used to
+     *  add a light only once to a batch covering several slices. */
+    std::vector<unsigned int> m_light_batch;
+
+    /** View space depth of the slice boundaries. */
+    float m_slice_depth[DEPTH_SLICES+1];
+
+    /** Number of lights that are in at least one cluster. */
+    unsigned int m_num_visible;
+
+    unsigned int getSlice(float z, float near_value,
+                          float slice_scale) const;
+    void         buildBatches();
+    void         addBatchLights(Batch *batch, unsigned int cluster);
+    unsigned int countNewLights(unsigned int cluster) const;
+
+public:
+                 LightCluster();
+    void         clearLights();
+    void         addLight(const core::vector3df &pos, float radius,
+                          const core::vector3df &color, float energy);
+    void         assignLights(const core::matrix4 &view,
+                              const core::matrix4 &projection,
+                              float near_value, float far_value);
+    static float getLightRadius(float energy);
+
+    // ------------------------------------------------------------------------
+    /** Returns the index of the cluster of the given tile and slice. */
+    static unsigned int getClusterIndex(unsigned int x, unsigned int y,
+                                        unsigned int slice)
+    {
+        return (slice*TILES_Y + y)*TILES_X + x;
+    }   // getClusterIndex
+    // ------------------------------------------------------------------------
+    /** Returns the number of lights added. */
+    unsigned int getNumLights() const { return m_pos_x.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of lights that are in at least one cluster. */
+    unsigned int getNumVisibleLights() const { return m_num_visible; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the given light is in at least one cluster. */
+    bool isVisible(unsigned int i) const
+    {
+        return m_light_range[6*i] <= m_light_range[6*i+1];
+    }   // isVisible
+    // ------------------------------------------------------------------------
+    /** Returns the number of lights in the given cluster. */
+    unsigned int getNumClusterLights(unsigned int cluster) const
+    {
+        return m_cluster_start[cluster+1] - m_cluster_start[cluster];
+    }   // getNumClusterLights
+    // ------------------------------------------------------------------------
+    /** Returns the indices of the lights in the given cluster. */
+    const unsigned int *getClusterLights(unsigned int cluster) const
+    {
+        if (m_light_indices.empty()) return NULL;
+        return &m_light_indices[0] + m_cluster_start[cluster];
+    }   // getClusterLights
+    // ------------------------------------------------------------------------
+    /** Returns the number of batches. */
+    unsigned int getNumBatches() const { return m_batches.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns a batch. */
+    const Batch& getBatch(unsigned int n) const { return m_batches[n]; }
+    // ------------------------------------------------------------------------
+    /** Returns the indices of the lights of a batch. */
+    const unsigned int *getBatchLights(const Batch &batch) const
+    {
+        if (m_batch_lights.empty()) return NULL;
+        return &m_batch_lights[0] + batch.m_first_light;
+    }   // getBatchLights
+    // ------------------------------------------------------------------------
+    /** Returns the view space depth of the near side of a slice. */
+    float getSliceNear(unsigned int slice) const
+    {
+        return m_slice_depth[slice];
+    }   // getSliceNear
+    // ------------------------------------------------------------------------
+    /** Returns the view space depth of the far side of a slice. */
+    float getSliceFar(unsigned int slice) const
+    {
+        return m_slice_depth[slice+1];
+    }   // getSliceFar
+    // ------------------------------------------------------------------------
+    /** Returns the world space position of a light. */
+    core::vector3df getPosition(unsigned int i) const
+    {
+        return core::vector3df(m_pos_x[i], m_pos_y[i], m_pos_z[i]);
+    }   // getPosition
+    // ------------------------------------------------------------------------
+    /** Returns the colour of a light. */
+    core::vector3df getColor(unsigned int i) const
+    {
+        return core::vector3df(m_red[i], m_green[i], m_blue[i]);
+    }   // getColor
+    // ------------------------------------------------------------------------
+    /** Returns the energy of a light. */
+    float getEnergy(unsigned int i) const { return m_energy[i]; }
+    // ------------------------------------------------------------------------
+    /** Returns the radius of influence of a light. */
+    float getRadius(unsigned int i) const { return m_radius[i]; }
+};   // LightCluster
+
+#endif
@@ -18,16 +18,22 @@
 
 #include "graphics/irr_driver.hpp"
 #include "graphics/lod_node.hpp"
+#include "graphics/frustum_culler.hpp"
 #include "graphics/hardware_skinning.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/material.hpp"
 #include "config/user_config.hpp"
+#include "utils/profiler.hpp"
 
 #include <ISceneManager.h>
 #include <ICameraSceneNode.h>
 #include <IMeshSceneNode.h>
 #include <IAnimatedMeshSceneNode.h>
 
+std::vector<LODNode*>            LODNode::m_all_nodes;
+FrustumCuller                    LODNode::m_culler;
+const scene::ICameraSceneNode   *LODNode::m_culled_camera = NULL;
+
 /**
   * @param group_name Only useful for getGroupName()
   */
@@ -50,10 +56,23 @@ LODNode::LODNode(std::string group_name, scene::ISceneNode* parent,
 
     m_forced_lod = -1;
     m_last_tick = 0;
+
+    m_cull_index  = m_all_nodes.size();
+    m_cull_dirty  = true;
+    m_cull_static = true;
+    m_all_nodes.push_back(this);
+    resetCulling();
 }
 
 LODNode::~LODNode()
 {
+    // Move the last node into the place of this node
+    LODNode *last = m_all_nodes.back();
+    m_all_nodes[m_cull_index] = last;
+    last->m_cull_index = m_cull_index;
+    last->m_cull_dirty = true;
+    m_all_nodes.pop_back();
+    resetCulling();
 }
 
 void LODNode::render()
@@ -62,7 +81,8 @@ void LODNode::render()
 }
 
 /** Returns the level to use, or -1 if the object is too far
- *  away.
+ *  away. If all nodes were culled for the active camera, the level
+ *  selected then is used.
  */
 int LODNode::getLevel()
 {
@@ -70,25 +90,101 @@ int LODNode::getLevel()
     if(m_forced_lod>-1)
         return m_forced_lod;
 
-    // TODO: optimize this, there is no need to check every frame
     scene::ICameraSceneNode* curr_cam = irr_driver->getSceneManager()->getActiveCamera();
+    if (curr_cam == m_culled_camera)
+    {
+        const int level = m_culler.getLevel(m_cull_index);
+        if (level != FrustumCuller::LEVEL_UNKNOWN)
+            return level;
+    }
 
-    // Assumes all children are at the same location
-    const int dist =
-        (int)((getPosition() + m_nodes[0]->getPosition()).getDistanceFromSQ( curr_cam->getPosition() ));
+    const float dist =
+        getLODPosition().getDistanceFromSQ(curr_cam->getAbsolutePosition());
+    return getLevelForDistance(dist, curr_cam->isOrthogonal());
+}  // getLevel
+
+// ---------------------------------------------------------------------------
+/** Returns the position used to select the level of detail. This assumes
+ *  that all children are at the same location.
+ */
+core::vector3df LODNode::getLODPosition() const
+{
+    if (m_nodes.size() == 0)
+        return getAbsolutePosition();
+    return getAbsolutePosition() + m_nodes[0]->getPosition();
+}   // getLODPosition
 
+// ---------------------------------------------------------------------------
+/** Returns the level to use for an object at the given squared distance
+ *  from the camera, or -1 if the object is too far away.
+ */
+int LODNode::getLevelForDistance(float distance2, bool orthogonal) const
+{
     for (unsigned int n=0; n<m_detail.size(); n++)
     {
-        if (dist < m_detail[n])
+        if (distance2 < m_detail[n])
           return n;
     }
 
     // If it's the shadow pass, and we would have otherwise hidden the item, show the min one
-    if (curr_cam->isOrthogonal())
+    if (orthogonal)
         return m_detail.size() - 1;
 
     return -1;
-}  // getLevel
+}   // getLevelForDistance
+
+// ---------------------------------------------------------------------------
+/** Invalidates the culling results. This must be called whenever nodes or
+ *  cameras could have moved, i.e. each frame and for each camera.
+ */
+void LODNode::resetCulling()
+{
+    m_culled_camera = NULL;
+}   // resetCulling
+
+// ---------------------------------------------------------------------------
+/** Culls all LOD nodes against the view frustum of a camera, and selects
+ *  their level of detail, in one pass over contiguous arrays instead of
+ *  node by node in the scene manager. This is done when the first LOD node
+ *  is registered for rendering with a camera, since at this time the
+ *  absolute positions of all nodes are up to date. The bounding boxes of
+ *  static nodes that did not move are kept from the previous call.
+ */
+void LODNode::cullNodes(const scene::ICameraSceneNode *camera)
+{
+    PROFILER_PUSH_CPU_MARKER("LODNode::cullNodes", 0x80, 0x80, 0x00);
+    m_culler.resize(m_all_nodes.size());
+    for (unsigned int i = 0; i < m_all_nodes.size(); i++)
+    {
+        LODNode *node = m_all_nodes[i];
+        if (!node->m_cull_dirty && node->m_cull_static &&
+            node->getAbsoluteTransformation() == node->m_cull_transform)
+            continue;
+        const core::vector3df pos = node->getLODPosition();
+        core::aabbox3df box(pos);
+        // The levels can have different bounding boxes, so use a box
+        // that contains all of them.
+        for (unsigned int k = 0; k < node->m_nodes.size(); k++)
+        {
+            const scene::ISceneNode *level = node->m_nodes[k];
+            core::aabbox3df level_box = level->getBoundingBox();
+            core::matrix4 m = node->getAbsoluteTransformation();
+            m *= level->getRelativeTransformation();
+            m.transformBoxEx(level_box);
+            if (k == 0)
+                box = level_box;
+            else
+                box.addInternalBox(level_box);
+        }
+        m_culler.setObject(i, box, pos, node->m_detail);
+        node->m_cull_transform = node->getAbsoluteTransformation();
+        node->m_cull_dirty     = false;
+    }
+    m_culler.cull(*camera->getViewFrustum(), camera->getAbsolutePosition(),
+                  camera->isOrthogonal());
+    m_culled_camera = camera;
+    PROFILER_POP_CPU_MARKER();
+}   // cullNodes
 
 // ---------------------------------------------------------------------------
 /** Forces the level of detail to be n. If n>number of levels, the most
@@ -136,12 +232,29 @@ void LODNode::OnRegisterSceneNode()
     if (!isVisible()) return;
     if (m_nodes.size() == 0) return;
 
+    const scene::ICameraSceneNode *camera = SceneManager->getActiveCamera();
+    if (camera && camera != m_culled_camera)
+        cullNodes(camera);
+
     bool shown = false;
     int level = getLevel();
     if (level>=0)
     {
-        m_nodes[level]->updateAbsolutePosition();
-        m_nodes[level]->OnRegisterSceneNode();
+        if (camera != m_culled_camera)
+        {
+            m_nodes[level]->setAutomaticCulling(m_automatic_culling[level]);
+            m_nodes[level]->updateAbsolutePosition();
+            m_nodes[level]->OnRegisterSceneNode();
+        }
+        // Nodes outside of the view frustum are not registered at all. The
+        // others were already tested by the culler, so the scene manager
+        // does not need to test them again.
+        else if (m_culler.isInFrustum(m_cull_index))
+        {
+            m_nodes[level]->setAutomaticCulling(scene::EAC_OFF);
+            m_nodes[level]->updateAbsolutePosition();
+            m_nodes[level]->OnRegisterSceneNode();
+        }
         shown = true;
     }
 
@@ -283,6 +396,10 @@ void LODNode::add(int level, scene::ISceneNode* node, bool reparent)
     node->setPosition(core::vector3df(0,0,0));
     m_detail.push_back(level*level);
     m_nodes.push_back(node);
+    m_automatic_culling.push_back(node->getAutomaticCulling());
+    // The bounding box of an animated mesh changes with the animation
+    m_cull_static = m_cull_static && node->getType() == scene::ESNT_MESH;
+    m_cull_dirty  = true;
     m_nodes_set.insert(node);
     node->setParent(this);
 
@@ -27,10 +27,12 @@
 
 namespace irr
 {
-    namespace scene { class ISceneManager; class ISceneNode; }
+    namespace scene { class ICameraSceneNode; class ISceneManager; class ISceneNode; }
 }
 using namespace irr;
 
+class FrustumCuller;
+
 #include <set>
 
 namespace irr
@@ -54,6 +56,10 @@ private:
     std::vector<int> m_detail;
     std::vector<irr::scene::ISceneNode*> m_nodes;
 
+    /** The automatic culling of each level node when it was added. It is
+     *  turned off while the frustum culler has tested the node. */
+    std::vector<u32> m_automatic_culling;
+
     std::set<scene::ISceneNode*> m_nodes_set;
 
     std::string m_group_name;
@@ -73,6 +79,35 @@ private:
 
     u32 m_last_tick;
 
+    /** Index of this node in m_all_nodes and in the frustum culler. */
+    unsigned int m_cull_index;
+
+    /** Absolute transformation of this node when its data was last
+     *  passed to the frustum culler. */
+    core::matrix4 m_cull_transform;
+
+    /** True if the data of this node in the frustum culler must be set
+     *  again, e.g. because a level was added or the index changed. */
+    bool m_cull_dirty;
+
+    /** True if all levels are static meshes, so that the bounding box only
+     *  changes if the node moves. */
+    bool m_cull_static;
+
+    /** All LOD nodes, which are culled together for each camera. */
+    static std::vector<LODNode*> m_all_nodes;
+
+    /** Culls all LOD nodes against the frustum of a camera and selects
+     *  their level of detail. */
+    static FrustumCuller m_culler;
+
+    /** The camera for which m_culler has valid results, or NULL. */
+    static const scene::ICameraSceneNode *m_culled_camera;
+
+    static void     cullNodes(const scene::ICameraSceneNode *camera);
+    core::vector3df getLODPosition() const;
+    int             getLevelForDistance(float distance2, bool orthogonal) const;
+
 public:
 
     LODNode(std::string group_name, scene::ISceneNode* parent, scene::ISceneManager* mgr, s32 id=-1);
@@ -83,6 +118,8 @@ public:
 
     int getLevel();
 
+    static void resetCulling();
+
     /*
     //! Returns a reference to the current relative transformation matrix.
     //! This is the matrix, this scene node uses instead of scale, translation
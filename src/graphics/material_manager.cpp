@@ -24,6 +24,7 @@
 
 #include "config/user_config.hpp"
 #include "graphics/material.hpp"
+#include "graphics/texture_preloader.hpp"
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
 #include "modes/world.hpp"
@@ -41,6 +42,9 @@ MaterialManager::MaterialManager()
     /* Create list - and default material zero */
 
     m_materials.reserve(256);
+    m_hidden_material.reserve(256);
+    m_material_file.reserve(256);
+    m_shared_material_index = 0;
     // We can't call init/loadMaterial here, since the global variable
     // material_manager has not yet been initialised, and
     // material_manager is used in the Material constructor.
@@ -58,8 +62,90 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_hidden_material.clear();
+    m_material_file.clear();
+    m_material_index.clear();
 }   // ~MaterialManager
 
+//-----------------------------------------------------------------------------
+/** Adds a material at the end of the list of materials, and makes it the
+ *  material that is found for its texture name.
+ *  \param m The material to add.
+ */
+void MaterialManager::addMaterial(Material *m)
+{
+    const int index = (int)m_materials.size();
+    m_materials.push_back(m);
+    std::map<std::string, int>::iterator i =
+        m_material_index.find(m->getTexFname());
+    if(i==m_material_index.end())
+    {
+        m_hidden_material.push_back(-1);
+        m_material_index[m->getTexFname()] = index;
+    }
+    else
+    {
+        m_hidden_material.push_back(i->second);
+        i->second = index;
+    }
+    m_material_file.push_back("");
+}   // addMaterial
+
+//-----------------------------------------------------------------------------
+/** Deletes the last material, and makes the material it was hiding (if
+ *  any) visible again.
+ */
+void MaterialManager::removeLastMaterial()
+{
+    const int index = (int)m_materials.size()-1;
+    Material *m     = m_materials[index];
+    std::map<std::string, int>::iterator i =
+        m_material_index.find(m->getTexFname());
+    assert(i!=m_material_index.end() && i->second==index);
+    if(m_hidden_material[index]<0)
+        m_material_index.erase(i);
+    else
+        i->second = m_hidden_material[index];
+    delete m;
+    m_materials.pop_back();
+    m_hidden_material.pop_back();
+    m_material_file.pop_back();
+}   // removeLastMaterial
+
+//-----------------------------------------------------------------------------
+/** Replaces the list of materials (without deleting any material), and
+ *  rebuilds the index used to find a material by name.
+ *  \param materials The new list of materials.
+ *  \param files For each material the file it was loaded from, see
+ *         m_material_file.
+ */
+void MaterialManager::setMaterials(const std::vector<Material*> &materials,
+                                   const std::vector<std::string> &files)
+{
+    m_materials.clear();
+    m_hidden_material.clear();
+    m_material_file.clear();
+    m_material_index.clear();
+    for(unsigned int i=0; i<materials.size(); i++)
+    {
+        addMaterial(materials[i]);
+        m_material_file.back() = files[i];
+    }
+}   // setMaterials
+
+//-----------------------------------------------------------------------------
+/** Returns the last added material for a texture name, or NULL if no such
+ *  material exists.
+ *  \param name Texture name (without path) of the material.
+ */
+Material *MaterialManager::findMaterial(const std::string &name) const
+{
+    std::map<std::string, int>::const_iterator i = m_material_index.find(name);
+    if(i==m_material_index.end())
+        return NULL;
+    return m_materials[i->second];
+}   // findMaterial
+
 //-----------------------------------------------------------------------------
 
 Material* MaterialManager::getMaterialFor(video::ITexture* t,
@@ -67,17 +153,9 @@ Material* MaterialManager::getMaterialFor(video::ITexture* t,
 {
     assert(t != NULL);
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            return m_materials[i];
-        }
-    }   // for i
-
-    return NULL;
-}
+    // Temporary (track) textures are found before shared ones
+    return findMaterial(image);
+}   // getMaterialFor
 
 //-----------------------------------------------------------------------------
 /** Searches for the material in the given texture, and calls a function
@@ -143,15 +221,10 @@ void MaterialManager::adjustForFog(video::ITexture* t,
                                    bool use_fog) const
 {
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            m_materials[i]->adjustForFog(parent, &(mb->getMaterial()), use_fog);
-            return;
-        }
-    }   // for i
+    // Temporary (track) textures are found before shared ones
+    Material *m = findMaterial(image);
+    if(m)
+        m->adjustForFog(parent, &(mb->getMaterial()), use_fog);
 }   // adjustForFog
 
 //-----------------------------------------------------------------------------
@@ -173,7 +246,7 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb) cons
 //-----------------------------------------------------------------------------
 int MaterialManager::addEntity(Material *m)
 {
-    m_materials.push_back(m);
+    addMaterial(m);
     return (int)m_materials.size()-1;
 }
 
@@ -205,15 +278,73 @@ void MaterialManager::addSharedMaterial(const std::string& filename, bool deprec
         msg<<"FATAL: File '"<<filename<<"' not found\n";
         throw std::runtime_error(msg.str());
     }
-    if(!pushTempMaterial(filename, deprecated))
+
+    // If temporary (track) materials exist, take them out while the file
+    // is read, so that the new materials are added before them and are
+    // not popped together with them.
+    std::vector<Material*>   temp(m_materials.begin()+m_shared_material_index,
+                                  m_materials.end());
+    std::vector<std::string> temp_files(m_material_file.begin()
+                                            +m_shared_material_index,
+                                        m_material_file.end());
+    if(!temp.empty())
+    {
+        setMaterials(std::vector<Material*>(m_materials.begin(),
+                                            m_materials.begin()
+                                                +m_shared_material_index),
+                     std::vector<std::string>(m_material_file.begin(),
+                                              m_material_file.begin()
+                                                  +m_shared_material_index));
+    }
+
+    const unsigned int first = (unsigned int)m_materials.size();
+    const bool success = pushTempMaterial(filename, deprecated);
+    for(unsigned int i=first; i<m_materials.size(); i++)
+        m_material_file[i] = filename;
+    m_shared_material_index = (int)m_materials.size();
+
+    for(unsigned int i=0; i<temp.size(); i++)
+    {
+        addMaterial(temp[i]);
+        m_material_file.back() = temp_files[i];
+    }
+
+    if(!success)
     {
         std::ostringstream msg;
         msg <<"FATAL: Parsing error in '"<<filename<<"'\n";
         throw std::runtime_error(msg.str());
     }
-    m_shared_material_index = (int)m_materials.size();
 }   // addSharedMaterial
 
+//-----------------------------------------------------------------------------
+/** Deletes all shared materials that were loaded from the given file with
+ *  addSharedMaterial(), e.g. the materials of a kart that is unloaded.
+ *  Materials with the same name that were hidden by them are found again.
+ *  \param filename The file that was given to addSharedMaterial().
+ */
+void MaterialManager::removeSharedMaterial(const std::string& filename)
+{
+    std::vector<Material*>   materials;
+    std::vector<std::string> files;
+    int shared = m_shared_material_index;
+    for(unsigned int i=0; i<m_materials.size(); i++)
+    {
+        if((int)i<m_shared_material_index && m_material_file[i]==filename)
+        {
+            delete m_materials[i];
+            shared--;
+            continue;
+        }
+        materials.push_back(m_materials[i]);
+        files.push_back(m_material_file[i]);
+    }
+    if(shared==m_shared_material_index)
+        return;
+    setMaterials(materials, files);
+    m_shared_material_index = shared;
+}   // removeSharedMaterial
+
 //-----------------------------------------------------------------------------
 bool MaterialManager::pushTempMaterial(const std::string& filename, bool deprecated)
 {
@@ -233,6 +364,12 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
                                        const std::string& filename,
                                        bool deprecated)
 {
+    // Decode all textures in parallel first, so that creating the
+    // materials below finds them in the texture cache.
+    TexturePreloader preloader;
+    preloader.addMaterials(root);
+    preloader.load();
+
     for(unsigned int i=0; i<root->getNumNodes(); i++)
     {
         const XMLNode *node = root->getNode(i);
@@ -244,7 +381,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         }
         try
         {
-            m_materials.push_back(new Material(node, m_materials.size(), deprecated));
+            addMaterial(new Material(node, m_materials.size(), deprecated));
         }
         catch(std::exception& e)
         {
@@ -261,8 +398,7 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
-        delete m_materials[i];
-        m_materials.pop_back();
+        removeLastMaterial();
     }   // for i6
 }   // popTempMaterial
 
@@ -304,15 +440,13 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     else
         basename = fname;
         
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return m_materials[i];
-    }
+    // Temporary (track) textures are found before shared ones
+    Material *existing = findMaterial(basename);
+    if(existing) return existing;
 
     // Add the new material
     Material* m=new Material(fname, m_materials.size(), is_full_path, complain_if_not_found);
-    m_materials.push_back(m);
+    addMaterial(m);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -335,10 +469,5 @@ bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
 
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return findMaterial(basename)!=NULL;
 }
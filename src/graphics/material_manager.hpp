@@ -29,6 +29,7 @@ namespace irr
 }
 using namespace irr;
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -47,6 +48,27 @@ private:
     int     m_shared_material_index;
 
     std::vector<Material*> m_materials;
+
+    /** Maps a texture name to the index of the last material with this
+     *  name in m_materials, so that temporary (track) materials are found
+     *  before shared materials with the same name. */
+    std::map<std::string, int> m_material_index;
+
+    /** For each material the index of the material with the same name
+     *  that it hides in m_material_index, or -1. Used to restore the
+     *  index when temporary materials are removed. */
+    std::vector<int> m_hidden_material;
+
+    /** For each material the file given to addSharedMaterial() it was
+     *  loaded from, or "" for all other materials. Used by
+     *  removeSharedMaterial(). */
+    std::vector<std::string> m_material_file;
+
+    void      addMaterial(Material *m);
+    void      removeLastMaterial();
+    void      setMaterials(const std::vector<Material*> &materials,
+                           const std::vector<std::string> &files);
+    Material *findMaterial(const std::string &name) const;
 public:
               MaterialManager();
              ~MaterialManager();
@@ -69,6 +91,7 @@ public:
                                 bool complain_if_not_found=true,
                                 bool strip_path=true);
     void      addSharedMaterial(const std::string& filename, bool deprecated = false);
+    void      removeSharedMaterial(const std::string& filename);
     bool      pushTempMaterial (const std::string& filename, bool deprecated = false);
     bool      pushTempMaterial (const XMLNode *root, const std::string& filename, bool deprecated = false);
     void      popTempMaterial  ();
@@ -22,6 +22,7 @@
 #include "graphics/camera.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/light_cluster.hpp"
 #include "graphics/mlaa_areamap.hpp"
 #include "graphics/shaders.hpp"
 #include "io/file_manager.hpp"
@@ -302,7 +303,7 @@ namespace ColorLevelShader
 namespace PointLightShader
 {
 	GLuint Program = 0;
-	GLuint uniform_ntex, uniform_center, uniform_col, uniform_energy, uniform_spec, uniform_invproj, uniform_viewm;
+	GLuint uniform_ntex, uniform_center, uniform_col, uniform_energy, uniform_spec, uniform_invproj, uniform_viewm, uniform_depthrange;
 
 	GLuint vao = 0;
 
@@ -317,6 +318,7 @@ namespace PointLightShader
 		uniform_spec = glGetUniformLocation(Program, "spec");
 		uniform_invproj = glGetUniformLocation(Program, "invproj");
 		uniform_viewm = glGetUniformLocation(Program, "viewm");
+		uniform_depthrange = glGetUniformLocation(Program, "depthrange");
 		vao = createVAO(Program);
 	}
 }
@@ -596,7 +598,10 @@ void renderColorLevel(ITexture *in)
 	glEnable(GL_DEPTH_TEST);
 }
 
-void PostProcessing::renderPointlight(ITexture *in, const std::vector<float> &positions, const std::vector<float> &colors, const std::vector<float> &energy)
+/** Renders the point lights of all light cluster batches. Each batch is
+ *  drawn with a scissor rectangle covering its screen tiles, and the shader
+ *  discards pixels outside of its depth slices. */
+void PostProcessing::renderPointlights(ITexture *in, const LightCluster &lights)
 {
 	if (!PointLightShader::Program)
 		PointLightShader::init();
@@ -608,9 +613,6 @@ void PostProcessing::renderPointlight(ITexture *in, const std::vector<float> &po
 	glUseProgram(PointLightShader::Program);
 	glBindVertexArray(PointLightShader::vao);
 
-	glUniform4fv(PointLightShader::uniform_center, 16, positions.data());
-	glUniform4fv(PointLightShader::uniform_col, 16, colors.data());
-	glUniform1fv(PointLightShader::uniform_energy, 16, energy.data());
 	glUniform1f(PointLightShader::uniform_spec, 200);
 	glUniformMatrix4fv(PointLightShader::uniform_invproj, 1, GL_FALSE, irr_driver->getInvProjMatrix().pointer());
 	glUniformMatrix4fv(PointLightShader::uniform_viewm, 1, GL_FALSE, irr_driver->getViewMatrix().pointer());
@@ -619,7 +621,54 @@ void PostProcessing::renderPointlight(ITexture *in, const std::vector<float> &po
 	glBindTexture(GL_TEXTURE_2D, static_cast<irr::video::COpenGLTexture*>(in)->getOpenGLTextureName());
 	glUniform1i(PointLightShader::uniform_ntex, 0);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glEnable(GL_SCISSOR_TEST);
+
+	const unsigned int maxlight = LightCluster::LIGHTS_PER_BATCH;
+	float positions[4 * LightCluster::LIGHTS_PER_BATCH];
+	float colors[4 * LightCluster::LIGHTS_PER_BATCH];
+	float energy[LightCluster::LIGHTS_PER_BATCH];
+	for (unsigned int b = 0; b < lights.getNumBatches(); b++)
+	{
+		const LightCluster::Batch &batch = lights.getBatch(b);
+		const int x0 = viewport[0] + viewport[2] * batch.m_first_x / (int)LightCluster::TILES_X;
+		const int x1 = viewport[0] + viewport[2] * (batch.m_last_x + 1) / (int)LightCluster::TILES_X;
+		const int y0 = viewport[1] + viewport[3] * batch.m_first_y / (int)LightCluster::TILES_Y;
+		const int y1 = viewport[1] + viewport[3] * (batch.m_last_y + 1) / (int)LightCluster::TILES_Y;
+		glScissor(x0, y0, x1 - x0, y1 - y0);
+		glUniform2f(PointLightShader::uniform_depthrange, lights.getSliceNear(batch.m_first_slice), lights.getSliceFar(batch.m_last_slice));
+
+		const unsigned int *indices = lights.getBatchLights(batch);
+		for (unsigned int i = 0; i < maxlight; i++)
+		{
+			core::vector3df pos(0, 0, 0), col(0, 0, 0);
+			float radius = 1.;
+			energy[i] = 0.;
+			if (i < batch.m_num_lights)
+			{
+				pos = lights.getPosition(indices[i]);
+				col = lights.getColor(indices[i]);
+				energy[i] = lights.getEnergy(indices[i]);
+				radius = lights.getRadius(indices[i]);
+			}
+			positions[4 * i] = pos.X;
+			positions[4 * i + 1] = pos.Y;
+			positions[4 * i + 2] = pos.Z;
+			// The shader fades the light out towards its radius
+			positions[4 * i + 3] = radius;
+			colors[4 * i] = col.X;
+			colors[4 * i + 1] = col.Y;
+			colors[4 * i + 2] = col.Z;
+			colors[4 * i + 3] = 0.;
+		}
+		glUniform4fv(PointLightShader::uniform_center, maxlight, positions);
+		glUniform4fv(PointLightShader::uniform_col, maxlight, colors);
+		glUniform1fv(PointLightShader::uniform_energy, maxlight, energy);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	glDisable(GL_SCISSOR_TEST);
+
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -30,6 +30,8 @@ namespace irr
 }
 using namespace irr;
 
+class LightCluster;
+
 /** \brief   Handles post processing, eg motion blur
  *  \ingroup graphics
  */
@@ -73,7 +75,7 @@ public:
     void         update(float dt);
 
 	/** Generate diffuse and specular map */
-	void         renderPointlight(video::ITexture *in, const std::vector<float> &positions, const std::vector<float> &colors, const std::vector<float> &energy);
+	void         renderPointlights(video::ITexture *in, const LightCluster &lights);
 
 	/** Blend all light related map */
 	void renderLightbBlend(video::ITexture *diffuse, video::ITexture *specular, video::ITexture *ao, video::ITexture *specmap, bool debug);
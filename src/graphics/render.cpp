@@ -35,6 +35,7 @@
 #include "graphics/screenquad.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/shadow_importance.hpp"
+#include "graphics/stkmesh.hpp"
 #include "graphics/wind.hpp"
 #include "io/file_manager.hpp"
 #include "items/item.hpp"
@@ -70,66 +71,7 @@ void IrrDriver::renderGLSL(float dt)
         overridemat.EnablePasses = scene::ESNRP_SOLID;
     }
 
-    // Get a list of all glowing things. The driver's list contains the static ones,
-    // here we add items, as they may disappear each frame.
-    std::vector<GlowData> glows = m_glowing;
-    std::vector<GlowNode *> transparent_glow_nodes;
-
-    ItemManager * const items = ItemManager::get();
-    const u32 itemcount = items->getNumberOfItems();
-    u32 i;
-
-    // For each static node, give it a glow representation
-    const u32 staticglows = glows.size();
-    for (i = 0; i < staticglows; i++)
-    {
-        scene::ISceneNode * const node = glows[i].node;
-
-        const float radius = (node->getBoundingBox().getExtent().getLength() / 2) * 2.0f;
-        GlowNode * const repnode = new GlowNode(irr_driver->getSceneManager(), radius);
-        repnode->setPosition(node->getTransformedBoundingBox().getCenter());
-        transparent_glow_nodes.push_back(repnode);
-    }
-
-    for (i = 0; i < itemcount; i++)
-    {
-        Item * const item = items->getItem(i);
-        if (!item) continue;
-        const Item::ItemType type = item->getType();
-
-        if (type != Item::ITEM_NITRO_BIG && type != Item::ITEM_NITRO_SMALL &&
-            type != Item::ITEM_BONUS_BOX && type != Item::ITEM_BANANA && type != Item::ITEM_BUBBLEGUM)
-            continue;
-
-        LODNode * const lod = (LODNode *) item->getSceneNode();
-        if (!lod->isVisible()) continue;
-
-        const int level = lod->getLevel();
-        if (level < 0) continue;
-
-        scene::ISceneNode * const node = lod->getAllNodes()[level];
-        node->updateAbsolutePosition();
-
-        GlowData dat;
-        dat.node = node;
-
-        dat.r = 1.0f;
-        dat.g = 1.0f;
-        dat.b = 1.0f;
-
-        const video::SColorf &c = ItemManager::getGlowColor(type);
-        dat.r = c.getRed();
-        dat.g = c.getGreen();
-        dat.b = c.getBlue();
-
-        glows.push_back(dat);
-
-        // Push back its representation too
-        const float radius = (node->getBoundingBox().getExtent().getLength() / 2) * 2.0f;
-        GlowNode * const repnode = new GlowNode(irr_driver->getSceneManager(), radius);
-        repnode->setPosition(node->getTransformedBoundingBox().getCenter());
-        transparent_glow_nodes.push_back(repnode);
-    }
+    updateGlowNodes();
 
     // Start the RTT for post-processing.
     // We do this before beginScene() because we want to capture the glClear()
@@ -162,6 +104,7 @@ void IrrDriver::renderGLSL(float dt)
                                  0x00, 0x00);
 #endif
         camera->activate();
+        LODNode::resetCulling();
         rg->preRenderCallback(camera);   // adjusts start referee
 
         const u32 bgnodes = m_background.size();
@@ -178,7 +121,7 @@ void IrrDriver::renderGLSL(float dt)
             overridemat.EnableFlags = video::EMF_MATERIAL_TYPE;
             overridemat.Material.MaterialType = video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
 
-            for (i = 0; i < bgnodes; i++)
+            for (u32 i = 0; i < bgnodes; i++)
             {
                 m_background[i]->setPosition(camnode->getPosition() * 0.97f);
                 m_background[i]->updateAbsolutePosition();
@@ -198,7 +141,9 @@ void IrrDriver::renderGLSL(float dt)
         glStencilFunc(GL_ALWAYS, 1, ~0);
         glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
         glEnable(GL_STENCIL_TEST);
+        STKMesh::beginRenderQueue();
         m_scene_manager->drawAll(m_renderpass);
+        STKMesh::flushRenderQueue();
         glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
         glDisable(GL_STENCIL_TEST);
         irr_driver->setProjMatrix(irr_driver->getVideoDriver()->getTransform(video::ETS_PROJECTION));
@@ -216,7 +161,7 @@ void IrrDriver::renderGLSL(float dt)
         // Render anything glowing.
         if (!m_mipviz && !m_wireframe)
         {
-            //renderGlow(overridemat, glows, cambox, cam);
+            //renderGlow(overridemat, m_frame_glows, cambox, cam);
         } // end glow
 
         // Shadows
@@ -233,7 +178,9 @@ void IrrDriver::renderGLSL(float dt)
         glStencilFunc(GL_EQUAL, 0, ~0);
         glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
         glEnable(GL_STENCIL_TEST);
+        STKMesh::beginRenderQueue();
         m_scene_manager->drawAll(m_renderpass);
+        STKMesh::flushRenderQueue();
         glDisable(GL_STENCIL_TEST);
 
         if (!bgnodes)
@@ -286,14 +233,6 @@ void IrrDriver::renderGLSL(float dt)
             renderDisplacement(overridemat, cam);
         }
 
-        // Drawing for this cam done, cleanup
-        const u32 glowrepcount = transparent_glow_nodes.size();
-        for (i = 0; i < glowrepcount; i++)
-        {
-            transparent_glow_nodes[i]->remove();
-            transparent_glow_nodes[i]->drop();
-        }
-
         PROFILER_POP_CPU_MARKER();
 
         // Note that drawAll must be called before rendering
@@ -343,6 +282,63 @@ void IrrDriver::renderGLSL(float dt)
     getPostProcessing()->update(dt);
 }
 
+// --------------------------------------------
+/** Collects all glowing things of this frame in m_frame_glows: the static
+ *  glowing nodes of the track, plus the visible glowing items (which can
+ *  disappear at any time). Each of them gets a glow representation from
+ *  the pool of glow nodes, which are updated in place. Unused glow nodes
+ *  are hidden.
+ */
+void IrrDriver::updateGlowNodes()
+{
+    m_frame_glows = m_glowing;
+
+    const std::vector<Item*> &items = ItemManager::get()->getGlowingItems();
+    for (unsigned int i = 0; i < items.size(); i++)
+    {
+        Item * const item = items[i];
+        LODNode * const lod = (LODNode *) item->getSceneNode();
+        if (!lod->isVisible()) continue;
+
+        const int level = lod->getLevel();
+        if (level < 0) continue;
+
+        scene::ISceneNode * const node = lod->getAllNodes()[level];
+        node->updateAbsolutePosition();
+
+        GlowData dat;
+        dat.node = node;
+
+        const video::SColorf &c = ItemManager::getGlowColor(item->getType());
+        dat.r = c.getRed();
+        dat.g = c.getGreen();
+        dat.b = c.getBlue();
+
+        m_frame_glows.push_back(dat);
+    }
+
+    // Give each glowing node its glow representation
+    const unsigned int glowcount = m_frame_glows.size();
+    while (m_glow_nodes.size() < glowcount)
+    {
+        GlowNode * const repnode = new GlowNode(m_scene_manager, 1.0f);
+        m_glow_nodes.push_back(repnode);
+    }
+
+    for (unsigned int i = 0; i < glowcount; i++)
+    {
+        scene::ISceneNode * const node = m_frame_glows[i].node;
+        const float radius = (node->getBoundingBox().getExtent().getLength() / 2) * 2.0f;
+        GlowNode * const repnode = m_glow_nodes[i];
+        repnode->setScale(core::vector3df(radius));
+        repnode->setPosition(node->getTransformedBoundingBox().getCenter());
+        repnode->setVisible(true);
+    }
+
+    for (unsigned int i = glowcount; i < m_glow_nodes.size(); i++)
+        m_glow_nodes[i]->setVisible(false);
+}   // updateGlowNodes
+
 // --------------------------------------------
 
 void IrrDriver::renderFixed(float dt)
@@ -369,6 +365,7 @@ void IrrDriver::renderFixed(float dt)
                                  0x00, 0x00);
 #endif
         camera->activate();
+        LODNode::resetCulling();
         rg->preRenderCallback(camera);   // adjusts start referee
 
         m_renderpass = ~0;
@@ -480,6 +477,7 @@ void IrrDriver::renderShadows(ShadowImportanceProvider * const sicb,
     m_suncam->setProjectionMatrix(ortho, true);
     m_scene_manager->setActiveCamera(m_suncam);
     m_suncam->render();
+    LODNode::resetCulling();
 
     ortho *= m_suncam->getViewMatrix();
     ((SunLightProvider *) m_shaders->m_callbacks[ES_SUNLIGHT])->setShadowMatrix(ortho);
@@ -673,7 +671,6 @@ void IrrDriver::renderGlow(video::SOverrideMaterial &overridemat,
 }
 
 // ----------------------------------------------------------------------------
-#define MAXLIGHT 16 // to be adjusted in pointlight.frag too
 void IrrDriver::renderLights(const core::aabbox3df& cambox,
                              scene::ICameraSceneNode * const camnode,
                              video::SOverrideMaterial &overridemat,
@@ -688,81 +685,46 @@ void IrrDriver::renderLights(const core::aabbox3df& cambox,
     m_video_driver->setRenderTarget(rtts, true, false,
                                         video::SColor(0, 0, 0, 0));
 
+    // Assign all point lights to the clusters of this camera; the other
+    // lights are rendered directly.
+    m_light_cluster.clearLights();
     const u32 lightcount = m_lights.size();
-    const core::vector3df &campos =
-        irr_driver->getSceneManager()->getActiveCamera()->getAbsolutePosition();
-    std::vector<float> accumulatedLightPos;
-    std::vector<float> accumulatedLightColor;
-    std::vector<float> accumulatedLightEnergy;
-    std::vector<LightNode *> BucketedLN[15];
     for (unsigned int i = 0; i < lightcount; i++)
     {
         if (!m_lights[i]->isPointLight())
         {
-          m_lights[i]->render();
-          continue;
+            m_lights[i]->render();
+            continue;
         }
-        const core::vector3df &lightpos = (m_lights[i]->getAbsolutePosition() - campos);
-        unsigned idx = (unsigned)(lightpos.getLength() / 10);
-        if (idx > 14)
-          continue;
-        BucketedLN[idx].push_back(m_lights[i]);
+        m_light_cluster.addLight(m_lights[i]->getAbsolutePosition(),
+                                 LightCluster::getLightRadius(m_lights[i]->getEnergy()),
+                                 m_lights[i]->getColor(),
+                                 m_lights[i]->getEffectiveEnergy());
     }
+    m_light_cluster.assignLights(camnode->getViewMatrix(),
+                                 camnode->getProjectionMatrix(),
+                                 camnode->getNearValue(),
+                                 camnode->getFarValue());
 
-    unsigned lightnum = 0;
-
-    for (unsigned i = 0; i < 15; i++)
+    // Fade in lights when they come into view
+    unsigned int point_light = 0;
+    for (unsigned int i = 0; i < lightcount; i++)
     {
-        for (unsigned j = 0; j < BucketedLN[i].size(); j++)
-        {
-            if (++lightnum > MAXLIGHT)
-            {
-                LightNode* light_node = BucketedLN[i].at(j);
-                light_node->setEnergyMultiplier(0.0f);
-            }
-            else
-            {
-                LightNode* light_node = BucketedLN[i].at(j);
-
-                float em = light_node->getEnergyMultiplier();
-                if (em < 1.0f)
-                {
-                    light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
-                }
-
-                const core::vector3df &pos = light_node->getAbsolutePosition();
-                accumulatedLightPos.push_back(pos.X);
-                accumulatedLightPos.push_back(pos.Y);
-                accumulatedLightPos.push_back(pos.Z);
-                accumulatedLightPos.push_back(0.);
-                const core::vector3df &col = light_node->getColor();
-
-                accumulatedLightColor.push_back(col.X);
-                accumulatedLightColor.push_back(col.Y);
-                accumulatedLightColor.push_back(col.Z);
-                accumulatedLightColor.push_back(0.);
-                accumulatedLightEnergy.push_back(light_node->getEffectiveEnergy());
-            }
-        }
-        if (lightnum > MAXLIGHT)
+        if (!m_lights[i]->isPointLight())
+            continue;
+        LightNode * const light_node = m_lights[i];
+        if (!m_light_cluster.isVisible(point_light++))
         {
-          irr_driver->setLastLightBucketDistance(i * 10);
-          break;
+            light_node->setEnergyMultiplier(0.0f);
+            continue;
         }
+        const float em = light_node->getEnergyMultiplier();
+        if (em < 1.0f)
+            light_node->setEnergyMultiplier(std::min(1.0f, em + dt));
     }
-	// Fill lights
-	for (; lightnum < MAXLIGHT; lightnum++) {
-		accumulatedLightPos.push_back(0.);
-		accumulatedLightPos.push_back(0.);
-		accumulatedLightPos.push_back(0.);
-		accumulatedLightPos.push_back(0.);
-		accumulatedLightColor.push_back(0.);
-		accumulatedLightColor.push_back(0.);
-		accumulatedLightColor.push_back(0.);
-		accumulatedLightColor.push_back(0.);
-		accumulatedLightEnergy.push_back(0.);
-	}
-	m_post_processing->renderPointlight(irr_driver->getRTT(RTT_NORMAL_AND_DEPTH) , accumulatedLightPos, accumulatedLightColor, accumulatedLightEnergy);
+    m_last_visible_lights = m_light_cluster.getNumVisibleLights();
+
+    m_post_processing->renderPointlights(irr_driver->getRTT(RTT_NORMAL_AND_DEPTH), m_light_cluster);
     // Handle SSAO
     m_video_driver->setRenderTarget(irr_driver->getRTT(RTT_SSAO), true, false,
                          SColor(255, 255, 255, 255));
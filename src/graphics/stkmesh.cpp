@@ -3,6 +3,7 @@
 #include <ISceneManager.h>
 #include <IMaterialRenderer.h>
 #include "config/user_config.hpp"
+#include <algorithm>
 
 static
 GLuint createVAO(GLuint vbo, GLuint idx, GLuint attrib_position, GLuint attrib_texcoord, GLuint attrib_normal, size_t stride)
@@ -70,9 +71,8 @@ namespace ObjectPass2Shader
 		uniform_ambient = glGetUniformLocation(Program, "ambient");
 	}
 
-	void setUniforms(const core::matrix4 &ModelViewProjectionMatrix, unsigned TU_Albedo, unsigned TU_DiffuseMap, unsigned TU_SpecularMap, unsigned TU_SSAO)
+	void setPassUniforms(unsigned TU_Albedo, unsigned TU_DiffuseMap, unsigned TU_SpecularMap, unsigned TU_SSAO)
 	{
-		glUniformMatrix4fv(uniform_MVP, 1, GL_FALSE, ModelViewProjectionMatrix.pointer());
 		glUniform1i(uniform_Albedo, TU_Albedo);
 		glUniform1i(uniform_DiffuseMap, TU_DiffuseMap);
 		glUniform1i(uniform_SpecularMap, TU_SpecularMap);
@@ -81,6 +81,11 @@ namespace ObjectPass2Shader
 		const video::SColorf s = irr_driver->getSceneManager()->getAmbientLight();
 		glUniform3f(uniform_ambient, s.r, s.g, s.b);
 	}
+
+	void setUniforms(const core::matrix4 &ModelViewProjectionMatrix)
+	{
+		glUniformMatrix4fv(uniform_MVP, 1, GL_FALSE, ModelViewProjectionMatrix.pointer());
+	}
 }
 
 static
@@ -186,97 +191,201 @@ STKMesh::~STKMesh()
 //	glDeleteBuffers(index_buffer.size(), index_buffer.data());
 }
 
+// A draw of one mesh buffer in an object pass. The state it needs is the
+// sort key: program, material, texture, then depth (front to back) and
+// VAO. The VAOs are created per mesh buffer, so sorting by depth first
+// does not cost any VAO switch.
+struct QueuedDraw
+{
+	GLuint Program;
+	video::E_MATERIAL_TYPE MaterialType;
+	GLuint Texture;
+	float Depth;
+	GLuint VAO;
+	const GLMesh *Mesh;
+	core::matrix4 ModelViewProjectionMatrix;
+	core::matrix4 TransposeInverseModelView;
+};
+
+struct QueuedDrawKey
+{
+	const QueuedDraw *Draw;
+
+	bool operator<(const QueuedDrawKey &other) const
+	{
+		const QueuedDraw &a = *Draw, &b = *other.Draw;
+		if (a.Program != b.Program)
+			return a.Program < b.Program;
+		if (a.MaterialType != b.MaterialType)
+			return a.MaterialType < b.MaterialType;
+		if (a.Texture != b.Texture)
+			return a.Texture < b.Texture;
+		if (a.Depth != b.Depth)
+			return a.Depth < b.Depth;
+		return a.VAO < b.VAO;
+	}
+};
+
+static std::vector<QueuedDraw> DrawQueue;
+static std::vector<QueuedDrawKey> DrawQueueKeys;
+static bool DrawQueueOpen = false;
+static STKMeshDrawStats DrawStats;
+
 static
-void drawFirstPass(const GLMesh &mesh, video::E_MATERIAL_TYPE type)
+void queueDraw(const GLMesh &mesh, video::E_MATERIAL_TYPE type)
 {
-  irr_driver->getVideoDriver()->setRenderTarget(irr_driver->getRTT(RTT_NORMAL_AND_DEPTH), false, false);
-
-  glStencilFunc(GL_ALWAYS, 0, ~0);
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_ALPHA_TEST);
-  glDepthMask(GL_TRUE);
-  glDisable(GL_BLEND);
-  GLenum ptype = mesh.PrimitiveType;
-  GLenum itype = mesh.IndexType;
-  size_t count = mesh.IndexCount;
-
-  core::matrix4 ModelViewProjectionMatrix = irr_driver->getVideoDriver()->getTransform(video::ETS_PROJECTION);
-  ModelViewProjectionMatrix *= irr_driver->getVideoDriver()->getTransform(video::ETS_VIEW);
-  ModelViewProjectionMatrix *= irr_driver->getVideoDriver()->getTransform(video::ETS_WORLD);
-  core::matrix4 TransposeInverseModelView = irr_driver->getVideoDriver()->getTransform(video::ETS_VIEW);
-  TransposeInverseModelView *= irr_driver->getVideoDriver()->getTransform(video::ETS_WORLD);
-  TransposeInverseModelView.makeInverse();
-  TransposeInverseModelView = TransposeInverseModelView.getTransposed();
-
-  glUseProgram(ObjectPass1Shader::Program);
-  ObjectPass1Shader::setUniforms(ModelViewProjectionMatrix, TransposeInverseModelView);
-
-  glBindVertexArray(mesh.vao_first_pass);
-  glDrawElements(ptype, count, itype, 0);
-  glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glStencilFunc(GL_ALWAYS, 1, ~0);
-  irr_driver->getVideoDriver()->setRenderTarget(irr_driver->getMainSetup(), false, false);
+	if (!mesh.textures)
+		return;
+	video::IVideoDriver *driver = irr_driver->getVideoDriver();
+	const bool firstPass = irr_driver->getPhase() == 0;
+
+	QueuedDraw draw;
+	draw.Program = firstPass ? ObjectPass1Shader::Program : ObjectPass2Shader::Program;
+	draw.MaterialType = type;
+	// The first pass does not use the texture
+	draw.Texture = firstPass ? 0 : mesh.textures;
+	draw.VAO = firstPass ? mesh.vao_first_pass : mesh.vao_second_pass;
+	draw.Mesh = &mesh;
+
+	core::matrix4 ModelView = driver->getTransform(video::ETS_VIEW);
+	ModelView *= driver->getTransform(video::ETS_WORLD);
+	draw.Depth = ModelView[14];
+	draw.ModelViewProjectionMatrix = driver->getTransform(video::ETS_PROJECTION);
+	draw.ModelViewProjectionMatrix *= ModelView;
+	if (firstPass)
+	{
+		ModelView.makeInverse();
+		draw.TransposeInverseModelView = ModelView.getTransposed();
+	}
+	DrawQueue.push_back(draw);
 }
 
 static
-void drawSecondPass(const GLMesh &mesh, video::E_MATERIAL_TYPE type)
+void bindTexture(GLuint texture)
 {
-  irr_driver->getVideoDriver()->setRenderTarget(irr_driver->getRTT(RTT_COLOR), false, false);
-
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_ALPHA_TEST);
-  glDepthMask(GL_FALSE);
-  glDisable(GL_BLEND);
-  GLenum ptype = mesh.PrimitiveType;
-  GLenum itype = mesh.IndexType;
-  size_t count = mesh.IndexCount;
-
-  core::matrix4 ModelViewProjectionMatrix = irr_driver->getVideoDriver()->getTransform(video::ETS_PROJECTION);
-  ModelViewProjectionMatrix *= irr_driver->getVideoDriver()->getTransform(video::ETS_VIEW);
-  ModelViewProjectionMatrix *= irr_driver->getVideoDriver()->getTransform(video::ETS_WORLD);
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, mesh.textures);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_TMP1))->getOpenGLTextureName());
-  glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_2D, static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_TMP2))->getOpenGLTextureName());
-  glActiveTexture(GL_TEXTURE3);
-  glBindTexture(GL_TEXTURE_2D, static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_SSAO))->getOpenGLTextureName());
-
-  glUseProgram(ObjectPass2Shader::Program);
-  ObjectPass2Shader::setUniforms(ModelViewProjectionMatrix, 0, 1, 2, 3);
-
-  glBindVertexArray(mesh.vao_second_pass);
-  glDrawElements(ptype, count, itype, 0);
-  glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  irr_driver->getVideoDriver()->setRenderTarget(irr_driver->getRTT(RTT_COLOR), false, false);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	DrawStats.TextureSwitches++;
 }
 
+// Sorts the queued draws and submits them, setting the render target and
+// the state of the pass only once, and binding programs, textures and VAOs
+// only when they change.
 static
-void draw(const GLMesh &mesh, video::E_MATERIAL_TYPE type)
+void submitDrawQueue()
 {
-	if (!mesh.textures)
+	if (DrawQueue.empty())
 		return;
-	if (irr_driver->getPhase() == 0)
-		drawFirstPass(mesh, type);
+
+	DrawQueueKeys.resize(DrawQueue.size());
+	for (unsigned i = 0; i < DrawQueue.size(); i++)
+		DrawQueueKeys[i].Draw = &DrawQueue[i];
+	std::sort(DrawQueueKeys.begin(), DrawQueueKeys.end());
+
+	const bool firstPass = irr_driver->getPhase() == 0;
+	video::IVideoDriver *driver = irr_driver->getVideoDriver();
+	if (firstPass)
+	{
+		driver->setRenderTarget(irr_driver->getRTT(RTT_NORMAL_AND_DEPTH), false, false);
+		glStencilFunc(GL_ALWAYS, 0, ~0);
+		glDepthMask(GL_TRUE);
+	}
 	else
-		drawSecondPass(mesh, type);
+	{
+		driver->setRenderTarget(irr_driver->getRTT(RTT_COLOR), false, false);
+		glDepthMask(GL_FALSE);
+
+		glActiveTexture(GL_TEXTURE1);
+		bindTexture(static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_TMP1))->getOpenGLTextureName());
+		glActiveTexture(GL_TEXTURE2);
+		bindTexture(static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_TMP2))->getOpenGLTextureName());
+		glActiveTexture(GL_TEXTURE3);
+		bindTexture(static_cast<irr::video::COpenGLTexture*>(irr_driver->getRTT(RTT_SSAO))->getOpenGLTextureName());
+		glActiveTexture(GL_TEXTURE0);
+	}
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_ALPHA_TEST);
+	glDisable(GL_BLEND);
 
+	GLuint program = 0, texture = 0, vao = 0;
+	for (unsigned i = 0; i < DrawQueueKeys.size(); i++)
+	{
+		const QueuedDraw &draw = *DrawQueueKeys[i].Draw;
+		if (draw.Program != program)
+		{
+			program = draw.Program;
+			glUseProgram(program);
+			DrawStats.ProgramSwitches++;
+			if (!firstPass)
+				ObjectPass2Shader::setPassUniforms(0, 1, 2, 3);
+		}
+		if (!firstPass && draw.Texture != texture)
+		{
+			texture = draw.Texture;
+			bindTexture(texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		}
+		if (draw.VAO != vao)
+		{
+			vao = draw.VAO;
+			glBindVertexArray(vao);
+			DrawStats.VAOSwitches++;
+		}
+
+		if (firstPass)
+			ObjectPass1Shader::setUniforms(draw.ModelViewProjectionMatrix, draw.TransposeInverseModelView);
+		else
+			ObjectPass2Shader::setUniforms(draw.ModelViewProjectionMatrix);
+		glDrawElements(draw.Mesh->PrimitiveType, draw.Mesh->IndexCount, draw.Mesh->IndexType, 0);
+		DrawStats.DrawCalls++;
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (firstPass)
+	{
+		glStencilFunc(GL_ALWAYS, 1, ~0);
+		driver->setRenderTarget(irr_driver->getMainSetup(), false, false);
+	}
+	else
+		driver->setRenderTarget(irr_driver->getRTT(RTT_COLOR), false, false);
+
+	// Let irrlicht know that the GL state was changed
 	video::SMaterial material;
 	material.MaterialType = irr_driver->getShader(ES_RAIN);
 	material.BlendOperation = video::EBO_NONE;
 	material.ZWriteEnable = true;
 	material.Lighting = false;
-	irr_driver->getVideoDriver()->setMaterial(material);
-	static_cast<irr::video::COpenGLDriver*>(irr_driver->getVideoDriver())->setRenderStates3DMode();
+	driver->setMaterial(material);
+	static_cast<irr::video::COpenGLDriver*>(driver)->setRenderStates3DMode();
+
+	DrawQueue.clear();
+}
+
+void STKMesh::beginRenderQueue()
+{
+	DrawQueueOpen = true;
+}
+
+void STKMesh::flushRenderQueue()
+{
+	submitDrawQueue();
+	DrawQueueOpen = false;
+}
+
+const STKMeshDrawStats &STKMesh::getDrawStats()
+{
+	return DrawStats;
+}
+
+void STKMesh::resetDrawStats()
+{
+	DrawStats.DrawCalls = 0;
+	DrawStats.ProgramSwitches = 0;
+	DrawStats.TextureSwitches = 0;
+	DrawStats.VAOSwitches = 0;
 }
 
 static bool isObject(video::E_MATERIAL_TYPE type)
@@ -329,7 +438,7 @@ void STKMesh::render()
 			if (isObject(material.MaterialType) && !isTransparentPass && !transparent)
 			{
 				initvaostate(GLmeshes[i], material.MaterialType);
-				draw(GLmeshes[i], material.MaterialType);
+				queueDraw(GLmeshes[i], material.MaterialType);
 			}
 			else if (transparent == isTransparentPass)
 			{
@@ -338,4 +447,6 @@ void STKMesh::render()
 			}
 		}
 	}
+	if (!DrawQueueOpen)
+		submitDrawQueue();
 }
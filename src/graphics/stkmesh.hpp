@@ -20,6 +20,15 @@ struct GLMesh {
 	size_t Stride;
 };
 
+/** Number of draw calls and GL state changes of the STKMesh object
+ *  passes, counted since the last call to STKMesh::resetDrawStats(). */
+struct STKMeshDrawStats {
+	unsigned DrawCalls;
+	unsigned ProgramSwitches;
+	unsigned TextureSwitches;
+	unsigned VAOSwitches;
+};
+
 class STKMesh : public irr::scene::CMeshSceneNode
 {
 protected:
@@ -31,6 +40,14 @@ public:
 		const irr::core::vector3df& scale = irr::core::vector3df(1.0f, 1.0f, 1.0f));
 	virtual void render();
 	~STKMesh();
+
+	/** While the render queue is open, render() only queues the object pass
+	 *  draws; flushRenderQueue() sorts them by state and submits them.
+	 *  Otherwise they are submitted immediately. */
+	static void beginRenderQueue();
+	static void flushRenderQueue();
+	static const STKMeshDrawStats &getDrawStats();
+	static void resetDrawStats();
 };
 
 #endif // STKMESH_H
@@ -0,0 +1,189 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/texture_preloader.hpp"
+
+#include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "modes/profile_world.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/time.hpp"
+#include "utils/worker_pool.hpp"
+
+#include <IFileSystem.h>
+#include <IImage.h>
+#include <IReadFile.h>
+#include <IVideoDriver.h>
+
+#include <stdio.h>
+
+TexturePreloader::~TexturePreloader()
+{
+    // Only necessary if load() was not called
+    for(unsigned int i=0; i<m_entries.size(); i++)
+    {
+        if(m_entries[i].m_image)
+            m_entries[i].m_image->drop();
+    }
+}   // ~TexturePreloader
+
+// ----------------------------------------------------------------------------
+/** Adds a texture to the list of textures to load. Textures that are
+ *  already in the texture cache or already in the list are ignored.
+ *  \param full_path Full path of the texture file.
+ */
+void TexturePreloader::addTexture(const std::string &full_path)
+{
+    if(full_path.size()==0) return;
+
+    io::IFileSystem *fs = irr_driver->getDevice()->getFileSystem();
+    const std::string absolute_path =
+        fs->getAbsolutePath(full_path.c_str()).c_str();
+    if(irr_driver->getVideoDriver()->findTexture(absolute_path.c_str()))
+        return;
+
+    for(unsigned int i=0; i<m_entries.size(); i++)
+    {
+        if(m_entries[i].m_absolute_path==absolute_path) return;
+    }
+
+    Entry entry;
+    entry.m_path          = full_path;
+    entry.m_absolute_path = absolute_path;
+    entry.m_image         = NULL;
+    entry.m_decode_time   = 0;
+    m_entries.push_back(entry);
+}   // addTexture
+
+// ----------------------------------------------------------------------------
+/** Adds the textures of all materials in a materials.xml file. Materials
+ *  that modify the image (premultiply or divide by alpha) are skipped,
+ *  since they are not loaded through the texture cache.
+ *  \param root The root node of the materials file.
+ */
+void TexturePreloader::addMaterials(const XMLNode *root)
+{
+    for(unsigned int i=0; i<root->getNumNodes(); i++)
+    {
+        const XMLNode *node = root->getNode(i);
+        if(!node) continue;
+        std::string adjust_image;
+        node->get("adjust-image", &adjust_image);
+        if(adjust_image.size()>0) continue;
+        std::string name;
+        if(!node->get("name", &name)) continue;
+        addTexture(file_manager->searchTexture(name));
+    }   // for i<root->getNumNodes()
+}   // addMaterials
+
+// ----------------------------------------------------------------------------
+/** Reads and decodes one image. This is called on the worker threads, so
+ *  it must only access the entry with the given index. The file is read
+ *  into memory with stdio, since the irrlicht file system is not thread
+ *  safe, and then decoded from an irrlicht memory file.
+ *  \param index Index of the entry to decode.
+ *  \param data Pointer to the TexturePreloader.
+ */
+void TexturePreloader::decode(int index, void *data)
+{
+    Entry &entry = ((TexturePreloader*)data)->m_entries[index];
+    uint64_t start = StkTime::getMonoTimeUs();
+
+    FILE *file = fopen(entry.m_path.c_str(), "rb");
+    if(!file) return;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if(size<=0)
+    {
+        fclose(file);
+        return;
+    }
+    char *buffer = new char[size];
+    size_t n = fread(buffer, 1, size, file);
+    fclose(file);
+    if(n!=(size_t)size)
+    {
+        delete [] buffer;
+        return;
+    }
+
+    // The memory file takes ownership of the buffer
+    io::IReadFile *mem_file = irr_driver->getDevice()->getFileSystem()
+        ->createMemoryReadFile(buffer, size, entry.m_absolute_path.c_str(),
+                               /*deleteMemoryWhenDropped*/true);
+    entry.m_image =
+        irr_driver->getVideoDriver()->createImageFromFile(mem_file);
+    mem_file->drop();
+    entry.m_decode_time = StkTime::getMonoTimeUs() - start;
+}   // decode
+
+// ----------------------------------------------------------------------------
+/** Loads all textures: decodes them in parallel (if a worker pool exists),
+ *  then creates the textures on the main thread. Textures that could not
+ *  be decoded here are ignored, they will be loaded (and the error
+ *  reported) by the normal getTexture() call later.
+ */
+void TexturePreloader::load()
+{
+    // Without graphics the textures are dummies anyway
+    if(m_entries.size()==0 || ProfileWorld::isNoGraphics())
+        return;
+
+    PROFILER_PUSH_CPU_MARKER("Preload textures", 0x80, 0x80, 0xFF);
+    uint64_t start = StkTime::getMonoTimeUs();
+
+    WorkerPool *pool = WorkerPool::get();
+    if(pool)
+        pool->parallelFor(m_entries.size(), decode, this);
+    else
+    {
+        for(unsigned int i=0; i<m_entries.size(); i++)
+            decode(i, this);
+    }
+    uint64_t decoded = StkTime::getMonoTimeUs();
+
+    video::IVideoDriver *driver = irr_driver->getVideoDriver();
+    uint64_t decode_sum = 0;
+    unsigned int count  = 0;
+    for(unsigned int i=0; i<m_entries.size(); i++)
+    {
+        Entry &entry = m_entries[i];
+        if(!entry.m_image) continue;
+        uint64_t upload_start = StkTime::getMonoTimeUs();
+        driver->addTexture(entry.m_absolute_path.c_str(), entry.m_image);
+        entry.m_image->drop();
+        entry.m_image = NULL;
+        Log::debug("TexturePreloader", "'%s': decode %.2f ms, upload %.2f ms.",
+                   entry.m_path.c_str(), entry.m_decode_time/1000.0f,
+                   (StkTime::getMonoTimeUs()-upload_start)/1000.0f);
+        decode_sum += entry.m_decode_time;
+        count++;
+    }
+    uint64_t end = StkTime::getMonoTimeUs();
+
+    Log::info("TexturePreloader",
+              "Loaded %d textures in %.1f ms: decoding %.1f ms "
+              "(%.1f ms of work on %d threads), upload %.1f ms.",
+              count, (end-start)/1000.0f, (decoded-start)/1000.0f,
+              decode_sum/1000.0f, pool ? pool->getNumThreads()+1 : 1,
+              (end-decoded)/1000.0f);
+    PROFILER_POP_CPU_MARKER();
+}   // load
@@ -0,0 +1,76 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TEXTURE_PRELOADER_HPP
+#define HEADER_TEXTURE_PRELOADER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace irr
+{
+    namespace video { class IImage; }
+}
+using namespace irr;
+
+class XMLNode;
+
+/** Loads a set of textures in two phases: the files are read and decoded
+ *  into images in parallel on the worker pool, then the images are
+ *  uploaded as textures serially on the main thread (the video driver and
+ *  its texture cache are not thread safe). Textures that are loaded this
+ *  way are afterwards found in the texture cache by the normal
+ *  getTexture() calls, e.g. when installing the materials.
+ *  \ingroup graphics
+ */
+class TexturePreloader : public NoCopy
+{
+private:
+    /** Data for each texture to load. */
+    struct Entry
+    {
+        /** The full path as used by the material. */
+        std::string       m_path;
+        /** The absolute path, which is the key in the texture cache. */
+        std::string       m_absolute_path;
+        /** The decoded image, or NULL if decoding failed. */
+        video::IImage    *m_image;
+        /** Time in microseconds to read and decode the file. */
+        uint64_t          m_decode_time;
+    };   // Entry
+
+    /** The list of textures to load. */
+    std::vector<Entry> m_entries;
+
+    static void decode(int index, void *data);
+
+public:
+                 TexturePreloader() {}
+                ~TexturePreloader();
+    void         addTexture(const std::string &full_path);
+    void         addMaterials(const XMLNode *root);
+    void         load();
+    // ------------------------------------------------------------------------
+    /** Returns the number of textures to load. */
+    unsigned int getNumTextures() const { return m_entries.size(); }
+};   // TexturePreloader
+
+#endif
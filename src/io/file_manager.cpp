@@ -186,6 +186,7 @@ FileManager::FileManager()
     checkAndCreateConfigDir();
     checkAndCreateAddonsDir();
     checkAndCreateScreenshotDir();
+    checkAndCreateCacheDir();
 
 #ifdef WIN32
     redirectOutput();
@@ -203,6 +204,8 @@ FileManager::FileManager()
                m_addons_dir.c_str());
     Log::info("FileManager", "Screenshots will be stored in '%s'.",
                m_screenshot_dir.c_str());
+    Log::info("FileManager", "Cached data will be stored in '%s'.",
+               m_cache_dir.c_str());
 
     /** Now search for the path to all needed subdirectories. */
     // ==========================================================
@@ -570,6 +573,15 @@ std::string FileManager::getScreenshotDir() const
     return m_screenshot_dir;
 }   // getScreenshotDir
 
+//-----------------------------------------------------------------------------
+/** Returns the full path of a file in the cache directory.
+ *  \param name Name of the file.
+ */
+std::string FileManager::getCachedFile(const std::string &name) const
+{
+    return m_cache_dir+name;
+}   // getCachedFile
+
 //-----------------------------------------------------------------------------
 /** Returns the full path of a texture file name by searching in all 
  *  directories currently in the texture search path. The difference to
@@ -818,6 +830,31 @@ void FileManager::checkAndCreateScreenshotDir()
 
 }   // checkAndCreateScreenshotDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for cached data. This will set m_cache_dir with
+ *  the appropriate path.
+ */
+void FileManager::checkAndCreateCacheDir()
+{
+#if defined(WIN32) || defined(__CYGWIN__)
+    m_cache_dir  = m_user_config_dir+"cache/";
+#elif defined(__APPLE__)
+    m_cache_dir  = getenv("HOME");
+    m_cache_dir += "/Library/Caches/SuperTuxKart/";
+#else
+    m_cache_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cache_dir += "cache/";
+#endif
+
+    if(!checkAndCreateDirectoryP(m_cache_dir))
+    {
+        Log::error("FileManager", "Can not create cache directory '%s', "
+                   "falling back to '.'.", m_cache_dir.c_str());
+        m_cache_dir = "./";
+    }
+
+}   // checkAndCreateCacheDir
+
 // ----------------------------------------------------------------------------
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
 
@@ -72,6 +72,10 @@ private:
     /** Directory to store screenshots in. */
     std::string       m_screenshot_dir;
 
+    /** Directory to store data in that is computed from the assets and
+     *  can be recreated at any time, e.g. track height maps. */
+    std::string       m_cache_dir;
+
     std::vector<std::string>
                       m_texture_search_path,
                       m_model_search_path,
@@ -88,6 +92,7 @@ private:
     bool              isDirectory(const std::string &path) const;
     void              checkAndCreateAddonsDir();
     void              checkAndCreateScreenshotDir();
+    void              checkAndCreateCacheDir();
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
     std::string       checkAndCreateLinuxDir(const char *env_name,
                                              const char *dir_name,
@@ -106,6 +111,7 @@ public:
     XMLNode          *createXMLTreeFromString(const std::string & content);
 
     std::string       getScreenshotDir() const;
+    std::string       getCachedFile(const std::string &name) const;
     bool              checkAndCreateDirectoryP(const std::string &path);
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
@@ -18,27 +18,283 @@
 
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <map>
 #include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#ifdef WIN32
+#  include <sys/stat.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+/** Version of the binary XML format, increase when the layout changes. */
+static const uint32_t XML_CACHE_FORMAT = 1;
+
+/** Header of a binary XML document. It is followed by the name of the XML
+ *  file, the nodes (in pre-order), the attributes (in the order of the
+ *  nodes), the 8 bit strings and the wide strings. Each part starts at a
+ *  multiple of 4 bytes. */
+struct XMLCacheHeader
+{
+    char     m_magic[4];
+    uint32_t m_format;
+    /** sizeof(wchar_t), which is platform dependent. */
+    uint32_t m_wchar_size;
+    uint32_t m_num_nodes;
+    uint32_t m_num_attributes;
+    uint32_t m_path_size;
+    /** Size of the 8 bit strings in bytes. */
+    uint32_t m_narrow_size;
+    /** Number of wide characters. */
+    uint32_t m_wide_size;
+    /** Modification time and size of the XML file. */
+    int64_t  m_mtime;
+    uint64_t m_source_size;
+};   // XMLCacheHeader
+
+/** A node in a binary document. The attributes of a node follow the
+ *  attributes of the previous node, and the children follow the node. */
+struct XMLCacheNode
+{
+    /** Offset of the name in the 8 bit strings. */
+    uint32_t m_name;
+    uint32_t m_num_attributes;
+    uint32_t m_num_children;
+};   // XMLCacheNode
+
+/** An attribute in a binary document. */
+struct XMLCacheAttribute
+{
+    /** Offsets of the name and value in the 8 bit strings. */
+    uint32_t m_name;
+    uint32_t m_value;
+    /** Offset of the value in the wide strings. */
+    uint32_t m_wide_value;
+};   // XMLCacheAttribute
+
+/** Pointers to the parts of a binary document. */
+struct XMLNode::Document
+{
+    const XMLCacheNode      *m_nodes;
+    const XMLCacheAttribute *m_attributes;
+    const char              *m_narrow;
+    const wchar_t           *m_wide;
+    const XMLCacheHeader    *m_header;
+};   // Document
+
+/** Rounds a size up to a multiple of 4. */
+static size_t align4(size_t n) { return (n+3) & ~(size_t)3; }
+
+// ----------------------------------------------------------------------------
+/** Converts the elements read by an irrlicht XML reader into a binary
+ *  document. Element and attribute names are only stored once.
+ */
+class XMLBuilder
+{
+private:
+    std::vector<XMLCacheNode>       m_nodes;
+    std::vector<XMLCacheAttribute>  m_attributes;
+    std::string                     m_narrow;
+    std::vector<wchar_t>            m_wide;
+    std::map<std::string, uint32_t> m_names;
+
+    // ------------------------------------------------------------------------
+    uint32_t addNarrow(const char *s)
+    {
+        uint32_t offset = (uint32_t)m_narrow.size();
+        m_narrow.append(s, strlen(s)+1);
+        return offset;
+    }   // addNarrow
+    // ------------------------------------------------------------------------
+    uint32_t addName(const char *s)
+    {
+        std::map<std::string, uint32_t>::const_iterator i = m_names.find(s);
+        if(i!=m_names.end()) return i->second;
+        uint32_t offset = addNarrow(s);
+        m_names[s] = offset;
+        return offset;
+    }   // addName
+    // ------------------------------------------------------------------------
+    uint32_t addWide(const wchar_t *s)
+    {
+        uint32_t offset = (uint32_t)m_wide.size();
+        m_wide.insert(m_wide.end(), s, s+wcslen(s)+1);
+        return offset;
+    }   // addWide
+
+public:
+    // ------------------------------------------------------------------------
+    /** Adds the current element of the reader, and all its children. */
+    void readElement(io::IXMLReader *xml)
+    {
+        const unsigned int index = m_nodes.size();
+        XMLCacheNode node;
+        node.m_name           = addName(core::stringc(xml->getNodeName())
+                                        .c_str());
+        node.m_num_attributes = xml->getAttributeCount();
+        node.m_num_children   = 0;
+        m_nodes.push_back(node);
+
+        for(unsigned int i=0; i<node.m_num_attributes; i++)
+        {
+            XMLCacheAttribute a;
+            const wchar_t *value = xml->getAttributeValue(i);
+            a.m_name       = addName(core::stringc(xml->getAttributeName(i))
+                                     .c_str());
+            a.m_value      = addNarrow(core::stringc(value).c_str());
+            a.m_wide_value = addWide(value);
+            m_attributes.push_back(a);
+        }   // for i
+
+        // If no children, we are done
+        if(xml->isEmptyElement())
+            return;
+
+        while(xml->read())
+        {
+            switch (xml->getNodeType())
+            {
+            case io::EXN_ELEMENT:
+                m_nodes[index].m_num_children++;
+                readElement(xml);
+                break;
+            case io::EXN_ELEMENT_END:
+                // End of this element found.
+                return;
+            default: break;   // Ignore all other types
+            }   // switch
+        }   // while
+    }   // readElement
+
+    // ------------------------------------------------------------------------
+    /** Creates the binary document.
+     *  \param path Name of the XML file.
+     *  \param mtime Modification time of the XML file.
+     *  \param source_size Size of the XML file.
+     *  \param size On return the size of the document.
+     */
+    char *createBuffer(const std::string &path, int64_t mtime,
+                       uint64_t source_size, size_t *size)
+    {
+        // Make sure that the blocks are not empty (and zero terminated)
+        if(m_narrow.size()==0) m_narrow.push_back(0);
+        if(m_wide.size()==0)   m_wide.push_back(0);
+
+        XMLCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.m_magic, "STKX", 4);
+        header.m_format         = XML_CACHE_FORMAT;
+        header.m_wchar_size     = sizeof(wchar_t);
+        header.m_num_nodes      = m_nodes.size();
+        header.m_num_attributes = m_attributes.size();
+        header.m_path_size      = path.size();
+        header.m_narrow_size    = m_narrow.size();
+        header.m_wide_size      = m_wide.size();
+        header.m_mtime          = mtime;
+        header.m_source_size    = source_size;
+
+        *size = sizeof(header) + align4(path.size())
+              + m_nodes.size()*sizeof(XMLCacheNode)
+              + m_attributes.size()*sizeof(XMLCacheAttribute)
+              + align4(m_narrow.size()) + m_wide.size()*sizeof(wchar_t);
+        char *buffer = new char[*size];
+        memset(buffer, 0, *size);
+        char *p = buffer;
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        memcpy(p, path.c_str(), path.size());
+        p += align4(path.size());
+        if(m_nodes.size()>0)
+            memcpy(p, &m_nodes[0], m_nodes.size()*sizeof(XMLCacheNode));
+        p += m_nodes.size()*sizeof(XMLCacheNode);
+        if(m_attributes.size()>0)
+            memcpy(p, &m_attributes[0],
+                   m_attributes.size()*sizeof(XMLCacheAttribute));
+        p += m_attributes.size()*sizeof(XMLCacheAttribute);
+        memcpy(p, m_narrow.c_str(), m_narrow.size());
+        p += align4(m_narrow.size());
+        memcpy(p, &m_wide[0], m_wide.size()*sizeof(wchar_t));
+        return buffer;
+    }   // createBuffer
+};   // XMLBuilder
+
+// ----------------------------------------------------------------------------
+/** Creates an empty node, used for the children of a root node. */
+XMLNode::XMLNode()
+{
+    m_attributes     = NULL;
+    m_num_attributes = 0;
+    m_buffer         = NULL;
+    m_buffer_size    = 0;
+    m_buffer_mapped  = false;
+    m_all_attributes = NULL;
+}   // XMLNode
 
+// ----------------------------------------------------------------------------
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
-    m_file_name = "[unknown]";
+    m_file_name      = "[unknown]";
+    m_attributes     = NULL;
+    m_num_attributes = 0;
+    m_buffer         = NULL;
+    m_buffer_size    = 0;
+    m_buffer_mapped  = false;
+    m_all_attributes = NULL;
 
     while(xml->getNodeType()!=io::EXN_ELEMENT && xml->read());
-    readXML(xml);
+    XMLBuilder builder;
+    if(xml->getNodeType()==io::EXN_ELEMENT)
+        builder.readElement(xml);
+    size_t size;
+    char *buffer = builder.createBuffer(m_file_name, 0, 0, &size);
+    setBuffer(buffer, size, /*mapped*/false);
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
-/** Reads a XML file and convert it into a XMLNode tree.
+/** Reads a XML file and convert it into a XMLNode tree. If the binary
+ *  cache of this file is up to date, it is used instead of the XML file.
+ *  Files in the user config directory are not cached, since they can be
+ *  rewritten several times a second.
  *  \param filename Name of the XML file to read.
  */
 XMLNode::XMLNode(const std::string &filename)
 {
-    m_file_name = filename;
+    m_file_name      = filename;
+    m_attributes     = NULL;
+    m_num_attributes = 0;
+    m_buffer         = NULL;
+    m_buffer_size    = 0;
+    m_buffer_mapped  = false;
+    m_all_attributes = NULL;
+
+    struct stat st;
+    const bool use_cache = file_manager &&
+        !StringUtils::startsWith(filename,
+                                 file_manager->getUserConfigFile("")) &&
+        stat(filename.c_str(), &st)==0;
+    std::string cache_name;
+    if(use_cache)
+    {
+        // FNV-1a hash of the file name
+        uint64_t hash = 14695981039346656037ULL;
+        for(unsigned int i=0; i<filename.size(); i++)
+            hash = (hash ^ (unsigned char)filename[i]) * 1099511628211ULL;
+        char s[32];
+        sprintf(s, "xml-%08x%08x.bin", (unsigned int)(hash>>32),
+                (unsigned int)(hash & 0xffffffff));
+        cache_name = file_manager->getCachedFile(s);
+        if(loadCache(cache_name, st.st_mtime, st.st_size))
+            return;
+    }
 
     io::IXMLReader *xml = file_manager->createXMLReader(filename);
     
@@ -47,6 +303,7 @@ XMLNode::XMLNode(const std::string &filename)
         throw std::runtime_error("Cannot find file "+filename);
     }
 
+    XMLBuilder builder;
     bool is_first_element = true;
     while(xml->read())
     {
@@ -59,8 +316,12 @@ XMLNode::XMLNode(const std::string &filename)
                     fprintf(stderr,
                             "More than one root element in '%s' - ignored.\n",
                             filename.c_str());
+                    // Skip the element (and its children)
+                    XMLBuilder ignored;
+                    ignored.readElement(xml);
+                    break;
                 }
-                readXML(xml);
+                builder.readElement(xml);
                 is_first_element = false;
                 break;
             }
@@ -72,6 +333,33 @@ XMLNode::XMLNode(const std::string &filename)
         }   // switch
     }   // while
     xml->drop();
+
+    size_t size;
+    char *buffer = builder.createBuffer(filename,
+                                        use_cache ? st.st_mtime : 0,
+                                        use_cache ? st.st_size  : 0,
+                                        &size);
+    if(use_cache)
+    {
+        // Another process might have the old file memory mapped, so it must
+        // not be overwritten. Instead a new file is written and renamed.
+        const std::string tmp_name = cache_name+".tmp";
+        FILE *f = fopen(tmp_name.c_str(), "wb");
+        bool ok = f && fwrite(buffer, size, 1, f)==1;
+        if(f) fclose(f);
+#ifdef WIN32
+        // On windows rename fails if the destination exists
+        if(ok)
+            remove(cache_name.c_str());
+#endif
+        if(!ok || rename(tmp_name.c_str(), cache_name.c_str())!=0)
+        {
+            Log::warn("XMLNode", "Can't write XML cache '%s'.",
+                      cache_name.c_str());
+            remove(tmp_name.c_str());
+        }
+    }
+    setBuffer(buffer, size, /*mapped*/false);
 }   // XMLNode
 
 // ----------------------------------------------------------------------------
@@ -83,50 +371,216 @@ XMLNode::~XMLNode()
         delete m_nodes[i];
     }
     m_nodes.clear();
+    freeBuffer();
 }   // ~XMLNode
 
 // ----------------------------------------------------------------------------
-/** Stores all attributes, and reads in all children.
- *  \param xml The XML reader.
+/** Frees the binary document (only used in the root node). */
+void XMLNode::freeBuffer()
+{
+    delete [] m_all_attributes;
+    m_all_attributes = NULL;
+    if(!m_buffer)
+        return;
+#ifndef WIN32
+    if(m_buffer_mapped)
+        munmap(m_buffer, m_buffer_size);
+    else
+#endif
+        delete [] m_buffer;
+    m_buffer      = NULL;
+    m_buffer_size = 0;
+}   // freeBuffer
+
+// ----------------------------------------------------------------------------
+/** Loads the binary document from a cache file, and creates the node tree
+ *  from it. Returns false if the file does not exist, or is not up to date.
+ *  \param cache_name Name of the cache file.
+ *  \param mtime Modification time of the XML file.
+ *  \param size Size of the XML file.
  */
-void XMLNode::readXML(io::IXMLReader *xml)
+bool XMLNode::loadCache(const std::string &cache_name, int64_t mtime,
+                        uint64_t size)
 {
-    m_name = std::string(core::stringc(xml->getNodeName()).c_str());
+    XMLCacheHeader header;
+    FILE *f = fopen(cache_name.c_str(), "rb");
+    if(!f)
+        return false;
+    bool ok = fread(&header, sizeof(header), 1, f)==1;
+    fclose(f);
+
+    struct stat st;
+    ok = ok && stat(cache_name.c_str(), &st)==0      &&
+         memcmp(header.m_magic, "STKX", 4)==0         &&
+         header.m_format      == XML_CACHE_FORMAT     &&
+         header.m_wchar_size  == sizeof(wchar_t)      &&
+         header.m_mtime       == mtime                &&
+         header.m_source_size == size                 &&
+         header.m_path_size   == m_file_name.size()   &&
+         (size_t)st.st_size   >= sizeof(header)+align4(header.m_path_size);
+    if(!ok)
+    {
+        Log::debug("XMLNode", "XML cache of '%s' is missing or outdated.",
+                   m_file_name.c_str());
+        return false;
+    }
 
-    for(unsigned int i=0; i<xml->getAttributeCount(); i++)
+    const size_t buffer_size = (size_t)st.st_size;
+    char *buffer = NULL;
+#ifdef WIN32
+    const bool mapped = false;
+    buffer = new char[buffer_size];
+    f = fopen(cache_name.c_str(), "rb");
+    ok = f && fread(buffer, buffer_size, 1, f)==1;
+    if(f) fclose(f);
+    if(!ok)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
-    }   // for i
+        delete [] buffer;
+        buffer = NULL;
+    }
+#else
+    const bool mapped = true;
+    int fd = open(cache_name.c_str(), O_RDONLY);
+    if(fd>=0)
+    {
+        void *p = mmap(NULL, buffer_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(p!=MAP_FAILED)
+            buffer = (char*)p;
+    }
+#endif
+    if(!buffer)
+        return false;
 
-    // If no children, we are done
-    if(xml->isEmptyElement())
-        return;
+    // Make sure the file name matches (and not just its hash)
+    if(memcmp(buffer+sizeof(header), m_file_name.c_str(),
+              m_file_name.size())!=0)
+    {
+        m_buffer        = buffer;
+        m_buffer_size   = buffer_size;
+        m_buffer_mapped = mapped;
+        freeBuffer();
+        ok = false;
+    }
+    else
+        ok = setBuffer(buffer, buffer_size, mapped);
+    if(!ok)
+    {
+        Log::warn("XMLNode", "Invalid XML cache '%s' for '%s'.",
+                  cache_name.c_str(), m_file_name.c_str());
+        return false;
+    }
+    return true;
+}   // loadCache
 
-    /** Read all children elements. */
-    while(xml->read())
+// ----------------------------------------------------------------------------
+/** Creates the node tree from a binary document. This node takes ownership
+ *  of the buffer, it is freed if the document is invalid.
+ *  \param buffer The binary document.
+ *  \param size Size of the buffer.
+ *  \param mapped True if the buffer is memory mapped, otherwise it was
+ *         allocated with new.
+ *  \return True if the document is valid.
+ */
+bool XMLNode::setBuffer(char *buffer, size_t size, bool mapped)
+{
+    m_buffer        = buffer;
+    m_buffer_size   = size;
+    m_buffer_mapped = mapped;
+
+    Document doc;
+    doc.m_header = (const XMLCacheHeader*)buffer;
+    const XMLCacheHeader &h = *doc.m_header;
+    size_t offset = sizeof(XMLCacheHeader) + align4(h.m_path_size);
+    doc.m_nodes = (const XMLCacheNode*)(buffer+offset);
+    offset += h.m_num_nodes*sizeof(XMLCacheNode);
+    doc.m_attributes = (const XMLCacheAttribute*)(buffer+offset);
+    offset += h.m_num_attributes*sizeof(XMLCacheAttribute);
+    doc.m_narrow = buffer+offset;
+    offset += align4(h.m_narrow_size);
+    doc.m_wide = (const wchar_t*)(buffer+offset);
+    offset += h.m_wide_size*sizeof(wchar_t);
+
+    // Since all offsets are checked in readBinary, all strings are zero
+    // terminated if the last character of each block is zero.
+    bool ok = offset==size && h.m_narrow_size>0 && h.m_wide_size>0 &&
+              doc.m_narrow[h.m_narrow_size-1]==0 &&
+              doc.m_wide[h.m_wide_size-1]==0;
+    if(ok && h.m_num_nodes>0)
     {
-        switch (xml->getNodeType())
-        {
-        case io::EXN_ELEMENT:
-            {
-                XMLNode* n = new XMLNode(xml);
-                n->m_file_name = m_file_name;
-                m_nodes.push_back(n);
-                break;
-            }
-        case io::EXN_ELEMENT_END:
-            // End of this element found.
-            return;
-            break;
-        case io::EXN_UNKNOWN:            break;
-        case io::EXN_COMMENT:            break;
-        case io::EXN_TEXT:               break;
-        default:                         break;
-        }   // switch
-    }   // while
-}   // readXML
+        m_all_attributes = new Attribute[h.m_num_attributes>0
+                                         ? h.m_num_attributes : 1];
+        unsigned int node = 0, attribute = 0;
+        ok = readBinary(doc, &node, &attribute) &&
+             node==h.m_num_nodes && attribute==h.m_num_attributes;
+    }
+    if(!ok)
+    {
+        for(unsigned int i=0; i<m_nodes.size(); i++)
+            delete m_nodes[i];
+        m_nodes.clear();
+        m_name.clear();
+        m_attributes     = NULL;
+        m_num_attributes = 0;
+        freeBuffer();
+    }
+    return ok;
+}   // setBuffer
+
+// ----------------------------------------------------------------------------
+/** Sets the name and attributes of this node from a node of a binary
+ *  document, and creates all children.
+ *  \param doc The binary document.
+ *  \param node Index of the node to read, on return the index of the next
+ *         node after all children.
+ *  \param attribute Index of the first attribute of this node, on return
+ *         the index of the first attribute of the next node.
+ *  \return False if the document is invalid.
+ */
+bool XMLNode::readBinary(const Document &doc, unsigned int *node,
+                         unsigned int *attribute)
+{
+    const XMLCacheHeader &h = *doc.m_header;
+    if(*node>=h.m_num_nodes)
+        return false;
+    const XMLCacheNode &n = doc.m_nodes[*node];
+    if(n.m_name>=h.m_narrow_size ||
+       n.m_num_attributes > h.m_num_attributes - *attribute)
+        return false;
+    m_name = doc.m_narrow + n.m_name;
+
+    // All attributes of the tree are stored in the root node
+    Attribute *attributes = m_all_attributes + *attribute;
+    m_attributes     = attributes;
+    m_num_attributes = n.m_num_attributes;
+    for(unsigned int i=0; i<n.m_num_attributes; i++)
+    {
+        const XMLCacheAttribute &a = doc.m_attributes[*attribute+i];
+        if(a.m_name>=h.m_narrow_size || a.m_value>=h.m_narrow_size ||
+           a.m_wide_value>=h.m_wide_size)
+            return false;
+        attributes[i].m_name       = doc.m_narrow + a.m_name;
+        attributes[i].m_value      = doc.m_narrow + a.m_value;
+        attributes[i].m_wide_value = doc.m_wide   + a.m_wide_value;
+    }
+    (*attribute) += n.m_num_attributes;
+    (*node)++;
+
+    m_nodes.reserve(n.m_num_children);
+    for(unsigned int i=0; i<n.m_num_children; i++)
+    {
+        XMLNode *child = new XMLNode();
+        child->m_file_name      = m_file_name;
+        // The children use the attribute array of the root
+        child->m_all_attributes = m_all_attributes;
+        m_nodes.push_back(child);
+        bool ok = child->readBinary(doc, node, attribute);
+        child->m_all_attributes = NULL;
+        if(!ok)
+            return false;
+    }
+    return true;
+}   // readBinary
 
 // ----------------------------------------------------------------------------
 /** Returns the i.th node.
@@ -166,6 +620,22 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
     }
 }   // getNode
 
+// ----------------------------------------------------------------------------
+/** Returns the attribute with the given name, or NULL if it is not defined.
+ *  If an attribute is defined more than once, the last one is used.
+ *  \param attribute Name of the attribute.
+ */
+const XMLNode::Attribute *XMLNode::getAttribute(const std::string &attribute)
+                                                                         const
+{
+    for(int i=(int)m_num_attributes-1; i>=0; i--)
+    {
+        if(attribute==m_attributes[i].m_name)
+            return &m_attributes[i];
+    }
+    return NULL;
+}   // getAttribute
+
 // ----------------------------------------------------------------------------
 /** If 'attribute' was defined, set 'value' to the value of the
 *   attribute and return 1, otherwise return 0 and do not change value.
@@ -174,21 +644,17 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
+    *value = a->m_value;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
+    *value = a->m_wide_value;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
@@ -300,13 +766,13 @@ int XMLNode::get(const std::string &attribute, video::SColorf *color) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, int32_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
 
-    if (!StringUtils::parseString<int>(s, value))
+    if (!StringUtils::parseString<int>(a->m_value, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                a->m_value, attribute.c_str(), m_name.c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -316,13 +782,13 @@ int XMLNode::get(const std::string &attribute, int32_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, int64_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
 
-    if (!StringUtils::parseString<int64_t>(s, value))
+    if (!StringUtils::parseString<int64_t>(a->m_value, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                a->m_value, attribute.c_str(), m_name.c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -333,13 +799,13 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, uint16_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
 
-    if (!StringUtils::parseString<uint16_t>(s, value))
+    if (!StringUtils::parseString<uint16_t>(a->m_value, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                a->m_value, attribute.c_str(), m_name.c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -349,13 +815,13 @@ int XMLNode::get(const std::string &attribute, uint16_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, uint32_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
 
-    if (!StringUtils::parseString<unsigned int>(s, value))
+    if (!StringUtils::parseString<unsigned int>(a->m_value, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                a->m_value, attribute.c_str(), m_name.c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -365,13 +831,13 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, float *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
 
-    if (!StringUtils::parseString<float>(s, value))
+    if (!StringUtils::parseString<float>(a->m_value, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                a->m_value, attribute.c_str(), m_name.c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -381,12 +847,11 @@ int XMLNode::get(const std::string &attribute, float *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, bool *value) const
 {
-    std::string s;
-
-    // FIXME: for some reason, missing attributes don't trigger that if???
-    if(!get(attribute, &s)) return 0;
+    const Attribute *a = getAttribute(attribute);
+    if(!a) return 0;
+    const char *s = a->m_value;
     *value = s[0]=='T' || s[0]=='t' || s[0]=='Y' || s[0]=='y' ||
-             s=="#t"   || s   =="#T" || s=="1";
+             strcmp(s, "#t")==0 || strcmp(s, "#T")==0 || strcmp(s, "1")==0;
     return 1;
 }   // get(bool)
 
@@ -41,22 +41,60 @@ class Vec3;
 
 /**
   * \brief utility class used to parse XML files
+  * An XML file is first converted into a compact binary document, in which
+  * all names and attribute values are stored in one buffer, so no memory
+  * is allocated per attribute. The binary document of a data file is saved
+  * in the cache directory, and used instead of the XML file as long as the
+  * modification time and size of the XML file do not change. The cache file
+  * is memory mapped if possible.
   * \ingroup io
   */
 class XMLNode : public NoCopy
 {
 private:
+    /** An attribute. The strings are stored in the buffer of the root. */
+    struct Attribute
+    {
+        const char    *m_name;
+        /** The value converted to 8 bit characters. */
+        const char    *m_value;
+        const wchar_t *m_wide_value;
+    };   // Attribute
+
+    /** Pointers to the various parts of a binary document, defined in
+     *  xml_node.cpp. */
+    struct Document;
+
     /** Name of this element. */
     std::string                          m_name;
-    /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
+    /** List of all attributes, points into m_all_attributes of the root. */
+    const Attribute                     *m_attributes;
+    /** Number of attributes of this element. */
+    unsigned int                         m_num_attributes;
     /** List of all sub nodes. */
     std::vector<XMLNode *>               m_nodes;
 
-    void readXML(io::IXMLReader *xml);
-
     std::string                          m_file_name;
 
+    /** Only used in the root node: the binary document all strings point
+     *  to, either allocated or memory mapped. */
+    char                                *m_buffer;
+    /** Size of m_buffer. */
+    size_t                               m_buffer_size;
+    /** True if m_buffer is memory mapped. */
+    bool                                 m_buffer_mapped;
+    /** Only used in the root node: the attributes of all nodes. */
+    Attribute                           *m_all_attributes;
+
+         XMLNode();
+    bool setBuffer(char *buffer, size_t size, bool mapped);
+    bool readBinary(const Document &doc, unsigned int *node,
+                    unsigned int *attribute);
+    bool loadCache(const std::string &cache_name, int64_t mtime,
+                   uint64_t size);
+    void freeBuffer();
+    const Attribute *getAttribute(const std::string &attribute) const;
+
 public:
          LEAK_CHECK();
          XMLNode(io::IXMLReader *xml);
@@ -42,6 +42,7 @@ std::vector<scene::IMesh *> ItemManager::m_item_mesh;
 std::vector<scene::IMesh *> ItemManager::m_item_lowres_mesh;
 std::vector<video::SColorf> ItemManager::m_glow_color;
 ItemManager *               ItemManager::m_item_manager = NULL;
+const float                 ItemManager::GRID_CELL_SIZE = 4.0f;
 
 
 //-----------------------------------------------------------------------------
@@ -155,6 +156,8 @@ ItemManager::ItemManager()
         m_switch_to.push_back((Item::ItemType)i);
     setSwitchItems(stk_config->m_switch_items);
 
+    m_item_grid.resize(GRID_BUCKETS);
+
     if(QuadGraph::get())
     {
         m_items_in_quads = new std::vector<AllItemTypes>;
@@ -217,6 +220,8 @@ void ItemManager::insertItem(Item *item)
         m_all_items.push_back(item);
     item->setItemId(index);
 
+    getGridItems(item).push_back(item);
+
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
     if(m_items_in_quads)
@@ -233,6 +238,31 @@ void ItemManager::insertItem(Item *item)
     }   // if m_items_in_quads
 }   // insertItem
 
+//-----------------------------------------------------------------------------
+/** Returns the bucket of the item grid that stores the given cell.
+ *  \param cell_x, cell_z Coordinates of the cell.
+ */
+unsigned int ItemManager::getGridBucket(int cell_x, int cell_z) const
+{
+    unsigned int h = (unsigned int)cell_x*73856093u
+                   ^ (unsigned int)cell_z*19349663u;
+    return h & (GRID_BUCKETS-1);
+}   // getGridBucket
+
+//-----------------------------------------------------------------------------
+/** Returns the list of the item grid (or m_large_items) that contains the
+ *  given item.
+ */
+ItemManager::AllItemTypes &ItemManager::getGridItems(const Item *item)
+{
+    if(item->getHitDistance2() > GRID_CELL_SIZE*GRID_CELL_SIZE)
+        return m_large_items;
+    const Vec3 &xyz = item->getXYZ();
+    int cell_x = (int)floorf(xyz.getX()/GRID_CELL_SIZE);
+    int cell_z = (int)floorf(xyz.getZ()/GRID_CELL_SIZE);
+    return m_item_grid[getGridBucket(cell_x, cell_z)];
+}   // getGridItems
+
 //-----------------------------------------------------------------------------
 /** Creates a new item.
  *  \param type Type of the item.
@@ -261,6 +291,8 @@ Item* ItemManager::newItem(Item::ItemType type, const Vec3& xyz,
         item->switchTo(new_type, m_item_mesh[(int)new_type],
                        m_item_lowres_mesh[(int)new_type]);
     }
+    if(hasGlow(item->getType()))
+        m_glowing_items.push_back(item);
     return item;
 }   // newItem
 
@@ -300,33 +332,56 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
+    // Items are stored in a grid with cells that are at least as large as
+    // the hit distance of the items in it, so only items in the cell of the
+    // kart and the 8 adjacent cells can be hit. Different cells can share
+    // the same bucket, so each bucket is only tested once.
+    const Vec3 &xyz = kart->getXYZ();
+    int cell_x = (int)floorf(xyz.getX()/GRID_CELL_SIZE);
+    int cell_z = (int)floorf(xyz.getZ()/GRID_CELL_SIZE);
+    unsigned int buckets[9];
+    unsigned int num_buckets = 0;
+    for(int dx=-1; dx<=1; dx++)
+    {
+        for(int dz=-1; dz<=1; dz++)
+        {
+            unsigned int b = getGridBucket(cell_x+dx, cell_z+dz);
+            bool found = false;
+            for(unsigned int i=0; i<num_buckets && !found; i++)
+                found = buckets[i]==b;
+            if(found) continue;
+            buckets[num_buckets++] = b;
+            checkItemHit(kart, m_item_grid[b]);
+        }   // for dz
+    }   // for dx
+    checkItemHit(kart, m_large_items);
+}   // checkItemHit
 
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+//-----------------------------------------------------------------------------
+/** Checks if any of the given items was collected by the given kart.
+ *  \param kart Pointer to the kart.
+ *  \param items The items to test.
+ */
+void ItemManager::checkItemHit(AbstractKart* kart, const AllItemTypes &items)
+{
+    for(unsigned int i=0; i<items.size(); i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        Item *item = items[i];
+        if(item->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if(item->hitKart(kart->getXYZ(), kart))
         {
             // if we're not playing online, pick the item.
             if (!NetworkWorld::getInstance()->isRunning())
-                collectedItem(*i, kart);
+                collectedItem(item, kart);
             else if (NetworkManager::getInstance()->isServer())
             {
-                collectedItem(*i, kart);
-                NetworkWorld::getInstance()->collectedItem(*i, kart);
+                collectedItem(item, kart);
+                NetworkWorld::getInstance()->collectedItem(item, kart);
             }
         }   // if hit
-    }   // for m_all_items
+    }   // for items
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -344,6 +399,7 @@ void ItemManager::reset()
             if(*i) (*i)->switchBack();
         }
         m_switch_time = -1.0f;
+        updateGlowingItems();
 
     }
 
@@ -391,6 +447,7 @@ void ItemManager::update(float dt)
             {
                 if(*i) (*i)->switchBack();
             }   // for m_all_items
+            updateGlowingItems();
         }   // m_switch_time < 0
     }   // m_switch_time>=0
 
@@ -409,12 +466,18 @@ void ItemManager::update(float dt)
 }   // update
 
 //-----------------------------------------------------------------------------
-/** Removes an items from the items-in-quad list, from the list of all
- *  items, and then frees the item itself.
+/** Removes an items from the item grid, the items-in-quad list, from the
+ *  list of all items, and then frees the item itself.
  *  \param The item to delete.
  */
 void ItemManager::deleteItem(Item *item)
 {
+    AllItemTypes &grid_items = getGridItems(item);
+    AllItemTypes::iterator grid_it = std::find(grid_items.begin(),
+                                               grid_items.end(), item);
+    assert(grid_it!=grid_items.end());
+    grid_items.erase(grid_it);
+
     // First check if the item needs to be removed from the items-in-quad list
     if(m_items_in_quads)
     {
@@ -430,11 +493,31 @@ void ItemManager::deleteItem(Item *item)
         items.erase(it);
     }   // if m_items_in_quads
 
+    AllItemTypes::iterator glow_it = std::find(m_glowing_items.begin(),
+                                               m_glowing_items.end(), item);
+    if(glow_it!=m_glowing_items.end())
+        m_glowing_items.erase(glow_it);
+
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
 }   // delete item
 
+//-----------------------------------------------------------------------------
+/** Rebuilds the list of glowing items. This is called after items were
+ *  switched, since this changes the type (and therefore the glow) of items.
+ */
+void ItemManager::updateGlowingItems()
+{
+    m_glowing_items.clear();
+    for(AllItemTypes::iterator i =m_all_items.begin();
+        i!=m_all_items.end();  i++)
+    {
+        if(*i && hasGlow((*i)->getType()))
+            m_glowing_items.push_back(*i);
+    }
+}   // updateGlowingItems
+
 //-----------------------------------------------------------------------------
 /** Switches all items: boxes become bananas and vice versa for a certain
  *  amount of time (as defined in stk_config.xml.
@@ -461,6 +544,7 @@ void ItemManager::switchItems()
         else
             (*i)->switchBack();
     }   // for m_all_items
+    updateGlowingItems();
 
     // if the items are already switched (m_switch_time >=0)
     // then switch back, and set m_switch_time to -1 to indicate
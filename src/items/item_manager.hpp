@@ -64,6 +64,14 @@ public:
     static video::SColorf& getGlowColor(Item::ItemType type)
                                       { return m_glow_color[type]; }
     // ------------------------------------------------------------------------
+    /** Returns true if items of the given type glow. */
+    static bool hasGlow(Item::ItemType type)
+    {
+        return type==Item::ITEM_NITRO_BIG || type==Item::ITEM_NITRO_SMALL ||
+               type==Item::ITEM_BONUS_BOX || type==Item::ITEM_BANANA      ||
+               type==Item::ITEM_BUBBLEGUM;
+    }   // hasGlow
+    // ------------------------------------------------------------------------
     /** Return an instance of the item manager (it does not automatically
      *  create one, call create for that). */
     static ItemManager *get() {
@@ -82,6 +90,28 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Size of a cell of the item grid. Items whose hit distance is larger
+     *  than this are stored in m_large_items instead of the grid. */
+    static const float GRID_CELL_SIZE;
+
+    /** Number of buckets of the item grid (must be a power of 2). */
+    static const unsigned int GRID_BUCKETS = 1024;
+
+    /** A uniform grid in the XZ plane used to only test items close to a
+     *  kart in checkItemHit. The (unbounded) grid cells are hashed into
+     *  GRID_BUCKETS buckets, so it does not depend on the track size. Items
+     *  never move, so an item only needs to be added when it is created
+     *  and removed when it is deleted. */
+    std::vector<AllItemTypes> m_item_grid;
+
+    /** Items with a hit distance too large for the grid (e.g. triggers). */
+    AllItemTypes m_large_items;
+
+    /** All items that have a glow effect (see hasGlow). This list is
+     *  updated when items are added, removed or switched, so the renderer
+     *  does not need to check all items each frame. */
+    AllItemTypes m_glowing_items;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -91,6 +121,10 @@ private:
 
     void  insertItem(Item *item);
     void  deleteItem(Item *item);
+    unsigned int getGridBucket(int cell_x, int cell_z) const;
+    AllItemTypes &getGridItems(const Item *item);
+    void  checkItemHit(AbstractKart *kart, const AllItemTypes &items);
+    void  updateGlowingItems();
 
     // Make those private so only create/destroy functions can call them.
                    ItemManager();
@@ -119,6 +153,9 @@ public:
     /** Returns a pointer to the n-th item. */
     Item* getItem(unsigned int n)  { return m_all_items[n]; };
     // ------------------------------------------------------------------------
+    /** Returns all items that currently have a glow effect. */
+    const AllItemTypes& getGlowingItems() const { return m_glowing_items; }
+    // ------------------------------------------------------------------------
     /** Returns a reference to the array of all items on the specified quad.
      */
     const AllItemTypes& getItemsInQuads(unsigned int n) const
@@ -88,6 +88,17 @@ void ProjectileManager::update(float dt)
     }   // while hit effect != end
 }   // update
 
+// -----------------------------------------------------------------------------
+/** Interpolates the graphical position of all projectiles between the last
+ *  two simulation steps.
+ *  \param alpha Fraction of a simulation step since the last step.
+ */
+void ProjectileManager::updateGraphics(float alpha)
+{
+    for(unsigned int i=0; i<m_active_projectiles.size(); i++)
+        m_active_projectiles[i]->interpolateGraphics(alpha);
+}   // updateGraphics
+
 // -----------------------------------------------------------------------------
 /** Updates all rockets on the server (or no networking). */
 void ProjectileManager::updateServer(float dt)
@@ -60,6 +60,7 @@ public:
     void             loadData         ();
     void             cleanup          ();
     void             update           (float dt);
+    void             updateGraphics   (float alpha);
     Flyable*         newProjectile    (AbstractKart *kart,
                                        PowerupManager::PowerupType type);
     void             Deactivate       (Flyable *p) {}
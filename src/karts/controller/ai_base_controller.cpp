@@ -89,6 +89,8 @@ AIBaseController::AIBaseController(AbstractKart *kart,
                 : Controller(kart, player)
 {
     m_kart          = kart;
+    m_path_version  = 0;
+    m_prepared_valid= false;
     m_kart_length   = m_kart->getKartLength();
     m_kart_width    = m_kart->getKartWidth();
     m_ai_properties =
@@ -161,6 +163,7 @@ void  AIBaseController::newLap(int lap)
  */
 void AIBaseController::computePath()
 {
+    m_path_version++;
     m_next_node_index.resize(QuadGraph::get()->getNumNodes());
     m_successor_index.resize(QuadGraph::get()->getNumNodes());
     std::vector<unsigned int> next;
@@ -224,27 +227,68 @@ void AIBaseController::update(float dt)
 
     if(QuadGraph::get())
     {
-        // Update the current node:
-        int old_node = m_track_node;
-        if(m_track_node!=QuadGraph::UNKNOWN_SECTOR)
-        {
-            QuadGraph::get()->findRoadSector(m_kart->getXYZ(), &m_track_node,
-                &m_all_look_aheads[m_track_node]);
-        }
-        // If we can't find a proper place on the track, to a broader search
-        // on off-track locations.
-        if(m_track_node==QuadGraph::UNKNOWN_SECTOR)
-        {
-            m_track_node = QuadGraph::get()->findOutOfRoadSector(m_kart->getXYZ());
-        }
-        // IF the AI is off track (or on a branch of the track it did not
-        // select to be on), keep the old position.
-        if(m_track_node==QuadGraph::UNKNOWN_SECTOR ||
-            m_next_node_index[m_track_node]==-1)
-            m_track_node = old_node;
+        // Use the node computed in prepareUpdate if it was computed with
+        // the same input, otherwise search now.
+        const Vec3 &xyz = m_kart->getXYZ();
+        if(m_prepared_valid && m_prepared_xyz==xyz &&
+           m_prepared_old_node==m_track_node &&
+           m_prepared_path_version==m_path_version)
+            m_track_node = m_prepared_node;
+        else
+            m_track_node = findTrackNode(xyz, m_track_node);
     }
+    m_prepared_valid = false;
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Determines the graph node the kart is on, taking the path selected by
+ *  the AI into account.
+ *  \param xyz Position of the kart.
+ *  \param old_node The node the kart was on before.
+ */
+int AIBaseController::findTrackNode(const Vec3 &xyz, int old_node)
+{
+    int node = old_node;
+    if(node!=QuadGraph::UNKNOWN_SECTOR)
+    {
+        QuadGraph::get()->findRoadSector(xyz, &node,
+                                          &m_all_look_aheads[node]);
+    }
+    // If we can't find a proper place on the track, to a broader search
+    // on off-track locations.
+    if(node==QuadGraph::UNKNOWN_SECTOR)
+    {
+        node = QuadGraph::get()->findOutOfRoadSector(xyz);
+    }
+    // IF the AI is off track (or on a branch of the track it did not
+    // select to be on), keep the old position.
+    if(node==QuadGraph::UNKNOWN_SECTOR ||
+        m_next_node_index[node]==-1)
+        node = old_node;
+    return node;
+}   // findTrackNode
+
+//-----------------------------------------------------------------------------
+/** Computes the graph node the kart will be on in update(). This is called
+ *  for all karts in parallel before the karts are updated. The position is
+ *  taken from the motion state, which is what Moveable::update will use.
+ */
+void AIBaseController::prepareUpdate()
+{
+    m_prepared_valid = false;
+    if(!QuadGraph::get() || m_kart->getKartAnimation())
+        return;
+
+    btTransform trans = m_kart->getTrans();
+    if(m_kart->getBody()->getInvMass()!=0)
+        m_kart->getBody()->getMotionState()->getWorldTransform(trans);
+    m_prepared_xyz          = trans.getOrigin();
+    m_prepared_old_node     = m_track_node;
+    m_prepared_path_version = m_path_version;
+    m_prepared_node         = findTrackNode(m_prepared_xyz, m_track_node);
+    m_prepared_valid        = true;
+}   // prepareUpdate
+
 //-----------------------------------------------------------------------------
 /** This is called when the kart crashed with the terrain. This subroutine
  *  tries to detect if the AI is stuck by determining if a certain number
@@ -21,12 +21,12 @@
 
 #include "karts/controller/controller.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/vec3.hpp"
 
 class AIProperties;
 class LinearWorld;
 class QuadGraph;
 class Track;
-class Vec3;
 
 /** A base class for all AI karts. This class basically provides some
  *  common low level functions.
@@ -44,6 +44,24 @@ private:
     *  this kart is stuck and needs to be rescued. */
     bool m_stuck_trigger_rescue;
 
+    /** Incremented each time the path is computed, so that a prepared
+     *  track node can be discarded if the path has changed since. */
+    unsigned int m_path_version;
+
+    /** True if m_prepared_node was computed by prepareUpdate. */
+    bool         m_prepared_valid;
+
+    /** The position, track node and path version m_prepared_node was
+     *  computed for. */
+    Vec3         m_prepared_xyz;
+    int          m_prepared_old_node;
+    unsigned int m_prepared_path_version;
+
+    /** The new track node computed by prepareUpdate. */
+    int          m_prepared_node;
+
+    int          findTrackNode(const Vec3 &xyz, int old_node);
+
 protected:
     /** Length of the kart, storing it here saves many function calls. */
     float m_kart_length;
@@ -102,6 +120,7 @@ public:
                               StateManager::ActivePlayer *player=NULL);
     virtual ~AIBaseController() {};
     virtual void reset();
+    virtual void prepareUpdate();
     static void enableDebug() {m_ai_debug = true; }
     virtual void crashed(const AbstractKart *k) {};
     virtual void crashed(const Material *m);
@@ -63,6 +63,13 @@ public:
     virtual      ~Controller         () {};
     virtual void  reset              () = 0;
     virtual void  update             (float dt) = 0;
+    // ------------------------------------------------------------------------
+    /** Called before the karts are updated, for all karts in parallel (see
+     *  World::update). It can be used to precompute read-only parts of
+     *  update(). It must not modify any shared data, and update() must
+     *  check that the inputs of a precomputed result are unchanged before
+     *  using it, so that the result is the same as without precomputing. */
+    virtual void  prepareUpdate      () {};
     virtual void  handleZipper       (bool play_sound) = 0;
     virtual void  collectedItem      (const Item &item, int add_info=-1,
                                       float previous_energy=0) = 0;
@@ -57,6 +57,31 @@ void GhostKart::addTransform(float time, const btTransform &trans)
     m_all_transform.push_back(trans);
 }   // addTransform
 
+// ----------------------------------------------------------------------------
+/** Removes all transforms, e.g. before a replay is positioned at a new time.
+ */
+void GhostKart::clearTransforms()
+{
+    m_all_times.clear();
+    m_all_transform.clear();
+    m_current_transform = 0;
+}   // clearTransforms
+
+// ----------------------------------------------------------------------------
+/** Removes all transforms before the one currently used for interpolation,
+ *  so that a streamed replay does not keep the whole race in memory.
+ */
+void GhostKart::removeOldTransforms()
+{
+    if(m_current_transform==0)
+        return;
+    m_all_times.erase(m_all_times.begin(),
+                      m_all_times.begin()+m_current_transform);
+    m_all_transform.erase(m_all_transform.begin(),
+                          m_all_transform.begin()+m_current_transform);
+    m_current_transform = 0;
+}   // removeOldTransforms
+
 // ----------------------------------------------------------------------------
 /** Adds a replay event for this kart.
  */
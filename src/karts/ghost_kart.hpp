@@ -58,6 +58,14 @@ public:
     virtual void addTransform(float time, const btTransform &trans);
     virtual void addReplayEvent(const ReplayBase::KartReplayEvent &kre);
     virtual void reset();
+    void         clearTransforms();
+    void         removeOldTransforms();
+    // ------------------------------------------------------------------------
+    /** Returns the time of the last transform, or -1 if there is none. */
+    float getLastTransformTime() const
+    {
+        return m_all_times.empty() ? -1.0f : m_all_times.back();
+    }   // getLastTransformTime
     // ------------------------------------------------------------------------
     /** No physics body for ghost kart, so nothing to adjust. */
     virtual void updateWeight() {};
@@ -90,10 +90,10 @@ void SpeedWeightedObject::Properties::checkAllSet()
  *  shared variables in KartModel (esp. animation status) will cause
  *  incorrect animations. The mesh is shared (between the master instance
  *  and all of its copies).
- *  Technically the scene node and mesh should be grab'ed on copy,
- *  and dropped when the copy is deleted. But since the master copy
- *  in the kart_properties_manager is always kept, there is no risk of
- *  a mesh being deleted to early.
+ *  The mesh is grab'ed on copy and dropped when the copy is deleted.
+ *  The master instance only loads its meshes on first use, and
+ *  unloads them again once they are not in use anymore (see isInUse()
+ *  and unloadModels()), so a copy must keep the mesh alive.
  */
 KartModel::KartModel(bool is_master)
 {
@@ -218,11 +218,6 @@ KartModel::~KartModel()
 
             m_wheel_node[i]->drop();
         }
-        if(m_is_master && m_wheel_model[i])
-        {
-            irr_driver->dropAllTextures(m_wheel_model[i]);
-            irr_driver->removeMeshFromCache(m_wheel_model[i]);
-        }
     }
 
     for(size_t i=0; i<m_speed_weighted_objects.size(); i++)
@@ -234,24 +229,12 @@ KartModel::~KartModel()
 
             m_speed_weighted_objects[i].m_node->drop();
         }
-        if(m_is_master && m_speed_weighted_objects[i].m_model)
-        {
-            irr_driver->dropAllTextures(m_speed_weighted_objects[i].m_model);
-            irr_driver->removeMeshFromCache(m_speed_weighted_objects[i].m_model);
-        }
     }
 
-    if(m_is_master && m_mesh)
-    {
+    if(m_is_master)
+        unloadModels();
+    else if(m_mesh)
         m_mesh->drop();
-        // If there is only one copy left, it's the copy in irrlicht's
-        // mesh cache, so it can be remove.
-        if(m_mesh && m_mesh->getReferenceCount()==1)
-        {
-            irr_driver->dropAllTextures(m_mesh);
-            irr_driver->removeMeshFromCache(m_mesh);
-        }
-    }
 
 #ifdef DEBUG
 #if SKELETON_DEBUG
@@ -281,6 +264,9 @@ KartModel* KartModel::makeCopy()
     km->m_kart_highest_point= m_kart_highest_point;
     km->m_kart_lowest_point = m_kart_lowest_point;
     km->m_mesh              = m_mesh;
+    // The copy keeps the mesh alive, even if the master unloads its models.
+    if(m_mesh)
+        m_mesh->grab();
     km->m_model_filename    = m_model_filename;
     km->m_animation_speed   = m_animation_speed;
     km->m_current_animation = AF_DEFAULT;
@@ -547,6 +533,50 @@ bool KartModel::loadModels(const KartProperties &kart_properties)
     return true;
 }   // loadModels
 
+// ----------------------------------------------------------------------------
+/** Frees the meshes and textures loaded by loadModels(). All information
+ *  read from the kart.xml file is kept, so the models can be loaded again
+ *  later. This should only be called if the master instance is not in
+ *  use anymore, see isInUse().
+ */
+void KartModel::unloadModels()
+{
+    assert(m_is_master);
+
+    for(unsigned int i=0; i<4; i++)
+    {
+        if(m_wheel_model[i])
+        {
+            irr_driver->dropAllTextures(m_wheel_model[i]);
+            irr_driver->removeMeshFromCache(m_wheel_model[i]);
+            m_wheel_model[i] = NULL;
+        }
+    }
+
+    for(size_t i=0; i<m_speed_weighted_objects.size(); i++)
+    {
+        if(m_speed_weighted_objects[i].m_model)
+        {
+            irr_driver->dropAllTextures(m_speed_weighted_objects[i].m_model);
+            irr_driver->removeMeshFromCache(m_speed_weighted_objects[i].m_model);
+            m_speed_weighted_objects[i].m_model = NULL;
+        }
+    }
+
+    if(m_mesh)
+    {
+        m_mesh->drop();
+        // If there is only one copy left, it's the copy in irrlicht's
+        // mesh cache, so it can be remove.
+        if(m_mesh->getReferenceCount()==1)
+        {
+            irr_driver->dropAllTextures(m_mesh);
+            irr_driver->removeMeshFromCache(m_mesh);
+        }
+        m_mesh = NULL;
+    }
+}   // unloadModels
+
 // ----------------------------------------------------------------------------
 /** Loads a single nitro emitter node. Currently this the position of the nitro
  *  emitter relative to the kart.
@@ -231,6 +231,7 @@ public:
     void          reset();
     void          loadInfo(const XMLNode &node);
     bool          loadModels(const KartProperties &kart_properties);
+    void          unloadModels();
     void          update(float dt, float rotation_dt, float steer,
                          const float height_abve_terrain[4], float speed);
     void          setDefaultPhysicsPosition(const Vec3 &center_shift,
@@ -239,6 +240,21 @@ public:
     scene::ISceneNode*
                   attachModel(bool animatedModels);
     // ------------------------------------------------------------------------
+    /** Returns the name of the 3d model file. */
+    const std::string& getModelFile() const { return m_model_filename; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the meshes of this kart model are loaded. */
+    bool isLoaded() const { return m_mesh!=NULL; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the mesh of this master instance is used by anything
+     *  else than this instance and irrlicht's mesh cache, e.g. by a copy
+     *  or a scene node. */
+    bool isInUse() const
+    {
+        assert(m_is_master);
+        return m_mesh && m_mesh->getReferenceCount()>2;
+    }   // isInUse
+    // ------------------------------------------------------------------------
     /** Returns the animated mesh of this kart model. */
     scene::IAnimatedMesh*
                   getModel() const { return m_mesh; }
@@ -49,6 +49,10 @@ KartProperties::KartProperties(const std::string &filename)
 {
     m_icon_material = NULL;
     m_minimap_icon  = NULL;
+    m_shadow_texture= NULL;
+    m_models_loaded = false;
+    m_model_data_loaded = false;
+    m_models_broken = false;
     m_name          = "NONAME";
     m_ident         = "NONAME";
     m_icon_file     = "";
@@ -129,6 +133,8 @@ KartProperties::KartProperties(const std::string &filename)
 /** Destructor, dereferences the kart model. */
 KartProperties::~KartProperties()
 {
+    if(m_models_loaded)
+        unloadTextures();
     delete m_kart_model;
     if(m_skidding_properties)
         delete m_skidding_properties;
@@ -211,18 +217,22 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     if(m_groups.size()==0)
         m_groups.push_back(DEFAULT_GROUP_NAME);
 
+    // Load the icon, it is needed in the kart selection anyway. The
+    // materials, textures and meshes are only loaded when the kart is used
+    // for the first time (see loadModels). But make sure that the model
+    // exists, so that a broken kart is not offered in the kart selection.
+    if (m_version >= 1 &&
+        !file_manager->fileExists(m_root+m_kart_model->getModelFile()))
+    {
+        delete m_kart_model;
+        throw std::runtime_error("Cannot find kart model");
+    }
 
-    // Load material
-    std::string materials_file = m_root+"materials.xml";
-    file_manager->pushModelSearchPath  (m_root);
     file_manager->pushTextureSearchPath(m_root);
 
     irr_driver->setTextureErrorMessage("Error while loading kart '%s':",
                                        m_name);
 
-    // addShared makes sure that these textures/material infos stay in memory
-    material_manager->addSharedMaterial(materials_file);
-
     m_icon_file = m_root+m_icon_file;
 
     // Make permanent is important, since otherwise icons can get deleted
@@ -233,51 +243,148 @@ void KartProperties::load(const std::string &filename, const std::string &node)
                                                     /*make_permanent*/true,
                                                     /*complain_if_not_found*/true,
                                                     /*strip_path*/false);
-    if(m_minimap_icon_file!="")
-        m_minimap_icon = irr_driver->getTexture(m_root+m_minimap_icon_file);
-    else
-        m_minimap_icon = NULL;
 
-    // Only load the model if the .kart file has the appropriate version,
-    // otherwise warnings are printed.
-    if (m_version >= 1)
+    irr_driver->unsetTextureErrorMessage();
+    file_manager->popTextureSearchPath();
+
+    m_models_loaded     = false;
+    m_model_data_loaded = false;
+    m_models_broken     = false;
+}   // load
+
+//-----------------------------------------------------------------------------
+/** Loads the materials, textures and meshes of this kart. This is done
+ *  when the kart is used for the first time (see requireModels()), and
+ *  again if the models were unloaded with unloadModels() in between. The
+ *  values that depend on the size of the kart model (center of gravity,
+ *  wheel base, turn angles) are computed the first time the models are
+ *  loaded. If the models can not be loaded the kart is marked as broken,
+ *  and loading is not attempted again.
+ *  \return True if the models were loaded.
+ */
+bool KartProperties::loadModels()
+{
+    assert(m_kart_model);
+    assert(!m_models_loaded);
+
+    if(m_models_broken)
+        return false;
+
+    file_manager->pushModelSearchPath  (m_root);
+    file_manager->pushTextureSearchPath(m_root);
+    irr_driver->setTextureErrorMessage("Error while loading kart '%s':",
+                                       m_name);
+
+    bool success = true;
+    try
     {
-        const bool success = m_kart_model->loadModels(*this);
-        if (!success)
-        {
-            delete m_kart_model;
-            file_manager->popTextureSearchPath();
-            file_manager->popModelSearchPath();
-            throw std::runtime_error("Cannot load kart models");
-        }
+        // addShared makes sure that these textures/material infos stay in
+        // memory until the kart is unloaded
+        material_manager->addSharedMaterial(m_root+"materials.xml");
     }
-
-    if(m_gravity_center_shift.getX()==UNDEFINED)
+    catch(std::exception& err)
     {
-        m_gravity_center_shift.setX(0);
-        // Default: center at the very bottom of the kart.
-        m_gravity_center_shift.setY(m_kart_model->getHeight()*0.5f);
-        m_gravity_center_shift.setZ(0);
+        Log::error("KartProperties", "%s", err.what());
+        success = false;
     }
-    m_kart_model->setDefaultPhysicsPosition(m_gravity_center_shift,
-                                           m_wheel_radius           );
-    m_wheel_base = fabsf( m_kart_model->getWheelPhysicsPosition(0).getZ()
-                         -m_kart_model->getWheelPhysicsPosition(2).getZ());
 
-    // Now convert the turn radius into turn angle:
-    for(unsigned int i=0; i<m_turn_angle_at_speed.size(); i++)
+    // The textures are grabbed so that they are kept while the kart is
+    // loaded, see unloadModels.
+    if(success && m_minimap_icon_file!="")
     {
-        m_turn_angle_at_speed.setY( i,
-                            sin(m_wheel_base/m_turn_angle_at_speed.getY(i)) );
+        m_minimap_icon = irr_driver->getTexture(m_root+m_minimap_icon_file);
+        if(m_minimap_icon)
+            m_minimap_icon->grab();
+    }
+    if(success)
+    {
+        m_shadow_texture = irr_driver->getTexture(m_shadow_file);
+        if(m_shadow_texture)
+            m_shadow_texture->grab();
     }
 
-    m_shadow_texture = irr_driver->getTexture(m_shadow_file);
+    // Only load the model if the .kart file has the appropriate version,
+    // otherwise warnings are printed.
+    if (success && m_version >= 1)
+        success = m_kart_model->loadModels(*this);
 
     irr_driver->unsetTextureErrorMessage();
     file_manager->popTextureSearchPath();
     file_manager->popModelSearchPath();
 
-}   // load
+    if (!success)
+    {
+        Log::error("KartProperties", "Cannot load models of kart '%s', "
+                   "the kart is disabled.", m_ident.c_str());
+        unloadTextures();
+        m_models_broken = true;
+        return false;
+    }
+
+    if(!m_model_data_loaded)
+    {
+        if(m_gravity_center_shift.getX()==UNDEFINED)
+        {
+            m_gravity_center_shift.setX(0);
+            // Default: center at the very bottom of the kart.
+            m_gravity_center_shift.setY(m_kart_model->getHeight()*0.5f);
+            m_gravity_center_shift.setZ(0);
+        }
+        m_kart_model->setDefaultPhysicsPosition(m_gravity_center_shift,
+                                                m_wheel_radius           );
+        m_wheel_base = fabsf( m_kart_model->getWheelPhysicsPosition(0).getZ()
+                             -m_kart_model->getWheelPhysicsPosition(2).getZ());
+
+        // Now convert the turn radius into turn angle:
+        for(unsigned int i=0; i<m_turn_angle_at_speed.size(); i++)
+        {
+            m_turn_angle_at_speed.setY( i,
+                            sin(m_wheel_base/m_turn_angle_at_speed.getY(i)) );
+        }
+        m_model_data_loaded = true;
+    }
+    m_models_loaded = true;
+    return true;
+}   // loadModels
+
+//-----------------------------------------------------------------------------
+/** Frees the meshes, textures and materials of this kart if they are not
+ *  used anymore (by a kart in a race or any scene node). They will be
+ *  loaded again the next time they are needed. The icon is kept.
+ *  \return True if the models were unloaded.
+ */
+bool KartProperties::unloadModels()
+{
+    if(!m_models_loaded || m_kart_model->isInUse())
+        return false;
+    m_kart_model->unloadModels();
+    unloadTextures();
+    m_models_loaded = false;
+    return true;
+}   // unloadModels
+
+//-----------------------------------------------------------------------------
+/** Frees the minimap icon, the shadow texture and the materials loaded by
+ *  loadModels(). Textures are only removed if nothing else uses them.
+ */
+void KartProperties::unloadTextures()
+{
+    if(m_minimap_icon)
+    {
+        m_minimap_icon->drop();
+        if(m_minimap_icon->getReferenceCount()==1)
+            irr_driver->removeTexture(m_minimap_icon);
+        m_minimap_icon = NULL;
+    }
+    if(m_shadow_texture)
+    {
+        m_shadow_texture->drop();
+        if(m_shadow_texture->getReferenceCount()==1)
+            irr_driver->removeTexture(m_shadow_texture);
+        m_shadow_texture = NULL;
+    }
+    material_manager->removeSharedMaterial(m_root+"materials.xml");
+}   // unloadTextures
 
 //-----------------------------------------------------------------------------
 /** Actually reads in the data from the xml file.
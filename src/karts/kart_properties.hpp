@@ -76,7 +76,7 @@ private:
     std::string              m_minimap_icon_file;
 
     /** The texture to use in the minimap. If not defined, a simple
-     *  color dot is used. */
+     *  color dot is used. Only loaded while the models are loaded. */
     video::ITexture         *m_minimap_icon;
 
     /** The kart model and wheels. It is mutable since the wheels of the
@@ -84,6 +84,20 @@ private:
      *  the kart_properties object is const. */
     mutable KartModel       *m_kart_model;
 
+    /** True if the meshes of the kart model are loaded. The models,
+     *  materials and textures (except the icon) are only loaded on first
+     *  use, see loadModels(). */
+    bool                     m_models_loaded;
+
+    /** True once the values that depend on the size of the model (e.g.
+     *  wheel base) were computed. This is only done the first time the
+     *  models are loaded, and kept if the models are unloaded again. */
+    bool                     m_model_data_loaded;
+
+    /** True if loading the models failed. The kart is then not available
+     *  anymore, and loading is not attempted again. */
+    bool                     m_models_broken;
+
     /** List of all groups the kart belongs to. */
     std::vector<std::string> m_groups;
 
@@ -114,7 +128,9 @@ private:
                                        *   for this kart.*/
     float m_shadow_y_offset;          /**< Y offset of the shadow plane
                                        *   for this kart.*/
-    video::ITexture *m_shadow_texture;/**< The texture with the shadow. */
+    video::ITexture *m_shadow_texture;/**< The texture with the shadow, only
+                                       *   loaded while the models are
+                                       *   loaded. */
     video::SColor m_color;            /**< Color the represents the kart in the
                                        *   status bar and on the track-view. */
     int  m_shape;                     /**< Number of vertices in polygon when
@@ -378,6 +394,8 @@ private:
 
     void  load              (const std::string &filename,
                              const std::string &node);
+    bool  loadModels        ();
+    void  unloadTextures    ();
 
 
 public:
@@ -387,6 +405,27 @@ public:
     void  getAllData        (const XMLNode * root);
     void  checkAllSet       (const std::string &filename);
     float getStartupBoost   () const;
+    bool  unloadModels      ();
+
+    // ------------------------------------------------------------------------
+    /** Makes sure that the models of this kart are loaded. Loading the
+     *  models on first use does not change any property of the kart, so
+     *  this can be used from const functions.
+     *  \return False if the models could not be loaded. */
+    bool  requireModels     () const
+    {
+        if(m_models_loaded)
+            return true;
+        return const_cast<KartProperties*>(this)->loadModels();
+    }   // requireModels
+
+    // ------------------------------------------------------------------------
+    /** Returns true if the models of this kart could not be loaded. */
+    bool  areModelsBroken   () const { return m_models_broken; }
+
+    // ------------------------------------------------------------------------
+    /** Returns true if the models of this kart are currently loaded. */
+    bool  areModelsLoaded   () const { return m_models_loaded; }
 
     // ------------------------------------------------------------------------
     /** Returns the (maximum) speed for a given turn radius.
@@ -406,18 +445,26 @@ public:
     Material*     getIconMaterial    () const {return m_icon_material;        }
 
     // ------------------------------------------------------------------------
-    /** Returns the texture to use in the minimap, or NULL if not defined. */
+    /** Returns the texture to use in the minimap, or NULL if not defined.
+     *  Only valid while the models are loaded (see requireModels()). */
     video::ITexture *getMinimapIcon  () const {return m_minimap_icon;         }
 
     // ------------------------------------------------------------------------
     /** Returns a pointer to the KartModel object. */
     KartModel*    getKartModelCopy   () const
-                                            {return m_kart_model->makeCopy(); }
+    {
+        requireModels();
+        return m_kart_model->makeCopy();
+    }   // getKartModelCopy
 
     // ------------------------------------------------------------------------
     /** Returns a pointer to the main KartModel object. This copy
      *  should not be modified, not attachModel be called on it. */
-    const KartModel& getMasterKartModel() const {return *m_kart_model;        }
+    const KartModel& getMasterKartModel() const
+    {
+        requireModels();
+        return *m_kart_model;
+    }   // getMasterKartModel
 
     // ------------------------------------------------------------------------
     /** Sets the name of a mesh to be used for this kart.
@@ -444,7 +491,8 @@ public:
     const std::string& getIdent      () const {return m_ident;                }
 
     // ------------------------------------------------------------------------
-    /** Returns the shadow texture to use. */
+    /** Returns the shadow texture to use. Only valid while the models are
+     *  loaded (see requireModels()). */
     video::ITexture *getShadowTexture() const {return m_shadow_texture;       }
 
     // ------------------------------------------------------------------------
@@ -88,6 +88,45 @@ void KartPropertiesManager::reLoadAllKarts()
     loadAllKarts(false);
 }   // reLoadAllKarts
 
+//-----------------------------------------------------------------------------
+/** Frees the meshes and textures of all karts that are not used anymore.
+ *  This is called after a race, the models of karts used again later are
+ *  then loaded on demand again.
+ */
+void KartPropertiesManager::unloadUnusedKartModels()
+{
+    int count = 0;
+    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    {
+        if (m_karts_properties[i].unloadModels())
+            count++;
+    }
+    if (count>0)
+        Log::info("KartPropertiesManager", "Unloaded the models of %d karts.",
+                  count);
+}   // unloadUnusedKartModels
+
+//-----------------------------------------------------------------------------
+/** Makes sure that the models of a kart are loaded. If the models can not
+ *  be loaded, the kart is marked as unavailable, so that it is not offered
+ *  in the kart selection or picked as AI kart anymore.
+ *  \param ident The identifier of the kart.
+ *  \return False if the kart is unknown or its models can not be loaded.
+ */
+bool KartPropertiesManager::requireKartModels(const std::string &ident)
+{
+    for (unsigned int i=0; i<m_karts_properties.size(); i++)
+    {
+        if (m_karts_properties[i].getIdent() != ident)
+            continue;
+        if (m_karts_properties[i].requireModels())
+            return true;
+        m_kart_available[i] = false;
+        return false;
+    }
+    return false;
+}   // requireKartModels
+
 //-----------------------------------------------------------------------------
 /** Remove a kart from the kart manager.
  *  \param id The kart id (i.e. name of the directory) to remove.
@@ -152,7 +191,9 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 }   // removeKart
 
 //-----------------------------------------------------------------------------
-/** Loads all kart properties and models.
+/** Loads the properties of all karts. Only the kart.xml files are read,
+ *  the models and textures of a kart are loaded when it is used for the
+ *  first time.
  */
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
@@ -185,7 +226,8 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
 }   // loadAllKarts
 
 //-----------------------------------------------------------------------------
-/** Loads a single kart and (if not disabled) the oorresponding 3d model.
+/** Loads the properties of a single kart. The corresponding 3d model is
+ *  only loaded when the kart is used.
  *  \param filename Full path to the kart config file.
  */
 bool KartPropertiesManager::loadKart(const std::string &dir)
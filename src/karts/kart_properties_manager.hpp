@@ -78,6 +78,8 @@ public:
     void                     loadAllKarts           (bool loading_icon = true);
     void                     unloadAllKarts         ();
     void                     reLoadAllKarts         ();
+    void                     unloadUnusedKartModels ();
+    bool                     requireKartModels(const std::string &ident);
     void                     removeKart(const std::string &id);
     const std::vector<int>   getKartsInGroup        (const std::string& g);
     bool                     kartAvailable(int kartid);
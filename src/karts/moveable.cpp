@@ -35,6 +35,11 @@ Moveable::Moveable()
     m_mesh            = NULL;
     m_node            = NULL;
     m_heading         = 0;
+    m_previous_graphics_trans.setIdentity();
+    m_current_graphics_trans.setIdentity();
+    m_graphics_offset_xyz      = Vec3(0, 0, 0);
+    m_graphics_offset_rotation = btQuaternion(0, 0, 0, 1);
+    m_smoothing_offset         = Vec3(0, 0, 0);
 }   // Moveable
 
 //-----------------------------------------------------------------------------
@@ -66,16 +71,50 @@ void Moveable::setNode(scene::ISceneNode *n)
 void Moveable::updateGraphics(float dt, const Vec3& offset_xyz,
                               const btQuaternion& rotation)
 {
-    Vec3 xyz=getXYZ()+offset_xyz;
+    m_previous_graphics_trans  = m_current_graphics_trans;
+    m_current_graphics_trans   = m_transform;
+    m_graphics_offset_xyz      = offset_xyz;
+    m_graphics_offset_rotation = rotation;
+    m_smoothing_offset         = Vec3(0, 0, 0);
+    setNodeTransform(m_transform);
+}   // updateGraphics
+
+//-----------------------------------------------------------------------------
+/** Positions the graphical model between the last two simulation steps.
+ *  Since the simulation uses a fixed time step, a frame is usually drawn
+ *  at a time in between two simulation steps. Interpolating between the
+ *  last two steps avoids jerky movement if the frame rate is different
+ *  from the simulation rate, at the cost of one simulation step latency.
+ *  \param alpha Fraction of a simulation step since the last step, in
+ *         [0,1).
+ */
+void Moveable::interpolateGraphics(float alpha)
+{
+    const btTransform &p = m_previous_graphics_trans;
+    const btTransform &c = m_current_graphics_trans;
+    btTransform t(p.getRotation().slerp(c.getRotation(), alpha),
+                  p.getOrigin().lerp(c.getOrigin(), alpha));
+    m_smoothing_offset = t.getOrigin() - c.getOrigin();
+    setNodeTransform(t);
+}   // interpolateGraphics
+
+//-----------------------------------------------------------------------------
+/** Sets the scene node to the given transform, using the offsets of the
+ *  last call to updateGraphics.
+ *  \param t The transform to use.
+ */
+void Moveable::setNodeTransform(const btTransform &t)
+{
+    Vec3 xyz=t.getOrigin()+m_graphics_offset_xyz;
     m_node->setPosition(xyz.toIrrVector());
-    btQuaternion r_all = getRotation()*rotation;
+    btQuaternion r_all = t.getRotation()*m_graphics_offset_rotation;
     if(btFuzzyZero(r_all.getX()) && btFuzzyZero(r_all.getY()-0.70710677f) &&
        btFuzzyZero(r_all.getZ()) && btFuzzyZero(r_all.getW()-0.70710677f)   )
         r_all.setX(0.000001f);
     Vec3 hpr;
     hpr.setHPR(r_all);
     m_node->setRotation(hpr.toIrrHPR());
-}   // updateGraphics
+}   // setNodeTransform
 
 //-----------------------------------------------------------------------------
 /** The reset position must be set before calling reset
@@ -90,6 +129,10 @@ void Moveable::reset()
     }
     m_node->setVisible(true);  // In case that the objects was eliminated
 
+    // Don't interpolate the graphics from the position before the reset
+    m_previous_graphics_trans = m_current_graphics_trans = m_transform;
+    m_smoothing_offset        = Vec3(0, 0, 0);
+
     Vec3 up       = getTrans().getBasis().getColumn(1);
     m_pitch       = atan2(up.getZ(), fabsf(up.getY()));
     m_roll        = atan2(up.getX(), up.getY());
@@ -153,6 +196,7 @@ void Moveable::createBody(float mass, btTransform& trans,
     btVector3 inertia;
     shape->calculateLocalInertia(mass, inertia);
     m_transform = trans;
+    m_previous_graphics_trans = m_current_graphics_trans = trans;
     m_motion_state = new KartMotionState(trans);
 
     btRigidBody::btRigidBodyConstructionInfo info(mass, m_motion_state,
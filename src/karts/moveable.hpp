@@ -50,6 +50,22 @@ private:
     /** The roll between -180 and 180 degrees. */
     float                  m_roll;
 
+    /** The transforms used by the last two calls to updateGraphics, i.e.
+     *  of the last two simulation steps. The graphics are interpolated
+     *  between these two. */
+    btTransform            m_previous_graphics_trans;
+    btTransform            m_current_graphics_trans;
+
+    /** The offsets used by the last call to updateGraphics. */
+    Vec3                   m_graphics_offset_xyz;
+    btQuaternion           m_graphics_offset_rotation;
+
+    /** Difference between the interpolated graphical position and the
+     *  position of the last simulation step. */
+    Vec3                   m_smoothing_offset;
+
+    void          setNodeTransform(const btTransform &t);
+
 protected:
     UserPointer            m_user_pointer;
     scene::IMesh          *m_mesh;
@@ -102,6 +118,12 @@ public:
     // ------------------------------------------------------------------------
     virtual void  updateGraphics(float dt, const Vec3& off_xyz,
                                  const btQuaternion& off_rotation);
+    void          interpolateGraphics(float alpha);
+    // ------------------------------------------------------------------------
+    /** Returns how much the graphical position is behind the position of
+     *  the last simulation step (see interpolateGraphics). */
+    const Vec3&   getSmoothingOffset() const { return m_smoothing_offset; }
+    // ------------------------------------------------------------------------
     virtual void  reset();
     virtual void  update(float dt) ;
     btRigidBody  *getBody() const {return m_body; }
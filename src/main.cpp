@@ -149,6 +149,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "config/player.hpp"
+#include "graphics/frustum_culler.hpp"
 #include "graphics/hardware_skinning.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
@@ -200,7 +201,9 @@
 #include "utils/crash_reporting.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 static void cleanSuperTuxKart();
 
@@ -424,6 +427,14 @@ void cmdLineHelp()
                               "seconds.\n"
     "       --no-graphics      Do not display the actual race.\n"
     "       --with-profile     Enables the profile mode.\n"
+    "       --profile-sectors  In profile mode, replay all kart positions at\n"
+    "                          the end to benchmark the road sector lookup.\n"
+    "       --profile-output=FILE  In profile mode, write the statistics to\n"
+    "                          FILE (as CSV if it ends in .csv, else JSON).\n"
+    "       --profile-trace=FILE  Record all profiler markers of all threads\n"
+    "                          and write them to FILE as Chrome trace.\n"
+    "       --culling-scene=FILE  Write the culled objects and camera frustums\n"
+    "                          to FILE (for tools/culling_bench).\n"
     "       --demo-mode=t      Enables demo mode after t seconds idle time in "
                                "main menu.\n"
     "       --demo-tracks=t1,t2 List of tracks to be used in demo mode. No\n"
@@ -435,6 +446,11 @@ void cmdLineHelp()
     // "       --history=n        Replay history file 'history.dat' using:\n"
     // "                            n=1: recorded positions\n"
     // "                            n=2: recorded key strokes\n"
+    "       --record-history   Write the history of each race while racing,\n"
+    "                          without a limit on its length, to its own file\n"
+    "                          'history-<date>-<time>-<n>.dat'.\n"
+    "       --history-to-text=FILE  Convert the history file 'history.dat' to\n"
+    "                          the text format in FILE and exit.\n"
     "       --server           Start a server (not a playing client).\n"
     "       --login=s          Automatically sign in (set the login).\n"
     "       --password=s       Automatically sign in (set the password).\n"
@@ -503,12 +519,18 @@ int handleCmdLinePreliminary()
     if( CommandLine::has( "--kartdir", &s))
         KartPropertiesManager::addKartSearchDir(s);
 
+#ifdef SERVER_ONLY
+    // The dedicated server never renders anything
+    ProfileWorld::disableGraphics();
+    UserConfigParams::m_log_errors_to_console=true;
+#else
     if( CommandLine::has( "--no-graphics") ||
         CommandLine::has("-l"            )    )
     {
         ProfileWorld::disableGraphics();
         UserConfigParams::m_log_errors_to_console=true;
     }
+#endif
 
     if(CommandLine::has("--screensize", &s) || 
        CommandLine::has("-s", &s)              )
@@ -637,11 +659,17 @@ int handleCmdLine()
     }
 
     // Networking command lines
+#ifdef SERVER_ONLY
+    // The dedicated server can't be used as a client
+    NetworkManager::getInstance<ServerNetworkManager>();
+    Log::info("main", "Creating a server network manager.");
+#else
     if(CommandLine::has("--server") )
     {
         NetworkManager::getInstance<ServerNetworkManager>();
         Log::info("main", "Creating a server network manager.");
     }   // -server
+#endif
 
     if(CommandLine::has("--max-players", &n))
         UserConfigParams::m_server_max_players=n;
@@ -873,6 +901,22 @@ int handleCmdLine()
         }
     }   // --with-profile
 
+    if(CommandLine::has("--profile-sectors"))
+        ProfileWorld::enableSectorBenchmark();
+
+    if(CommandLine::has("--profile-output", &s))
+        ProfileWorld::setOutputFile(s);
+
+    if(CommandLine::has("--profile-trace", &s))
+        profiler.setTraceFile(s);
+
+    if(CommandLine::has("--culling-scene", &s))
+    {
+        if(!FrustumCuller::openSceneFile(s))
+            Log::error("main", "Can't open culling scene file '%s'.",
+                       s.c_str());
+    }
+
     if(CommandLine::has("--ghost"))
         ReplayPlay::create();
 
@@ -892,6 +936,15 @@ int handleCmdLine()
         UserConfigParams::m_no_start_screen = true;
     }   // --history
 
+    if(CommandLine::has("--record-history"))
+        history->enableStreaming();
+
+    if(CommandLine::has("--history-to-text", &s))
+    {
+        History::convertToText(s);
+        return 0;
+    }
+
     // Demo mode
     if(CommandLine::has("--demo-mode", &s))
     {
@@ -1033,6 +1086,7 @@ void initRest()
     track_manager           = new TrackManager         ();
     kart_properties_manager = new KartPropertiesManager();
     projectile_manager      = new ProjectileManager    ();
+    WorkerPool::create();
     powerup_manager         = new PowerupManager       ();
     attachment_manager      = new AttachmentManager    ();
     highscore_manager       = new HighscoreManager     ();
@@ -1099,6 +1153,7 @@ static void cleanSuperTuxKart()
     if(attachment_manager)      delete attachment_manager;
     ItemManager::removeTextures();
     if(powerup_manager)         delete powerup_manager;
+    if(WorkerPool::get())       WorkerPool::destroy();
     if(projectile_manager)      delete projectile_manager;
     if(kart_properties_manager) delete kart_properties_manager;
     if(track_manager)           delete track_manager;
@@ -1172,6 +1227,10 @@ int main(int argc, char *argv[] )
         file_manager->redirectOutput();
 #endif
 
+        // From now on log messages are written by a separate thread
+        if(!CommandLine::has("--log=sync"))
+            Log::startWriterThread();
+
         input_manager = new InputManager ();
 
 #ifdef ENABLE_WIIUSE
@@ -1412,10 +1471,14 @@ int main(int argc, char *argv[] )
 
     cleanSuperTuxKart();
 
+    profiler.writeTrace();
+
 #ifdef DEBUG
     MemoryLeaks::checkForLeaks();
 #endif
 
+    Log::stopWriterThread();
+
 #ifndef WIN32
     if (user_config) //close logfiles
     {
@@ -22,6 +22,7 @@
 #include <assert.h>
 
 #include "audio/music_manager.hpp"
+#include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
@@ -43,8 +44,9 @@ MainLoop::MainLoop() :
 m_abort(false),
 m_frame_count(0)
 {
-    m_curr_time = 0;
-    m_prev_time = 0;
+    m_curr_time       = 0;
+    m_prev_time       = 0;
+    m_sim_accumulator = 0;
 }  // MainLoop
 
 //-----------------------------------------------------------------------------
@@ -92,17 +94,39 @@ float MainLoop::getLimitedDt()
 }   // getLimitedDt
 
 //-----------------------------------------------------------------------------
-/** Updates all race related objects.
- *  \param dt Time step size.
+/** Updates all race related objects. The world is always simulated with a
+ *  fixed time step (see stk_config's physics fps), independent of the frame
+ *  rate: the frame time is accumulated, and as many time steps are
+ *  simulated as fit into it. The remainder is carried over to the next
+ *  frame, and the graphics are interpolated between the last two simulated
+ *  states accordingly.
+ *  \param dt Time since the last frame.
  */
 void MainLoop::updateRace(float dt)
 {
-    if(ProfileWorld::isProfileMode()) dt=1.0f/60.0f;
+    const float sim_dt = 1.0f/stk_config->m_physics_fps;
 
-    if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
-        NetworkWorld::getInstance<NetworkWorld>()->update(dt);
+    // In profile mode simulate exactly one time step per frame, so that
+    // the results do not depend on the speed of the computer.
+    if(ProfileWorld::isProfileMode())
+        m_sim_accumulator = sim_dt;
     else
-        World::getWorld()->updateWorld(dt);
+        m_sim_accumulator += dt;
+
+    // Note that the world can be deleted while being updated.
+    while(m_sim_accumulator >= sim_dt && World::getWorld())
+    {
+        if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
+            NetworkWorld::getInstance<NetworkWorld>()->update(sim_dt);
+        else
+            World::getWorld()->updateWorld(sim_dt);
+        m_sim_accumulator -= sim_dt;
+    }
+
+    if(!World::getWorld())
+        m_sim_accumulator = 0;
+    else if(!ProfileWorld::isNoGraphics())
+        World::getWorld()->updateGraphics(m_sim_accumulator/sim_dt);
 }   // updateRace
 
 //-----------------------------------------------------------------------------
@@ -33,6 +33,9 @@ private:
     int      m_frame_count;
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+    /** Frame time that has not been simulated yet, always less than one
+     *  simulation time step after updateRace. */
+    float    m_sim_accumulator;
     float    getLimitedDt();
     void     updateRace(float dt);
 public:
@@ -33,6 +33,7 @@
 #include "utils/constants.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 //-----------------------------------------------------------------------------
 /** Constructs the linear world. Note that here no functions can be called
@@ -139,6 +140,29 @@ void LinearWorld::reset()
 
 }   // reset
 
+//-----------------------------------------------------------------------------
+/** Updates the track sector and overall distance of one kart. This can be
+ *  called from a worker thread, so it must only modify the kart info of
+ *  this kart.
+ *  \param index Index of the kart.
+ *  \param world Pointer to the linear world.
+ */
+void LinearWorld::updateTrackSector(int index, void *world)
+{
+    LinearWorld *lw     = (LinearWorld*)world;
+    KartInfo& kart_info = lw->m_kart_info[index];
+    AbstractKart* kart  = lw->m_karts[index];
+
+    // Nothing to do for karts that are currently being
+    // rescued or eliminated
+    if(kart->getKartAnimation()) return;
+
+    kart_info.getTrackSector()->update(kart->getXYZ());
+    kart_info.m_overall_distance = kart_info.m_race_lap
+                                 * lw->m_track->getTrackLength()
+                   + lw->getDistanceDownTrackForKart(kart->getWorldKartId());
+}   // updateTrackSector
+
 //-----------------------------------------------------------------------------
 /** General update function called once per frame. This updates the kart
  *  sectors, which are then used to determine the kart positions.
@@ -162,20 +186,16 @@ void LinearWorld::update(float dt)
 
     // Do stuff specific to this subtype of race.
     // ------------------------------------------
-    for(unsigned int n=0; n<kart_amount; n++)
+    // Each kart only modifies its own kart info, so this can be done in
+    // parallel.
+    if(WorkerPool::get())
+        WorkerPool::get()->parallelFor(kart_amount,
+                                       &LinearWorld::updateTrackSector, this);
+    else
     {
-        KartInfo& kart_info = m_kart_info[n];
-        AbstractKart* kart = m_karts[n];
-
-        // Nothing to do for karts that are currently being
-        // rescued or eliminated
-        if(kart->getKartAnimation()) continue;
-
-        kart_info.getTrackSector()->update(kart->getXYZ());
-        kart_info.m_overall_distance = kart_info.m_race_lap
-                                     * m_track->getTrackLength()
-                        + getDistanceDownTrackForKart(kart->getWorldKartId());
-    }   // for n
+        for(unsigned int n=0; n<kart_amount; n++)
+            updateTrackSector(n, this);
+    }
 
     // Update all positions. This must be done after _all_ karts have
     // updated their position and laps etc, otherwise inconsistencies
@@ -113,6 +113,7 @@ protected:
 
     virtual void  checkForWrongDirection(unsigned int i);
     void          updateRacePosition();
+    static  void  updateTrackSector(int index, void *world);
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
 public:
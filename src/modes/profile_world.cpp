@@ -21,16 +21,32 @@
 #include "main_loop.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/irr_driver.hpp"
+#include "graphics/stkmesh.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "physics/physics.hpp"
+#include "tracks/quad_graph.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 
 #include <ISceneManager.h>
 
+#include <algorithm>
+#include <stdio.h>
+
+#ifndef WIN32
+#  include <sys/resource.h>
+#endif
+
 ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+bool  ProfileWorld::m_sector_benchmark = false;
+std::string ProfileWorld::m_output_file;
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -53,6 +69,13 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    m_num_mesh_draws   = 0;
+    m_num_program_switches = 0;
+    m_num_texture_switches = 0;
+    m_num_vao_switches     = 0;
+    m_last_frame_time  = 0;
+    if(!m_output_file.empty())
+        profiler.enableStatistics();
 }   // ProfileWorld
 
 //-----------------------------------------------------------------------------
@@ -148,6 +171,11 @@ bool ProfileWorld::isRaceOver()
  */
 void ProfileWorld::update(float dt)
 {
+    uint64_t now = StkTime::getMonoTimeUs();
+    if(m_last_frame_time>0)
+        m_frame_times.push_back((now-m_last_frame_time)*0.001f);
+    m_last_frame_time = now;
+
     StandardRace::update(dt);
 
     m_frame_count++;
@@ -161,6 +189,20 @@ void ProfileWorld::update(float dt)
     m_num_transparent  += attr->getAttributeAsInt("drawn_transparent" );
     m_num_trans_effect += attr->getAttributeAsInt("drawn_transparent_effect" );
 
+    // The statistics of the previous frame, which are reset when the
+    // next frame is rendered
+    const STKMeshDrawStats &stats = STKMesh::getDrawStats();
+    m_num_mesh_draws       += stats.DrawCalls;
+    m_num_program_switches += stats.ProgramSwitches;
+    m_num_texture_switches += stats.TextureSwitches;
+    m_num_vao_switches     += stats.VAOSwitches;
+
+    if(m_sector_benchmark)
+    {
+        m_kart_positions.resize(m_karts.size());
+        for(unsigned int i=0; i<m_karts.size(); i++)
+            m_kart_positions[i].push_back(m_karts[i]->getXYZ());
+    }
 }   // update
 
 //-----------------------------------------------------------------------------
@@ -200,6 +242,9 @@ void ProfileWorld::enterRaceOverState()
     printf("Number of frames: %d time %f, Average FPS: %f\n",
            m_frame_count, runtime, (float)m_frame_count/runtime);
 
+    if(m_sector_benchmark && QuadGraph::get())
+        QuadGraph::get()->benchmarkSectorLookup(m_kart_positions);
+
     // Print geometry statistics if we're not in no-graphics mode
     if(!m_no_graphics)
     {
@@ -213,6 +258,14 @@ void ProfileWorld::enterRaceOverState()
                (float)m_num_transparent/m_frame_count);
         printf("Average # transp. effect nodes: %f\n",
                (float)m_num_trans_effect/m_frame_count);
+        printf("Average # mesh draw calls:      %f\n",
+               (float)m_num_mesh_draws/m_frame_count);
+        printf("Average # program switches:     %f\n",
+               (float)m_num_program_switches/m_frame_count);
+        printf("Average # texture switches:     %f\n",
+               (float)m_num_texture_switches/m_frame_count);
+        printf("Average # VAO switches:         %f\n",
+               (float)m_num_vao_switches/m_frame_count);
     }
 
     // Print race statistics for each individual kart
@@ -330,6 +383,224 @@ void ProfileWorld::enterRaceOverState()
                banana_count, s_nitro_count, l_nitro_count, bubble_count,
                off_track_count);
     }   // for it !=all_groups.end
+
+    if(!m_output_file.empty())
+        writeStatistics(runtime);
+
     delete this;
     main_loop->abort();
 }   // enterRaceOverState
+
+//-----------------------------------------------------------------------------
+/** Returns the given percentile of a sorted list of values.
+ */
+static float getPercentile(const std::vector<float> &sorted, float percent)
+{
+    if(sorted.empty()) return 0.0f;
+    unsigned int n = (unsigned int)(percent*0.01f*(sorted.size()-1)+0.5f);
+    return sorted[n];
+}   // getPercentile
+
+//-----------------------------------------------------------------------------
+/** Returns the maximum resident memory used by this process so far in KB,
+ *  or -1 if this is not supported on this platform.
+ */
+static long getMemoryHighWaterMark()
+{
+#ifdef WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)!=0)
+        return -1;
+#  ifdef __APPLE__
+    return usage.ru_maxrss/1024;   // bytes on OSX
+#  else
+    return usage.ru_maxrss;
+#  endif
+#endif
+}   // getMemoryHighWaterMark
+
+//-----------------------------------------------------------------------------
+/** Returns a string as a quoted field of a CSV or JSON file. CSV fields
+ *  double any quote (RFC 4180), JSON strings escape quotes, backslashes
+ *  and control characters.
+ */
+static std::string quote(const std::string &s, bool csv)
+{
+    std::string result = "\"";
+    for(unsigned int i=0; i<s.size(); i++)
+    {
+        if(csv)
+        {
+            if(s[i]=='"') result += '"';
+            result += s[i];
+        }
+        else if(s[i]=='"' || s[i]=='\\')
+        {
+            result += '\\';
+            result += s[i];
+        }
+        else if((unsigned char)s[i] < 0x20)
+        {
+            char code[8];
+            sprintf(code, "\\u%04x", (int)s[i]);
+            result += code;
+        }
+        else
+            result += s[i];
+    }
+    return result + "\"";
+}   // quote
+
+//-----------------------------------------------------------------------------
+/** Returns a number as a CSV or JSON value. JSON has no representation for
+ *  infinity or NaN, so those are written as null (or an empty CSV field).
+ */
+static std::string number(double x, bool csv)
+{
+    // x-x is NaN for infinity and NaN
+    if(!(x-x == 0))
+        return csv ? "" : "null";
+    char s[64];
+    sprintf(s, "%f", x);
+    return s;
+}   // number
+
+//-----------------------------------------------------------------------------
+/** Writes the statistics of this run in a machine readable form: as CSV
+ *  (one 'name,value' line per value) if the file name ends in .csv,
+ *  otherwise as JSON. This contains the frame time percentiles, the
+ *  accumulated time of each profiler marker, the number of physics steps,
+ *  the memory high water mark and the per-kart results.
+ *  \param runtime Real time the race took in seconds.
+ */
+void ProfileWorld::writeStatistics(float runtime)
+{
+    FILE *f = fopen(m_output_file.c_str(), "w");
+    if(!f)
+    {
+        Log::error("ProfileWorld", "Can't open '%s' for writing.",
+                   m_output_file.c_str());
+        return;
+    }
+    const bool csv = StringUtils::hasSuffix(m_output_file, ".csv");
+
+    std::vector<float> sorted = m_frame_times;
+    std::sort(sorted.begin(), sorted.end());
+
+    // First collect all single values as name/value pairs, which are
+    // written in the same way in both formats.
+    std::vector<std::pair<std::string, std::string> > values;
+    values.push_back(std::make_pair("track",
+                                    quote(m_track->getIdent(), csv)));
+    values.push_back(std::make_pair("num_karts",
+                                  StringUtils::toString(m_karts.size())));
+    values.push_back(std::make_pair("mode",
+        quote(m_profile_mode==PROFILE_LAPS ? "laps" : "time", csv)));
+    values.push_back(std::make_pair("laps",
+                          StringUtils::toString(race_manager->getNumLaps())));
+    values.push_back(std::make_pair("no_graphics",
+                                    m_no_graphics ? "true" : "false"));
+    values.push_back(std::make_pair("frames",
+                                    StringUtils::toString(m_frame_count)));
+    values.push_back(std::make_pair("runtime", number(runtime, csv)));
+    values.push_back(std::make_pair("fps",
+                                    number(m_frame_count/runtime, csv)));
+    values.push_back(std::make_pair("frame_time_p50",
+                                number(getPercentile(sorted, 50), csv)));
+    values.push_back(std::make_pair("frame_time_p95",
+                                number(getPercentile(sorted, 95), csv)));
+    values.push_back(std::make_pair("frame_time_p99",
+                                number(getPercentile(sorted, 99), csv)));
+    values.push_back(std::make_pair("frame_time_max",
+                         number(sorted.empty() ? 0 : sorted.back(), csv)));
+    values.push_back(std::make_pair("physics_steps",
+                         StringUtils::toString(getPhysics()->getNumSteps())));
+    values.push_back(std::make_pair("memory_high_water_mark_kb",
+                         StringUtils::toString(getMemoryHighWaterMark())));
+    if(!m_no_graphics && m_frame_count>0)
+    {
+        values.push_back(std::make_pair("mesh_draws_per_frame",
+           number((float)m_num_mesh_draws/m_frame_count, csv)));
+        values.push_back(std::make_pair("program_switches_per_frame",
+           number((float)m_num_program_switches/m_frame_count, csv)));
+        values.push_back(std::make_pair("texture_switches_per_frame",
+           number((float)m_num_texture_switches/m_frame_count, csv)));
+        values.push_back(std::make_pair("vao_switches_per_frame",
+           number((float)m_num_vao_switches/m_frame_count, csv)));
+    }
+
+    const Profiler::StatisticsMap &phases = profiler.getStatistics();
+    Profiler::StatisticsMap::const_iterator p;
+
+    if(csv)
+    {
+        fprintf(f, "name,value\n");
+        for(unsigned int i=0; i<values.size(); i++)
+            fprintf(f, "%s,%s\n", values[i].first.c_str(),
+                    values[i].second.c_str());
+        for(p=phases.begin(); p!=phases.end(); p++)
+        {
+            std::string name = "phase:"+p->first+":";
+            fprintf(f, "%s,%s\n", quote(name+"total_ms", true).c_str(),
+                    number(p->second.total, true).c_str());
+            fprintf(f, "%s,%s\n", quote(name+"max_ms", true).c_str(),
+                    number(p->second.max, true).c_str());
+            fprintf(f, "%s,%u\n", quote(name+"count", true).c_str(),
+                    p->second.count);
+        }
+        for(unsigned int i=0; i<m_karts.size(); i++)
+        {
+            KartWithStats* kart = dynamic_cast<KartWithStats*>(m_karts[i]);
+            std::string name = "kart:"+StringUtils::toString(i)+":"
+                             + kart->getIdent()+":";
+            fprintf(f, "%s,%s\n", quote(name+"finish_time", true).c_str(),
+                    number(kart->getFinishTime(), true).c_str());
+            fprintf(f, "%s,%d\n", quote(name+"position", true).c_str(),
+                    kart->getPosition());
+        }
+        fclose(f);
+        return;
+    }
+
+    fprintf(f, "{\n");
+    for(unsigned int i=0; i<values.size(); i++)
+        fprintf(f, "  \"%s\": %s,\n", values[i].first.c_str(),
+                values[i].second.c_str());
+
+    fprintf(f, "  \"phases\": {");
+    for(p=phases.begin(); p!=phases.end(); p++)
+    {
+        double per_frame = m_frame_count>0 ? p->second.total/m_frame_count
+                                           : 0.0;
+        fprintf(f, "%s\n    %s: {\"total_ms\": %s, \"max_ms\": %s, "
+                "\"count\": %u, \"ms_per_frame\": %s}",
+                p==phases.begin() ? "" : ",", quote(p->first, false).c_str(),
+                number(p->second.total, false).c_str(),
+                number(p->second.max, false).c_str(), p->second.count,
+                number(per_frame, false).c_str());
+    }
+    fprintf(f, "\n  },\n");
+
+    fprintf(f, "  \"karts\": [");
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        KartWithStats* kart = dynamic_cast<KartWithStats*>(m_karts[i]);
+        fprintf(f, "%s\n    {\"name\": %s, \"controller\": %s, "
+                "\"start_position\": %d, \"end_position\": %d, "
+                "\"finish_time\": %s, \"top_speed\": %s, "
+                "\"rescue_count\": %u, \"explosion_count\": %u, "
+                "\"off_track_count\": %u}",
+                i==0 ? "" : ",", quote(kart->getIdent(), false).c_str(),
+                quote(kart->getController()->getControllerName(),
+                      false).c_str(),
+                1+i, kart->getPosition(),
+                number(kart->getFinishTime(), false).c_str(),
+                number(kart->getTopSpeed(), false).c_str(),
+                kart->getRescueCount(), kart->getExplosionCount(),
+                kart->getOffTrackCount());
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}   // writeStatistics
@@ -20,6 +20,10 @@
 #define HEADER_PROFILE_WORLD_HPP
 
 #include "modes/standard_race.hpp"
+#include "utils/types.hpp"
+
+#include <string>
+#include <vector>
 
 class Kart;
 
@@ -43,6 +47,14 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** If the positions of all karts should be recorded, and replayed
+     *  at the end of the race to benchmark the road sector lookup. */
+    static bool  m_sector_benchmark;
+
+    /** For each kart the positions in each frame (only if
+     *  m_sector_benchmark is set). */
+    std::vector< std::vector<Vec3> > m_kart_positions;
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -67,6 +79,25 @@ private:
     /** Number of calls to draw. */
     long long    m_num_calls;
 
+    /** Number of draw calls, program, texture and vertex array switches
+     *  of the STKMesh object passes. */
+    long long    m_num_mesh_draws;
+    long long    m_num_program_switches;
+    long long    m_num_texture_switches;
+    long long    m_num_vao_switches;
+
+    /** If not empty, the statistics are also written to this file, as
+     *  JSON or (if the name ends in .csv) as CSV. */
+    static std::string m_output_file;
+
+    /** Real time of each frame in milliseconds. */
+    std::vector<float> m_frame_times;
+
+    /** Real time of the previous frame, in microseconds. */
+    uint64_t     m_last_frame_time;
+
+    void         writeStatistics(float runtime);
+
 protected:
     /** In laps based profiling: number of laps to run. Also
      *  used by DemoWorld. */
@@ -88,9 +119,16 @@ public:
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
     // ------------------------------------------------------------------------
+    /** Sets the file to which the statistics are written. */
+    static   void setOutputFile(const std::string &name)
+                                                  { m_output_file = name; }
+    // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
     // ------------------------------------------------------------------------
+    /** Records all kart positions to benchmark the road sector lookup. */
+    static   void enableSectorBenchmark() { m_sector_benchmark = true; }
+    // ------------------------------------------------------------------------
     /** Switches off graphics. */
     static   void disableGraphics() { m_no_graphics = true; }
     // ------------------------------------------------------------------------
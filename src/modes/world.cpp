@@ -64,6 +64,7 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 World* World::m_world = NULL;
 
@@ -825,15 +826,31 @@ void World::update(float dt)
 
     if (!history->dontDoPhysics())
     {
+        PROFILER_PUSH_CPU_MARKER("Physics", 0x7F, 0x7F, 0x00);
         m_physics->update(dt);
+        PROFILER_POP_CPU_MARKER();
     }
 
     const int kart_amount = m_karts.size();
+
+    // Let the controllers precompute the read-only parts of their update
+    // in parallel. A precomputed result is only used if its input did not
+    // change, so the karts are updated exactly as without this step.
+    if (WorkerPool::get() && !history->replayHistory())
+    {
+        PROFILER_PUSH_CPU_MARKER("World::prepareKartUpdate", 0x00, 0x7F, 0x7F);
+        WorkerPool::get()->parallelFor(kart_amount, &World::prepareKartUpdate,
+                                       this);
+        PROFILER_POP_CPU_MARKER();
+    }
+
+    PROFILER_PUSH_CPU_MARKER("Karts update", 0x7F, 0x00, 0x00);
     for (int i = 0 ; i < kart_amount; ++i)
     {
         // Update all karts that are not eliminated
         if(!m_karts[i]->isEliminated()) m_karts[i]->update(dt) ;
     }
+    PROFILER_POP_CPU_MARKER();
 
     for(unsigned int i=0; i<Camera::getNumCameras(); i++)
     {
@@ -849,6 +866,44 @@ void World::update(float dt)
 #endif
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Called once per frame after the simulation steps of this frame, to place
+ *  the karts, projectiles and cameras between the last two simulation steps.
+ *  \param alpha Fraction of a simulation step that has passed since the
+ *         last simulation step.
+ */
+void World::updateGraphics(float alpha)
+{
+    PROFILER_PUSH_CPU_MARKER("World::updateGraphics", 0x00, 0x3F, 0x7F);
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if(!m_karts[i]->isEliminated())
+            m_karts[i]->interpolateGraphics(alpha);
+    }
+    if(ReplayPlay::get()) ReplayPlay::get()->updateGraphics(alpha);
+    projectile_manager->updateGraphics(alpha);
+
+    for(unsigned int i=0; i<Camera::getNumCameras(); i++)
+    {
+        Camera *camera = Camera::getCamera(i);
+        camera->setSmoothingOffset(camera->getKart()->getSmoothingOffset());
+    }
+    PROFILER_POP_CPU_MARKER();
+}   // updateGraphics
+
+// ----------------------------------------------------------------------------
+/** Job function for the worker pool: calls prepareUpdate for the controller
+ *  of one kart.
+ *  \param index Index of the kart.
+ *  \param world Pointer to the world.
+ */
+void World::prepareKartUpdate(int index, void *world)
+{
+    AbstractKart *kart = ((World*)world)->m_karts[index];
+    if(!kart->isEliminated() && kart->getController())
+        kart->getController()->prepareUpdate();
+}   // prepareKartUpdate
+
 // ----------------------------------------------------------------------------
 /** Only updates the track. The order in which the various parts of STK are
  *  updated is quite important (i.e. the track can't be updated as part of
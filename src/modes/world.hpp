@@ -161,6 +161,7 @@ protected:
     virtual void  update(float dt);
     virtual void  createRaceGUI();
             void  updateTrack(float dt);
+    static  void  prepareKartUpdate(int index, void *world);
     void moveKartTo(AbstractKart* kart, const btTransform &t);
     // ------------------------------------------------------------------------
     /** Used for AI karts that are still racing when all player kart finished.
@@ -269,6 +270,7 @@ public:
     void            scheduleExitRace() { m_schedule_exit_race = true; }
     void            scheduleTutorial();
     void            updateWorld(float dt);
+    void            updateGraphics(float alpha);
     void            handleExplosion(const Vec3 &xyz, AbstractKart *kart_hit,
                                     PhysicalObject *object);
     AbstractKart*   getPlayerKart(unsigned int player) const;
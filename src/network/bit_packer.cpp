@@ -0,0 +1,116 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/bit_packer.hpp"
+
+#include <assert.h>
+
+BitWriter::BitWriter(NetworkString *ns)
+{
+    m_string       = ns;
+    m_scratch      = 0;
+    m_scratch_bits = 0;
+    m_bit_count    = 0;
+}   // BitWriter
+
+// ----------------------------------------------------------------------------
+/** Writes the lowest bits of a value.
+ *  \param value The value to write.
+ *  \param bits Number of bits to write (1 to 32).
+ */
+void BitWriter::write(uint32_t value, int bits)
+{
+    assert(bits > 0 && bits <= 32);
+    if (bits < 32)
+        value &= (1u << bits) - 1;
+    m_scratch       = (m_scratch << bits) | value;
+    m_scratch_bits += bits;
+    m_bit_count    += bits;
+    while (m_scratch_bits >= 8)
+    {
+        m_scratch_bits -= 8;
+        m_string->addUInt8((uint8_t)(m_scratch >> m_scratch_bits));
+    }
+}   // write
+
+// ----------------------------------------------------------------------------
+/** Writes a signed value as two's complement. The value must fit into the
+ *  given number of bits.
+ */
+void BitWriter::writeSigned(int32_t value, int bits)
+{
+    assert(bits==32 || (value >= -(1 << (bits-1)) && value < (1 << (bits-1))));
+    write((uint32_t)value, bits);
+}   // writeSigned
+
+// ----------------------------------------------------------------------------
+/** Writes the remaining bits to the string, padding the last byte with 0.
+ */
+void BitWriter::flush()
+{
+    if (m_scratch_bits == 0)
+        return;
+    m_string->addUInt8((uint8_t)(m_scratch << (8-m_scratch_bits)));
+    m_scratch      = 0;
+    m_scratch_bits = 0;
+}   // flush
+
+// ============================================================================
+BitReader::BitReader(const NetworkString &ns, int byte_offset)
+         : m_string(ns)
+{
+    m_bit_pos = byte_offset*8;
+    m_valid   = true;
+}   // BitReader
+
+// ----------------------------------------------------------------------------
+/** Reads an unsigned value.
+ *  \param bits Number of bits to read (1 to 32).
+ */
+uint32_t BitReader::read(int bits)
+{
+    assert(bits > 0 && bits <= 32);
+    if (m_bit_pos + bits > m_string.size()*8)
+    {
+        m_valid = false;
+        return 0;
+    }
+    uint32_t result = 0;
+    while (bits > 0)
+    {
+        int byte_bit = m_bit_pos & 7;
+        int available = 8 - byte_bit;
+        int n = bits < available ? bits : available;
+        uint8_t byte = m_string.getUInt8(m_bit_pos >> 3);
+        uint32_t chunk = (byte >> (available - n)) & ((1u << n) - 1);
+        result     = (result << n) | chunk;
+        m_bit_pos += n;
+        bits      -= n;
+    }
+    return result;
+}   // read
+
+// ----------------------------------------------------------------------------
+/** Reads a signed value written with BitWriter::writeSigned. */
+int32_t BitReader::readSigned(int bits)
+{
+    uint32_t value = read(bits);
+    if (bits < 32 && (value & (1u << (bits-1))))
+        value |= ~((1u << bits) - 1);   // sign extension
+    return (int32_t)value;
+}   // readSigned
@@ -0,0 +1,89 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file bit_packer.hpp
+ *  \brief Classes to write and read values using an arbitrary number of
+ *  bits into/from a NetworkString.
+ */
+
+#ifndef BIT_PACKER_HPP
+#define BIT_PACKER_HPP
+
+#include "network/network_string.hpp"
+#include "utils/types.hpp"
+
+/** \class BitWriter
+ *  \brief Appends values of up to 32 bits to a NetworkString.
+ *  Bits are written most significant first. The last byte is padded with
+ *  0 when flush() is called (which the destructor does as well).
+ */
+class BitWriter
+{
+    private:
+        /** The string the bytes are appended to. */
+        NetworkString *m_string;
+        /** Bits not yet written to the string, right aligned. */
+        uint64_t       m_scratch;
+        /** Number of bits in m_scratch. */
+        int            m_scratch_bits;
+        /** Total number of bits written. */
+        int            m_bit_count;
+
+    public:
+        BitWriter(NetworkString *ns);
+        ~BitWriter() { flush(); }
+        void write(uint32_t value, int bits);
+        void writeSigned(int32_t value, int bits);
+        void flush();
+        // --------------------------------------------------------------------
+        /** Writes a single bit. */
+        void writeBool(bool value) { write(value ? 1 : 0, 1); }
+        // --------------------------------------------------------------------
+        /** Returns the number of bits written so far. */
+        int getBitCount() const { return m_bit_count; }
+};   // BitWriter
+
+// ============================================================================
+/** \class BitReader
+ *  \brief Reads values written by a BitWriter from a NetworkString.
+ *  Reading past the end of the string returns 0 and marks the reader as
+ *  invalid, so that messages can be checked once after decoding.
+ */
+class BitReader
+{
+    private:
+        /** The string to read from. */
+        const NetworkString &m_string;
+        /** Position of the next bit to read, from the start of the string. */
+        int                  m_bit_pos;
+        /** False if an attempt was made to read past the end. */
+        bool                 m_valid;
+
+    public:
+        BitReader(const NetworkString &ns, int byte_offset=0);
+        uint32_t read(int bits);
+        int32_t  readSigned(int bits);
+        // --------------------------------------------------------------------
+        /** Reads a single bit. */
+        bool readBool() { return read(1) != 0; }
+        // --------------------------------------------------------------------
+        /** False if more bits were read than available. */
+        bool isValid() const { return m_valid; }
+};   // BitReader
+
+#endif // BIT_PACKER_HPP
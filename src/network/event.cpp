@@ -20,11 +20,13 @@
 #include "network/network_manager.hpp"
 
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <string.h>
 
 Event::Event(ENetEvent* event)
 {
+    m_arrival_time = StkTime::getMonoTimeUs();
     switch (event->type)
     {
     case ENET_EVENT_TYPE_CONNECT:
@@ -42,18 +44,16 @@ Event::Event(ENetEvent* event)
     }
     if (type == EVENT_TYPE_MESSAGE)
     {
-        m_data = NetworkString(std::string((char*)(event->packet->data), event->packet->dataLength-1));
+        // Wrap the packet without copying it: the data is shared by all
+        // protocols receiving this event, and the packet is destroyed once
+        // the last string using it is freed. The last byte is the 0 added
+        // by the sender.
+        m_data = NetworkString(event->packet, event->packet->dataLength-1);
     }
+    else if (event->packet)
+        enet_packet_destroy(event->packet);
 
-    m_packet = NULL;
-    if (event->packet)
-        m_packet = event->packet;
-
-    if (m_packet)
-        enet_packet_destroy(m_packet); // we got all we need, just remove the data.
-    m_packet = NULL;
-
-    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    const std::vector<STKPeer*> &peers = NetworkManager::getInstance()->getPeers();
     peer = new STKPeer*;
     *peer = NULL;
     for (unsigned int i = 0; i < peers.size(); i++)
@@ -76,8 +76,8 @@ Event::Event(ENetEvent* event)
 
 Event::Event(const Event& event)
 {
-    m_packet = NULL;
     m_data = event.m_data;
+    m_arrival_time = event.m_arrival_time;
     // copy the peer
     peer = event.peer;
     type = event.type;
@@ -86,7 +86,6 @@ Event::Event(const Event& event)
 Event::~Event()
 {
     peer = NULL;
-    m_packet = NULL;
 }
 
 void Event::removeFront(int size)
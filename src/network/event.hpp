@@ -61,27 +61,34 @@ class Event
          */
         Event(const Event& event);
         /*! \brief Destructor
-         *  frees the memory of the ENetPacket.
+         *  The ENetPacket is freed when the last string using it is deleted.
          */
         ~Event();
 
         /*! \brief Remove bytes at the beginning of data.
+         *  This only moves the read cursor, no data is copied.
          *  \param size : The number of bytes to remove.
          */
         void removeFront(int size);
 
-        /*! \brief Get a copy of the data.
-         *  \return A copy of the message data. This is empty for events like
-         *  connection or disconnections.
+        /*! \brief Get the data.
+         *  \return The message data. This is empty for events like
+         *  connection or disconnections. Copying it is cheap, since the bytes
+         *  are shared with the received packet.
          */
-        NetworkString data() const { return m_data; }
+        const NetworkString& data() const { return m_data; }
+
+        /*! \brief Get the time at which the event was received.
+         *  \return The receive time, see StkTime::getMonoTimeUs().
+         */
+        uint64_t getArrivalTime() const { return m_arrival_time; }
 
         EVENT_TYPE type;    //!< Type of the event.
         STKPeer** peer;     //!< Pointer to the peer that triggered that event.
 
     private:
-        NetworkString m_data; //!< Copy of the data passed by the event.
-        ENetPacket* m_packet; //!< A pointer on the ENetPacket to be deleted.
+        NetworkString m_data; //!< View on the data of the received packet.
+        uint64_t m_arrival_time; //!< When the event was received (in us).
 };
 
 #endif // EVENT_HPP
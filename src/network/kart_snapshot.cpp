@@ -0,0 +1,405 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_snapshot.hpp"
+
+#include "network/bit_packer.hpp"
+
+#include <assert.h>
+#include <math.h>
+
+/** Largest absolute value of the three smallest components of a unit
+ *  quaternion (1/sqrt(2)). */
+static const float ROTATION_RANGE = 0.70710678f;
+
+/** Bits used for a small difference to a predicted position. */
+static const int SMALL_DELTA_BITS    = 6;
+/** Bits used for the change of a rotation component. */
+static const int ROTATION_DELTA_BITS = 5;
+
+/** How a coordinate is stored by encodePredicted. */
+enum { POS_SAME = 0, POS_SMALL = 1, POS_DELTA = 2, POS_ABSOLUTE = 3 };
+/** How a rotation is stored by encodePredicted. */
+enum { ROT_SAME = 0, ROT_DELTA = 1, ROT_ABSOLUTE = 2 };
+
+// ----------------------------------------------------------------------------
+/** Returns one of the three smallest components of a compressed rotation
+ *  (see compressRotation), 0 being the first one written.
+ */
+static int rotationComponent(uint32_t rotation, int i)
+{
+    const int shift = (2-i)*KartSnapshot::ROTATION_BITS;
+    return (rotation >> shift) & ((1 << KartSnapshot::ROTATION_BITS) - 1);
+}   // rotationComponent
+
+// ----------------------------------------------------------------------------
+/** Quantizes a position and rotation.
+ */
+KartState KartSnapshot::quantize(const Vec3 &xyz, const btQuaternion &rotation)
+{
+    KartState state;
+    const int32_t limit = (1 << (POSITION_BITS-1)) - 1;
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t v = (int32_t)floorf(xyz[i]*POSITION_SCALE + 0.5f);
+        if (v >  limit) v =  limit;
+        if (v < -limit) v = -limit;
+        state.m_xyz[i] = v;
+    }
+    state.m_rotation = compressRotation(rotation);
+    return state;
+}   // quantize
+
+// ----------------------------------------------------------------------------
+/** Compresses a quaternion using the smallest-three method: the index of
+ *  the largest component (2 bits) followed by the three other components
+ *  (ROTATION_BITS each). Since q and -q are the same rotation, the
+ *  quaternion is negated if necessary so that the largest component is
+ *  positive, and can be recomputed from the unit length.
+ */
+uint32_t KartSnapshot::compressRotation(const btQuaternion &q)
+{
+    float c[4] = { q.x(), q.y(), q.z(), q.w() };
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    }
+    float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    const int max_value = (1 << ROTATION_BITS) - 1;
+    uint32_t result = largest;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        float f = (sign*c[i] + ROTATION_RANGE) / (2.0f*ROTATION_RANGE);
+        int v = (int)floorf(f*max_value + 0.5f);
+        if (v < 0) v = 0;
+        if (v > max_value) v = max_value;
+        result = (result << ROTATION_BITS) | v;
+    }
+    return result;
+}   // compressRotation
+
+// ----------------------------------------------------------------------------
+/** Restores a quaternion compressed with compressRotation.
+ */
+btQuaternion KartSnapshot::decompressRotation(uint32_t compressed)
+{
+    const int max_value = (1 << ROTATION_BITS) - 1;
+    int largest = (compressed >> (3*ROTATION_BITS)) & 3;
+    float c[4];
+    float sum = 0;
+    for (int i = 3; i >= 0; i--)
+    {
+        if (i == largest) continue;
+        int v = compressed & max_value;
+        compressed >>= ROTATION_BITS;
+        c[i] = v/(float)max_value * 2.0f*ROTATION_RANGE - ROTATION_RANGE;
+        sum += c[i]*c[i];
+    }
+    c[largest] = sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f;
+    btQuaternion q(c[0], c[1], c[2], c[3]);
+    return q.normalize();
+}   // decompressRotation
+
+// ----------------------------------------------------------------------------
+/** Sets the state of a kart in this snapshot.
+ */
+void KartSnapshot::set(unsigned int kart_id, const Vec3 &xyz,
+                       const btQuaternion &rotation)
+{
+    if (kart_id >= m_karts.size())
+        m_karts.resize(kart_id+1);
+    m_karts[kart_id] = quantize(xyz, rotation);
+}   // set
+
+// ----------------------------------------------------------------------------
+/** Returns the position stored in a quantized state. */
+Vec3 KartSnapshot::toXYZ(const KartState &state)
+{
+    return Vec3(state.m_xyz[0] / (float)POSITION_SCALE,
+                state.m_xyz[1] / (float)POSITION_SCALE,
+                state.m_xyz[2] / (float)POSITION_SCALE);
+}   // toXYZ
+
+// ----------------------------------------------------------------------------
+/** Returns the rotation stored in a quantized state. */
+btQuaternion KartSnapshot::toRotation(const KartState &state)
+{
+    return decompressRotation(state.m_rotation);
+}   // toRotation
+
+// ----------------------------------------------------------------------------
+Vec3 KartSnapshot::getXYZ(unsigned int kart_id) const
+{
+    return toXYZ(m_karts[kart_id]);
+}   // getXYZ
+
+// ----------------------------------------------------------------------------
+btQuaternion KartSnapshot::getRotation(unsigned int kart_id) const
+{
+    return toRotation(m_karts[kart_id]);
+}   // getRotation
+
+// ----------------------------------------------------------------------------
+/** Writes a single kart state without any baseline.
+ */
+void KartSnapshot::encodeState(const KartState &state, BitWriter *writer)
+{
+    for (int i = 0; i < 3; i++)
+        writer->writeSigned(state.m_xyz[i], POSITION_BITS);
+    writer->write(state.m_rotation, 2+3*ROTATION_BITS);
+}   // encodeState
+
+// ----------------------------------------------------------------------------
+/** Reads a single kart state written by encodeState.
+ *  \return False if the data was too short.
+ */
+bool KartSnapshot::decodeState(BitReader *reader, KartState *state)
+{
+    for (int i = 0; i < 3; i++)
+        state->m_xyz[i] = reader->readSigned(POSITION_BITS);
+    state->m_rotation = reader->read(2+3*ROTATION_BITS);
+    return reader->isValid();
+}   // decodeState
+
+// ----------------------------------------------------------------------------
+/** Writes a kart state relative to the previous states of the same kart,
+ *  as used for recorded data where a state is stored for every time step.
+ *  The position is predicted by linear extrapolation from the two previous
+ *  states, and only the (usually very small) difference to the prediction
+ *  is written. A rotation that did not change costs 2 bits, a small change
+ *  of all components 17 bits.
+ *  \param state The state to write.
+ *  \param prev The previous state, or NULL to write the state absolute.
+ *  \param prev2 The state before prev, or NULL to only use prev as
+ *         prediction.
+ *  \param writer Where to write the data.
+ */
+void KartSnapshot::encodePredicted(const KartState &state,
+                                   const KartState *prev,
+                                   const KartState *prev2,
+                                   BitWriter *writer)
+{
+    if (!prev)
+    {
+        encodeState(state, writer);
+        return;
+    }
+    const int32_t small_limit = 1 << (SMALL_DELTA_BITS-1);
+    const int32_t delta_limit = 1 << (DELTA_BITS-1);
+    for (int j = 0; j < 3; j++)
+    {
+        int32_t predicted = prev2 ? 2*prev->m_xyz[j] - prev2->m_xyz[j]
+                                  : prev->m_xyz[j];
+        int32_t residual  = state.m_xyz[j] - predicted;
+        if (residual == 0)
+            writer->write(POS_SAME, 2);
+        else if (residual >= -small_limit && residual < small_limit)
+        {
+            writer->write(POS_SMALL, 2);
+            writer->writeSigned(residual, SMALL_DELTA_BITS);
+        }
+        else if (residual >= -delta_limit && residual < delta_limit)
+        {
+            writer->write(POS_DELTA, 2);
+            writer->writeSigned(residual, DELTA_BITS);
+        }
+        else
+        {
+            writer->write(POS_ABSOLUTE, 2);
+            writer->writeSigned(state.m_xyz[j], POSITION_BITS);
+        }
+    }
+
+    if (state.m_rotation == prev->m_rotation)
+    {
+        writer->write(ROT_SAME, 2);
+        return;
+    }
+    // A small change can only be stored if the largest component is the same
+    const int largest_shift = 3*ROTATION_BITS;
+    bool small_change = (state.m_rotation >> largest_shift)
+                     == (prev->m_rotation >> largest_shift);
+    const int rotation_limit = 1 << (ROTATION_DELTA_BITS-1);
+    int delta[3];
+    for (int j = 0; j < 3 && small_change; j++)
+    {
+        delta[j] = rotationComponent(state.m_rotation, j)
+                 - rotationComponent(prev->m_rotation, j);
+        small_change = delta[j] >= -rotation_limit &&
+                       delta[j] <   rotation_limit;
+    }
+    if (small_change)
+    {
+        writer->write(ROT_DELTA, 2);
+        for (int j = 0; j < 3; j++)
+            writer->writeSigned(delta[j], ROTATION_DELTA_BITS);
+    }
+    else
+    {
+        writer->write(ROT_ABSOLUTE, 2);
+        writer->write(state.m_rotation, 2+3*ROTATION_BITS);
+    }
+}   // encodePredicted
+
+// ----------------------------------------------------------------------------
+/** Reads a kart state written by encodePredicted. The same previous states
+ *  as used when writing must be given.
+ *  \return False if the data was invalid.
+ */
+bool KartSnapshot::decodePredicted(BitReader *reader, const KartState *prev,
+                                   const KartState *prev2, KartState *state)
+{
+    if (!prev)
+        return decodeState(reader, state);
+
+    for (int j = 0; j < 3; j++)
+    {
+        int32_t predicted = prev2 ? 2*prev->m_xyz[j] - prev2->m_xyz[j]
+                                  : prev->m_xyz[j];
+        switch (reader->read(2))
+        {
+        case POS_SAME:
+            state->m_xyz[j] = predicted;
+            break;
+        case POS_SMALL:
+            state->m_xyz[j] = predicted + reader->readSigned(SMALL_DELTA_BITS);
+            break;
+        case POS_DELTA:
+            state->m_xyz[j] = predicted + reader->readSigned(DELTA_BITS);
+            break;
+        default:
+            state->m_xyz[j] = reader->readSigned(POSITION_BITS);
+        }
+    }
+
+    switch (reader->read(2))
+    {
+    case ROT_SAME:
+        state->m_rotation = prev->m_rotation;
+        break;
+    case ROT_DELTA:
+    {
+        const int max_value = (1 << ROTATION_BITS) - 1;
+        uint32_t rotation = prev->m_rotation >> (3*ROTATION_BITS);
+        for (int j = 0; j < 3; j++)
+        {
+            int c = rotationComponent(prev->m_rotation, j)
+                  + reader->readSigned(ROTATION_DELTA_BITS);
+            rotation = (rotation << ROTATION_BITS) | (c & max_value);
+        }
+        state->m_rotation = rotation;
+        break;
+    }
+    case ROT_ABSOLUTE:
+        state->m_rotation = reader->read(2+3*ROTATION_BITS);
+        break;
+    default:
+        return false;
+    }
+    return reader->isValid();
+}   // decodePredicted
+
+// ----------------------------------------------------------------------------
+/** Writes this snapshot, relative to a baseline if one is given. For each
+ *  kart one bit tells if it changed. For changed karts each coordinate is
+ *  either a short delta to the baseline or an absolute value, and the
+ *  rotation is only sent if it changed.
+ *  \param baseline The snapshot the receiver is known to have, or NULL.
+ *         It must contain the same number of karts as this snapshot.
+ *  \param writer Where to write the data.
+ */
+void KartSnapshot::encode(const KartSnapshot *baseline,
+                          BitWriter *writer) const
+{
+    assert(!baseline || baseline->getNumKarts() == m_karts.size());
+    writer->write(m_karts.size(), 8);
+    const int32_t delta_limit = 1 << (DELTA_BITS-1);
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        const KartState &s = m_karts[i];
+        if (!baseline)
+        {
+            encodeState(s, writer);
+            continue;
+        }
+        const KartState &b = baseline->m_karts[i];
+        if (s == b)
+        {
+            writer->writeBool(false);
+            continue;
+        }
+        writer->writeBool(true);
+        for (int j = 0; j < 3; j++)
+        {
+            int32_t delta = s.m_xyz[j] - b.m_xyz[j];
+            if (delta >= -delta_limit && delta < delta_limit)
+            {
+                writer->writeBool(true);
+                writer->writeSigned(delta, DELTA_BITS);
+            }
+            else
+            {
+                writer->writeBool(false);
+                writer->writeSigned(s.m_xyz[j], POSITION_BITS);
+            }
+        }
+        writer->writeBool(s.m_rotation != b.m_rotation);
+        if (s.m_rotation != b.m_rotation)
+            writer->write(s.m_rotation, 2+3*ROTATION_BITS);
+    }
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Reads a snapshot written by encode().
+ *  \param baseline The baseline used by the sender, or NULL if the
+ *         snapshot was sent without a baseline.
+ *  \param reader Where to read the data from.
+ *  \return False if the data was invalid.
+ */
+bool KartSnapshot::decode(const KartSnapshot *baseline, BitReader *reader)
+{
+    unsigned int num_karts = reader->read(8);
+    if (baseline && baseline->getNumKarts() != num_karts)
+        return false;
+    m_karts.resize(num_karts);
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        KartState &s = m_karts[i];
+        if (!baseline)
+        {
+            decodeState(reader, &s);
+            continue;
+        }
+        s = baseline->m_karts[i];
+        if (!reader->readBool())
+            continue;
+        for (int j = 0; j < 3; j++)
+        {
+            if (reader->readBool())
+                s.m_xyz[j] += reader->readSigned(DELTA_BITS);
+            else
+                s.m_xyz[j]  = reader->readSigned(POSITION_BITS);
+        }
+        if (reader->readBool())
+            s.m_rotation = reader->read(2+3*ROTATION_BITS);
+    }
+    return reader->isValid();
+}   // decode
@@ -0,0 +1,126 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_snapshot.hpp
+ *  \brief Compact encoding of the position and rotation of all karts.
+ */
+
+#ifndef KART_SNAPSHOT_HPP
+#define KART_SNAPSHOT_HPP
+
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+class BitReader;
+class BitWriter;
+
+/*! \struct KartState
+ *  \brief Quantized position and rotation of one kart.
+ */
+struct KartState
+{
+    /** Position in units of 1/KartSnapshot::POSITION_SCALE meters. */
+    int32_t  m_xyz[3];
+    /** Rotation compressed with the smallest-three method. */
+    uint32_t m_rotation;
+
+    bool operator==(const KartState &other) const
+    {
+        return m_xyz[0]==other.m_xyz[0] && m_xyz[1]==other.m_xyz[1] &&
+               m_xyz[2]==other.m_xyz[2] && m_rotation==other.m_rotation;
+    }
+};   // KartState
+
+/*! \class KartSnapshot
+ *  \brief The state of all karts at one point in time, as sent by the
+ *  server to the clients.
+ *  Positions are quantized to POSITION_SCALE units per meter, rotations
+ *  are compressed to 32 bits by only sending the three smallest components
+ *  of the quaternion (the largest one follows from the unit length).
+ *  A snapshot can be encoded relative to an older snapshot (the last one
+ *  acknowledged by a client): karts that did not move then cost one bit,
+ *  and small position changes are sent as short deltas.
+ */
+class KartSnapshot
+{
+    public:
+        /** Number of position units per meter. */
+        static const int POSITION_SCALE = 256;
+        /** Bits used for an absolute position coordinate (+-8 km). */
+        static const int POSITION_BITS  = 22;
+        /** Bits used for a position delta (+-8 m). */
+        static const int DELTA_BITS     = 12;
+        /** Bits used for each of the three smallest quaternion components.*/
+        static const int ROTATION_BITS  = 10;
+
+    private:
+        /** Sequence number of this snapshot. */
+        uint16_t               m_sequence;
+        /** State of each kart, indexed by world kart id. */
+        std::vector<KartState> m_karts;
+
+    public:
+                 KartSnapshot() : m_sequence(0) {}
+        void     set(unsigned int kart_id, const Vec3 &xyz,
+                     const btQuaternion &rotation);
+        void     encode(const KartSnapshot *baseline, BitWriter *writer) const;
+        bool     decode(const KartSnapshot *baseline, BitReader *reader);
+        Vec3     getXYZ(unsigned int kart_id) const;
+        btQuaternion getRotation(unsigned int kart_id) const;
+
+        static KartState    quantize(const Vec3 &xyz,
+                                     const btQuaternion &rotation);
+        static Vec3         toXYZ(const KartState &state);
+        static btQuaternion toRotation(const KartState &state);
+        static uint32_t     compressRotation(const btQuaternion &q);
+        static btQuaternion decompressRotation(uint32_t compressed);
+        static void         encodeState(const KartState &state,
+                                        BitWriter *writer);
+        static bool         decodeState(BitReader *reader, KartState *state);
+        static void         encodePredicted(const KartState &state,
+                                            const KartState *prev,
+                                            const KartState *prev2,
+                                            BitWriter *writer);
+        static bool         decodePredicted(BitReader *reader,
+                                            const KartState *prev,
+                                            const KartState *prev2,
+                                            KartState *state);
+
+        // --------------------------------------------------------------------
+        /** Sets the number of karts in this snapshot. */
+        void setNumKarts(unsigned int n) { m_karts.resize(n); }
+        // --------------------------------------------------------------------
+        /** Returns the number of karts in this snapshot. */
+        unsigned int getNumKarts() const { return m_karts.size(); }
+        // --------------------------------------------------------------------
+        /** Returns the quantized state of a kart. */
+        const KartState& getState(unsigned int kart_id) const
+        {
+            return m_karts[kart_id];
+        }
+        // --------------------------------------------------------------------
+        void     setSequence(uint16_t sequence) { m_sequence = sequence; }
+        // --------------------------------------------------------------------
+        uint16_t getSequence() const { return m_sequence; }
+};   // KartSnapshot
+
+#endif // KART_SNAPSHOT_HPP
@@ -0,0 +1,123 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_state_buffer.hpp"
+
+const float KartStateBuffer::MAX_EXTRAPOLATION = 0.2f;
+
+KartStateBuffer::KartStateBuffer()
+{
+    m_time_offset = 0;
+    m_interval    = 0.1;
+}   // KartStateBuffer
+
+// ----------------------------------------------------------------------------
+/** Adds a received state.
+ *  \param sender_time Time of the state on the sender's clock, which
+ *         must never run backwards.
+ *  \param local_time Local time at which the state was received.
+ *  \param xyz Position of the kart.
+ *  \param rotation Rotation of the kart.
+ */
+void KartStateBuffer::add(double sender_time, double local_time,
+                          const Vec3 &xyz, const btQuaternion &rotation)
+{
+    // The packet with the smallest latency gives the largest offset. Slowly
+    // follow if the latency increases.
+    double offset = sender_time - local_time;
+    if (m_samples.empty() || offset > m_time_offset)
+        m_time_offset = offset;
+    else
+        m_time_offset += (offset - m_time_offset)*0.02;
+
+    Sample sample;
+    sample.m_time     = sender_time;
+    sample.m_xyz      = xyz;
+    sample.m_rotation = rotation;
+
+    if (m_samples.empty() || sender_time > m_samples.back().m_time)
+    {
+        if (!m_samples.empty())
+        {
+            double interval = sender_time - m_samples.back().m_time;
+            m_interval += (interval - m_interval)*0.1;
+        }
+        m_samples.push_back(sample);
+    }
+    else
+    {
+        // Out of order packet: insert it at the right place, unless it is
+        // a duplicate or older than everything we have.
+        std::deque<Sample>::iterator i = m_samples.end();
+        while (i != m_samples.begin() && (i-1)->m_time > sender_time)
+            i--;
+        if (i == m_samples.begin() || (i-1)->m_time == sender_time)
+            return;
+        m_samples.insert(i, sample);
+    }
+    while (m_samples.size() > MAX_SAMPLES)
+        m_samples.pop_front();
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Computes the state to display at the given local time.
+ *  \param local_time The current local time.
+ *  \param xyz On return the position.
+ *  \param rotation On return the rotation.
+ *  \param velocity On return the velocity between the two samples used,
+ *         or zero if the extrapolation limit was reached.
+ *  \return False if there is no sample.
+ */
+bool KartStateBuffer::getState(double local_time, Vec3 *xyz,
+                               btQuaternion *rotation, Vec3 *velocity) const
+{
+    if (m_samples.empty())
+        return false;
+    if (m_samples.size() == 1)
+    {
+        *xyz      = m_samples.back().m_xyz;
+        *rotation = m_samples.back().m_rotation;
+        *velocity = Vec3(0, 0, 0);
+        return true;
+    }
+
+    double time = local_time + m_time_offset - getDelay();
+    bool clamped = time > m_samples.back().m_time + MAX_EXTRAPOLATION;
+    if (clamped)
+        time = m_samples.back().m_time + MAX_EXTRAPOLATION;
+
+    // Find the two samples around time, or the last two if time is after
+    // the last sample (extrapolation).
+    unsigned int b = 1;
+    while (b < m_samples.size()-1 && m_samples[b].m_time < time)
+        b++;
+    const Sample &s0 = m_samples[b-1];
+    const Sample &s1 = m_samples[b];
+    double dt = s1.m_time - s0.m_time;
+    float f = (float)((time - s0.m_time)/dt);
+    if (f < 0) f = 0;
+
+    *xyz      = s0.m_xyz + (s1.m_xyz - s0.m_xyz)*f;
+    // The kart is shown standing at the last extrapolated position
+    *velocity = clamped ? Vec3(0, 0, 0) : (s1.m_xyz - s0.m_xyz) / (float)dt;
+    if (f <= 1.0f)
+        *rotation = s0.m_rotation.slerp(s1.m_rotation, f);
+    else
+        *rotation = s1.m_rotation;
+    return true;
+}   // getState
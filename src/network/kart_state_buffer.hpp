@@ -0,0 +1,82 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_state_buffer.hpp
+ *  \brief Jitter buffer to interpolate the state of a remote kart.
+ */
+
+#ifndef KART_STATE_BUFFER_HPP
+#define KART_STATE_BUFFER_HPP
+
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <deque>
+
+/*! \class KartStateBuffer
+ *  \brief Stores the last states received for a remote kart, time-stamped
+ *  with the sender's clock, and interpolates between them.
+ *  The state is shown with a delay of about 1.5 times the interval between
+ *  updates, so that there usually are two samples around the displayed
+ *  time even if packets arrive with some jitter. If updates stop, the last
+ *  movement is extrapolated for at most MAX_EXTRAPOLATION seconds.
+ *  The offset between the sender's clock and the local clock is estimated
+ *  from the fastest packets received, so that the two clocks do not need
+ *  to be synchronised.
+ */
+class KartStateBuffer
+{
+    public:
+        /** Maximum number of samples kept. */
+        static const unsigned int MAX_SAMPLES = 16;
+        /** Maximum time to extrapolate past the last sample, in seconds. */
+        static const float MAX_EXTRAPOLATION;
+
+    private:
+        struct Sample
+        {
+            double       m_time;
+            Vec3         m_xyz;
+            btQuaternion m_rotation;
+        };
+
+        /** Samples received, sorted by time. */
+        std::deque<Sample> m_samples;
+
+        /** Estimated sender time minus local time. */
+        double             m_time_offset;
+
+        /** Smoothed interval between samples, in seconds. */
+        double             m_interval;
+
+    public:
+             KartStateBuffer();
+        void add(double sender_time, double local_time, const Vec3 &xyz,
+                 const btQuaternion &rotation);
+        bool getState(double local_time, Vec3 *xyz, btQuaternion *rotation,
+                      Vec3 *velocity) const;
+        // --------------------------------------------------------------------
+        /** True if no sample was received yet. */
+        bool isEmpty() const { return m_samples.empty(); }
+        // --------------------------------------------------------------------
+        /** Returns the delay with which the states are displayed. */
+        double getDelay() const { return 1.5*m_interval + 0.01; }
+};   // KartStateBuffer
+
+#endif // KART_STATE_BUFFER_HPP
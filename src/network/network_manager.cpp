@@ -104,31 +104,23 @@ void NetworkManager::setManualSocketsMode(bool manual)
 }
 
 //-----------------------------------------------------------------------------
-
-void NetworkManager::notifyEvent(Event* event)
-{
-    Log::verbose("NetworkManager", "EVENT received of type %d", (int)(event->type));
-    STKPeer* peer = *event->peer;
-    if (event->type == EVENT_TYPE_CONNECTED)
-    {
-        Log::info("NetworkManager", "A client has just connected. There are now %lu peers.", m_peers.size() + 1);
-        Log::debug("NetworkManager", "Addresses are : %lx, %lx, %lx", event->peer, *event->peer, peer);
-        // create the new peer:
-        m_peers.push_back(peer);
-    }
-    if (event->type == EVENT_TYPE_MESSAGE)
+/** Handles a batch of received events: the peer list is updated for all
+ *  events first, and then the whole batch is handed to the protocol
+ *  manager at once, which takes ownership of the events.
+ *  \param events The received events, in the order they were received.
+ */
+void NetworkManager::notifyEvents(const std::vector<Event*> &events)
+{
+    for (unsigned int i = 0; i < events.size(); i++)
     {
-        uint32_t addr = peer->getAddress();
-        Log::verbose("NetworkManager", "Message, Sender : %i.%i.%i.%i, message = \"%s\"",
-                  ((addr>>24)&0xff),
-                  ((addr>>16)&0xff),
-                  ((addr>>8)&0xff),
-                  (addr&0xff), event->data().c_str());
-
+        Event *event = events[i];
+        if (event->type == EVENT_TYPE_CONNECTED)
+        {
+            Log::info("NetworkManager", "A client has just connected. There are now %lu peers.", m_peers.size() + 1);
+            m_peers.push_back(*event->peer);
+        }
     }
-
-    // notify for the event now.
-    ProtocolManager::getInstance()->notifyEvent(event);
+    ProtocolManager::getInstance()->notifyEvents(events);
 }
 
 //-----------------------------------------------------------------------------
@@ -74,7 +74,7 @@ class NetworkManager : public Singleton<NetworkManager>
         virtual void setManualSocketsMode(bool manual);
 
         // message/packets related functions
-        virtual void notifyEvent(Event* event);
+        virtual void notifyEvents(const std::vector<Event*> &events);
         virtual void sendPacket(const NetworkString& data, 
                                 bool reliable = true) = 0;
         virtual void sendPacket(STKPeer* peer, 
@@ -101,7 +101,7 @@ class NetworkManager : public Singleton<NetworkManager>
         inline bool isClient()              { return !isServer();       }
         bool isPlayingOnline()              { return m_playing_online;  }
         STKHost* getHost()                  { return m_localhost;       }
-        std::vector<STKPeer*> getPeers()    { return m_peers;           }
+        const std::vector<STKPeer*>& getPeers() const { return m_peers; }
         unsigned int getPeerCount()         { return m_peers.size();    }
         TransportAddress getPublicAddress() { return m_public_address;  }
         GameSetup* getGameSetup()           { return m_game_setup;      }
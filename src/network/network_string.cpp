@@ -1,5 +1,42 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
 #include "network/network_string.hpp"
 
+#include "utils/atomic.hpp"
+
+// ----------------------------------------------------------------------------
+/** Adds a reference to this buffer. */
+void NetworkBuffer::grab()
+{
+    Atomic::increment(&m_ref_count);
+}   // grab
+
+// ----------------------------------------------------------------------------
+/** Removes a reference to this buffer, and deletes it (and the packet it
+ *  might wrap) if it was the last one. */
+void NetworkBuffer::drop()
+{
+    if (Atomic::decrement(&m_ref_count) == 0)
+        delete this;
+}   // drop
+
+// ----------------------------------------------------------------------------
 NetworkString operator+(NetworkString const& a, NetworkString const& b)
 {
     NetworkString ns(a);
@@ -23,8 +23,11 @@
 #ifndef NETWORK_STRING_HPP
 #define NETWORK_STRING_HPP
 
+#include "utils/no_copy.hpp"
 #include "utils/types.hpp"
 
+#include <enet/enet.h>
+
 #include <string>
 #include <vector>
 #include <stdarg.h>
@@ -32,34 +35,172 @@
 
 typedef unsigned char uchar;
 
+/** \class NetworkBuffer
+ *  \brief Reference counted storage for the bytes of a NetworkString.
+ *  A buffer either owns a vector of bytes (for strings that are built
+ *  locally), or wraps a received ENetPacket without copying its data. In
+ *  the latter case the packet is destroyed when the last NetworkString
+ *  using it is deleted. Reference counting is atomic, since received
+ *  events are shared between the network thread and the protocol threads.
+ */
+class NetworkBuffer : public NoCopy
+{
+    private:
+        /** Number of NetworkStrings using this buffer. */
+        volatile long        m_ref_count;
+        /** The received packet if this buffer wraps one, NULL otherwise. */
+        ENetPacket          *m_packet;
+        /** The bytes of this buffer if it does not wrap a packet. */
+        std::vector<uint8_t> m_bytes;
+
+    public:
+        NetworkBuffer(ENetPacket *packet = NULL)
+        {
+            m_ref_count = 1;
+            m_packet    = packet;
+        }   // NetworkBuffer
+        // --------------------------------------------------------------------
+        ~NetworkBuffer()
+        {
+            if (m_packet)
+                enet_packet_destroy(m_packet);
+        }   // ~NetworkBuffer
+        // --------------------------------------------------------------------
+        void grab();
+        void drop();
+        // --------------------------------------------------------------------
+        /** Returns a pointer to the first byte of this buffer. */
+        const uint8_t* getBytes() const
+        {
+            if (m_packet)
+                return m_packet->data;
+            return m_bytes.empty() ? NULL : &(m_bytes[0]);
+        }   // getBytes
+        // --------------------------------------------------------------------
+        /** True if this buffer can be modified in place, i.e. it is not
+         *  shared and does not wrap a received packet. */
+        bool isWritable() const { return m_packet==NULL && m_ref_count==1; }
+        // --------------------------------------------------------------------
+        /** Gives access to the bytes of a writable buffer. */
+        std::vector<uint8_t>& getVector()
+        {
+            assert(isWritable());
+            return m_bytes;
+        }   // getVector
+};   // NetworkBuffer
+
+// ============================================================================
 /** \class NetworkString
  *  \brief Describes a chain of 8-bit unsigned integers.
  *  This class allows you to easily create and parse 8-bit strings.
+ *  The bytes are stored in a shared NetworkBuffer, and a NetworkString is
+ *  only a view (offset and size) into that buffer: copying a string only
+ *  increases a reference count, and removing bytes at the front only moves
+ *  the read cursor. A string is copied to its own buffer the first time it
+ *  is modified while being shared (copy-on-write).
  */
 class NetworkString
 {
-    union {
+    mutable union {
     float f;
     uint8_t i[4];
     } f_as_i; // float as integer
-    union {
+    mutable union {
     double d;
     uint8_t i[8];
     } d_as_i; // double as integer
+
+    /** Makes sure that this string has its own buffer that can be
+     *  modified in place, copying the viewed bytes if necessary. */
+    void makeWritable()
+    {
+        if (m_buffer && m_buffer->isWritable())
+            return;
+        NetworkBuffer *buffer = new NetworkBuffer();
+        if (m_size > 0)
+            buffer->getVector().assign(getBytes(), getBytes()+m_size);
+        if (m_buffer)
+            m_buffer->drop();
+        m_buffer = buffer;
+        m_offset = 0;
+    }   // makeWritable
+    // ------------------------------------------------------------------------
+    /** Appends one byte at the end of this string. */
+    void push(uint8_t value)
+    {
+        makeWritable();
+        m_buffer->getVector().push_back(value);
+        m_size++;
+    }   // push
+    // ------------------------------------------------------------------------
+    /** Shares the buffer of another string. */
+    void share(const NetworkString &other)
+    {
+        m_buffer = other.m_buffer;
+        m_offset = other.m_offset;
+        m_size   = other.m_size;
+        if (m_buffer)
+            m_buffer->grab();
+    }   // share
+
     public:
-        NetworkString() { }
-        NetworkString(const uint8_t& value) { m_string.push_back(value); }
-        NetworkString(NetworkString const& copy) { m_string = copy.m_string; }
-        NetworkString(const std::string & value) { m_string = std::vector<uint8_t>(value.begin(), value.end()); }
+        NetworkString() : m_buffer(NULL), m_offset(0), m_size(0) { }
+        NetworkString(const uint8_t& value)
+                    : m_buffer(NULL), m_offset(0), m_size(0) { push(value); }
+        NetworkString(NetworkString const& copy) { share(copy); }
+        NetworkString(const std::string & value)
+                    : m_buffer(NULL), m_offset(0), m_size(0)
+        {
+            addString(value);
+        }
+        /** Wraps a received packet without copying its data. The string
+         *  takes ownership of the packet.
+         *  \param packet The received packet.
+         *  \param size Number of bytes of the packet to use.
+         */
+        NetworkString(ENetPacket* packet, int size)
+        {
+            m_buffer = new NetworkBuffer(packet);
+            m_offset = 0;
+            m_size   = size;
+        }
+        ~NetworkString()
+        {
+            if (m_buffer)
+                m_buffer->drop();
+        }
+        NetworkString& operator=(NetworkString const& other)
+        {
+            if (this == &other)
+                return *this;
+            NetworkBuffer *old = m_buffer;
+            share(other);
+            if (old)
+                old->drop();
+            return *this;
+        }
+
+        /** Returns a pointer to the first byte of this string. */
+        const uint8_t* getBytes() const
+        {
+            return m_buffer ? m_buffer->getBytes()+m_offset : NULL;
+        }
 
         NetworkString& removeFront(int size)
         {
-            m_string.erase(m_string.begin(), m_string.begin()+size);
+            assert(size <= m_size);
+            m_offset += size;
+            m_size   -= size;
             return *this;
         }
         NetworkString& remove(int pos, int size)
         {
-            m_string.erase(m_string.begin()+pos, m_string.begin()+pos+size);
+            if (pos == 0)
+                return removeFront(size);
+            makeWritable();
+            std::vector<uint8_t> &v = m_buffer->getVector();
+            v.erase(v.begin()+m_offset+pos, v.begin()+m_offset+pos+size);
+            m_size -= size;
             return *this;
         }
 
@@ -70,32 +211,32 @@ class NetworkString
 
         NetworkString& addUInt8(const uint8_t& value)
         {
-            m_string.push_back(value);
+            push(value);
             return *this;
         }
         inline NetworkString& ai8(const uint8_t& value) { return addUInt8(value); }
         NetworkString& addUInt16(const uint16_t& value)
         {
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
+            push((value>>8)&0xff);
+            push(value&0xff);
             return *this;
         }
         inline NetworkString& ai16(const uint16_t& value) { return addUInt16(value); }
         NetworkString& addUInt32(const uint32_t& value)
         {
-            m_string.push_back((value>>24)&0xff);
-            m_string.push_back((value>>16)&0xff);
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
+            push((value>>24)&0xff);
+            push((value>>16)&0xff);
+            push((value>>8)&0xff);
+            push(value&0xff);
             return *this;
         }
         inline NetworkString& ai32(const uint32_t& value) { return addUInt32(value); }
         NetworkString& addInt(const int& value)
         {
-            m_string.push_back((value>>24)&0xff);
-            m_string.push_back((value>>16)&0xff);
-            m_string.push_back((value>>8)&0xff);
-            m_string.push_back(value&0xff);
+            push((value>>24)&0xff);
+            push((value>>16)&0xff);
+            push((value>>8)&0xff);
+            push(value&0xff);
             return *this;
         }
         inline NetworkString& ai(const int& value) { return addInt(value); }
@@ -103,10 +244,10 @@ class NetworkString
         {
             assert(sizeof(float)==4);
             f_as_i.f = value;
-            m_string.push_back(f_as_i.i[0]);
-            m_string.push_back(f_as_i.i[1]);
-            m_string.push_back(f_as_i.i[2]);
-            m_string.push_back(f_as_i.i[3]);
+            push(f_as_i.i[0]);
+            push(f_as_i.i[1]);
+            push(f_as_i.i[2]);
+            push(f_as_i.i[3]);
             return *this;
         }
         inline NetworkString& af(const float& value) { return addFloat(value); }
@@ -114,57 +255,66 @@ class NetworkString
         {
             assert(sizeof(double)==8);
             d_as_i.d = value;
-            m_string.push_back(d_as_i.i[0]);
-            m_string.push_back(d_as_i.i[1]);
-            m_string.push_back(d_as_i.i[2]);
-            m_string.push_back(d_as_i.i[3]);
-            m_string.push_back(d_as_i.i[4]);
-            m_string.push_back(d_as_i.i[5]);
-            m_string.push_back(d_as_i.i[6]);
-            m_string.push_back(d_as_i.i[7]);
+            for (int i = 0; i < 8; i++)
+                push(d_as_i.i[i]);
             return *this;
         }
         inline NetworkString& ad(const double& value) { return addDouble(value); }
         NetworkString& addChar(const char& value)
         {
-            m_string.push_back((uint8_t)(value));
+            push((uint8_t)(value));
             return *this;
         }
         inline NetworkString& ac(const char& value) { return addChar(value); }
 
         NetworkString& addString(const std::string& value)
         {
-            for (unsigned int i = 0; i < value.size(); i++)
-                m_string.push_back((uint8_t)(value[i]));
+            if (value.empty())
+                return *this;
+            makeWritable();
+            m_buffer->getVector().insert(m_buffer->getVector().end(),
+                                         value.begin(), value.end());
+            m_size += value.size();
             return *this;
         }
         inline NetworkString& as(const std::string& value) { return addString(value); }
 
         NetworkString& operator+=(NetworkString const& value)
         {
-            m_string.insert( m_string.end(), value.m_string.begin(), value.m_string.end() );
+            if (value.size() == 0)
+                return *this;
+            if (m_size == 0)
+                return *this = value;
+            // Keep a reference in case value is this string.
+            NetworkString copy(value);
+            makeWritable();
+            m_buffer->getVector().insert(m_buffer->getVector().end(),
+                                         copy.getBytes(),
+                                         copy.getBytes()+copy.size());
+            m_size += copy.size();
             return *this;
         }
 
         const char* c_str() const
         {
-            std::string str(m_string.begin(), m_string.end());
+            std::string str(getBytes(), getBytes()+m_size);
             return str.c_str();
         }
         int size() const
         {
-            return m_string.size();
+            return m_size;
         }
 
         template<typename T, size_t n>
         T get(int pos) const
         {
+            const uint8_t *bytes = getBytes();
             int a = n;
             T result = 0;
             while(a--)
             {
                 result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data to result
+                result += ((uint8_t)(bytes[pos+n-1-a]) & 0xff); // add the data to result
             }
             return result;
         }
@@ -176,7 +326,7 @@ class NetworkString
         inline uint8_t      getUInt8(int pos = 0)  const { return get<uint8_t,1>(pos);         }
         inline char         getChar(int pos = 0)   const { return get<char,1>(pos);            }
         inline unsigned char getUChar(int pos = 0) const { return get<unsigned char,1>(pos);   }
-        std::string         getString(int pos, int len) const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         getString(int pos, int len) const { return std::string(getBytes()+pos, getBytes()+pos+len); }
 
         inline int          gi(int pos = 0)        const { return get<int,4>(pos);             }
         inline uint32_t     gui(int pos = 0)       const { return get<uint32_t,4>(pos);        }
@@ -185,18 +335,18 @@ class NetworkString
         inline uint8_t      gui8(int pos = 0)      const { return get<uint8_t,1>(pos);         }
         inline char         gc(int pos = 0)        const { return get<char,1>(pos);            }
         inline unsigned char guc(int pos = 0)      const { return get<unsigned char,1>(pos);   }
-        std::string         gs(int pos, int len)   const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         gs(int pos, int len)   const { return std::string(getBytes()+pos, getBytes()+pos+len); }
 
-        double getDouble(int pos = 0) //!< BEWARE OF PRECISION
+        double getDouble(int pos = 0) const //!< BEWARE OF PRECISION
         {
             for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
+                d_as_i.i[i] = getBytes()[pos+i];
             return d_as_i.d;
         }
-        float getFloat(int pos = 0) //!< BEWARE OF PRECISION
+        float getFloat(int pos = 0) const //!< BEWARE OF PRECISION
         {
             for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
+                f_as_i.i[i] = getBytes()[pos+i];
             return f_as_i.f;
         }
 
@@ -204,13 +354,7 @@ class NetworkString
         template<typename T, size_t n>
         T getAndRemove(int pos)
         {
-            int a = n;
-            T result = 0;
-            while(a--)
-            {
-                result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data
-            }
+            T result = get<T, n>(pos);
             remove(pos,n);
             return result;
         }
@@ -225,14 +369,14 @@ class NetworkString
         double getAndRemoveDouble(int pos = 0) //!< BEWARE OF PRECISION
         {
             for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
+                d_as_i.i[i] = getBytes()[pos+i];
             return d_as_i.d;
             remove(pos, 8);
         }
         float getAndRemoveFloat(int pos = 0) //!< BEWARE OF PRECISION
         {
             for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
+                f_as_i.i[i] = getBytes()[pos+i];
             return f_as_i.f;
             remove(pos, 4);
         }
@@ -248,7 +392,12 @@ class NetworkString
         inline NetworkString& gf(float* dst)       { *dst = getAndRemoveFloat(0);  return *this; }
 
     protected:
-        std::vector<uint8_t> m_string;
+        /** The shared buffer holding the bytes, NULL for an empty string. */
+        NetworkBuffer *m_buffer;
+        /** Offset of the first byte of this string in the buffer. */
+        int            m_offset;
+        /** Number of bytes in this string. */
+        int            m_size;
 };
 
 NetworkString operator+(NetworkString const& a, NetworkString const& b);
@@ -0,0 +1,198 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/packet_capture.hpp"
+
+#include "utils/atomic.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/time.hpp"
+
+#include <errno.h>
+#ifdef WIN32
+#  include <sys/timeb.h>
+#else
+#  include <sys/time.h>
+#endif
+
+/** Time in milliseconds between two writes of the captured packets. */
+static const int WRITE_INTERVAL = 100;
+
+// ----------------------------------------------------------------------------
+/** Opens the capture file and starts the writer thread.
+ *  \param filename Name of the file to write to.
+ */
+PacketCapture::PacketCapture(const std::string &filename)
+{
+    m_abort          = false;
+    m_ring           = NULL;
+    m_write_position = 0;
+    m_read_position  = 0;
+    m_num_dropped    = 0;
+    m_file           = fopen(filename.c_str(), "wb");
+    if (!m_file)
+    {
+        Log::warn("PacketCapture", "Can't open '%s', packets won't be "
+                  "captured.", filename.c_str());
+        return;
+    }
+    uint32_t version = FORMAT_VERSION;
+    fwrite("STKP", 4, 1, m_file);
+    fwrite(&version, sizeof(version), 1, m_file);
+
+    m_ring = new Record[RING_SIZE];
+    for (long i = 0; i < RING_SIZE; i++)
+        m_ring[i].m_sequence = i;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+    pthread_create(&m_thread, NULL, &PacketCapture::mainLoop, this);
+}   // PacketCapture
+
+// ----------------------------------------------------------------------------
+/** Stops the writer thread, writes all remaining packets and closes the
+ *  file. No packet must be captured anymore once this is called.
+ */
+PacketCapture::~PacketCapture()
+{
+    if (!m_file)
+        return;
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+
+    writeRecords();
+    fclose(m_file);
+    delete [] m_ring;
+    if (m_num_dropped > 0)
+        Log::warn("PacketCapture", "%ld packets were not captured.",
+                  m_num_dropped);
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_cond);
+}   // ~PacketCapture
+
+// ----------------------------------------------------------------------------
+/** Adds a packet to the capture. Can be called from any thread, and does
+ *  not block: a thread claims the next free record of the ring by
+ *  advancing the write position, fills it, and then marks it as filled.
+ *  \param data The data of the packet.
+ *  \param incoming True if the packet was received, false if it was sent.
+ */
+void PacketCapture::capture(const NetworkString &data, bool incoming)
+{
+    if (!m_file)
+        return;
+    long position = m_write_position;
+    Record *record;
+    while (true)
+    {
+        record = &m_ring[position & (RING_SIZE-1)];
+        long diff = record->m_sequence - position;
+        if (diff == 0)
+        {
+            if (Atomic::compareAndSwap(&m_write_position, position,
+                                       position+1))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // The writer thread did not write this record yet
+            Atomic::increment(&m_num_dropped);
+            return;
+        }
+        position = m_write_position;
+    }
+    record->m_time     = StkTime::getMonoTimeUs();
+    record->m_incoming = incoming;
+    record->m_data     = data;
+    // Only mark the record as filled once the data is stored
+    Atomic::memoryBarrier();
+    record->m_sequence = position+1;
+}   // capture
+
+// ----------------------------------------------------------------------------
+/** The writer thread: writes the captured packets every WRITE_INTERVAL
+ *  milliseconds until the capture is stopped.
+ *  \param obj Pointer to the packet capture.
+ */
+void *PacketCapture::mainLoop(void *obj)
+{
+    PacketCapture *me = (PacketCapture*)obj;
+    PROFILER_REGISTER_THREAD("Packet capture");
+    pthread_mutex_lock(&me->m_mutex);
+    while (!me->m_abort)
+    {
+        struct timespec timeout;
+#ifdef WIN32
+        struct _timeb now;
+        _ftime(&now);
+        long usec = now.millitm*1000 + WRITE_INTERVAL*1000;
+        timeout.tv_sec = (long)now.time + usec/1000000;
+#else
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long usec = now.tv_usec + WRITE_INTERVAL*1000;
+        timeout.tv_sec = now.tv_sec + usec/1000000;
+#endif
+        timeout.tv_nsec = (usec%1000000)*1000;
+        pthread_cond_timedwait(&me->m_cond, &me->m_mutex, &timeout);
+        if (me->m_abort)
+            break;
+
+        pthread_mutex_unlock(&me->m_mutex);
+        PROFILER_PUSH_CPU_MARKER("Write packets", 0x00, 0x7F, 0x7F);
+        me->writeRecords();
+        PROFILER_POP_CPU_MARKER();
+        pthread_mutex_lock(&me->m_mutex);
+    }
+    pthread_mutex_unlock(&me->m_mutex);
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Writes all filled records of the ring into the file, and makes them
+ *  available for new packets. */
+void PacketCapture::writeRecords()
+{
+    bool written = false;
+    while (true)
+    {
+        Record *record = &m_ring[m_read_position & (RING_SIZE-1)];
+        if (record->m_sequence != m_read_position+1)
+            break;
+        // Read the record only after its sequence number
+        Atomic::memoryBarrier();
+        uint8_t  incoming = record->m_incoming ? 1 : 0;
+        uint32_t size     = record->m_data.size();
+        fwrite(&record->m_time, sizeof(record->m_time), 1, m_file);
+        fwrite(&incoming, sizeof(incoming), 1, m_file);
+        fwrite(&size, sizeof(size), 1, m_file);
+        if (size > 0)
+            fwrite(record->m_data.getBytes(), size, 1, m_file);
+        // Release the shared data before the record can be reused
+        record->m_data = NetworkString();
+        Atomic::memoryBarrier();
+        record->m_sequence = m_read_position + RING_SIZE;
+        m_read_position++;
+        written = true;
+    }
+    if (written)
+        fflush(m_file);
+}   // writeRecords
@@ -0,0 +1,97 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file packet_capture.hpp
+ *  \brief Asynchronous binary capture of all network packets.
+ */
+
+#ifndef PACKET_CAPTURE_HPP
+#define PACKET_CAPTURE_HPP
+
+#include "network/network_string.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string>
+
+/*! \class PacketCapture
+ *  \brief Writes all captured packets into a binary file.
+ *  Capturing a packet only stores it in a preallocated lock-free ring
+ *  buffer (the data of the network string is shared, not copied). A
+ *  separate thread regularly empties the ring and writes the packets to
+ *  the file, so the network threads never wait for the file, a lock or
+ *  the memory allocator. If the ring is full, the packet is not captured.
+ *  The file starts with the 4 bytes "STKP" and a 32 bit format version,
+ *  followed by one record per packet: the time in microseconds (64 bit),
+ *  1 byte that is 1 for incoming and 0 for outgoing packets, the size of
+ *  the data (32 bit) and the data itself. All numbers are stored in the
+ *  byte order of the machine that wrote the file.
+ */
+class PacketCapture : public NoCopy
+{
+    private:
+        /** Number of records in the ring, must be a power of 2. */
+        static const long RING_SIZE = 4096;
+
+        struct Record
+        {
+            /** Equal to the write position for which this record is free,
+             *  and one more once the record is filled. */
+            volatile long m_sequence;
+            uint64_t      m_time;
+            bool          m_incoming;
+            NetworkString m_data;
+        };
+
+        /** Ring of packets not written yet, filled by any number of
+         *  threads and emptied by the writer thread. */
+        Record         *m_ring;
+        /** Position of the next record to fill. */
+        volatile long   m_write_position;
+        /** Position of the next record to write, only used by the writer
+         *  thread. */
+        long            m_read_position;
+        /** Number of packets not captured because the ring was full. */
+        volatile long   m_num_dropped;
+
+        FILE           *m_file;
+        pthread_t       m_thread;
+
+        /** Used to wake up the writer thread when capturing stops. */
+        pthread_mutex_t m_mutex;
+        pthread_cond_t  m_cond;
+        bool            m_abort;
+
+        static void    *mainLoop(void *obj);
+        void            writeRecords();
+
+    public:
+        /** Version of the file format. */
+        static const uint32_t FORMAT_VERSION = 1;
+
+                 PacketCapture(const std::string &filename);
+                ~PacketCapture();
+        void     capture(const NetworkString &data, bool incoming);
+        // --------------------------------------------------------------------
+        /** Returns true if the capture file could be opened. */
+        bool     isOpen() const { return m_file!=NULL; }
+};   // PacketCapture
+
+#endif // PACKET_CAPTURE_HPP
@@ -20,13 +20,20 @@
 
 #include "network/protocol.hpp"
 #include "network/network_manager.hpp"
+#include "utils/atomic.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
 #include <assert.h>
 #include <cstdlib>
 #include <errno.h>
 #include <typeinfo>
+#ifdef WIN32
+#  include <sys/timeb.h>
+#else
+#  include <sys/time.h>
+#endif
 
 void* protocolManagerUpdate(void* data)
 {
@@ -41,11 +48,14 @@ void* protocolManagerUpdate(void* data)
 void* protocolManagerAsynchronousUpdate(void* data)
 {
     ProtocolManager* manager = static_cast<ProtocolManager*>(data);
+    PROFILER_REGISTER_THREAD("Protocol manager");
     manager->m_asynchronous_thread_running = true;
     while(manager && !manager->exit())
     {
+        PROFILER_PUSH_CPU_MARKER("Protocol manager async update", 0x7F, 0x00, 0x7F);
         manager->asynchronousUpdate();
-        StkTime::sleep(2);
+        PROFILER_POP_CPU_MARKER();
+        manager->waitForEvents(2);
     }
     manager->m_asynchronous_thread_running = false;
     return NULL;
@@ -59,6 +69,9 @@ ProtocolManager::ProtocolManager()
     pthread_mutex_init(&m_requests_mutex, NULL);
     pthread_mutex_init(&m_id_mutex, NULL);
     pthread_mutex_init(&m_exit_mutex, NULL);
+    pthread_mutex_init(&m_wakeup_mutex, NULL);
+    pthread_cond_init(&m_wakeup_cond, NULL);
+    m_consumer_waiting = 0;
     m_next_protocol_id = 0;
 
 
@@ -82,7 +95,9 @@ ProtocolManager::~ProtocolManager()
 void ProtocolManager::abort()
 {
     pthread_mutex_unlock(&m_exit_mutex); // will stop the update function
+    wakeUp();
     pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
+    m_event_latency.print("ProtocolManager", "Event receive-to-dispatch time");
     pthread_mutex_lock(&m_events_mutex);
     pthread_mutex_lock(&m_protocols_mutex);
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
@@ -91,7 +106,16 @@ void ProtocolManager::abort()
     for (unsigned int i = 0; i < m_protocols.size() ; i++)
         delete m_protocols[i].protocol;
     for (unsigned int i = 0; i < m_events_to_process.size() ; i++)
+    {
+        delete m_events_to_process[i].event->peer;
         delete m_events_to_process[i].event;
+    }
+    Event* event;
+    while (m_incoming_events.pop(&event))
+    {
+        delete event->peer;
+        delete event;
+    }
     m_protocols.clear();
     m_requests.clear();
     m_events_to_process.clear();
@@ -107,57 +131,124 @@ void ProtocolManager::abort()
     pthread_mutex_destroy(&m_requests_mutex);
     pthread_mutex_destroy(&m_id_mutex);
     pthread_mutex_destroy(&m_exit_mutex);
+    pthread_mutex_destroy(&m_wakeup_mutex);
+    pthread_cond_destroy(&m_wakeup_cond);
 }
 
 void ProtocolManager::notifyEvent(Event* event)
 {
-    pthread_mutex_lock(&m_events_mutex);
-    Event* event2 = new Event(*event);
-    // register protocols that will receive this event
-    std::vector<unsigned int> protocols_ids;
-    PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
-    if (event2->type == EVENT_TYPE_MESSAGE)
+    // No lock here: the network thread only hands the event over, it is
+    // routed to the protocols by the asynchronous update thread.
+    m_incoming_events.push(event);
+    Atomic::memoryBarrier();
+    if (m_consumer_waiting)
+        wakeUp();
+}
+
+void ProtocolManager::notifyEvents(const std::vector<Event*> &events)
+{
+    for (unsigned int i = 0; i < events.size(); i++)
+        m_incoming_events.push(events[i]);
+    Atomic::memoryBarrier();
+    if (m_consumer_waiting)
+        wakeUp();
+}
+
+void ProtocolManager::wakeUp()
+{
+    pthread_mutex_lock(&m_wakeup_mutex);
+    pthread_cond_signal(&m_wakeup_cond);
+    pthread_mutex_unlock(&m_wakeup_mutex);
+}
+
+void ProtocolManager::waitForEvents(int msec)
+{
+    pthread_mutex_lock(&m_wakeup_mutex);
+    m_consumer_waiting = 1;
+    Atomic::memoryBarrier();
+    // A producer that pushed an event before seeing m_consumer_waiting set
+    // did not signal, so check the queue again before sleeping.
+    if (m_incoming_events.isEmpty() && !exit())
     {
-        if (event2->data().size() > 0)
+        struct timespec timeout;
+#ifdef WIN32
+        struct _timeb now;
+        _ftime(&now);
+        long usec = now.millitm*1000 + msec*1000;
+        timeout.tv_sec = (long)now.time + usec/1000000;
+#else
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        long usec = now.tv_usec + msec*1000;
+        timeout.tv_sec = now.tv_sec + usec/1000000;
+#endif
+        timeout.tv_nsec = (usec%1000000)*1000;
+        pthread_cond_timedwait(&m_wakeup_cond, &m_wakeup_mutex, &timeout);
+    }
+    m_consumer_waiting = 0;
+    pthread_mutex_unlock(&m_wakeup_mutex);
+}
+
+void ProtocolManager::routeIncomingEvents()
+{
+    Event* event;
+    while (m_incoming_events.pop(&event))
+    {
+        // register protocols that will receive this event
+        std::vector<unsigned int> protocols_ids;
+        PROTOCOL_TYPE searchedProtocol = PROTOCOL_NONE;
+        if (event->type == EVENT_TYPE_MESSAGE)
         {
-            searchedProtocol = (PROTOCOL_TYPE)(event2->data()[0]);
-            event2->removeFront(1);
+            if (event->data().size() > 0)
+            {
+                searchedProtocol = (PROTOCOL_TYPE)(event->data()[0]);
+                event->removeFront(1);
+            }
+            else
+            {
+                Log::warn("ProtocolManager", "Not enough data.");
+            }
         }
-        else
+        if (event->type == EVENT_TYPE_CONNECTED)
         {
-            Log::warn("ProtocolManager", "Not enough data.");
+            searchedProtocol = PROTOCOL_CONNECTION;
         }
-    }
-    if (event2->type == EVENT_TYPE_CONNECTED)
-    {
-        searchedProtocol = PROTOCOL_CONNECTION;
-    }
-    Log::verbose("ProtocolManager", "Received event for protocols of type %d", searchedProtocol);
-    pthread_mutex_lock(&m_protocols_mutex);
-    for (unsigned int i = 0; i < m_protocols.size() ; i++)
-    {
-        if (m_protocols[i].protocol->getProtocolType() == searchedProtocol || event2->type == EVENT_TYPE_DISCONNECTED) // pass data to protocols even when paused
+        static Log::RateLimit limit(20);
+        Log::verbose(limit, "ProtocolManager",
+                     "Received event for protocols of type %d",
+                     searchedProtocol);
+        pthread_mutex_lock(&m_protocols_mutex);
+        for (unsigned int i = 0; i < m_protocols.size() ; i++)
         {
-            protocols_ids.push_back(m_protocols[i].id);
+            if (m_protocols[i].protocol->getProtocolType() == searchedProtocol || event->type == EVENT_TYPE_DISCONNECTED) // pass data to protocols even when paused
+            {
+                protocols_ids.push_back(m_protocols[i].id);
+            }
+        }
+        pthread_mutex_unlock(&m_protocols_mutex);
+        if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
+        {
+            Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event->data().c_str());
         }
-    }
-    pthread_mutex_unlock(&m_protocols_mutex);
-    if (searchedProtocol == PROTOCOL_NONE) // no protocol was aimed, show the msg to debug
-    {
-        Log::debug("ProtocolManager", "NO PROTOCOL : Message is \"%s\"", event2->data().c_str());
-    }
 
-    if (protocols_ids.size() != 0)
-    {
-        EventProcessingInfo epi;
-        epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
-        epi.event = event2;
-        epi.protocols_ids = protocols_ids;
-        m_events_to_process.push_back(epi); // add the event to the queue
+        if (protocols_ids.size() != 0)
+        {
+            EventProcessingInfo epi;
+            epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
+            epi.event = event;
+            epi.protocols_ids = protocols_ids;
+            epi.dispatched = false;
+            pthread_mutex_lock(&m_events_mutex);
+            m_events_to_process.push_back(epi); // add the event to the queue
+            pthread_mutex_unlock(&m_events_mutex);
+        }
+        else
+        {
+            Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
+            delete event->peer;
+            delete event;
+        }
     }
-    else
-        Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
-    pthread_mutex_unlock(&m_events_mutex);
 }
 
 void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message, bool reliable)
@@ -327,6 +418,12 @@ void ProtocolManager::protocolTerminated(ProtocolInfo protocol)
 
 bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronous)
 {
+    if (!event->dispatched)
+    {
+        m_event_latency.add(StkTime::getMonoTimeUs() -
+                            event->event->getArrivalTime());
+        event->dispatched = true;
+    }
     int index = 0;
     for (unsigned int i = 0; i < m_protocols.size(); i++)
     {
@@ -345,7 +442,7 @@ bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronou
     }
     if (event->protocols_ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
     {
-        // because we made a copy of the event
+        // the manager owns the event
         delete event->event->peer; // no more need of that
         delete event->event;
         return true;
@@ -381,6 +478,9 @@ void ProtocolManager::update()
 
 void ProtocolManager::asynchronousUpdate()
 {
+    // first get the events received since the last update
+    routeIncomingEvents();
+
     // before updating, notice protocols that they have received information
     pthread_mutex_lock(&m_events_mutex); // secure threads
     int size = m_events_to_process.size();
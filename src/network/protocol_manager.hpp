@@ -27,6 +27,8 @@
 #include "network/event.hpp"
 #include "network/network_string.hpp"
 #include "network/protocol.hpp"
+#include "utils/histogram.hpp"
+#include "utils/lock_free_queue.hpp"
 #include "utils/types.hpp"
 
 #include <vector>
@@ -88,6 +90,7 @@ typedef struct EventProcessingInfo
     Event* event;
     double arrival_time;
     std::vector<unsigned int> protocols_ids;
+    bool dispatched; //!< True once passed to a protocol for the first time.
 } EventProcessingInfo;
 
 /*!
@@ -113,9 +116,19 @@ class ProtocolManager : public Singleton<ProtocolManager>
         /*!
          * \brief Function that processes incoming events.
          * This function is called by the network manager each time there is an
-         * incoming packet.
+         * incoming packet. The manager takes ownership of the event, which is
+         * then shared (not copied) by all protocols that receive it.
+         * The event is only put in a lock-free queue and the asynchronous
+         * update thread is woken up to route it, so this never blocks the
+         * network thread.
          */
         virtual void            notifyEvent(Event* event);
+        /*!
+         * \brief Processes a batch of incoming events.
+         * Same as notifyEvent for each event, but the asynchronous update
+         * thread is only woken up once for the whole batch.
+         */
+        virtual void            notifyEvents(const std::vector<Event*> &events);
         /*!
          * \brief WILL BE COMMENTED LATER
          */
@@ -285,6 +298,19 @@ class ProtocolManager : public Singleton<ProtocolManager>
         virtual void            protocolTerminated(ProtocolInfo protocol);
 
         bool                    propagateEvent(EventProcessingInfo* event, bool synchronous);
+        /*!
+         * \brief Moves the events received by the network thread into the
+         * events queue, finding the protocols that will receive them.
+         * Only called by the asynchronous update thread.
+         */
+        void                    routeIncomingEvents();
+        /*!
+         * \brief Waits until an event is received, or the given time is over.
+         * \param msec : Maximum time to wait in milliseconds.
+         */
+        void                    waitForEvents(int msec);
+        /*! \brief Wakes up the asynchronous update thread. */
+        void                    wakeUp();
 
         // protected members
         /*!
@@ -293,6 +319,11 @@ class ProtocolManager : public Singleton<ProtocolManager>
          * state and their unique id.
          */
         std::vector<ProtocolInfo>       m_protocols;
+        /*!
+         * \brief Events received by the network thread, not yet routed.
+         * Filled by notifyEvent and emptied by the asynchronous thread.
+         */
+        LockFreeQueue<Event*>           m_incoming_events;
         /*!
          * \brief Contains the network events to pass to protocols.
          */
@@ -321,6 +352,16 @@ class ProtocolManager : public Singleton<ProtocolManager>
         pthread_mutex_t                 m_id_mutex;
         /*! Used when need to quit.*/
         pthread_mutex_t                 m_exit_mutex;
+        /*! Used with m_wakeup_cond to wake up the asynchronous thread. */
+        pthread_mutex_t                 m_wakeup_mutex;
+        /*! Signaled when an event is received. */
+        pthread_cond_t                  m_wakeup_cond;
+        /*! 1 while the asynchronous thread is waiting for events. */
+        volatile long                   m_consumer_waiting;
+
+        /*! Time between receiving an event and passing it to a protocol,
+         *  in microseconds. Protected by m_events_mutex. */
+        Histogram                       m_event_latency;
 
         /*! Update thread.*/
         pthread_t* m_update_thread;
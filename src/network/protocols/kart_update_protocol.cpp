@@ -1,9 +1,23 @@
 #include "network/protocols/kart_update_protocol.hpp"
 
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/bit_packer.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "utils/time.hpp"
+
+/** A remote kart is moved to its received position immediately if the
+ *  simulated position is further away than this (in m). */
+static const float MAX_POSITION_ERROR = 1.0f;
+/** Cosine of half the angle by which the simulated rotation of a remote
+ *  kart may differ from the received rotation before it is moved
+ *  immediately (about 30 degrees). */
+static const float MIN_ROTATION_DOT   = 0.966f;
+/** Smaller errors are blended in over about this time (in s). */
+static const float ERROR_BLEND_TIME   = 0.1f;
 
 KartUpdateProtocol::KartUpdateProtocol()
     : Protocol(NULL, PROTOCOL_KART_UPDATE)
@@ -21,6 +35,14 @@ KartUpdateProtocol::KartUpdateProtocol()
             m_self_kart_index = i;
         }
     }
+    m_last_send_time = 0;
+    m_last_apply_time = -1;
+    m_start_time = StkTime::getMonoTimeUs();
+    m_next_sequence = 0;
+    m_last_received_snapshot = -1;
+    for (int i = 0; i < SNAPSHOT_HISTORY; i++)
+        m_received_valid[i] = false;
+    m_state_buffers.resize(m_karts.size());
     pthread_mutex_init(&m_positions_updates_mutex, NULL);
 }
 
@@ -30,108 +52,295 @@ KartUpdateProtocol::~KartUpdateProtocol()
 
 bool KartUpdateProtocol::notifyEventAsynchronous(Event* event)
 {
+    if (event->type == EVENT_TYPE_DISCONNECTED)
+    {
+        // The peer is deleted, forget the snapshot it acknowledged
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        m_acked_snapshots.erase(*event->peer);
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+        return true;
+    }
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString ns = event->data();
-    if (ns.size() < 36)
+    if (m_listener->isServer())
+        receiveClientState(*event->peer, event->data());
+    else
+        receiveSnapshot(event->data());
+    return true;
+}
+
+/** Decodes a snapshot sent by the server. The message contains the world
+ *  time, the snapshot sequence number, the distance to the baseline
+ *  sequence number (0 if no baseline is used) and the encoded snapshot.
+ */
+void KartUpdateProtocol::receiveSnapshot(const NetworkString &ns)
+{
+    if (ns.size() < 8)
     {
         Log::info("KartUpdateProtocol", "Message too short.");
-        return true;
+        return;
+    }
+    uint16_t sequence = ns.getUInt16(4);
+    uint8_t distance = ns.getUInt8(6);
+    const KartSnapshot *baseline = NULL;
+    if (distance > 0)
+    {
+        uint16_t baseline_sequence = sequence - distance;
+        int index = baseline_sequence % SNAPSHOT_HISTORY;
+        if (distance >= SNAPSHOT_HISTORY || !m_received_valid[index] ||
+            m_received_snapshots[index].getSequence() != baseline_sequence)
+        {
+            static Log::RateLimit limit(10);
+            Log::verbose(limit, "KartUpdateProtocol", "Missing baseline %u "
+                         "for snapshot %u.", baseline_sequence, sequence);
+            return;
+        }
+        baseline = &m_received_snapshots[index];
+    }
+    KartSnapshot snapshot;
+    BitReader reader(ns, 7);
+    if (!snapshot.decode(baseline, &reader) ||
+        snapshot.getNumKarts() != m_karts.size())
+    {
+        Log::warn("KartUpdateProtocol", "Invalid snapshot %u.", sequence);
+        return;
+    }
+    snapshot.setSequence(sequence);
+    int index = sequence % SNAPSHOT_HISTORY;
+    m_received_snapshots[index] = snapshot;
+    m_received_valid[index] = true;
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    // Ignore snapshots older than the last one (they are still kept as
+    // possible baselines).
+    bool newer = m_last_received_snapshot < 0 ||
+        (int16_t)(sequence - (uint16_t)m_last_received_snapshot) > 0;
+    if (newer)
+        m_last_received_snapshot = sequence;
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+    if (!newer)
+        return;
+
+    float time = ns.getFloat(0);
+    for (unsigned int i = 0; i < snapshot.getNumKarts(); i++)
+        queueUpdate(i, time, snapshot.getXYZ(i), snapshot.getRotation(i));
+}
+
+/** Handles the state of a client's kart. The message contains the world
+ *  time, the last snapshot received by the client, if this value is valid,
+ *  the kart id and the state of the kart.
+ */
+void KartUpdateProtocol::receiveClientState(STKPeer *peer,
+                                            const NetworkString &ns)
+{
+    if (ns.size() < 11)
+    {
+        Log::info("KartUpdateProtocol", "Message too short.");
+        return;
+    }
+    uint16_t ack = ns.getUInt16(4);
+    bool has_ack = ns.getUInt8(6) != 0;
+    uint32_t kart_id = ns.getUInt32(7);
+    KartState state;
+    BitReader reader(ns, 11);
+    if (!KartSnapshot::decodeState(&reader, &state) ||
+        kart_id >= m_karts.size())
+    {
+        Log::warn("KartUpdateProtocol", "Invalid kart state.");
+        return;
     }
-    ns.removeFront(4);
-    while(ns.size() >= 16)
+    if (has_ack)
     {
-        uint32_t kart_id = ns.getUInt32(0);
-
-        float a,b,c;
-        a = ns.getFloat(4);
-        b = ns.getFloat(8);
-        c = ns.getFloat(12);
-        float d,e,f,g;
-        d = ns.getFloat(16);
-        e = ns.getFloat(20);
-        f = ns.getFloat(24);
-        g = ns.getFloat(28);
-        pthread_mutex_trylock(&m_positions_updates_mutex);
-        m_next_positions.push_back(Vec3(a,b,c));
-        m_next_quaternions.push_back(btQuaternion(d,e,f,g));
-        m_karts_ids.push_back(kart_id);
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        m_acked_snapshots[peer] = ack;
         pthread_mutex_unlock(&m_positions_updates_mutex);
-        ns.removeFront(32);
     }
-    return true;
+    queueUpdate(kart_id, ns.getFloat(0), KartSnapshot::toXYZ(state),
+                KartSnapshot::toRotation(state));
+}
+
+/** Stores a received state until the main thread adds it to the state
+ *  buffer of the kart. The local reception time is recorded here so that
+ *  the delay before the next update() does not count as network jitter.
+ */
+void KartUpdateProtocol::queueUpdate(uint32_t kart_id, double sender_time,
+                                     const Vec3 &xyz,
+                                     const btQuaternion &rotation)
+{
+    PendingUpdate update;
+    update.m_kart_id     = kart_id;
+    update.m_sender_time = sender_time;
+    update.m_local_time  = StkTime::getMonoTimeUs()*1.0e-6;
+    update.m_xyz         = xyz;
+    update.m_rotation    = rotation;
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    m_pending_updates.push_back(update);
+    pthread_mutex_unlock(&m_positions_updates_mutex);
 }
 
 void KartUpdateProtocol::setup()
 {
 }
 
+/** Sends a snapshot of all karts to each client, delta-encoded against
+ *  the last snapshot this client acknowledged if it is still known.
+ */
+void KartUpdateProtocol::sendSnapshots()
+{
+    uint16_t sequence = m_next_sequence++;
+    KartSnapshot &snapshot = m_sent_snapshots[sequence % SNAPSHOT_HISTORY];
+    snapshot.setSequence(sequence);
+    snapshot.setNumKarts(m_karts.size());
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        AbstractKart* kart = m_karts[i];
+        snapshot.set(kart->getWorldKartId(), kart->getXYZ(),
+                     kart->getRotation());
+    }
+
+    const std::vector<STKPeer*> &peers =
+        NetworkManager::getInstance()->getPeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        const KartSnapshot *baseline = NULL;
+        uint8_t distance = 0;
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        std::map<STKPeer*, uint16_t>::iterator it =
+            m_acked_snapshots.find(peers[i]);
+        if (it != m_acked_snapshots.end())
+        {
+            uint16_t d = sequence - it->second;
+            const KartSnapshot &b =
+                m_sent_snapshots[it->second % SNAPSHOT_HISTORY];
+            if (d > 0 && d < SNAPSHOT_HISTORY &&
+                b.getSequence() == it->second &&
+                b.getNumKarts() == snapshot.getNumKarts())
+            {
+                baseline = &b;
+                distance = (uint8_t)d;
+            }
+        }
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+
+        NetworkString ns;
+        ns.af(getSenderTime());
+        ns.ai16(sequence).ai8(distance);
+        BitWriter writer(&ns);
+        snapshot.encode(baseline, &writer);
+        writer.flush();
+        m_listener->sendMessage(this, peers[i], ns, false);
+    }
+}
+
+/** Sends the state of the local kart to the server, together with the last
+ *  snapshot received.
+ */
+void KartUpdateProtocol::sendOwnKart()
+{
+    AbstractKart* kart = m_karts[m_self_kart_index];
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    int last_received = m_last_received_snapshot;
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+
+    NetworkString ns;
+    ns.af(getSenderTime());
+    ns.ai16(last_received < 0 ? 0 : (uint16_t)last_received);
+    ns.ai8(last_received < 0 ? 0 : 1);
+    ns.ai32( kart->getWorldKartId());
+    BitWriter writer(&ns);
+    KartSnapshot::encodeState(KartSnapshot::quantize(kart->getXYZ(),
+                                                     kart->getRotation()),
+                              &writer);
+    writer.flush();
+    static Log::RateLimit limit(10);
+    Log::verbose(limit, "KartUpdateProtocol", "Sending %d's positions",
+                 kart->getWorldKartId());
+    m_listener->sendMessage(this, ns, false);
+}
+
 void KartUpdateProtocol::update()
 {
     if (!World::getWorld())
         return;
-    static double time = 0;
+    int rate = UserConfigParams::m_kart_update_rate;
+    if (rate < 1) rate = 1;
+    if (rate > 60) rate = 60;
     double current_time = StkTime::getRealTime();
-    if (current_time > time + 0.1) // 10 updates per second
+    if (current_time > m_last_send_time + 1.0/rate)
     {
-        time = current_time;
+        m_last_send_time = current_time;
         if (m_listener->isServer())
-        {
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            for (unsigned int i = 0; i < m_karts.size(); i++)
-            {
-                AbstractKart* kart = m_karts[i];
-                Vec3 v = kart->getXYZ();
-                btQuaternion quat = kart->getRotation();
-                ns.ai32( kart->getWorldKartId());
-                ns.af(v[0]).af(v[1]).af(v[2]); // add position
-                ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-                Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
-            }
-            m_listener->sendMessage(this, ns, false);
-        }
+            sendSnapshots();
         else
+            sendOwnKart();
+    }
+    applyStates();
+}
+
+/** Moves the received states into the state buffers, and moves each
+ *  remote kart towards the state interpolated for the current time. Small
+ *  errors are blended in over ERROR_BLEND_TIME, so that the kart follows
+ *  the received states smoothly. Only if the position or rotation is too
+ *  far off the kart is moved to the interpolated state immediately.
+ */
+void KartUpdateProtocol::applyStates()
+{
+    if (pthread_mutex_trylock(&m_positions_updates_mutex) == 0)
+    {
+        while (!m_pending_updates.empty())
         {
-            AbstractKart* kart = m_karts[m_self_kart_index];
-            Vec3 v = kart->getXYZ();
-            btQuaternion quat = kart->getRotation();
-            NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            ns.ai32( kart->getWorldKartId());
-            ns.af(v[0]).af(v[1]).af(v[2]); // add position
-            ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-            Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
-            m_listener->sendMessage(this, ns, false);
+            const PendingUpdate &u = m_pending_updates.front();
+            if (u.m_kart_id < m_state_buffers.size())
+                m_state_buffers[u.m_kart_id].add(u.m_sender_time,
+                                                 u.m_local_time, u.m_xyz,
+                                                 u.m_rotation);
+            m_pending_updates.pop_front();
         }
+        pthread_mutex_unlock(&m_positions_updates_mutex);
     }
-    switch(pthread_mutex_trylock(&m_positions_updates_mutex))
+
+    double now = StkTime::getMonoTimeUs()*1.0e-6;
+    float dt = m_last_apply_time < 0 ? 0.0f
+                                     : (float)(now - m_last_apply_time);
+    m_last_apply_time = now;
+    // Fraction of the error removed in this frame, independent of the
+    // frame rate.
+    float blend = 1.0f - expf(-dt/ERROR_BLEND_TIME);
+
+    for (unsigned int id = 0; id < m_state_buffers.size(); id++)
     {
-        case 0: /* if we got the lock */
-            while (!m_next_positions.empty())
-            {
-                uint32_t id = m_karts_ids.back();
-                if (id != m_self_kart_index || m_listener->isServer()) // server takes all updates
-                {
-                    Vec3 pos = m_next_positions.back();
-                    btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
-                    transform.setOrigin(pos);
-                    transform.setRotation(m_next_quaternions.back());
-                    m_karts[id]->getBody()->setCenterOfMassTransform(transform);
-                    //m_karts[id]->getBody()->setLinearVelocity(Vec3(0,0,0));
-                    Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f", id, pos[0], pos[1], pos[2]);
-                }
-                m_next_positions.pop_back();
-                m_next_quaternions.pop_back();
-                m_karts_ids.pop_back();
-            }
-            pthread_mutex_unlock(&m_positions_updates_mutex);
-            break;
-        default:
-            break;
+        // The server takes all updates, clients ignore their own kart.
+        if (id == m_self_kart_index && !m_listener->isServer())
+            continue;
+        Vec3 xyz, velocity;
+        btQuaternion rotation;
+        if (!m_state_buffers[id].getState(now, &xyz, &rotation, &velocity))
+            continue;
+        AbstractKart *kart = m_karts[id];
+        btRigidBody *body = kart->getBody();
+        btTransform transform = body->getCenterOfMassTransform();
+        btQuaternion current = transform.getRotation();
+        float dot = current.dot(rotation);
+        // Use the shorter way between the two rotations.
+        if (dot < 0)
+        {
+            rotation = -rotation;
+            dot = -dot;
+        }
+        if ((transform.getOrigin() - xyz).length2() <
+                MAX_POSITION_ERROR*MAX_POSITION_ERROR &&
+            dot > MIN_ROTATION_DOT)
+        {
+            transform.setOrigin(transform.getOrigin().lerp(xyz, blend));
+            transform.setRotation(current.slerp(rotation, blend));
+        }
+        else
+        {
+            transform.setOrigin(xyz);
+            transform.setRotation(rotation);
+        }
+        body->setCenterOfMassTransform(transform);
+        body->setLinearVelocity(velocity);
+        kart->setTrans(transform);
     }
 }
-
-
-
-
@@ -1,13 +1,28 @@
 #ifndef KART_UPDATE_PROTOCOL_HPP
 #define KART_UPDATE_PROTOCOL_HPP
 
+#include "network/kart_snapshot.hpp"
+#include "network/kart_state_buffer.hpp"
 #include "network/protocol.hpp"
+#include "utils/time.hpp"
 #include "utils/vec3.hpp"
 #include "LinearMath/btQuaternion.h"
 #include <list>
+#include <map>
 
 class AbstractKart;
+class STKPeer;
 
+/** Sends the position and rotation of the karts. The server sends
+ *  snapshots of all karts to each client, delta-encoded against the last
+ *  snapshot acknowledged by that client. Clients send the state of their
+ *  own kart and acknowledge the last snapshot they received.
+ *  The number of updates per second is set by the kart_update_rate
+ *  user config parameter.
+ *  Received states are not applied directly: they are stored in a
+ *  KartStateBuffer per kart. Each frame the remote karts are moved
+ *  towards the state interpolated between the received ones.
+ */
 class KartUpdateProtocol : public Protocol
 {
     public:
@@ -20,12 +35,71 @@ class KartUpdateProtocol : public Protocol
         virtual void asynchronousUpdate() {};
 
     protected:
+        /** Number of snapshots kept to be used as baselines. */
+        static const int SNAPSHOT_HISTORY = 32;
+
+        void sendSnapshots();
+        void sendOwnKart();
+        void receiveSnapshot(const NetworkString &ns);
+        void receiveClientState(STKPeer *peer, const NetworkString &ns);
+        void queueUpdate(uint32_t kart_id, double sender_time,
+                         const Vec3 &xyz, const btQuaternion &rotation);
+        void applyStates();
+        // --------------------------------------------------------------------
+        /** Returns the time stamp of sent states. Unlike the world time it
+         *  never decreases, so the receiver can order the states. */
+        float getSenderTime() const
+        {
+            return (float)((StkTime::getMonoTimeUs() - m_start_time)*1.0e-6);
+        }
+
+        /** A state received by the protocol thread, waiting to be added to
+         *  the state buffer of its kart by the main thread. */
+        struct PendingUpdate
+        {
+            uint32_t     m_kart_id;
+            double       m_sender_time;
+            double       m_local_time;
+            Vec3         m_xyz;
+            btQuaternion m_rotation;
+        };
+
         std::vector<AbstractKart*> m_karts;
         uint32_t m_self_kart_index;
 
-        std::list<Vec3> m_next_positions;
-        std::list<btQuaternion> m_next_quaternions;
-        std::list<uint32_t> m_karts_ids;
+        /** Time the last update was sent. */
+        double m_last_send_time;
+        /** Time the remote karts were last moved, -1 if never. */
+        double m_last_apply_time;
+        /** Time this protocol was created, see getSenderTime. */
+        uint64_t m_start_time;
+
+        /** Server: the last snapshots sent, indexed by sequence number
+         *  modulo SNAPSHOT_HISTORY. */
+        KartSnapshot m_sent_snapshots[SNAPSHOT_HISTORY];
+        /** Server: sequence number of the next snapshot to send. */
+        uint16_t m_next_sequence;
+        /** Server: last snapshot acknowledged by each client. An entry is
+         *  removed when its peer disconnects. Protected by
+         *  m_positions_updates_mutex. */
+        std::map<STKPeer*, uint16_t> m_acked_snapshots;
+
+        /** Client: the last snapshots received, indexed by sequence number
+         *  modulo SNAPSHOT_HISTORY. Only used by the protocol thread. */
+        KartSnapshot m_received_snapshots[SNAPSHOT_HISTORY];
+        /** Client: true for each valid entry in m_received_snapshots. */
+        bool m_received_valid[SNAPSHOT_HISTORY];
+        /** Client: sequence number of the most recent snapshot received, -1
+         *  if none. Protected by m_positions_updates_mutex. */
+        int m_last_received_snapshot;
+
+        /** States received but not yet added to m_state_buffers. Protected
+         *  by m_positions_updates_mutex. */
+        std::list<PendingUpdate> m_pending_updates;
+
+        /** Received states of each kart, used to interpolate the displayed
+         *  state. Only used by the main thread. */
+        std::vector<KartStateBuffer> m_state_buffers;
 
         pthread_mutex_t m_positions_updates_mutex;
 };
@@ -20,7 +20,9 @@
 
 #include "config/user_config.hpp"
 #include "network/network_manager.hpp"
+#include "network/packet_capture.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/time.hpp"
 
 #include <string.h>
@@ -34,24 +36,28 @@
 #include <pthread.h>
 #include <signal.h>
 
-FILE* STKHost::m_log_file = NULL;
-pthread_mutex_t STKHost::m_log_mutex;
+PacketCapture* STKHost::m_packet_capture = NULL;
 
-void STKHost::logPacket(const NetworkString ns, bool incoming)
+/** Maximum number of events handed to the network manager at once. */
+static const unsigned int MAX_EVENT_BATCH = 256;
+
+void STKHost::logPacket(const NetworkString &ns, bool incoming)
 {
-    if (m_log_file == NULL)
+    if (m_packet_capture == NULL)
         return;
-    pthread_mutex_lock(&m_log_mutex);
-    if (incoming)
-        fprintf(m_log_file, "[%d\t]  <--  ", (int)(StkTime::getRealTime()));
-    else
-        fprintf(m_log_file, "[%d\t]  -->  ", (int)(StkTime::getRealTime()));
-    for (int i = 0; i < ns.size(); i++)
-    {
-        fprintf(m_log_file, "%d.", ns[i]);
-    }
-    fprintf(m_log_file, "\n");
-    pthread_mutex_unlock(&m_log_mutex);
+    m_packet_capture->capture(ns, incoming);
+}
+
+// ----------------------------------------------------------------------------
+
+ENetPacket* STKHost::createPacket(const NetworkString &data, bool reliable)
+{
+    ENetPacket* packet = enet_packet_create(NULL, data.size()+1,
+               (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    if (data.size() > 0)
+        memcpy(packet->data, data.getBytes(), data.size());
+    packet->data[data.size()] = 0;
+    return packet;
 }
 
 // ----------------------------------------------------------------------------
@@ -61,16 +67,32 @@ void* STKHost::receive_data(void* self)
     ENetEvent event;
     STKHost* myself = (STKHost*)(self);
     ENetHost* host = myself->m_host;
+    std::vector<Event*> batch;
+    batch.reserve(MAX_EVENT_BATCH);
+    PROFILER_REGISTER_THREAD("Listening");
     while (!myself->mustStopListening())
     {
-        while (enet_host_service(host, &event, 20) != 0) {
+        // Wait for the first event, then collect all events that are
+        // already pending without waiting any further.
+        int timeout = 20;
+        while (batch.size() < MAX_EVENT_BATCH &&
+               enet_host_service(host, &event, timeout) > 0)
+        {
+            timeout = 0;
+            if (event.type == ENET_EVENT_TYPE_NONE)
+                continue;
             Event* evt = new Event(&event);
             if (evt->type == EVENT_TYPE_MESSAGE)
                 logPacket(evt->data(), true);
-            if (event.type != ENET_EVENT_TYPE_NONE)
-                NetworkManager::getInstance()->notifyEvent(evt);
-            delete evt;
+            batch.push_back(evt);
         }
+        if (batch.empty())
+            continue;
+        PROFILER_PUSH_CPU_MARKER("STKHost receive", 0x00, 0x7F, 0x7F);
+        // the protocol manager takes ownership of the events
+        NetworkManager::getInstance()->notifyEvents(batch);
+        batch.clear();
+        PROFILER_POP_CPU_MARKER();
     }
     myself->m_listening = false;
     delete myself->m_listening_thread;
@@ -85,12 +107,19 @@ STKHost::STKHost()
 {
     m_host = NULL;
     m_listening_thread = NULL;
-    m_log_file = NULL;
     pthread_mutex_init(&m_exit_mutex, NULL);
-    pthread_mutex_init(&m_log_mutex, NULL);
-    if (UserConfigParams::m_packets_log_filename.toString() != "")
-        m_log_file = fopen(UserConfigParams::m_packets_log_filename.c_str(), "w+");
-    if (!m_log_file)
+    if (!m_packet_capture &&
+        UserConfigParams::m_packets_log_filename.toString() != "")
+    {
+        m_packet_capture =
+            new PacketCapture(UserConfigParams::m_packets_log_filename);
+        if (!m_packet_capture->isOpen())
+        {
+            delete m_packet_capture;
+            m_packet_capture = NULL;
+        }
+    }
+    if (!m_packet_capture)
         Log::warn("STKHost", "Network packets won't be logged: no file.");
 }
 
@@ -99,9 +128,10 @@ STKHost::STKHost()
 STKHost::~STKHost()
 {
     stopListening();
-    if (m_log_file)
+    if (m_packet_capture)
     {
-        fclose(m_log_file);
+        delete m_packet_capture;
+        m_packet_capture = NULL;
         Log::warn("STKHost", "Packet logging file has been closed.");
     }
     if (m_host)
@@ -302,8 +332,7 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress sender, int max_tries)
 
 void STKHost::broadcastPacket(const NetworkString& data, bool reliable)
 {
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1,
-               (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    ENetPacket* packet = createPacket(data, reliable);
     enet_host_broadcast(m_host, 0, packet);
     STKHost::logPacket(data, false);
 }
@@ -34,6 +34,8 @@
 
 #include <pthread.h>
 
+class PacketCapture;
+
 /*! \class STKHost
  *  \brief Represents the local host.
  *  This host is either a server host or a client host. A client host is in
@@ -65,16 +67,26 @@ class STKHost
         virtual ~STKHost();
         
         /*! \brief Log packets into a file
+         *  The packet is only queued, it is written to the file
+         *  asynchronously by the PacketCapture.
          *  \param ns : The data in the packet
          *  \param incoming : True if the packet comes from a peer.
          *  False if it's sent to a peer.
          */
-        static void logPacket(const NetworkString ns, bool incoming);
+        static void logPacket(const NetworkString &ns, bool incoming);
+
+        /*! \brief Creates an ENet packet containing a network string.
+         *  A 0 is appended to the data, which is removed by the receiver.
+         *  \param data : The data to put in the packet.
+         *  \param reliable : If the packet must be sent reliably.
+         */
+        static ENetPacket* createPacket(const NetworkString &data,
+                                        bool reliable);
 
         /*! \brief Thread function checking if data is received.
          *  This function tries to get data from network low-level functions as
-         *  often as possible. When something is received, it generates an
-         *  event and passes it to the Network Manager.
+         *  often as possible. When something is received, all pending events
+         *  are collected and passed to the Network Manager as one batch.
          *  \param self : used to pass the ENet host to the function.
          */
         static void* receive_data(void* self);
@@ -165,8 +177,7 @@ class STKHost
         pthread_t*  m_listening_thread; //!< Thread listening network events.
         pthread_mutex_t m_exit_mutex;   //!< Mutex to kill properly the thread
         bool        m_listening;
-        static FILE*       m_log_file;         //!< Where to log packets
-        static pthread_mutex_t m_log_mutex;    //!< To write in the log only once at a time
+        static PacketCapture* m_packet_capture; //!< Where to log packets
 
 };
 
@@ -95,8 +95,7 @@ void STKPeer::sendPacket(NetworkString const& data, bool reliable)
                 data.size(), (m_peer->address.host>>0)&0xff,
                 (m_peer->address.host>>8)&0xff,(m_peer->address.host>>16)&0xff,
                 (m_peer->address.host>>24)&0xff,m_peer->address.port);
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1,
-                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    ENetPacket* packet = STKHost::createPacket(data, reliable);
     /* to debug the packet output
     printf("STKPeer: ");
     for (unsigned int i = 0; i < data.size(); i++)
@@ -22,6 +22,7 @@
 
 #include "online/current_user.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/profiler.hpp"
 
 #include <iostream>
 #include <stdio.h>
@@ -186,6 +187,7 @@ namespace Online
         RequestManager *me = (RequestManager*) obj;
 
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        PROFILER_REGISTER_THREAD("Request manager");
 
         me->m_current_request = NULL;
         me->m_request_queue.lock();
@@ -206,8 +208,10 @@ namespace Online
             if(me->m_current_request->getType()==Request::RT_QUIT)
                 break;
             me->m_request_queue.unlock();
+            PROFILER_PUSH_CPU_MARKER("Request execute", 0x00, 0x7F, 0x7F);
             me->m_current_request->execute();
             me->addResult(me->m_current_request);
+            PROFILER_POP_CPU_MARKER();
             me->m_request_queue.lock();
         }   // while
 
@@ -45,6 +45,7 @@ Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_num_steps           = 0;
 }   // Physics
 
 //-----------------------------------------------------------------------------
@@ -144,9 +145,12 @@ void Physics::update(float dt)
     // of objects.
     m_all_collisions.clear();
 
-    // Maximum of three substeps. This will work for framerate down to
-    // 20 FPS (bullet default frequency is 60 HZ).
-    m_dynamics_world->stepSimulation(dt, 3);
+    // The world is simulated with a fixed time step (see
+    // MainLoop::updateRace), so do exactly one bullet step of that size.
+    // Since dt is the bullet time step as well, no remainder is left for
+    // bullet to interpolate the motion states with, so the kart transforms
+    // are the actual simulation results.
+    m_num_steps += m_dynamics_world->stepSimulation(dt, 1, dt);
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -145,6 +145,9 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** Number of bullet substeps taken since this object was created. */
+    unsigned int                     m_num_steps;
+
 public:
           Physics          ();
          ~Physics          ();
@@ -165,6 +168,8 @@ public:
     void  setDebugMode(IrrDebugDrawer::DebugModeType mode) { m_debug_drawer->setDebugMode(mode); }
     /** Returns true if the debug drawer is enabled. */
     bool  isDebug() const     {return m_debug_drawer->debugEnabled(); }
+    /** Returns the number of physics substeps taken so far. */
+    unsigned int getNumSteps() const { return m_num_steps; }
     virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies,
                                 btPersistentManifold** manifold,int numManifolds,
                                 btTypedConstraint** constraints,int numConstraints,
@@ -23,9 +23,38 @@
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
 #include "utils/time.hpp"
 
-#include <fstream>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef WIN32
+#  include <sys/stat.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+/** Version of the BVH cache file format, increase when the layout of the
+ *  file or of bullet's serialized BVH changes. */
+static const uint32_t BVH_CACHE_FORMAT = 1;
+
+/** Header of a BVH cache file, followed by the serialized btOptimizedBvh.
+ *  Its size must be a multiple of 16, since the BVH must be 16 byte aligned.
+ */
+struct BvhCacheHeader
+{
+    char     m_magic[4];
+    uint32_t m_format;
+    uint32_t m_version;
+    uint32_t m_num_triangles;
+    uint64_t m_hash;
+    uint64_t m_bvh_size;
+    char     m_padding[32];
+};   // BvhCacheHeader
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -41,6 +70,9 @@ TriangleMesh::TriangleMesh() : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_memory       = NULL;
+    m_bvh_memory_size  = 0;
+    m_bvh_mapped       = false;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -81,10 +113,16 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  \param bvh_cache If not empty, the name of a file in which the BVH of
+ *         this mesh is cached. If the file contains the BVH for this mesh,
+ *         it is used instead of building the BVH on the fly, otherwise the
+ *         BVH is built and saved in this file.
+ *  \param cache_version A version number (e.g. of the track) that must
+ *         match the one stored in the cache file.
  */
-void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
+void TriangleMesh::createCollisionShape(bool create_collision_object,
+                                        const std::string &bvh_cache,
+                                        uint32_t cache_version)
 {
     if(m_triangleIndex2Material.size()==0)
     {
@@ -97,52 +135,29 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
     // Now convert the triangle mesh into a static rigid body
     btBvhTriangleMeshShape* bhv_triangle_mesh;
 
-    if (serialized_bhv != NULL)
+    if (bvh_cache.size()>0)
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
+        // A quantized BVH is used, since it is smaller (which means less
+        // data to load) and faster to traverse.
+        btOptimizedBvh* bvh = loadCachedBvh(bvh_cache, cache_version);
+        if (bvh)
         {
-            fprintf(stderr, "[TriangleMesh] WARNING, failed to load serialized BHV\n");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh,
+                                           true /* useQuantizedAabbCompression */,
+                                           false /* buildBvh */);
+            bhv_triangle_mesh->setOptimizedBvh(bvh);
         }
         else
         {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh,
+                                           true /* useQuantizedAabbCompression */);
+            saveCachedBvh(bhv_triangle_mesh->getOptimizedBvh(), bvh_cache,
+                          cache_version);
         }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
     }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -167,15 +182,16 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  removed and all objects together with the track is converted again into
  *  a single rigid body. This avoids using irrlicht (or the graphics engine)
  *  for height of terrain detection).
- *  @param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  \param bvh_cache,cache_version See createCollisionShape().
  */
 void TriangleMesh::createPhysicalBody(btCollisionObject::CollisionFlags flags,
-                                      const char* serializedBhv)
+                                      const std::string &bvh_cache,
+                                      uint32_t cache_version)
 {
     // We need the collision shape, but not the collision object (since
     // this will be created when the dynamics body is anyway).
-    createCollisionShape(/*create_collision_object*/false, serializedBhv);
+    createCollisionShape(/*create_collision_object*/false, bvh_cache,
+                         cache_version);
     btTransform startTransform;
     startTransform.setIdentity();
     m_motion_state = new btDefaultMotionState(startTransform);
@@ -214,8 +230,145 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    freeBvhMemory();
 }   // removeAll
 
+// -----------------------------------------------------------------------------
+/** Loads a BVH for this mesh from a cache file. The file is memory mapped
+ *  if possible, so only the parts of the BVH that are actually used are
+ *  read from disk. Returns NULL if the file does not exist or does not
+ *  match this mesh.
+ *  \param filename Name of the cache file.
+ *  \param version Version number that must be stored in the file.
+ */
+btOptimizedBvh* TriangleMesh::loadCachedBvh(const std::string &filename,
+                                            uint32_t version)
+{
+    assert(!m_bvh_memory);
+    BvhCacheHeader header;
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(!f)
+        return NULL;
+    bool ok = fread(&header, sizeof(header), 1, f)==1;
+    fclose(f);
+
+    struct stat st;
+    ok = ok && stat(filename.c_str(), &st)==0                           &&
+         memcmp(header.m_magic, "STKB", 4)==0                           &&
+         header.m_format        == BVH_CACHE_FORMAT                     &&
+         header.m_version       == version                              &&
+         header.m_num_triangles == m_triangleIndex2Material.size()      &&
+         (uint64_t)st.st_size   == sizeof(header)+header.m_bvh_size;
+    // Only compute the hash if everything else is fine
+    ok = ok && header.m_hash == getHash();
+    if(!ok)
+    {
+        Log::info("TriangleMesh", "BVH cache '%s' is missing or outdated.",
+                  filename.c_str());
+        return NULL;
+    }
+
+    m_bvh_memory_size = (size_t)st.st_size;
+#ifdef WIN32
+    m_bvh_memory = btAlignedAlloc(m_bvh_memory_size, 16);
+    m_bvh_mapped = false;
+    f = fopen(filename.c_str(), "rb");
+    ok = f && fread(m_bvh_memory, m_bvh_memory_size, 1, f)==1;
+    if(f) fclose(f);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd>=0)
+    {
+        // The BVH is initialised in place, so the mapping must be
+        // writable. Since it is private the file itself is not modified.
+        m_bvh_memory = mmap(NULL, m_bvh_memory_size, PROT_READ|PROT_WRITE,
+                            MAP_PRIVATE, fd, 0);
+        close(fd);
+    }
+    if(fd<0 || m_bvh_memory==MAP_FAILED)
+        m_bvh_memory = NULL;
+    m_bvh_mapped = true;
+    ok = m_bvh_memory!=NULL;
+#endif
+    btOptimizedBvh *bvh = NULL;
+    if(ok)
+    {
+        bvh = btOptimizedBvh::deSerializeInPlace(
+                                  (char*)m_bvh_memory+sizeof(BvhCacheHeader),
+                                  (unsigned int)header.m_bvh_size,
+                                  false);
+    }
+    if(!bvh)
+    {
+        Log::warn("TriangleMesh", "Failed to load BVH cache '%s'.",
+                  filename.c_str());
+        freeBvhMemory();
+    }
+    return bvh;
+}   // loadCachedBvh
+
+// -----------------------------------------------------------------------------
+/** Saves the BVH of this mesh into a cache file.
+ *  \param bvh The BVH to save.
+ *  \param filename Name of the cache file.
+ *  \param version Version number to store in the file.
+ */
+void TriangleMesh::saveCachedBvh(const btOptimizedBvh *bvh,
+                                 const std::string &filename,
+                                 uint32_t version) const
+{
+    BvhCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, "STKB", 4);
+    header.m_format        = BVH_CACHE_FORMAT;
+    header.m_version       = version;
+    header.m_num_triangles = (uint32_t)m_triangleIndex2Material.size();
+    header.m_hash          = getHash();
+    header.m_bvh_size      = bvh->calculateSerializeBufferSize();
+
+    void *buffer = btAlignedAlloc((size_t)header.m_bvh_size, 16);
+    bool ok = bvh->serializeInPlace(buffer, (unsigned)header.m_bvh_size,
+                                    false);
+    // Another process might have the old file memory mapped, so it must
+    // not be overwritten. Instead a new file is written and renamed.
+    const std::string tmp_name = filename+".tmp";
+    FILE *f = ok ? fopen(tmp_name.c_str(), "wb") : NULL;
+    if(f)
+    {
+        ok = fwrite(&header, sizeof(header), 1, f)==1 &&
+             fwrite(buffer, (size_t)header.m_bvh_size, 1, f)==1;
+        fclose(f);
+    }
+    btAlignedFree(buffer);
+#ifdef WIN32
+    // On windows rename fails if the destination exists
+    if(f && ok)
+        remove(filename.c_str());
+#endif
+    if(!f || !ok || rename(tmp_name.c_str(), filename.c_str())!=0)
+    {
+        Log::warn("TriangleMesh", "Can't write BVH cache '%s'.",
+                  filename.c_str());
+        remove(tmp_name.c_str());
+    }
+}   // saveCachedBvh
+
+// -----------------------------------------------------------------------------
+/** Frees the memory of a BVH loaded from a cache file. */
+void TriangleMesh::freeBvhMemory()
+{
+    if(!m_bvh_memory)
+        return;
+#ifndef WIN32
+    if(m_bvh_mapped)
+        munmap(m_bvh_memory, m_bvh_memory_size);
+    else
+#endif
+        btAlignedFree(m_bvh_memory);
+    m_bvh_memory      = NULL;
+    m_bvh_memory_size = 0;
+}   // freeBvhMemory
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
@@ -353,3 +506,26 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of the position of all triangles of this mesh (using
+ *  64 bit FNV-1a), which can be used to detect if data computed from this
+ *  mesh and stored in a file is still up to date.
+ */
+uint64_t TriangleMesh::getHash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned int i=0; i<m_triangleIndex2Material.size(); i++)
+    {
+        btVector3 p[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        for(unsigned int j=0; j<3; j++)
+        {
+            float xyz[3] = { p[j].getX(), p[j].getY(), p[j].getZ() };
+            const unsigned char *bytes = (const unsigned char*)xyz;
+            for(unsigned int k=0; k<sizeof(xyz); k++)
+                hash = (hash ^ bytes[k]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}   // getHash
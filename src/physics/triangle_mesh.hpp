@@ -19,11 +19,13 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/types.hpp"
 
 class Material;
 
@@ -44,6 +46,20 @@ private:
     btCollisionShape            *m_collision_shape;
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
+    /** Memory of a BVH loaded from a cache file, which must be kept as long
+     *  as the collision shape exists. NULL if the BVH was built. */
+    void                        *m_bvh_memory;
+    /** Size of m_bvh_memory. */
+    size_t                       m_bvh_memory_size;
+    /** True if m_bvh_memory is a memory mapped file. */
+    bool                         m_bvh_mapped;
+
+    btOptimizedBvh* loadCachedBvh(const std::string &filename,
+                                  uint32_t version);
+    void            saveCachedBvh(const btOptimizedBvh *bvh,
+                                  const std::string &filename,
+                                  uint32_t version) const;
+    void            freeBvhMemory();
 public:
          TriangleMesh();
         ~TriangleMesh();
@@ -51,14 +67,18 @@ public:
                      const btVector3 &t3, const btVector3 &n1,
                      const btVector3 &n2, const btVector3 &n3,
                      const Material* m);
-    void createCollisionShape(bool create_collision_object=true, const char* serialized_bhv=NULL);
+    void createCollisionShape(bool create_collision_object=true,
+                              const std::string &bvh_cache="",
+                              uint32_t cache_version=0);
     void createPhysicalBody(btCollisionObject::CollisionFlags flags=
                                (btCollisionObject::CollisionFlags)0,
-                            const char* serializedBhv = NULL);
+                            const std::string &bvh_cache="",
+                            uint32_t cache_version=0);
     void removeAll();
     void removeCollisionObject();
     btVector3 getInterpolatedNormal(unsigned int index,
                                     const btVector3 &position) const;
+    uint64_t getHash() const;
     // ------------------------------------------------------------------------
     const Material* getMaterial(int n) const
                                           {return m_triangleIndex2Material[n];}
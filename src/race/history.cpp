@@ -18,26 +18,123 @@
 
 #include "race/history.hpp"
 
+#include <algorithm>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
+#include "config/stk_config.hpp"
 #include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
+#include "network/bit_packer.hpp"
+#include "network/kart_snapshot.hpp"
+#include "network/network_string.hpp"
 #include "physics/physics.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
 
 History* history = 0;
 
+const int History::FRAMES_PER_CHUNK;
+
+namespace
+{
+    /** The first bytes of a binary history file. */
+    const char HISTORY_MAGIC[] = "STKH";
+
+    /** Version of the binary history format. */
+    const unsigned int HISTORY_FORMAT_VERSION = 1;
+
+    /** Bits used to store the buttons of a KartControl. */
+    const int BUTTON_BITS = 7;
+
+    // ------------------------------------------------------------------------
+    /** Writes the bits of a float, so that it is restored exactly. */
+    void writeFloat(float f, BitWriter *writer)
+    {
+        uint32_t i;
+        memcpy(&i, &f, sizeof(i));
+        writer->write(i, 32);
+    }   // writeFloat
+
+    // ------------------------------------------------------------------------
+    float readFloat(BitReader *reader)
+    {
+        uint32_t i = reader->read(32);
+        float f;
+        memcpy(&f, &i, sizeof(f));
+        return f;
+    }   // readFloat
+
+    // ------------------------------------------------------------------------
+    /** Appends a string with an 8 bit length to a network string. */
+    void addShortString(NetworkString *ns, const std::string &s)
+    {
+        ns->ai8(s.size()).as(s);
+    }   // addShortString
+
+    // ------------------------------------------------------------------------
+    /** Reads a string written by addShortString.
+     *  \return False if the data is too short. */
+    bool getShortString(const NetworkString &ns, int *pos, std::string *s)
+    {
+        if(*pos+1>ns.size()) return false;
+        int len = ns.gui8(*pos);
+        if(*pos+1+len>ns.size()) return false;
+        *s = ns.gs(*pos+1, len);
+        *pos += 1+len;
+        return true;
+    }   // getShortString
+}   // namespace
+
 //-----------------------------------------------------------------------------
 /** Initialises the history object and sets the mode to none.
  */
 History::History()
 {
-    m_replay_mode = HISTORY_NONE;
+    m_replay_mode   = HISTORY_NONE;
+    m_current       = -1;
+    m_wrapped       = false;
+    m_size          = 0;
+    m_num_players   = 0;
+    m_difficulty    = 0;
+    m_streaming     = false;
+    m_stream_fd     = NULL;
+    m_stream_thread = NULL;
+    m_stream_count  = 0;
+    pthread_cond_init(&m_cond_pending, NULL);
 }   // History
 
+//-----------------------------------------------------------------------------
+/** Writes all not yet written history data if it is streamed to a file.
+ */
+History::~History()
+{
+    stopStreaming();
+    pthread_cond_destroy(&m_cond_pending);
+}   // ~History
+
+//-----------------------------------------------------------------------------
+/** Write the history of each race to a file while racing, so that the
+ *  length of a recording is not limited. Enabled from the command line.
+ *  Each race is written to its own file history-<date>-<time>-<n>.dat, so
+ *  that the history of earlier races is not overwritten.
+ */
+void History::enableStreaming()
+{
+    m_streaming = true;
+    const time_t now = time(NULL);
+    char prefix[32];
+    strftime(prefix, sizeof(prefix), "history-%Y%m%d-%H%M%S",
+             localtime(&now));
+    m_stream_prefix = prefix;
+    m_stream_count  = 0;
+}   // enableStreaming
+
 //-----------------------------------------------------------------------------
 /** Starts replay from the history file in the current directory.
  */
@@ -48,16 +145,39 @@ void History::startReplay()
 
 //-----------------------------------------------------------------------------
 /** Initialise the history for a new recording. It especially allocates memory
- *  to store the history.
+ *  to store the history. If the history is streamed, the history of the
+ *  previous race is completed, and the file is started again.
  */
 void History::initRecording()
 {
-    allocateMemory(stk_config->m_max_history);
+    stopStreaming();
+    setRaceInfo();
+    if(m_streaming)
+        startStreaming();
+    // When streaming, only one chunk is kept in memory
+    allocateMemory(m_streaming ? FRAMES_PER_CHUNK
+                               : stk_config->m_max_history);
     m_current = -1;
     m_wrapped = false;
     m_size    = 0;
 }   // initRecording
 
+//-----------------------------------------------------------------------------
+/** Stores the information about the current race that is saved in the
+ *  header of a history file.
+ */
+void History::setRaceInfo()
+{
+    World *world  = World::getWorld();
+    m_stk_version = STK_VERSION;
+    m_num_players = race_manager->getNumPlayers();
+    m_difficulty  = race_manager->getDifficulty();
+    m_track_name  = world->getTrack()->getIdent();
+    m_kart_ident.clear();
+    for(unsigned int i=0; i<world->getNumKarts(); i++)
+        m_kart_ident.push_back(world->getKart(i)->getIdent());
+}   // setRaceInfo
+
 //-----------------------------------------------------------------------------
 /** Allocates memory for the history. This is used when recording as well
  *  as when replaying (since in replay the data is read into memory first).
@@ -66,7 +186,7 @@ void History::initRecording()
 void History::allocateMemory(int number_of_frames)
 {
     m_all_deltas.resize   (number_of_frames);
-    unsigned int num_karts = race_manager->getNumberOfKarts();
+    unsigned int num_karts = m_kart_ident.size();
     m_all_controls.resize (number_of_frames*num_karts);
     m_all_xyz.resize      (number_of_frames*num_karts);
     m_all_rotations.resize(number_of_frames*num_karts);
@@ -115,6 +235,11 @@ void History::updateSaving(float dt)
         m_all_xyz[index+i]       = kart->getXYZ();
         m_all_rotations[index+i] = kart->getVisualRotation();
     }   // for i
+
+    // When streaming, hand the chunk over to the stream thread once it
+    // is full, and start a new one.
+    if(m_stream_thread && m_size==FRAMES_PER_CHUNK)
+        flushChunk();
 }   // updateSaving
 
 //-----------------------------------------------------------------------------
@@ -151,22 +276,246 @@ void History::updateReplay(float dt)
 }   // updateReplay
 
 //-----------------------------------------------------------------------------
-/** Saves the history stored in the internal data structures into a file called
- *  history.dat.
+/** Opens a history file, either in the current directory or in the user
+ *  config directory.
+ *  \param name Name of the file, e.g. history.dat.
+ *  \param writeable True if the file should be opened for writing.
+ *  \param filename On return the name of the opened file.
+ *  \return The file, or NULL if it could not be opened.
  */
-void History::Save()
+FILE *History::openHistoryFile(const std::string &name, bool writeable,
+                               std::string *filename)
 {
-    FILE *fd = fopen("history.dat","w");
-    if(fd)
-        printf("History saved in ./history.dat.\n");
-    else
+    *filename = name;
+    FILE *fd = fopen(filename->c_str(), writeable ? "wb" : "rb");
+    if(!fd)
+    {
+        *filename = file_manager->getUserConfigFile(name);
+        fd = fopen(filename->c_str(), writeable ? "wb" : "rb");
+    }
+    return fd;
+}   // openHistoryFile
+
+//-----------------------------------------------------------------------------
+/** Writes the header of a binary history file: the magic bytes, the format
+ *  version and the race information. It is followed by any number of
+ *  chunks (see encodeChunk), so that a history can be appended to while
+ *  racing.
+ *  \param fd The file to write to.
+ */
+void History::writeHeader(FILE *fd)
+{
+    NetworkString header;
+    addShortString(&header, m_stk_version);
+    header.ai8(m_kart_ident.size())
+          .ai8(m_num_players)
+          .ai8(m_difficulty);
+    addShortString(&header, m_track_name);
+    for(unsigned int i=0; i<m_kart_ident.size(); i++)
+        addShortString(&header, m_kart_ident[i]);
+
+    NetworkString prefix;
+    prefix.as(HISTORY_MAGIC).ai32(HISTORY_FORMAT_VERSION).ai32(header.size());
+    prefix += header;
+    fwrite(prefix.getBytes(), prefix.size(), 1, fd);
+}   // writeHeader
+
+//-----------------------------------------------------------------------------
+/** Encodes a number of frames as one chunk of a binary history file: the
+ *  number of frames and the size of the data (32 bit each), followed by the
+ *  bit packed frames. A time step size or kart control that did not change
+ *  from the previous frame costs only one bit. Positions and rotations are
+ *  quantized and stored relative to the previous frames (see
+ *  KartSnapshot::encodePredicted), which for a typical frame needs about
+ *  two bytes per kart. Each chunk can be decoded on its own.
+ *  \param first Index of the first frame in the ring buffer.
+ *  \param count Number of frames to encode.
+ *  \param ns The chunk is appended to this string.
+ */
+void History::encodeChunk(int first, int count, NetworkString *ns) const
+{
+    const unsigned int num_karts = m_kart_ident.size();
+    const int capacity = m_all_deltas.size();
+    std::vector<KartState> prev(num_karts), prev2(num_karts);
+
+    NetworkString data;
+    BitWriter writer(&data);
+    for(int i=0; i<count; i++)
+    {
+        const int frame      = (first+i) % capacity;
+        const int prev_frame = (first+i-1+capacity) % capacity;
+        if(i>0 && m_all_deltas[frame]==m_all_deltas[prev_frame])
+            writer.writeBool(true);
+        else
+        {
+            if(i>0) writer.writeBool(false);
+            writeFloat(m_all_deltas[frame], &writer);
+        }
+
+        for(unsigned int k=0; k<num_karts; k++)
+        {
+            const KartControl &c = m_all_controls[frame*num_karts+k];
+            const KartControl *p =
+                i>0 ? &m_all_controls[prev_frame*num_karts+k] : NULL;
+            bool same = p && p->m_steer==c.m_steer;
+            if(i>0) writer.writeBool(same);
+            if(!same) writeFloat(c.m_steer, &writer);
+            same = p && p->m_accel==c.m_accel;
+            if(i>0) writer.writeBool(same);
+            if(!same) writeFloat(c.m_accel, &writer);
+            same = p && p->getButtonsCompressed()==c.getButtonsCompressed();
+            if(i>0) writer.writeBool(same);
+            if(!same) writer.write(c.getButtonsCompressed(), BUTTON_BITS);
+
+            KartState state =
+                KartSnapshot::quantize(m_all_xyz[frame*num_karts+k],
+                                       m_all_rotations[frame*num_karts+k]);
+            KartSnapshot::encodePredicted(state, i>0 ? &prev[k]  : NULL,
+                                                 i>1 ? &prev2[k] : NULL,
+                                          &writer);
+            prev2[k] = prev[k];
+            prev[k]  = state;
+        }   // for k<num_karts
+    }   // for i<count
+    writer.flush();
+
+    ns->ai32(count).ai32(data.size());
+    *ns += data;
+}   // encodeChunk
+
+//-----------------------------------------------------------------------------
+/** Opens the history file of the next race and starts the thread that
+ *  writes the history chunks while racing.
+ */
+void History::startStreaming()
+{
+    m_stream_count++;
+    const std::string name = StringUtils::insertValues("%s-%d.dat",
+                                                       m_stream_prefix.c_str(),
+                                                       m_stream_count);
+    m_stream_fd = openHistoryFile(name, /*writeable*/true, &m_stream_filename);
+    if(!m_stream_fd)
     {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
-        fd = fopen(fn.c_str(), "w");
-        if(fd)
-            printf("History saved in '%s'.\n",fn.c_str());
+        Log::error("History", "Can't open '%s' for writing - "
+                   "history is not streamed.", name.c_str());
+        m_streaming = false;
+        return;
+    }
+    writeHeader(m_stream_fd);
 
+    m_stream_thread = new pthread_t();
+    if(pthread_create(m_stream_thread, NULL, &History::streamThread, this))
+    {
+        Log::error("History", "Could not create stream thread.");
+        delete m_stream_thread;
+        m_stream_thread = NULL;
+        fclose(m_stream_fd);
+        m_stream_fd = NULL;
+        m_streaming = false;
+        return;
+    }
+    Log::info("History", "Streaming history to '%s'.",
+              m_stream_filename.c_str());
+}   // startStreaming
+
+//-----------------------------------------------------------------------------
+/** Encodes all frames in memory as a chunk, and passes it on to the stream
+ *  thread. The memory is then used for the next frames.
+ */
+void History::flushChunk()
+{
+    if(!m_stream_thread || m_size==0)
+        return;
+    NetworkString *chunk = new NetworkString();
+    encodeChunk(m_wrapped ? (m_current+1)%m_size : 0, m_size, chunk);
+    m_current = -1;
+    m_wrapped = false;
+    m_size    = 0;
+
+    m_pending_chunks.lock();
+    m_pending_chunks.getData().push_back(chunk);
+    pthread_cond_signal(&m_cond_pending);
+    m_pending_chunks.unlock();
+}   // flushChunk
+
+//-----------------------------------------------------------------------------
+/** Writes the remaining frames, waits for the stream thread to finish, and
+ *  closes the history file.
+ */
+void History::stopStreaming()
+{
+    if(!m_stream_thread)
+        return;
+    flushChunk();
+    m_pending_chunks.lock();
+    m_pending_chunks.getData().push_back(NULL);
+    pthread_cond_signal(&m_cond_pending);
+    m_pending_chunks.unlock();
+
+    pthread_join(*m_stream_thread, NULL);
+    delete m_stream_thread;
+    m_stream_thread = NULL;
+    fclose(m_stream_fd);
+    m_stream_fd = NULL;
+    Log::info("History", "History saved in '%s'.", m_stream_filename.c_str());
+}   // stopStreaming
+
+//-----------------------------------------------------------------------------
+/** The stream thread: writes all chunks passed on by flushChunk to the
+ *  history file, until a NULL chunk is received.
+ *  \param obj Pointer to the history object.
+ */
+void *History::streamThread(void *obj)
+{
+    History *me = (History*)obj;
+    std::vector<NetworkString*> chunks;
+    bool quit = false;
+    while(!quit)
+    {
+        me->m_pending_chunks.lock();
+        // Wait in a loop since pthread_cond_wait can wake up spuriously
+        while(me->m_pending_chunks.getData().empty())
+            pthread_cond_wait(&me->m_cond_pending,
+                              me->m_pending_chunks.getMutex());
+        chunks.swap(me->m_pending_chunks.getData());
+        me->m_pending_chunks.unlock();
+
+        for(unsigned int i=0; i<chunks.size(); i++)
+        {
+            if(!chunks[i])
+            {
+                quit = true;
+                continue;
+            }
+            if(fwrite(chunks[i]->getBytes(), chunks[i]->size(), 1,
+                      me->m_stream_fd)!=1)
+                Log::error("History", "Error writing '%s'.",
+                           me->m_stream_filename.c_str());
+            delete chunks[i];
+        }
+        chunks.clear();
+        fflush(me->m_stream_fd);
+    }   // while !quit
+    return NULL;
+}   // streamThread
+
+//-----------------------------------------------------------------------------
+/** Saves the history stored in the internal data structures into a file
+ *  called history.dat (in binary format). If the history is streamed, this
+ *  only makes sure that all frames so far are written.
+ */
+void History::Save()
+{
+    if(m_stream_thread)
+    {
+        flushChunk();
+        Log::info("History", "History is streamed to '%s'.",
+                  m_stream_filename.c_str());
+        return;
     }
+
+    std::string filename;
+    FILE *fd = openHistoryFile("history.dat", /*writeable*/true, &filename);
     if(!fd)
     {
         printf("Can't open history.dat file for writing - can't save history.\n");
@@ -175,31 +524,50 @@ void History::Save()
         return;
     }
 
-    World *world   = World::getWorld();
-    const int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %s\n",   STK_VERSION);
+    assert(m_kart_ident.size() > 0);
+    writeHeader(fd);
+    const int first = m_wrapped ? (m_current+1)%m_size : 0;
+    for(int i=0; i<m_size; i+=FRAMES_PER_CHUNK)
+    {
+        NetworkString chunk;
+        encodeChunk(first+i, std::min(m_size-i, FRAMES_PER_CHUNK), &chunk);
+        fwrite(chunk.getBytes(), chunk.size(), 1, fd);
+    }
+    fclose(fd);
+    printf("History saved in '%s'.\n", filename.c_str());
+}   // Save
+
+//-----------------------------------------------------------------------------
+/** Writes the history in the text format.
+ *  \param fd The file to write to.
+ */
+void History::writeText(FILE *fd) const
+{
+    const int num_karts = m_kart_ident.size();
+    fprintf(fd, "Version:  %s\n",   m_stk_version.c_str());
     fprintf(fd, "numkarts: %d\n",   num_karts);
-    fprintf(fd, "numplayers: %d\n", race_manager->getNumPlayers());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
+    fprintf(fd, "numplayers: %d\n", m_num_players);
+    fprintf(fd, "difficulty: %d\n", m_difficulty);
+    fprintf(fd, "track: %s\n",      m_track_name.c_str());
 
     assert(num_karts > 0);
 
     int k;
     for(k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model %d: %s\n",k, world->getKart(k)->getIdent().c_str());
+        fprintf(fd, "model %d: %s\n",k, m_kart_ident[k].c_str());
     }
     fprintf(fd, "size:     %d\n", m_size);
 
-    int index = m_wrapped ? m_current : 0;
+    const int first = m_wrapped ? (m_current+1)%m_size : 0;
+    int index = first;
     for(int i=0; i<m_size; i++)
     {
         fprintf(fd, "delta: %f\n",m_all_deltas[index]);
         index=(index+1)%m_size;
     }
 
-    index = num_karts * (m_wrapped ? m_current : 0);
+    index = num_karts * first;
     for(int i=0; i<m_size; i++)
     {
         for(int k=0; k<num_karts; k++)
@@ -218,32 +586,212 @@ void History::Save()
         index=(index+num_karts)%(num_karts*m_size);
     }   // for k
     fprintf(fd, "History file end.\n");
-    fclose(fd);
-}   // Save
+}   // writeText
 
 //-----------------------------------------------------------------------------
-/** Loads a history from history.dat in the current directory.
+/** Converts the history file history.dat to the text format.
+ *  \param filename Name of the text file to write.
+ *  \return True if the conversion was successful.
  */
-void History::Load()
+bool History::convertToText(const std::string &filename)
 {
-    char s[1024], s1[1024];
-    int  n;
+    History h;
+    std::string in_name;
+    FILE *in = h.openHistoryFile("history.dat", /*writeable*/false, &in_name);
+    if(!in)
+    {
+        Log::error("History", "Could not open history.dat.");
+        return false;
+    }
+    bool ok = h.readHistory(in);
+    fclose(in);
+    if(!ok)
+    {
+        Log::error("History", "Could not read '%s'.", in_name.c_str());
+        return false;
+    }
 
-    FILE *fd = fopen("history.dat","r");
-    if(fd)
-        printf("Reading ./history.dat\n");
-    else
+    FILE *out = fopen(filename.c_str(), "w");
+    if(!out)
     {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
-        fd = fopen(fn.c_str(), "r");
-        if(fd)
-            printf("Reading '%s'.\n", fn.c_str());
+        Log::error("History", "Could not open '%s' for writing.",
+                   filename.c_str());
+        return false;
     }
+    h.writeText(out);
+    fclose(out);
+    Log::info("History", "Converted '%s' to '%s' (%d frames).",
+              in_name.c_str(), filename.c_str(), h.m_size);
+    return true;
+}   // convertToText
+
+//-----------------------------------------------------------------------------
+/** Loads a history from history.dat in the current directory, and sets up
+ *  the race manager to replay it.
+ */
+void History::Load()
+{
+    std::string filename;
+    FILE *fd = openHistoryFile("history.dat", /*writeable*/false, &filename);
     if(!fd)
     {
         fprintf(stderr, "ERROR: could not open history.dat\n");
         exit(-2);
     }
+    printf("Reading '%s'.\n", filename.c_str());
+    if(!readHistory(fd))
+    {
+        fprintf(stderr, "ERROR: could not read '%s'.\n", filename.c_str());
+        exit(-2);
+    }
+    fclose(fd);
+
+    unsigned int num_karts = m_kart_ident.size();
+    race_manager->setNumKarts(num_karts);
+    race_manager->setNumLocalPlayers(m_num_players);
+    race_manager->setDifficulty((RaceManager::Difficulty)m_difficulty);
+    race_manager->setTrack(m_track_name);
+    // This value doesn't really matter, but should be defined, otherwise
+    // the racing phase can switch to 'ending'
+    race_manager->setNumLaps(10);
+    for(unsigned int i=0; i<num_karts; i++)
+    {
+        if(i<race_manager->getNumPlayers())
+            race_manager->setLocalKartInfo(i, m_kart_ident[i]);
+    }
+    m_current = -1;
+}   // Load
+
+//-----------------------------------------------------------------------------
+/** Reads a history file, either in the binary or in the text format.
+ *  \param fd The file to read.
+ *  \return False if the file could not be read.
+ */
+bool History::readHistory(FILE *fd)
+{
+    char magic[4];
+    if(fread(magic, 4, 1, fd)==1 && memcmp(magic, HISTORY_MAGIC, 4)==0)
+        return readBinary(fd);
+    rewind(fd);
+    return readText(fd);
+}   // readHistory
+
+//-----------------------------------------------------------------------------
+/** Reads a binary history file written by Save or while streaming.
+ *  \param fd The history file, positioned after the magic bytes.
+ *  \return False if the file is invalid.
+ */
+bool History::readBinary(FILE *fd)
+{
+    uint8_t prefix[8];
+    if(fread(prefix, 8, 1, fd)!=1)
+        return false;
+    NetworkString ns(std::string((const char*)prefix, 8));
+    unsigned int version     = ns.gui32(0);
+    unsigned int header_size = ns.gui32(4);
+    if(version!=HISTORY_FORMAT_VERSION)
+    {
+        Log::error("History", "History format version %d is not supported.",
+                   version);
+        return false;
+    }
+
+    std::string data(header_size, '\0');
+    if(header_size==0 || fread(&data[0], header_size, 1, fd)!=1)
+        return false;
+    NetworkString header(data);
+    int pos = 0;
+    if(!getShortString(header, &pos, &m_stk_version) || pos+3>header.size())
+        return false;
+    if(m_stk_version!=STK_VERSION)
+    {
+        fprintf(stderr, "WARNING: history is version '%s'\n",
+                m_stk_version.c_str());
+        fprintf(stderr, "         STK version is '%s'\n",STK_VERSION);
+    }
+    unsigned int num_karts = header.gui8(pos);
+    m_num_players          = header.gui8(pos+1);
+    m_difficulty           = header.gui8(pos+2);
+    pos += 3;
+    if(!getShortString(header, &pos, &m_track_name))
+        return false;
+    m_kart_ident.resize(num_karts);
+    for(unsigned int i=0; i<num_karts; i++)
+    {
+        if(!getShortString(header, &pos, &m_kart_ident[i]))
+            return false;
+    }
+
+    m_all_deltas.clear();
+    m_all_controls.clear();
+    m_all_xyz.clear();
+    m_all_rotations.clear();
+    std::vector<KartState> prev(num_karts), prev2(num_karts);
+    while(fread(prefix, 8, 1, fd)==1)
+    {
+        ns = NetworkString(std::string((const char*)prefix, 8));
+        unsigned int count = ns.gui32(0);
+        unsigned int size  = ns.gui32(4);
+        if(size==0)
+            return false;
+        data.resize(size);
+        if(fread(&data[0], size, 1, fd)!=1)
+        {
+            Log::warn("History", "History file is truncated.");
+            break;
+        }
+
+        NetworkString chunk(data);
+        BitReader reader(chunk);
+        float delta = 0;
+        for(unsigned int i=0; i<count; i++)
+        {
+            if(i==0 || !reader.readBool())
+                delta = readFloat(&reader);
+            m_all_deltas.push_back(delta);
+
+            for(unsigned int k=0; k<num_karts; k++)
+            {
+                KartControl c;
+                if(i>0)
+                    c = m_all_controls[m_all_controls.size()-num_karts];
+                if(i==0 || !reader.readBool())
+                    c.m_steer = readFloat(&reader);
+                if(i==0 || !reader.readBool())
+                    c.m_accel = readFloat(&reader);
+                if(i==0 || !reader.readBool())
+                    c.setButtonsCompressed(char(reader.read(BUTTON_BITS)));
+                m_all_controls.push_back(c);
+
+                KartState state;
+                if(!KartSnapshot::decodePredicted(&reader,
+                                                  i>0 ? &prev[k]  : NULL,
+                                                  i>1 ? &prev2[k] : NULL,
+                                                  &state))
+                    return false;
+                m_all_xyz.push_back(KartSnapshot::toXYZ(state));
+                m_all_rotations.push_back(KartSnapshot::toRotation(state));
+                prev2[k] = prev[k];
+                prev[k]  = state;
+            }   // for k<num_karts
+        }   // for i<count
+    }   // while fread
+
+    m_size    = m_all_deltas.size();
+    m_wrapped = false;
+    m_current = -1;
+    return true;
+}   // readBinary
+
+//-----------------------------------------------------------------------------
+/** Reads a history file in the text format.
+ *  \param fd The history file.
+ *  \return False if the file is invalid.
+ */
+bool History::readText(FILE *fd)
+{
+    char s[1024], s1[1024];
+    int  n;
 
     if (fgets(s, 1023, fd) == NULL)
     {
@@ -258,6 +806,7 @@ void History::Load()
     }
     else
     {
+        m_stk_version = s1;
         if (strcmp(s1,STK_VERSION))
         {
             fprintf(stderr, "WARNING: history is version '%s'\n",s1);
@@ -277,34 +826,29 @@ void History::Load()
         fprintf(stderr,"WARNING: No number of karts found in history file.\n");
         exit(-2);
     }
-    race_manager->setNumKarts(num_karts);
 
     fgets(s, 1023, fd);
-    if(sscanf(s, "numplayers: %d",&n)!=1)
+    if(sscanf(s, "numplayers: %d",&m_num_players)!=1)
     {
         fprintf(stderr,"WARNING: No number of players found in history file.\n");
         exit(-2);
     }
-    race_manager->setNumLocalPlayers(n);
 
     fgets(s, 1023, fd);
-    if(sscanf(s, "difficulty: %d",&n)!=1)
+    if(sscanf(s, "difficulty: %d",&m_difficulty)!=1)
     {
         fprintf(stderr,"WARNING: No difficulty found in history file.\n");
         exit(-2);
     }
-    race_manager->setDifficulty((RaceManager::Difficulty)n);
 
     fgets(s, 1023, fd);
     if(sscanf(s, "track: %1023s",s1)!=1)
     {
         fprintf(stderr,"WARNING: Track not found in history file.\n");
     }
-    race_manager->setTrack(s1);
-    // This value doesn't really matter, but should be defined, otherwise
-    // the racing phase can switch to 'ending'
-    race_manager->setNumLaps(10);
+    m_track_name = s1;
 
+    m_kart_ident.clear();
     for(unsigned int i=0; i<num_karts; i++)
     {
         fgets(s, 1023, fd);
@@ -315,10 +859,6 @@ void History::Load()
             exit(-2);
         }
         m_kart_ident.push_back(s1);
-        if(i<race_manager->getNumPlayers())
-        {
-            race_manager->setLocalKartInfo(i, s1);
-        }
     }   // for i<nKarts
     // FIXME: The model information is currently ignored
     fgets(s, 1023, fd);
@@ -329,6 +869,7 @@ void History::Load()
     }
     allocateMemory(m_size);
     m_current = -1;
+    m_wrapped = false;
 
     for(int i=0; i<m_size; i++)
     {
@@ -356,7 +897,5 @@ void History::Load()
             m_all_controls[index].setButtonsCompressed(char(buttonsCompressed));
         }   // for i
     }   // for k
-    fprintf(fd, "History file end.\n");
-    fclose(fd);
-}   // Load
-
+    return true;
+}   // readText
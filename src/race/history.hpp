@@ -21,14 +21,18 @@
 
 #include <vector>
 #include <string>
+#include <pthread.h>
+#include <stdio.h>
 
 #include "LinearMath/btQuaternion.h"
 
 #include "karts/controller/kart_control.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
 
 class Kart;
+class NetworkString;
 
 /**
   * \ingroup race
@@ -76,16 +80,72 @@ private:
     /** The identities of the karts to use. */
     std::vector<std::string>  m_kart_ident;
 
+    /** STK version with which the history was recorded. */
+    std::string                m_stk_version;
+
+    /** Number of players, difficulty and track of the recorded race. */
+    int                        m_num_players;
+    int                        m_difficulty;
+    std::string                m_track_name;
+
+    /** True if the history is written to a file while racing, instead of
+     *  being kept in memory until it is saved. */
+    bool                       m_streaming;
+
+    /** The file the history is streamed to, or NULL. */
+    FILE                      *m_stream_fd;
+
+    /** Name of the file the history is streamed to. */
+    std::string                m_stream_filename;
+
+    /** Start of the names of the streamed files, it contains the time
+     *  streaming was enabled so that files of earlier sessions are kept. */
+    std::string                m_stream_prefix;
+
+    /** Number of races streamed so far, each race is written to its own
+     *  file. */
+    int                        m_stream_count;
+
+    /** Encoded chunks waiting to be written by the stream thread. A NULL
+     *  entry tells the thread to stop. */
+    Synchronised< std::vector<NetworkString*> > m_pending_chunks;
+
+    /** Signals the stream thread that a chunk is available. */
+    pthread_cond_t             m_cond_pending;
+
+    /** The thread writing the chunks, NULL if it is not running. */
+    pthread_t                 *m_stream_thread;
+
     void  allocateMemory(int number_of_frames);
     void  updateSaving(float dt);
     void  updateReplay(float dt);
+    void  setRaceInfo();
+    FILE *openHistoryFile(const std::string &name, bool writeable,
+                          std::string *filename);
+    void  writeHeader(FILE *fd);
+    void  encodeChunk(int first, int count, NetworkString *ns) const;
+    void  flushChunk();
+    void  startStreaming();
+    void  stopStreaming();
+    static void *streamThread(void *obj);
+    bool  readHistory(FILE *fd);
+    bool  readBinary(FILE *fd);
+    bool  readText(FILE *fd);
+    void  writeText(FILE *fd) const;
 public:
+    /** Number of frames stored in one chunk of a binary history file. */
+    static const int FRAMES_PER_CHUNK = 256;
+
           History        ();
+         ~History        ();
     void  startReplay    ();
     void  initRecording  ();
     void  update         (float dt);
     void  Save           ();
     void  Load           ();
+    static bool convertToText(const std::string &filename);
+
+    void  enableStreaming();
 
     // -------------------I-----------------------------------------------------
     /** Returns the identifier of the n-th kart. */
@@ -418,6 +418,28 @@ void RaceManager::startNextRace()
         }
     }   // not first race
 
+    // Load the models of all karts before the world is created. A kart
+    // whose models can not be loaded is disabled and replaced by another
+    // kart, instead of aborting the game.
+    for(unsigned int i=0; i<m_kart_status.size(); i++)
+    {
+        std::string &ident = m_kart_status[i].m_ident;
+        if(kart_properties_manager->requireKartModels(ident))
+            continue;
+        std::vector<std::string> karts =
+            kart_properties_manager->getAllAvailableKarts();
+        for(unsigned int j=0; j<karts.size(); j++)
+        {
+            if(kart_properties_manager->requireKartModels(karts[j]))
+            {
+                Log::warn("RaceManager", "Using kart '%s' instead of '%s'.",
+                          karts[j].c_str(), ident.c_str());
+                ident = karts[j];
+                break;
+            }
+        }
+    }
+
     // the constructor assigns this object to the global
     // variable world. Admittedly a bit ugly, but simplifies
     // handling of objects which get created in the constructor
@@ -704,7 +726,13 @@ void RaceManager::exitRace(bool delete_world)
         }
     }
 
-    if (delete_world) World::deleteWorld();
+    if (delete_world)
+    {
+        World::deleteWorld();
+        // Karts still shown (e.g. in the grand prix result screens) are
+        // in use and are not unloaded.
+        kart_properties_manager->unloadUnusedKartModels();
+    }
 
     m_track_number = 0;
 }   // exitRace
@@ -18,8 +18,27 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "network/bit_packer.hpp"
+#include "network/kart_snapshot.hpp"
 #include "race/race_manager.hpp"
 
+#include <stdlib.h>
+
+namespace
+{
+    /** Bits used for a time difference (in ms) between two events. */
+    const int TIME_DELTA_BITS = 12;
+
+    // ------------------------------------------------------------------------
+    /** Converts a time to milliseconds. */
+    uint32_t toMs(float time)
+    {
+        return time <= 0 ? 0 : (uint32_t)(time*1000.0f + 0.5f);
+    }   // toMs
+}   // namespace
+
+const char ReplayBase::REPLAY_MAGIC[] = "STKR";
+
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
 {
@@ -35,12 +54,92 @@ FILE* ReplayBase::openReplayFile(bool writeable)
 {
     m_filename = file_manager->getUserConfigFile(
                                        race_manager->getTrackName()+".replay");
-    FILE *fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+    FILE *fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     if(!fd)
     {
         m_filename = race_manager->getTrackName()+".replay";
-        fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+        fd = fopen(m_filename.c_str(), writeable ? "wb" : "rb");
     }
     return fd;
 
 }   // openReplayFilen
+
+// -----------------------------------------------------------------------------
+/** Encodes a chunk of transform events. Positions and rotations are
+ *  quantized like the kart states sent over the network, and each event
+ *  is stored relative to the previous ones (see
+ *  KartSnapshot::encodePredicted). Times are stored in ms as differences
+ *  to the previous event.
+ *  \param events The events to encode (at most 65535).
+ *  \param ns The string to which the encoded data is appended.
+ */
+void ReplayBase::encodeChunk(const std::vector<TransformEvent> &events,
+                             NetworkString *ns)
+{
+    BitWriter writer(ns);
+    KartState state, prev, prev2;
+    uint32_t  prev_ms = 0;
+
+    for(unsigned int i=0; i<events.size(); i++)
+    {
+        const TransformEvent &e = events[i];
+        state = KartSnapshot::quantize(Vec3(e.m_transform.getOrigin()),
+                                       e.m_transform.getRotation());
+        uint32_t ms = toMs(e.m_time);
+        if(i==0)
+            writer.write(ms, 32);
+        else if(ms>=prev_ms && ms-prev_ms < (1u<<TIME_DELTA_BITS))
+        {
+            writer.writeBool(true);
+            writer.write(ms-prev_ms, TIME_DELTA_BITS);
+        }
+        else
+        {
+            writer.writeBool(false);
+            writer.write(ms, 32);
+        }
+        KartSnapshot::encodePredicted(state, i>0 ? &prev  : NULL,
+                                             i>1 ? &prev2 : NULL, &writer);
+        prev2   = prev;
+        prev    = state;
+        prev_ms = ms;
+    }   // for i<events.size()
+    writer.flush();
+}   // encodeChunk
+
+// -----------------------------------------------------------------------------
+/** Decodes a chunk written by encodeChunk.
+ *  \param ns The encoded chunk.
+ *  \param num_transforms Number of events in this chunk.
+ *  \param events The decoded events are appended to this vector.
+ *  \return False if the data is invalid.
+ */
+bool ReplayBase::decodeChunk(const NetworkString &ns,
+                             unsigned int num_transforms,
+                             std::vector<TransformEvent> *events)
+{
+    BitReader reader(ns);
+    KartState state, prev, prev2;
+    uint32_t  ms = 0;
+
+    for(unsigned int i=0; i<num_transforms; i++)
+    {
+        if(i==0 || !reader.readBool())
+            ms  = reader.read(32);
+        else
+            ms += reader.read(TIME_DELTA_BITS);
+        if(!KartSnapshot::decodePredicted(&reader, i>0 ? &prev  : NULL,
+                                          i>1 ? &prev2 : NULL, &state))
+            return false;
+
+        TransformEvent e;
+        e.m_time = ms/1000.0f;
+        e.m_transform.setOrigin(KartSnapshot::toXYZ(state));
+        e.m_transform.setRotation(KartSnapshot::toRotation(state));
+        events->push_back(e);
+
+        prev2 = prev;
+        prev  = state;
+    }   // for i<num_transforms
+    return true;
+}   // decodeChunk
@@ -21,9 +21,13 @@
 
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+
+class NetworkString;
 
 /**
   * \ingroup race
@@ -61,9 +65,36 @@ protected:
         float       m_time;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** The transforms of a kart are saved in chunks of this many events.
+     *  Each chunk can be decoded on its own, so a replay can be streamed
+     *  and positioned at any time without reading the whole file. */
+    static const unsigned int TRANSFORMS_PER_CHUNK = 64;
+
+    /** The first bytes of a binary replay file. */
+    static const char REPLAY_MAGIC[];
+
+    /** Describes a chunk of transform events in a replay file. */
+    struct ChunkInfo
+    {
+        /** Time of the first event in this chunk. */
+        float    m_start_time;
+        /** Number of events in this chunk. */
+        uint16_t m_num_transforms;
+        /** Offset of the chunk from the start of the chunk data. */
+        uint32_t m_offset;
+        /** Size of the encoded chunk in bytes. */
+        uint32_t m_size;
+    };   // ChunkInfo
+
     // ------------------------------------------------------------------------
           ReplayBase();
     FILE *openReplayFile(bool writeable);
+    static void encodeChunk(const std::vector<TransformEvent> &events,
+                            NetworkString *ns);
+    static bool decodeChunk(const NetworkString &ns,
+                            unsigned int num_transforms,
+                            std::vector<TransformEvent> *events);
     // ----------------------------------------------------------------------
     /** Returns the filename that was opened. */
     const std::string &getReplayFilename() const { return m_filename;}
@@ -71,7 +102,7 @@ protected:
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
      *  executable. */
-    unsigned int getReplayVersion() const { return 1; }
+    unsigned int getReplayVersion() const { return 2; }
 };   // ReplayBase
 
 #endif
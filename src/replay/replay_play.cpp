@@ -22,28 +22,52 @@
 #include "io/file_manager.hpp"
 #include "karts/ghost_kart.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
 ReplayPlay *ReplayPlay::m_replay_play = NULL;
 
+namespace
+{
+    /** How many seconds of transform events are loaded ahead of the
+     *  current world time. */
+    const float PRELOAD_TIME = 2.0f;
+}   // namespace
+
 //-----------------------------------------------------------------------------
 /** Initialises the Replay engine
  */
 ReplayPlay::ReplayPlay()
 {
-    m_next            = 0;
+    m_next             = 0;
+    m_fd               = NULL;
+    m_chunk_data_start = 0;
 }   // ReplayPlay
 
 //-----------------------------------------------------------------------------
 /** Frees all stored data. */
 ReplayPlay::~ReplayPlay()
 {
+    closeFile();
 }   // ~Replay
 
+//-----------------------------------------------------------------------------
+/** Closes the replay file from which chunks are streamed. */
+void ReplayPlay::closeFile()
+{
+    if(m_fd)
+        fclose(m_fd);
+    m_fd = NULL;
+    m_chunk_info.clear();
+    m_next_chunk.clear();
+}   // closeFile
+
 //-----------------------------------------------------------------------------
 /** Starts replay from the replay file in the current directory.
  */
@@ -59,6 +83,8 @@ void ReplayPlay::init()
 void ReplayPlay::reset()
 {
     m_next = 0;
+    if(m_fd)
+        seek(0);
     for(unsigned int i=0; i<(unsigned int)m_ghost_karts.size(); i++)
     {
         m_ghost_karts[i].reset();
@@ -71,6 +97,14 @@ void ReplayPlay::reset()
  */
 void ReplayPlay::update(float dt)
 {
+    // Make sure the transforms needed for the next few seconds are loaded
+    if(m_fd)
+    {
+        float time = World::getWorld()->getTime();
+        for(unsigned int i=0; i<m_chunk_info.size(); i++)
+            streamChunks(i, time+PRELOAD_TIME);
+    }
+
     // First update all ghost karts
     for(unsigned int i=0; i<(unsigned int)m_ghost_karts.size(); i++)
         m_ghost_karts[i].update(dt);
@@ -78,12 +112,104 @@ void ReplayPlay::update(float dt)
 }   // update
 
 //-----------------------------------------------------------------------------
-/** Loads a replay data from  file called 'trackname'.replay.
+/** Interpolates the graphical position of all ghost karts between the last
+ *  two simulation steps.
+ *  \param alpha Fraction of a simulation step since the last step.
+ */
+void ReplayPlay::updateGraphics(float alpha)
+{
+    for(unsigned int i=0; i<(unsigned int)m_ghost_karts.size(); i++)
+        m_ghost_karts[i].interpolateGraphics(alpha);
+}   // updateGraphics
+
+//-----------------------------------------------------------------------------
+/** Positions all ghost karts of a binary replay at the given time. Only the
+ *  chunks needed for the next few seconds after that time are loaded.
+ *  \param time The world time to go to.
+ */
+void ReplayPlay::seek(float time)
+{
+    if(!m_fd)
+        return;
+    for(unsigned int i=0; i<m_chunk_info.size(); i++)
+    {
+        // Find the last chunk starting at or before time
+        const std::vector<ChunkInfo> &chunks = m_chunk_info[i];
+        unsigned int low = 0, high = chunks.size();
+        while(low<high)
+        {
+            unsigned int mid = (low+high)/2;
+            if(chunks[mid].m_start_time<=time)
+                low  = mid+1;
+            else
+                high = mid;
+        }
+        m_ghost_karts[i].clearTransforms();
+        m_next_chunk[i] = low>0 ? low-1 : 0;
+        streamChunks(i, time+PRELOAD_TIME);
+    }
+}   // seek
+
+//-----------------------------------------------------------------------------
+/** Loads all chunks of a kart that start before the given time. Transforms
+ *  that are not needed anymore are removed from the ghost kart first.
+ *  \param kart_id Index of the ghost kart.
+ *  \param time Chunks starting before this time are loaded.
+ */
+void ReplayPlay::streamChunks(unsigned int kart_id, float time)
+{
+    const std::vector<ChunkInfo> &chunks = m_chunk_info[kart_id];
+    unsigned int &next = m_next_chunk[kart_id];
+    if(next>=chunks.size() || chunks[next].m_start_time>time)
+        return;
+    m_ghost_karts[kart_id].removeOldTransforms();
+    while(next<chunks.size() && chunks[next].m_start_time<=time)
+    {
+        loadChunk(kart_id, next);
+        next++;
+    }
+}   // streamChunks
+
+//-----------------------------------------------------------------------------
+/** Reads and decodes one chunk of transform events from the replay file,
+ *  and adds the events to the ghost kart.
+ *  \param kart_id Index of the ghost kart.
+ *  \param chunk Index of the chunk of this kart.
+ */
+void ReplayPlay::loadChunk(unsigned int kart_id, unsigned int chunk)
+{
+    const ChunkInfo &info = m_chunk_info[kart_id][chunk];
+    if(info.m_size==0)
+        return;
+    std::string data(info.m_size, '\0');
+    if(fseek(m_fd, m_chunk_data_start+info.m_offset, SEEK_SET)!=0 ||
+       fread(&data[0], info.m_size, 1, m_fd)!=1)
+    {
+        Log::warn("ReplayPlay", "Can't read chunk %d of kart %d in '%s'.",
+                  chunk, kart_id, getReplayFilename().c_str());
+        return;
+    }
+
+    std::vector<TransformEvent> events;
+    events.reserve(info.m_num_transforms);
+    if(!decodeChunk(NetworkString(data), info.m_num_transforms, &events))
+        Log::warn("ReplayPlay", "Invalid chunk %d of kart %d in '%s'.",
+                  chunk, kart_id, getReplayFilename().c_str());
+
+    GhostKart &kart = m_ghost_karts[kart_id];
+    for(unsigned int i=0; i<events.size(); i++)
+        kart.addTransform(events[i].m_time, events[i].m_transform);
+}   // loadChunk
+
+//-----------------------------------------------------------------------------
+/** Loads a replay data from  file called 'trackname'.replay. For a binary
+ *  replay only the header is read here, the transform events are streamed
+ *  from the file during the race. Old text replays are loaded completely.
  */
 void ReplayPlay::Load()
 {
     m_ghost_karts.clearAndDeleteAll();
-    char s[1024], s1[1024];
+    closeFile();
 
     FILE *fd = openReplayFile(/*writeable*/false);
     if(!fd)
@@ -96,6 +222,121 @@ void ReplayPlay::Load()
 
     printf("Reading replay file '%s'.\n", getReplayFilename().c_str());
 
+    char magic[4];
+    if(fread(magic, 4, 1, fd)==1 && memcmp(magic, REPLAY_MAGIC, 4)==0)
+    {
+        if(!readBinaryHeader(fd))
+        {
+            Log::error("ReplayPlay", "Invalid replay file '%s'.",
+                       getReplayFilename().c_str());
+            fclose(fd);
+            m_ghost_karts.clearAndDeleteAll();
+            closeFile();
+            return;
+        }
+        // Keep the file open to stream the chunks
+        m_fd = fd;
+        return;
+    }
+
+    rewind(fd);
+    readTextReplay(fd);
+    fclose(fd);
+}   // Load
+
+//-----------------------------------------------------------------------------
+/** Reads the header of a binary replay file and creates the ghost karts.
+ *  \param fd The replay file, positioned after the magic bytes.
+ *  \return False if the header could not be read.
+ */
+bool ReplayPlay::readBinaryHeader(FILE *fd)
+{
+    uint8_t prefix[8];
+    if(fread(prefix, 8, 1, fd)!=1)
+        return false;
+    NetworkString ns(std::string((const char*)prefix, 8));
+    unsigned int version     = ns.gui32(0);
+    unsigned int header_size = ns.gui32(4);
+    if(version!=getReplayVersion())
+    {
+        Log::error("ReplayPlay", "Replay is version %d, STK version is %d.",
+                   version, getReplayVersion());
+        return false;
+    }
+
+    std::string data(header_size, '\0');
+    if(header_size==0 || fread(&data[0], header_size, 1, fd)!=1)
+        return false;
+    m_chunk_data_start = 12 + header_size;
+
+    NetworkString header(data);
+    const int size = header.size();
+    int pos = 0;
+    // Difficulty, laps, length of track name
+    if(pos+3>size) return false;
+    int difficulty = header.gui8(pos);
+    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)difficulty)
+        printf("Warning, difficulty of replay is '%d', "
+               "while '%d' is selected.\n",
+               race_manager->getDifficulty(), difficulty);
+    race_manager->setNumLaps(header.gui8(pos+1));
+    int len = header.gui8(pos+2);
+    pos += 3;
+    if(pos+len+1>size) return false;
+    std::string track = header.gs(pos, len);
+    pos += len;
+    assert(track==race_manager->getTrackName());
+    race_manager->setTrack(track);
+
+    unsigned int num_karts = header.gui8(pos++);
+    m_chunk_info.resize(num_karts);
+    m_next_chunk.resize(num_karts, 0);
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        if(pos+1>size) return false;
+        len = header.gui8(pos++);
+        if(pos+len+4>size) return false;
+        m_ghost_karts.push_back(new GhostKart(header.gs(pos, len)));
+        m_ghost_karts[k].init(RaceManager::KT_GHOST);
+        pos += len;
+
+        unsigned int num_chunks = header.gui32(pos);
+        pos += 4;
+        if(pos+14*(int64_t)num_chunks+4>size) return false;
+        m_chunk_info[k].resize(num_chunks);
+        for(unsigned int i=0; i<num_chunks; i++)
+        {
+            ChunkInfo &info = m_chunk_info[k][i];
+            info.m_start_time     = header.gui32(pos)/1000.0f;
+            info.m_num_transforms = header.gui16(pos+4);
+            info.m_offset         = header.gui32(pos+6);
+            info.m_size           = header.gui32(pos+10);
+            pos += 14;
+        }
+
+        unsigned int num_events = header.gui32(pos);
+        pos += 4;
+        if(pos+5*(int64_t)num_events>size) return false;
+        for(unsigned int i=0; i<num_events; i++)
+        {
+            KartReplayEvent kre;
+            kre.m_time = header.gui32(pos)/1000.0f;
+            kre.m_type = (KartReplayEvent::KartReplayEventType)
+                         header.gui8(pos+4);
+            m_ghost_karts[k].addReplayEvent(kre);
+            pos += 5;
+        }
+    }   // for k<num_karts
+    return true;
+}   // readBinaryHeader
+
+//-----------------------------------------------------------------------------
+/** Loads an old (version 1) text replay file completely.
+ *  \param fd The replay file.
+ */
+void ReplayPlay::readTextReplay(FILE *fd)
+{
+    char s[1024], s1[1024];
     if (fgets(s, 1023, fd) == NULL)
     {
         fprintf(stderr, "ERROR: could not read '%s'.\n",
@@ -111,10 +352,10 @@ void ReplayPlay::Load()
         exit(-2);
     }
 
-    if (version!=getReplayVersion())
+    if (version!=1)
     {
-        fprintf(stderr, "WARNING: replay is version '%d'\n",version);
-        fprintf(stderr, "         STK version is '%d'\n",getReplayVersion());
+        fprintf(stderr, "WARNING: text replay is version '%d'\n",version);
+        fprintf(stderr, "         Text replays are version '1'\n");
         fprintf(stderr, "         We try to proceed, but it may fail.\n");
     }
 
@@ -163,9 +404,7 @@ void ReplayPlay::Load()
         readKartData(fd, s);
     }   // for k<num_ghost_karts
 
-    fprintf(fd, "Replay file end.\n");
-    fclose(fd);
-}   // Load
+}   // readTextReplay
 
 //-----------------------------------------------------------------------------
 /** Reads all data from a replay file for a specific kart.
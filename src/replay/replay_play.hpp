@@ -41,13 +41,33 @@ private:
     /** All ghost karts. */
     PtrVector<GhostKart>    m_ghost_karts;
 
+    /** The binary replay file from which chunks are streamed, or NULL if
+     *  a text replay was loaded completely. */
+    FILE                   *m_fd;
+
+    /** File offset of the chunk data in m_fd. */
+    long                    m_chunk_data_start;
+
+    /** For each ghost kart the chunks of transform events in the file. */
+    std::vector< std::vector<ChunkInfo> > m_chunk_info;
+
+    /** For each ghost kart the index of the next chunk to load. */
+    std::vector<unsigned int> m_next_chunk;
+
           ReplayPlay();
          ~ReplayPlay();
     void  readKartData(FILE *fd, char *next_line);
+    void  readTextReplay(FILE *fd);
+    bool  readBinaryHeader(FILE *fd);
+    void  loadChunk(unsigned int kart_id, unsigned int chunk);
+    void  streamChunks(unsigned int kart_id, float time);
+    void  closeFile();
 public:
     void  init();
     void  update(float dt);
+    void  updateGraphics(float alpha);
     void  reset();
+    void  seek(float time);
     void  Load();
 
     // ------------------------------------------------------------------------
@@ -43,28 +43,36 @@ ReplayRecorder::ReplayRecorder()
 ReplayRecorder::~ReplayRecorder()
 {
     m_transform_events.clear();
+    m_chunk_data.clear();
+    m_chunk_info.clear();
 }   // ~Replay
 
 //-----------------------------------------------------------------------------
-/** Initialise the replay recorder. It especially allocates memory
- *  to store the replay data.
+/** Initialise the replay recorder. The transform events are encoded in
+ *  chunks while the race is running, so there is no limit on the number
+ *  of events that can be recorded.
  */
 void ReplayRecorder::init()
 {
+    const unsigned int num_karts = race_manager->getNumberOfKarts();
     m_transform_events.clear();
-    m_transform_events.resize(race_manager->getNumberOfKarts());
-    m_skid_control.resize(race_manager->getNumberOfKarts());
-    m_kart_replay_event.resize(race_manager->getNumberOfKarts());
-    for(unsigned int i=0; i<race_manager->getNumberOfKarts(); i++)
+    m_transform_events.resize(num_karts);
+    m_chunk_data.clear();
+    m_chunk_data.resize(num_karts);
+    m_chunk_info.clear();
+    m_chunk_info.resize(num_karts);
+    m_skid_control.resize(num_karts);
+    m_kart_replay_event.resize(num_karts);
+    for(unsigned int i=0; i<num_karts; i++)
     {
-        m_transform_events[i].resize(stk_config->m_max_history);
+        m_transform_events[i].reserve(TRANSFORMS_PER_CHUNK);
         // Rather arbitraritly sized, it will be added with push_back
         m_kart_replay_event[i].reserve(100);
     }
     m_count_transforms.clear();
-    m_count_transforms.resize(race_manager->getNumberOfKarts(), 0);
+    m_count_transforms.resize(num_karts, 0);
     m_last_saved_time.clear();
-    m_last_saved_time.resize(race_manager->getNumberOfKarts(), -1.0f);
+    m_last_saved_time.resize(num_karts, -1.0f);
 
 #ifdef DEBUG
     m_count                       = 0;
@@ -126,21 +134,37 @@ void ReplayRecorder::update(float dt)
         }
 
         m_count_transforms[i]++;
-        if(m_count_transforms[i]>=m_transform_events[i].size())
-        {
-            // Only print this message once.
-            if(m_count_transforms[i]==m_transform_events[i].size())
-                printf("Can't store more events for kart %s.\n",
-                        kart->getIdent().c_str());
-            continue;
-        }
-        TransformEvent *p = &(m_transform_events[i][m_count_transforms[i]-1]);
-        p->m_time      = World::getWorld()->getTime();
-        p->m_transform.setOrigin(kart->getXYZ());
-        p->m_transform.setRotation(kart->getVisualRotation());
+        m_last_saved_time[i] = time;
+        TransformEvent p;
+        p.m_time      = time;
+        p.m_transform.setOrigin(kart->getXYZ());
+        p.m_transform.setRotation(kart->getVisualRotation());
+        m_transform_events[i].push_back(p);
+        if(m_transform_events[i].size()>=TRANSFORMS_PER_CHUNK)
+            encodeTransforms(i);
     }   // for i
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Encodes all not yet encoded transform events of a kart into a new chunk.
+ *  \param kart_id Index of the kart.
+ */
+void ReplayRecorder::encodeTransforms(unsigned int kart_id)
+{
+    std::vector<TransformEvent> &events = m_transform_events[kart_id];
+    if(events.empty())
+        return;
+
+    ChunkInfo info;
+    info.m_start_time     = events[0].m_time;
+    info.m_num_transforms = (uint16_t)events.size();
+    info.m_offset         = m_chunk_data[kart_id].size();
+    encodeChunk(events, &m_chunk_data[kart_id]);
+    info.m_size           = m_chunk_data[kart_id].size() - info.m_offset;
+    m_chunk_info[kart_id].push_back(info);
+    events.clear();
+}   // encodeTransforms
+
 //-----------------------------------------------------------------------------
 /** Saves the replay data stored in the internal data structures.
  */
@@ -158,44 +182,61 @@ void ReplayRecorder::Save()
         return;
     }
 
-    printf("Replay saved in '%s'.\n", getReplayFilename().c_str());
-
     World *world   = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %d\n",   getReplayVersion());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-    fprintf(fd, "Laps: %d\n",       race_manager->getNumLaps());
 
+    // The header contains the race settings, and for each kart the list
+    // of chunks and all kart events. The chunk offsets are relative to
+    // the end of the header.
+    NetworkString header;
+    const std::string &track = world->getTrack()->getIdent();
+    header.ai8(race_manager->getDifficulty())
+          .ai8(race_manager->getNumLaps())
+          .ai8(track.size()).as(track)
+          .ai8(num_karts);
+    uint32_t kart_offset = 0;
     for(unsigned int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model: %s\n", world->getKart(k)->getIdent().c_str());
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
-
-        unsigned int num_transforms =
-            std::min((unsigned int)stk_config->m_max_history,
-                      m_count_transforms[k]                   );
-        for(unsigned int i=0; i<num_transforms; i++)
+        encodeTransforms(k);
+        const std::string &ident = world->getKart(k)->getIdent();
+        header.ai8(ident.size()).as(ident)
+              .ai32(m_chunk_info[k].size());
+        for(unsigned int i=0; i<m_chunk_info[k].size(); i++)
         {
-            const TransformEvent *p=&(m_transform_events[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW()
-                );
-        }   // for i
-        fprintf(fd, "events: %d\n", (int)m_kart_replay_event[k].size());
+            const ChunkInfo &info = m_chunk_info[k][i];
+            header.ai32((uint32_t)(info.m_start_time*1000.0f + 0.5f))
+                  .ai16(info.m_num_transforms)
+                  .ai32(kart_offset + info.m_offset)
+                  .ai32(info.m_size);
+        }
+        kart_offset += m_chunk_data[k].size();
+
+        header.ai32(m_kart_replay_event[k].size());
         for(unsigned int i=0; i<m_kart_replay_event[k].size(); i++)
         {
-            const KartReplayEvent *p=&(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
+            const KartReplayEvent &p = m_kart_replay_event[k][i];
+            header.ai32((uint32_t)(p.m_time*1000.0f + 0.5f))
+                  .ai8(p.m_type);
         }
+    }   // for k<num_karts
+
+    NetworkString prefix;
+    prefix.as(REPLAY_MAGIC).ai32(getReplayVersion()).ai32(header.size());
+
+    bool ok = fwrite(prefix.getBytes(), prefix.size(), 1, fd)==1 &&
+              fwrite(header.getBytes(), header.size(), 1, fd)==1;
+    for(unsigned int k=0; k<num_karts && ok; k++)
+    {
+        if(m_chunk_data[k].size()>0)
+            ok = fwrite(m_chunk_data[k].getBytes(), m_chunk_data[k].size(),
+                        1, fd)==1;
     }
     fclose(fd);
-}   // Save
 
+    if(ok)
+        printf("Replay saved in '%s' (%d bytes).\n",
+               getReplayFilename().c_str(),
+               prefix.size()+header.size()+(int)kart_offset);
+    else
+        printf("Error writing '%s'.\n", getReplayFilename().c_str());
+}   // Save
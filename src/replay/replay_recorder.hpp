@@ -20,6 +20,7 @@
 #define HEADER_REPLAY_RECORDER_HPP
 
 #include "karts/controller/kart_control.hpp"
+#include "network/network_string.hpp"
 #include "replay/replay_base.hpp"
 
 #include <vector>
@@ -31,9 +32,16 @@ class ReplayRecorder : public ReplayBase
 {
 private:
 
-    /** A separate vector of Replay Events for all transforms. */
+    /** For each kart the transform events that have not yet been encoded
+     *  into a chunk. */
     std::vector< std::vector<TransformEvent> > m_transform_events;
 
+    /** For each kart the encoded chunks of transform events. */
+    std::vector<NetworkString> m_chunk_data;
+
+    /** For each kart the information about all encoded chunks. */
+    std::vector< std::vector<ChunkInfo> > m_chunk_info;
+
     /** Time at which a transform was saved for the last time. */
     std::vector<float> m_last_saved_time;
 
@@ -62,6 +70,7 @@ private:
 
           ReplayRecorder();
          ~ReplayRecorder();
+    void  encodeTransforms(unsigned int kart_id);
 public:
     void  init();
     void  update(float dt);
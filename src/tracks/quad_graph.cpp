@@ -37,6 +37,7 @@
 #include "tracks/check_manager.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
+#include "utils/time.hpp"
 
 const int QuadGraph::UNKNOWN_SECTOR  = -1;
 QuadGraph *QuadGraph::m_quad_graph = NULL;
@@ -58,7 +59,9 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     QuadSet::get()->init(quad_file_name);
     m_quad_filename        = quad_file_name;
     m_quad_graph           = this;
+    m_use_grid             = true;
     load(graph_file_name);
+    buildSectorGrid();
 }   // QuadGraph
 
 // -----------------------------------------------------------------------------
@@ -73,6 +76,81 @@ QuadGraph::~QuadGraph()
         cleanupDebugMesh();
 }   // ~QuadGraph
 
+// -----------------------------------------------------------------------------
+/** Builds the sector grid used to speed up findRoadSector and
+ *  findOutOfRoadSector. Each graph node is stored in all cells overlapped
+ *  by the 2d bounding box of its quad. The cell size is chosen so that
+ *  there is about one quad per cell on average.
+ */
+void QuadGraph::buildSectorGrid()
+{
+    m_grid_start.clear();
+    m_grid_nodes.clear();
+    m_grid_width = m_grid_height = 0;
+    if(m_all_nodes.empty()) return;
+
+    std::vector<core::rectf> boxes(m_all_nodes.size());
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        boxes[i] = core::rectf(q[0].getX(), q[0].getZ(),
+                               q[0].getX(), q[0].getZ());
+        for(unsigned int j=1; j<4; j++)
+            boxes[i].addInternalPoint(q[j].getX(), q[j].getZ());
+    }
+    core::rectf all = boxes[0];
+    for(unsigned int i=1; i<boxes.size(); i++)
+    {
+        all.addInternalPoint(boxes[i].UpperLeftCorner);
+        all.addInternalPoint(boxes[i].LowerRightCorner);
+    }
+
+    const float MAX_CELLS = 256;
+    float width  = all.getWidth();
+    float height = all.getHeight();
+    m_grid_cell_size = sqrt(width*height/m_all_nodes.size());
+    m_grid_cell_size = std::max(m_grid_cell_size, 1.0f);
+    m_grid_cell_size = std::max(m_grid_cell_size, width /MAX_CELLS);
+    m_grid_cell_size = std::max(m_grid_cell_size, height/MAX_CELLS);
+    m_grid_min_x     = all.UpperLeftCorner.X;
+    m_grid_min_z     = all.UpperLeftCorner.Y;
+    m_grid_width     = (int)(width /m_grid_cell_size)+1;
+    m_grid_height    = (int)(height/m_grid_cell_size)+1;
+
+    // First count the nodes in each cell, then store them.
+    std::vector<int> cell_range(4*boxes.size());
+    m_grid_start.resize(m_grid_width*m_grid_height+1, 0);
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        int *r = &cell_range[4*i];
+        r[0] = (int)((boxes[i].UpperLeftCorner.X -m_grid_min_x)/m_grid_cell_size);
+        r[1] = (int)((boxes[i].UpperLeftCorner.Y -m_grid_min_z)/m_grid_cell_size);
+        r[2] = (int)((boxes[i].LowerRightCorner.X-m_grid_min_x)/m_grid_cell_size);
+        r[3] = (int)((boxes[i].LowerRightCorner.Y-m_grid_min_z)/m_grid_cell_size);
+        r[2] = std::min(r[2], m_grid_width -1);
+        r[3] = std::min(r[3], m_grid_height-1);
+        for(int z=r[1]; z<=r[3]; z++)
+            for(int x=r[0]; x<=r[2]; x++)
+                m_grid_start[z*m_grid_width+x+1]++;
+    }
+    for(unsigned int i=1; i<m_grid_start.size(); i++)
+        m_grid_start[i] += m_grid_start[i-1];
+
+    std::vector<unsigned int> next(m_grid_start.begin(), m_grid_start.end()-1);
+    m_grid_nodes.resize(m_grid_start.back());
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        const int *r = &cell_range[4*i];
+        for(int z=r[1]; z<=r[3]; z++)
+            for(int x=r[0]; x<=r[2]; x++)
+                m_grid_nodes[next[z*m_grid_width+x]++] = i;
+    }
+    Log::info("QuadGraph", "Sector grid has %dx%d cells of size %f with "
+              "%d entries for %d nodes.", m_grid_width, m_grid_height,
+              m_grid_cell_size, (int)m_grid_nodes.size(),
+              (int)m_all_nodes.size());
+}   // buildSectorGrid
+
 // -----------------------------------------------------------------------------
 
 void QuadGraph::addSuccessor(unsigned int from, unsigned int to) {
@@ -823,6 +901,12 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
         return;
     }   // if still on same quad
 
+    if(!all_sectors && m_use_grid && !m_grid_start.empty())
+    {
+        findRoadSectorInGrid(xyz, sector);
+        return;
+    }
+
     // Now we search through all graph nodes, starting with
     // the current one
     int indx       = *sector;
@@ -861,6 +945,50 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     return;
 }   // findRoadSector
 
+//-----------------------------------------------------------------------------
+/** Implements findRoadSector using the sector grid, which is used if no list
+ *  of sectors to test is given. The result is identical to testing all
+ *  graph nodes: if the point is on more than one quad, the quad with the
+ *  smallest height difference is used, and of those the first one in the
+ *  order in which the linear search tests them (starting after *sector).
+ *  \param xyz The point to find the sector for.
+ *  \param sector On input the previous sector (or UNKNOWN_SECTOR), on output
+ *         the sector the point is on or UNKNOWN_SECTOR.
+ */
+void QuadGraph::findRoadSectorInGrid(const Vec3& xyz, int *sector) const
+{
+    const int n     = m_all_nodes.size();
+    const int first = *sector<n-1 ? *sector+1 : 0;
+    *sector = UNKNOWN_SECTOR;
+
+    float fx = (xyz.getX()-m_grid_min_x)/m_grid_cell_size;
+    float fz = (xyz.getZ()-m_grid_min_z)/m_grid_cell_size;
+    // A point outside of the grid can not be on any quad. Points on the
+    // upper border are in the last cell.
+    if(fx<0 || fz<0 || fx>m_grid_width || fz>m_grid_height)
+        return;
+    int cell = std::min((int)fz, m_grid_height-1)*m_grid_width
+             + std::min((int)fx, m_grid_width -1);
+
+    float min_dist  = 999999.9f;
+    int   min_order = n;
+    for(unsigned int i=m_grid_start[cell]; i<m_grid_start[cell+1]; i++)
+    {
+        int indx      = m_grid_nodes[i];
+        const Quad &q = getQuadOfNode(indx);
+        float dist    = xyz.getY() - q.getMinHeight();
+        if(dist>min_dist || dist<=-1.0f) continue;
+        int order     = indx>=first ? indx-first : indx-first+n;
+        if(dist==min_dist && order>min_order) continue;
+        if(q.pointInQuad(xyz))
+        {
+            min_dist  = dist;
+            min_order = order;
+            *sector   = indx;
+        }
+    }   // for i in cell
+}   // findRoadSectorInGrid
+
 //-----------------------------------------------------------------------------
 /** findOutOfRoadSector finds the sector where XYZ is, but as it name
     implies, it is more accurate for the outside of the track than the
@@ -917,6 +1045,15 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    if(!all_sectors && m_use_grid && !m_grid_start.empty())
+    {
+        int min_sector =
+            findOutOfRoadSectorInGrid(xyz, current_sector+1==(int)getNumNodes()
+                                           ? 0 : current_sector+1);
+        if(min_sector!=UNKNOWN_SECTOR)
+            return min_sector;
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -967,6 +1104,140 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
     return min_sector;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Implements findOutOfRoadSector using the sector grid. The cells are
+ *  searched in rings of increasing distance around the point, until no
+ *  cell that was not searched can contain a closer driveline. The result
+ *  is identical to the linear search: nodes that fulfill the height
+ *  condition are preferred, and of nodes with the same distance the first
+ *  one in the order of the linear search (starting at first_sector) is used.
+ *  \param xyz The point to find the sector for.
+ *  \param first_sector The first sector tested by the linear search.
+ *  \return The sector, or UNKNOWN_SECTOR if the point is outside of the
+ *          grid, in which case the linear search must be used.
+ */
+int QuadGraph::findOutOfRoadSectorInGrid(const Vec3& xyz,
+                                         int first_sector) const
+{
+    const int n = m_all_nodes.size();
+    float fx = (xyz.getX()-m_grid_min_x)/m_grid_cell_size;
+    float fz = (xyz.getZ()-m_grid_min_z)/m_grid_cell_size;
+    if(fx<0 || fz<0 || fx>m_grid_width || fz>m_grid_height)
+        return UNKNOWN_SECTOR;
+    const int cx = std::min((int)fx, m_grid_width -1);
+    const int cz = std::min((int)fz, m_grid_height-1);
+
+    // Best node for phase 0 (with height condition) and phase 1 (without).
+    int   min_sector[2] = { UNKNOWN_SECTOR, UNKNOWN_SECTOR };
+    float min_dist_2[2] = { 999999.0f*999999.0f, 999999.0f*999999.0f };
+    int   min_order[2]  = { n, n };
+
+    for(int r=0; ; r++)
+    {
+        const int x0 = cx-r, x1 = cx+r, z0 = cz-r, z1 = cz+r;
+        for(int z=std::max(z0, 0); z<=std::min(z1, m_grid_height-1); z++)
+        {
+            // Only the border of the ring, the inside was done before.
+            const int step = (z==z0 || z==z1) ? 1 : x1-x0;
+            for(int x=x0; x<=x1; x+=std::max(step, 1))
+            {
+                if(x<0 || x>=m_grid_width) continue;
+                const int cell = z*m_grid_width+x;
+                for(unsigned int i=m_grid_start[cell];
+                    i<m_grid_start[cell+1]; i++)
+                {
+                    int indx = m_grid_nodes[i];
+                    float dist_2 = m_all_nodes[indx]->getDistance2FromPoint(xyz);
+                    if(dist_2>min_dist_2[1] && dist_2>min_dist_2[0])
+                        continue;
+                    int order = indx>=first_sector ? indx-first_sector
+                                                   : indx-first_sector+n;
+                    float dist = xyz.getY() - getQuadOfNode(indx).getMinHeight();
+                    for(int phase=(dist<5.0f && dist>-1.0f) ? 0 : 1;
+                        phase<2; phase++)
+                    {
+                        if(dist_2<min_dist_2[phase] ||
+                           (dist_2==min_dist_2[phase] &&
+                            order<min_order[phase]    )   )
+                        {
+                            min_dist_2[phase] = dist_2;
+                            min_order[phase]  = order;
+                            min_sector[phase] = indx;
+                        }
+                    }   // for phase
+                }   // for i in cell
+            }   // for x
+        }   // for z
+
+        // Stop if the whole grid was searched, or if no cell outside of
+        // the searched square can contain a closer node.
+        float outside = 999999.0f;
+        if(x0>0)
+            outside = std::min(outside, xyz.getX()-m_grid_min_x
+                                        -x0*m_grid_cell_size);
+        if(z0>0)
+            outside = std::min(outside, xyz.getZ()-m_grid_min_z
+                                        -z0*m_grid_cell_size);
+        if(x1<m_grid_width-1)
+            outside = std::min(outside, m_grid_min_x+(x1+1)*m_grid_cell_size
+                                        -xyz.getX());
+        if(z1<m_grid_height-1)
+            outside = std::min(outside, m_grid_min_z+(z1+1)*m_grid_cell_size
+                                        -xyz.getZ());
+        if(outside==999999.0f)
+            break;
+        // Allow for some rounding errors in the cell computation.
+        outside -= 0.001f;
+        if(min_sector[0]!=UNKNOWN_SECTOR && outside>0 &&
+           min_dist_2[0]<outside*outside)
+            return min_sector[0];
+    }   // for r
+
+    return min_sector[0]!=UNKNOWN_SECTOR ? min_sector[0] : min_sector[1];
+}   // findOutOfRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Replays recorded kart positions the same way TrackSector::update does,
+ *  once with the linear search and once with the sector grid, and prints
+ *  the time taken and the number of different results.
+ *  \param positions For each kart the positions recorded in each frame.
+ */
+void QuadGraph::benchmarkSectorLookup(
+                         const std::vector< std::vector<Vec3> > &positions)
+{
+    std::vector<int> results[2];
+    uint64_t time[2];
+    unsigned int count = 0;
+    for(int use_grid=0; use_grid<2; use_grid++)
+    {
+        m_use_grid = use_grid==1;
+        uint64_t start = StkTime::getMonoTimeUs();
+        for(unsigned int k=0; k<positions.size(); k++)
+        {
+            int sector = UNKNOWN_SECTOR;
+            for(unsigned int i=0; i<positions[k].size(); i++)
+            {
+                int prev_sector = sector;
+                findRoadSector(positions[k][i], &sector);
+                if(sector==UNKNOWN_SECTOR)
+                    sector = findOutOfRoadSector(positions[k][i], prev_sector);
+                results[use_grid].push_back(sector);
+            }
+        }
+        time[use_grid] = StkTime::getMonoTimeUs() - start;
+        count = results[use_grid].size();
+    }   // for use_grid
+    m_use_grid = true;
+
+    unsigned int differences = 0;
+    for(unsigned int i=0; i<count; i++)
+        if(results[0][i]!=results[1][i]) differences++;
+
+    Log::info("QuadGraph", "Sector lookup for %d positions: linear %f ms, "
+              "grid %f ms, %d different results.", count,
+              time[0]*0.001f, time[1]*0.001f, differences);
+}   // benchmarkSectorLookup
+
 //-----------------------------------------------------------------------------
 /** Takes a snapshot of the driveline quads so they can be used as minimap.
  */
@@ -78,6 +78,32 @@ private:
     /** Wether the graph should be reverted or not */
     bool                     m_reverse;
 
+    /** Minimum X coordinate of the sector grid. */
+    float                    m_grid_min_x;
+
+    /** Minimum Z coordinate of the sector grid. */
+    float                    m_grid_min_z;
+
+    /** Size of a cell of the sector grid. */
+    float                    m_grid_cell_size;
+
+    /** Number of cells of the sector grid along X and Z. */
+    int                      m_grid_width, m_grid_height;
+
+    /** The sector grid is a 2d grid in the XZ plane that stores for each
+     *  cell the graph nodes whose quad overlaps this cell. It is used to
+     *  speed up findRoadSector and findOutOfRoadSector. The nodes of
+     *  cell i are stored in m_grid_nodes from index m_grid_start[i] to
+     *  m_grid_start[i+1]-1. */
+    std::vector<unsigned int> m_grid_start;
+
+    /** The graph nodes in all cells of the sector grid. */
+    std::vector<int>         m_grid_nodes;
+
+    /** If the sector grid is used (it can be disabled to compare with the
+     *  linear search). */
+    bool                     m_use_grid;
+
     void setDefaultSuccessors();
     void computeChecklineRequirements(GraphNode* node, int latest_checkline);
     void computeDirectionData();
@@ -92,6 +118,10 @@ private:
                     const video::SColor *track_color=NULL,
                     const video::SColor *lap_color=NULL);
     unsigned int getStartNode() const;
+    void         buildSectorGrid();
+    void         findRoadSectorInGrid(const Vec3& xyz, int *sector) const;
+    int          findOutOfRoadSectorInGrid(const Vec3& xyz,
+                                           int first_sector) const;
          QuadGraph     (const std::string &quad_file_name,
                         const std::string graph_file_name,
                         const bool reverse);
@@ -112,6 +142,8 @@ public:
                                      const int curr_sector=UNKNOWN_SECTOR,
                                      std::vector<int> *all_sectors=NULL
                                      ) const;
+    void         benchmarkSectorLookup(
+                       const std::vector< std::vector<Vec3> > &positions);
     void         setDefaultStartPositions(AlignedArray<btTransform>
                                                        *start_transforms,
                                          unsigned int karts_per_row,
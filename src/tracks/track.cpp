@@ -66,7 +66,9 @@ using namespace irr;
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <ISceneManager.h>
 #include <IMeshSceneNode.h>
@@ -74,6 +76,9 @@ using namespace irr;
 #include <ILightSceneNode.h>
 #include <IMeshCache.h>
 
+#include <stdio.h>
+#include <string.h>
+
 const float Track::NOHIT           = -99999.9f;
 
 // ----------------------------------------------------------------------------
@@ -207,6 +212,9 @@ void Track::cleanup()
     delete m_track_mesh;
     m_track_mesh = NULL;
 
+    // Free the memory of the height map
+    std::vector<float>().swap(m_height_map);
+
     delete m_gfx_effect_mesh;
     m_gfx_effect_mesh = NULL;
 
@@ -586,7 +594,11 @@ void Track::createPhysicsModel(unsigned int main_track_count)
     {
         convertTrackToBullet(m_all_nodes[i]);
     }
-    m_track_mesh->createPhysicalBody();
+    // Building the BVH of the whole track takes a significant part of the
+    // loading time, so it is cached.
+    m_track_mesh->createPhysicalBody((btCollisionObject::CollisionFlags)0,
+                         file_manager->getCachedFile("bvh-"+m_ident+".bin"),
+                         m_version);
     m_gfx_effect_mesh->createCollisionShape();
 }   // createPhysicsModel
 
@@ -1397,6 +1409,7 @@ void Track::createWater(const XMLNode &node)
  */
 void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 {
+    const uint64_t load_start = StkTime::getMonoTimeUs();
     // Use m_filename to also get the path, not only the identifier
     irr_driver->setTextureErrorMessage("While loading track '%s'",
                                        m_filename                  );
@@ -1459,6 +1472,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         // no temporary materials.xml file, ignore
         (void)e;
     }
+    const uint64_t materials_loaded = StkTime::getMonoTimeUs();
 
     // Load the graph only now: this function is called from world, after
     // the race gui was created. The race gui is needed since it stores
@@ -1708,6 +1722,13 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     }
 
     irr_driver->unsetTextureErrorMessage();
+
+    const uint64_t load_end = StkTime::getMonoTimeUs();
+    Log::info("Track", "Loaded track '%s' in %.1f ms (materials %.1f ms, "
+              "scene %.1f ms).", getIdent().c_str(),
+              (load_end-load_start)/1000.0f,
+              (materials_loaded-load_start)/1000.0f,
+              (load_end-materials_loaded)/1000.0f);
 }   // loadTrackModel
 
 //-----------------------------------------------------------------------------
@@ -2149,42 +2170,168 @@ bool Track::setTerrainHeight(Vec3 *pos) const
 
 // ----------------------------------------------------------------------------
 
-std::vector< std::vector<float> > Track::buildHeightMap()
+/** Returns the height map of this track, see m_height_map. The height map
+ *  is only computed when it is needed for the first time. Since casting
+ *  HEIGHT_MAP_RESOLUTION^2 rays takes a while, the result is stored in a
+ *  cache file that is identified by a hash of the track mesh, so that
+ *  further loads of the same track only need to read that file.
+ */
+const std::vector<float>& Track::getHeightMap()
 {
-    std::vector< std::vector<float> > out(HEIGHT_MAP_RESOLUTION);
+    if(!m_height_map.empty())
+        return m_height_map;
+
+    const uint64_t hash = m_track_mesh->getHash();
+    const std::string filename = file_manager->getCachedFile("heightmap-"
+                               + m_ident + ".bin");
+    if(loadCachedHeightMap(filename, hash))
+        return m_height_map;
+
+    m_height_map.resize(HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION);
+    // The rows are independent of each other, and castRay does not modify
+    // the mesh, so the rows can be computed in parallel.
+    if(WorkerPool::get())
+        WorkerPool::get()->parallelFor(HEIGHT_MAP_RESOLUTION,
+                                       &Track::buildHeightMapRow, this);
+    else
+    {
+        for(int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+            buildHeightMapRow(i, this);
+    }
+
+    saveCachedHeightMap(filename, hash);
+    return m_height_map;
+}   // getHeightMap
 
-    float x = m_aabb_min.getX();
-    const float x_len = m_aabb_max.getX() - m_aabb_min.getX();
-    const float z_len = m_aabb_max.getZ() - m_aabb_min.getZ();
+// ----------------------------------------------------------------------------
+/** Computes one row (i.e. one x value) of the height map by casting rays
+ *  down onto the track. If no triangle is hit, the height of the previous
+ *  point of the row is used (or the end of the ray for the first point).
+ *  \param row The row to compute.
+ *  \param track Pointer to the track.
+ */
+void Track::buildHeightMapRow(int row, void *track)
+{
+    Track *me = (Track*)track;
+    const float x_len = me->m_aabb_max.getX() - me->m_aabb_min.getX();
+    const float z_len = me->m_aabb_max.getZ() - me->m_aabb_min.getZ();
 
     const float x_step = x_len/HEIGHT_MAP_RESOLUTION;
     const float z_step = z_len/HEIGHT_MAP_RESOLUTION;
 
-    btVector3 hitpoint;
+    const float x = me->m_aabb_min.getX() + row*x_step;
+    float z = me->m_aabb_min.getZ();
+
+    btVector3 hitpoint(0, -100000.f, 0);
     const Material* material;
     btVector3 normal;
+    float *out = &me->m_height_map[row*HEIGHT_MAP_RESOLUTION];
 
-    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+    for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
     {
-        out[i].resize(HEIGHT_MAP_RESOLUTION);
-        float z = m_aabb_min.getZ();
+        btVector3 pos(x, 100.0f, z);
+        btVector3 to = pos;
+        to.setY(-100000.f);
 
-        for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
-        {
-            btVector3 pos(x, 100.0f, z);
-            btVector3 to = pos;
-            to.setY(-100000.f);
+        me->m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
+        z += z_step;
+
+        out[j] = hitpoint.getY();
+    }   // j<HEIGHT_MAP_RESOLUTION
+}   // buildHeightMapRow
+
+// ----------------------------------------------------------------------------
+/** The header of a height map cache file. */
+struct HeightMapCacheHeader
+{
+    char     m_magic[4];
+    uint32_t m_resolution;
+    uint64_t m_hash;
+    float    m_aabb[6];
+};   // HeightMapCacheHeader
+
+// ----------------------------------------------------------------------------
+/** Fills in the header of a height map cache file for this track. */
+static void fillHeightMapHeader(HeightMapCacheHeader *header, uint64_t hash,
+                                const Vec3 &min, const Vec3 &max)
+{
+    memset(header, 0, sizeof(HeightMapCacheHeader));
+    memcpy(header->m_magic, "STKH", 4);
+    header->m_resolution = HEIGHT_MAP_RESOLUTION;
+    header->m_hash       = hash;
+    header->m_aabb[0]    = min.getX();
+    header->m_aabb[1]    = min.getY();
+    header->m_aabb[2]    = min.getZ();
+    header->m_aabb[3]    = max.getX();
+    header->m_aabb[4]    = max.getY();
+    header->m_aabb[5]    = max.getZ();
+}   // fillHeightMapHeader
 
-            m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
-            z += z_step;
+// ----------------------------------------------------------------------------
+/** Loads the height map from a cache file. Returns false (and leaves the
+ *  height map empty) if the file does not exist, or was computed for a
+ *  different track mesh.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the current track mesh.
+ */
+bool Track::loadCachedHeightMap(const std::string &filename, uint64_t hash)
+{
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(!f)
+        return false;
 
-            out[i][j] = hitpoint.getY();
-        }   // j<HEIGHT_MAP_RESOLUTION
-        x += x_step;
+    HeightMapCacheHeader expected, header;
+    fillHeightMapHeader(&expected, hash, m_aabb_min, m_aabb_max);
+    const unsigned int n = HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION;
+    m_height_map.resize(n);
+    bool ok = fread(&header, sizeof(header), 1, f)==1                  &&
+              memcmp(&header, &expected, sizeof(header))==0            &&
+              fread(&m_height_map[0], sizeof(float), n, f)==n;
+    fclose(f);
+    if(!ok)
+    {
+        Log::info("Track", "Height map cache '%s' is outdated.",
+                  filename.c_str());
+        m_height_map.clear();
     }
+    return ok;
+}   // loadCachedHeightMap
 
-    return out;
-}
+// ----------------------------------------------------------------------------
+/** Saves the height map into a cache file. The data is written to a
+ *  temporary file which is then renamed, so that a crash while writing
+ *  never leaves a truncated cache file behind.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the current track mesh.
+ */
+void Track::saveCachedHeightMap(const std::string &filename, uint64_t hash)
+{
+    const std::string tmp_name = filename+".tmp";
+    FILE *f = fopen(tmp_name.c_str(), "wb");
+    bool ok = f!=NULL;
+    if(f)
+    {
+        HeightMapCacheHeader header;
+        fillHeightMapHeader(&header, hash, m_aabb_min, m_aabb_max);
+        ok = fwrite(&header, sizeof(header), 1, f)==1 &&
+             fwrite(&m_height_map[0], sizeof(float), m_height_map.size(), f)
+                 == m_height_map.size();
+        // Buffered data is only written (and write errors detected) here
+        if(fclose(f)!=0)
+            ok = false;
+    }
+#ifdef WIN32
+    // On windows rename fails if the destination exists
+    if(ok)
+        remove(filename.c_str());
+#endif
+    if(!ok || rename(tmp_name.c_str(), filename.c_str())!=0)
+    {
+        Log::warn("Track", "Can't write height map cache '%s'.",
+                  filename.c_str());
+        remove(tmp_name.c_str());
+    }
+}   // saveCachedHeightMap
 
 // ----------------------------------------------------------------------------
 /** Returns the rotation of the sun. */
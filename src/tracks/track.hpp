@@ -235,6 +235,10 @@ private:
     Vec3                     m_aabb_min;
     /** Maximum coordinates of this track. */
     Vec3                     m_aabb_max;
+    /** The height of the track on a HEIGHT_MAP_RESOLUTION x
+     *  HEIGHT_MAP_RESOLUTION grid over the track's aabb, stored row by row
+     *  (the x index is the row). Empty until getHeightMap() is called. */
+    std::vector<float>       m_height_map;
     /** True if this track is an arena. */
     bool                     m_is_arena;
     /** True if this track has easter eggs. */
@@ -399,6 +403,9 @@ private:
     void getMusicInformation(std::vector<std::string>&  filenames,
                              std::vector<MusicInformation*>& m_music   );
     void loadCurves(const XMLNode &node);
+    static void buildHeightMapRow(int row, void *track);
+    bool loadCachedHeightMap(const std::string &filename, uint64_t hash);
+    void saveCachedHeightMap(const std::string &filename, uint64_t hash);
     void handleSky(const XMLNode &root, const std::string &filename);
     void loadObjects(const XMLNode* root, const std::string& path, LodNodeLoader& lod_loader,
                      bool create_lod_definitions, scene::ISceneNode* parent,
@@ -436,7 +443,7 @@ public:
                                         unsigned int mode_id=0);
     bool findGround(AbstractKart *kart);
 
-    std::vector< std::vector<float> > buildHeightMap();
+    const std::vector<float>& getHeightMap();
     // ------------------------------------------------------------------------
     /** Returns the texture with the mini map for this track. */
     const video::ITexture*    getMiniMap    () const { return m_mini_map; }
@@ -0,0 +1,97 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ATOMIC_HPP
+#define HEADER_ATOMIC_HPP
+
+#ifdef WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define _WINSOCKAPI_
+#  include <windows.h>
+#endif
+
+/** A few atomic operations used by the lock-free data structures. They map
+ *  to the interlocked functions on windows and to the gcc builtins
+ *  everywhere else. All of them act as a full memory barrier.
+ */
+namespace Atomic
+{
+    // ------------------------------------------------------------------------
+    /** Atomically increments a value and returns the new value. */
+    inline long increment(volatile long *value)
+    {
+#ifdef WIN32
+        return InterlockedIncrement(value);
+#else
+        return __sync_add_and_fetch(value, 1);
+#endif
+    }   // increment
+
+    // ------------------------------------------------------------------------
+    /** Atomically decrements a value and returns the new value. */
+    inline long decrement(volatile long *value)
+    {
+#ifdef WIN32
+        return InterlockedDecrement(value);
+#else
+        return __sync_sub_and_fetch(value, 1);
+#endif
+    }   // decrement
+
+    // ------------------------------------------------------------------------
+    /** Atomically sets a pointer to a new value and returns the old one. */
+    template<typename T>
+    T* exchangePointer(T* volatile *dest, T *value)
+    {
+#ifdef WIN32
+        return (T*)InterlockedExchangePointer((void* volatile*)dest, value);
+#else
+        // __sync_lock_test_and_set is only an acquire barrier
+        __sync_synchronize();
+        return __sync_lock_test_and_set(dest, value);
+#endif
+    }   // exchangePointer
+
+    // ------------------------------------------------------------------------
+    /** Sets value to new_value if it is equal to expected. Returns true if
+     *  the value was changed. */
+    inline bool compareAndSwap(volatile long *value, long expected,
+                               long new_value)
+    {
+#ifdef WIN32
+        return InterlockedCompareExchange(value, new_value, expected)
+               == expected;
+#else
+        return __sync_bool_compare_and_swap(value, expected, new_value);
+#endif
+    }   // compareAndSwap
+
+    // ------------------------------------------------------------------------
+    /** A full memory barrier. */
+    inline void memoryBarrier()
+    {
+#ifdef WIN32
+        MemoryBarrier();
+#else
+        __sync_synchronize();
+#endif
+    }   // memoryBarrier
+
+}   // namespace Atomic
+
+#endif
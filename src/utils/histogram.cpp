@@ -0,0 +1,100 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/histogram.hpp"
+
+#include "utils/log.hpp"
+
+// ----------------------------------------------------------------------------
+/** Removes all values from the histogram. */
+void Histogram::reset()
+{
+    for(int i=0; i<NUM_BUCKETS; i++)
+        m_buckets[i] = 0;
+    m_count = 0;
+    m_sum   = 0;
+    m_max   = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Adds a value to the histogram.
+ *  \param us The duration in microseconds.
+ */
+void Histogram::add(uint64_t us)
+{
+    int bucket = 0;
+    uint64_t v = us;
+    while(v > 0 && bucket < NUM_BUCKETS-1)
+    {
+        v >>= 1;
+        bucket++;
+    }
+    m_buckets[bucket]++;
+    m_count++;
+    m_sum += us;
+    if(us > m_max)
+        m_max = us;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Returns an estimate of the given percentile, i.e. the upper limit of the
+ *  bucket that contains it.
+ *  \param percent Percentile to compute, between 0 and 100.
+ */
+uint64_t Histogram::getPercentile(float percent) const
+{
+    if(m_count==0)
+        return 0;
+    uint64_t target = (uint64_t)(m_count*percent/100.0f);
+    if(target >= m_count)
+        target = m_count-1;
+    uint64_t seen = 0;
+    for(int i=0; i<NUM_BUCKETS; i++)
+    {
+        seen += m_buckets[i];
+        if(seen > target)
+        {
+            uint64_t limit = (uint64_t)1 << i;
+            return limit < m_max ? limit : m_max;
+        }
+    }
+    return m_max;
+}   // getPercentile
+
+// ----------------------------------------------------------------------------
+/** Prints a summary and the non-empty buckets using the log.
+ *  \param component The log component to use.
+ *  \param name Name of the measured quantity.
+ */
+void Histogram::print(const char *component, const std::string &name) const
+{
+    Log::info(component, "%s: %llu samples, avg %llu us, p50 %llu us, "
+              "p95 %llu us, p99 %llu us, max %llu us.", name.c_str(),
+              (unsigned long long)m_count, (unsigned long long)getAverage(),
+              (unsigned long long)getPercentile(50),
+              (unsigned long long)getPercentile(95),
+              (unsigned long long)getPercentile(99),
+              (unsigned long long)m_max);
+    for(int i=0; i<NUM_BUCKETS; i++)
+    {
+        if(m_buckets[i]==0) continue;
+        Log::info(component, "  < %10llu us: %llu", 
+                  (unsigned long long)((uint64_t)1 << i),
+                  (unsigned long long)m_buckets[i]);
+    }
+}   // print
@@ -0,0 +1,68 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_HISTOGRAM_HPP
+#define HEADER_HISTOGRAM_HPP
+
+#include "utils/types.hpp"
+
+#include <string>
+
+/** A histogram of durations in microseconds, using power-of-two buckets
+ *  (bucket i contains values in [2^(i-1), 2^i) us). It is cheap enough to
+ *  be updated on hot paths, and can estimate percentiles. It is not thread
+ *  safe, the caller has to protect it if necessary.
+ */
+class Histogram
+{
+public:
+    /** Number of buckets, the last one collects everything above
+     *  2^(NUM_BUCKETS-2) us (about 17 minutes). */
+    static const int NUM_BUCKETS = 32;
+
+private:
+    /** Number of values in each bucket. */
+    uint64_t m_buckets[NUM_BUCKETS];
+
+    /** Number of values added. */
+    uint64_t m_count;
+
+    /** Sum of all values, to compute the average. */
+    uint64_t m_sum;
+
+    /** Largest value added. */
+    uint64_t m_max;
+
+public:
+             Histogram() { reset(); }
+    void     reset();
+    void     add(uint64_t us);
+    uint64_t getPercentile(float percent) const;
+    void     print(const char *component, const std::string &name) const;
+    // ------------------------------------------------------------------------
+    /** Returns the number of values added. */
+    uint64_t getCount() const { return m_count; }
+    // ------------------------------------------------------------------------
+    /** Returns the largest value added. */
+    uint64_t getMax() const { return m_max; }
+    // ------------------------------------------------------------------------
+    /** Returns the average of all values added. */
+    uint64_t getAverage() const { return m_count ? m_sum/m_count : 0; }
+};   // Histogram
+
+#endif
@@ -0,0 +1,108 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOCK_FREE_QUEUE_HPP
+#define HEADER_LOCK_FREE_QUEUE_HPP
+
+#include "utils/atomic.hpp"
+#include "utils/no_copy.hpp"
+
+#include <stddef.h>
+
+/** An unbounded multi-producer, single-consumer FIFO queue that does not use
+ *  any locks. Any number of threads can push() concurrently, but only one
+ *  thread at a time may call pop() or isEmpty().
+ *  The queue is a linked list with a dummy node: producers atomically swap
+ *  the head pointer and then link the previous head to the new node, the
+ *  consumer follows the next pointers from the tail. A pushed element can
+ *  briefly be invisible to the consumer until the producer has linked it,
+ *  in which case pop() just returns false.
+ */
+template<typename TYPE>
+class LockFreeQueue : public NoCopy
+{
+private:
+    struct Node
+    {
+        Node * volatile m_next;
+        TYPE            m_value;
+    };
+
+    /** Most recently pushed node, modified by the producers. */
+    Node * volatile m_head;
+
+    /** The dummy node before the oldest element, only used by the
+     *  consumer. */
+    Node           *m_tail;
+
+public:
+    LockFreeQueue()
+    {
+        m_tail = new Node();
+        m_tail->m_next = NULL;
+        m_head = m_tail;
+    }   // LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    /** Deletes all nodes. Elements still in the queue are not freed. */
+    ~LockFreeQueue()
+    {
+        TYPE value;
+        while(pop(&value)) {}
+        delete m_tail;
+    }   // ~LockFreeQueue
+
+    // ------------------------------------------------------------------------
+    /** Adds an element at the end of the queue. Can be called from any
+     *  thread. */
+    void push(const TYPE &value)
+    {
+        Node *node    = new Node();
+        node->m_value = value;
+        node->m_next  = NULL;
+        Node *prev    = Atomic::exchangePointer(&m_head, node);
+        prev->m_next  = node;
+    }   // push
+
+    // ------------------------------------------------------------------------
+    /** Removes the oldest element from the queue. Must only be called by
+     *  the consumer thread.
+     *  \param value Where to store the removed element.
+     *  \return False if the queue was empty.
+     */
+    bool pop(TYPE *value)
+    {
+        Node *next = m_tail->m_next;
+        if (next == NULL)
+            return false;
+        // make sure the value written by the producer is visible
+        Atomic::memoryBarrier();
+        *value = next->m_value;
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }   // pop
+
+    // ------------------------------------------------------------------------
+    /** True if there is no element to pop. Must only be called by the
+     *  consumer thread. */
+    bool isEmpty() const { return m_tail->m_next == NULL; }
+
+};   // LockFreeQueue
+
+#endif
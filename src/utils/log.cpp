@@ -19,8 +19,12 @@
 #include "utils/log.hpp"
 
 #include "config/user_config.hpp"
+#include "utils/atomic.hpp"
+#include "utils/lock_free_queue.hpp"
+#include "utils/time.hpp"
 
 #include <cstdio>
+#include <pthread.h>
 #include <stdio.h>
 
 #ifdef ANDROID
@@ -35,6 +39,45 @@ Log::LogLevel Log::m_min_log_level = Log::LL_VERBOSE;
 bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
 
+static const char *g_level_names[] = {"verbose", "debug  ", "info   ",
+                                      "warn   ", "error  ", "fatal  "};
+
+/** A formatted message waiting to be written by the writer thread. */
+struct LogMessage
+{
+    int         m_level;
+    std::string m_text;
+};   // LogMessage
+
+/** The messages to be written. It is created when the writer thread is
+ *  started for the first time and never deleted, since other threads might
+ *  still hold a pointer to it while the program exits. Messages are pushed
+ *  without taking any lock. */
+static LockFreeQueue<LogMessage*> *g_log_queue = NULL;
+static pthread_t     g_writer_thread;
+/** Only used to start and stop the writer thread, to let it sleep while
+ *  there is nothing to write, and for flushBuffers(). Logging a message
+ *  only takes the lock if the writer thread has to be woken up. */
+static pthread_mutex_t g_writer_mutex       = PTHREAD_MUTEX_INITIALIZER;
+/** Signalled when a message was queued while the writer thread was
+ *  sleeping, or when the thread should stop. */
+static pthread_cond_t  g_writer_cond        = PTHREAD_COND_INITIALIZER;
+/** Signalled when the writer thread has written all queued messages. */
+static pthread_cond_t  g_written_cond       = PTHREAD_COND_INITIALIZER;
+/** True while the writer thread accepts messages. */
+static volatile bool g_writer_running     = false;
+/** Set by stopWriterThread() once no thread is pushing messages anymore,
+ *  the writer thread exits after writing the remaining messages. */
+static bool          g_writer_stop        = false;
+/** True while the writer thread waits for new messages. */
+static volatile bool g_writer_sleeping    = false;
+/** Number of threads that are about to push a message. */
+static volatile long g_num_pushing        = 0;
+/** Number of messages queued and written, used by flushBuffers(). */
+static volatile long g_num_queued         = 0;
+static long          g_num_written        = 0;
+static bool          g_atexit_registered  = false;
+
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
  *  log level. It is only called if messages are not redirected to a file.
@@ -121,14 +164,18 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually prints the log message. If log messages are not redirected
- *  to a file, it tries to select a terminal colour.
+/** This formats the log message, and either queues it for the writer
+ *  thread or writes it immediately if there is no writer thread. The level
+ *  is tested before formatting. Fatal messages are written before this
+ *  function returns, since the program is aborted afterwards.
  *  \param level Log level of the message to print.
  *  \param format A printf-like format string.
  *  \param va_list The values to be printed for the format.
+ *  \param suppressed Number of messages from the same call site that were
+ *         suppressed by a RateLimit, which is added to the message.
  */
 void Log::printMessage(int level, const char *component, const char *format,
-                       VALIST args)
+                       VALIST args, int suppressed)
 {
     assert(level>=0 && level <=LL_FATAL);
 
@@ -153,61 +200,266 @@ void Log::printMessage(int level, const char *component, const char *format,
     }
     __android_log_vprint(alp, "SuperTuxKart", format, args);
 #else
-    static const char *names[] = {"verbose", "debug  ", "info   ",
-                                  "warn   ", "error  ", "fatal  "};
+    // The message is formatted directly into the object that is queued.
+    LogMessage *message = new LogMessage();
+    message->m_level    = level;
+    std::string &text   = message->m_text;
 
     // Using a va_list twice produces undefined results, ie crash.
     // So make a copy if we're going to use it twice.
+    char buffer[1024];
     VALIST copy;
-    if (m_file_stdout)
+    va_copy(copy, args);
+    int n = vsnprintf(buffer, sizeof(buffer), format, copy);
+    va_end(copy);
+    // Older windows versions return -1 and don't add a 0 if truncated
+    buffer[sizeof(buffer)-1] = 0;
+
+    text = component;
+    text += ": ";
+    if(n>=(int)sizeof(buffer))
     {
+        // Message was truncated, format again with a big enough buffer
+        char *big = new char[n+1];
         va_copy(copy, args);
+        vsnprintf(big, n+1, format, copy);
+        va_end(copy);
+        text += big;
+        delete [] big;
+    }
+    else
+        text += buffer;
+
+    if(suppressed>0)
+    {
+        sprintf(buffer, " (%d similar messages suppressed)", suppressed);
+        text += buffer;
     }
+
 #if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    VALIST copy2;
-    va_copy(copy2, args);
+    OutputDebugString("[");
+    OutputDebugString(g_level_names[level]);
+    OutputDebugString("] ");
+    OutputDebugString(text.c_str());
+    OutputDebugString("\r\n");
 #endif
 
+    // Announce the push before testing g_writer_running, so that
+    // stopWriterThread() can wait for this message to be queued.
+    Atomic::increment(&g_num_pushing);
+    const bool queued = g_writer_running;
+    if(queued)
+    {
+        g_log_queue->push(message);
+        Atomic::increment(&g_num_queued);
+        // Only wake up the writer thread if it is waiting, otherwise it
+        // will find the message anyway.
+        if(g_writer_sleeping)
+        {
+            pthread_mutex_lock(&g_writer_mutex);
+            pthread_cond_signal(&g_writer_cond);
+            pthread_mutex_unlock(&g_writer_mutex);
+        }
+    }
+    Atomic::decrement(&g_num_pushing);
+
+    if(!queued)
+    {
+        writeMessage(level, text);
+        delete message;
+    }
+    else if(level==LL_FATAL)
+        flushBuffers();
+#endif
+}   // printMessage
+
+// ----------------------------------------------------------------------------
+/** Writes a formatted message to the console and/or the log file. If log
+ *  messages are not redirected to a file, it tries to select a terminal
+ *  colour.
+ *  \param level Log level of the message.
+ *  \param text The message including the component.
+ */
+void Log::writeMessage(int level, const std::string &text)
+{
     // If we don't have a console file, write to stdout and hope for the best
     if(!m_file_stdout || level >= LL_WARN ||
         UserConfigParams::m_log_errors_to_console) // log to console & file
     {
-        VALIST out;
-        va_copy(out, args);
-
         setTerminalColor((LogLevel)level);
-        printf("[%s] %s: ", names[level], component);
-        vprintf(format, out);
+        printf("[%s] %s", g_level_names[level], text.c_str());
         resetTerminalColor();  // this prints a \n
+    }
 
-        va_end(out);
+    if(m_file_stdout)
+    {
+        fprintf(m_file_stdout, "[%s] %s\n", g_level_names[level],
+                text.c_str());
     }
+}   // writeMessage
 
-#if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    static char szBuff[2048];
-    vsnprintf(szBuff, sizeof(szBuff), format, copy2);
+// ----------------------------------------------------------------------------
+/** The main loop of the writer thread: writes all queued messages, then
+ *  flushes stdout and sleeps until new messages are queued.
+ */
+void *Log::writerLoop(void *data)
+{
+    LockFreeQueue<LogMessage*> *queue = (LockFreeQueue<LogMessage*>*)data;
+    long written = 0;
+    bool stop    = false;
+    while(true)
+    {
+        LogMessage *message;
+        while(queue->pop(&message))
+        {
+            writeMessage(message->m_level, message->m_text);
+            delete message;
+            written++;
+        }
+        fflush(stdout);
+        if(stop)
+            break;
 
-    OutputDebugString("[");
-    OutputDebugString(names[level]);
-    OutputDebugString("] ");
-    OutputDebugString(component);
-    OutputDebugString(": ");
-    OutputDebugString(szBuff);
-    OutputDebugString("\r\n");
-#endif
-    
+        pthread_mutex_lock(&g_writer_mutex);
+        g_num_written = written;
+        pthread_cond_broadcast(&g_written_cond);
+        // A thread that queues a message increments g_num_queued before
+        // testing g_writer_sleeping, so either the new count is seen
+        // here, or the thread signals g_writer_cond (which it can only do
+        // once the wait below has released the lock).
+        g_writer_sleeping = true;
+        Atomic::memoryBarrier();
+        while(!g_writer_stop && g_num_queued<=written)
+            pthread_cond_wait(&g_writer_cond, &g_writer_mutex);
+        g_writer_sleeping = false;
+        stop = g_writer_stop;
+        pthread_mutex_unlock(&g_writer_mutex);
+    }
 
-    if(m_file_stdout)
+    pthread_mutex_lock(&g_writer_mutex);
+    g_num_written = written;
+    pthread_cond_broadcast(&g_written_cond);
+    pthread_mutex_unlock(&g_writer_mutex);
+    return NULL;
+}   // writerLoop
+
+// ----------------------------------------------------------------------------
+/** Starts a thread that writes the log messages, so that threads that log
+ *  messages do not have to wait for the console or the log file. Messages
+ *  are still formatted by the thread that logs them. The thread is stopped
+ *  (after writing all messages) by stopWriterThread(), or at exit.
+ */
+void Log::startWriterThread()
+{
+#ifndef ANDROID
+    pthread_mutex_lock(&g_writer_mutex);
+    if(g_writer_running)
     {
-        fprintf (m_file_stdout, "[%s] %s: ", names[level], component);
-        vfprintf(m_file_stdout, format, copy);
-        fprintf (m_file_stdout, "\n");
-        va_end(copy);
+        pthread_mutex_unlock(&g_writer_mutex);
+        return;
+    }
+    if(!g_log_queue)
+        g_log_queue = new LockFreeQueue<LogMessage*>();
+    // All messages of a previous writer thread were written
+    g_num_queued  = 0;
+    g_num_written = 0;
+    g_writer_stop = false;
+    if(pthread_create(&g_writer_thread, NULL, writerLoop, g_log_queue)!=0)
+    {
+        pthread_mutex_unlock(&g_writer_mutex);
+        Log::warn("Log", "Could not start log writer thread.");
+        return;
     }
+    g_writer_running = true;
+    pthread_mutex_unlock(&g_writer_mutex);
 
+    if(!g_atexit_registered)
+    {
+        atexit(stopWriterThread);
+        g_atexit_registered = true;
+    }
 #endif
-}   // printMessage
+}   // startWriterThread
+
+// ----------------------------------------------------------------------------
+/** Writes all queued messages and stops the writer thread. Afterwards
+ *  messages are written immediately again. The queue itself is kept.
+ */
+void Log::stopWriterThread()
+{
+    pthread_mutex_lock(&g_writer_mutex);
+    if(!g_writer_running)
+    {
+        pthread_mutex_unlock(&g_writer_mutex);
+        return;
+    }
+    g_writer_running = false;
+    pthread_mutex_unlock(&g_writer_mutex);
 
+    // Threads that have seen g_writer_running still push their message,
+    // wait for them so that the writer thread can write all messages.
+    Atomic::memoryBarrier();
+    while(g_num_pushing>0)
+        StkTime::sleep(0);
+
+    pthread_mutex_lock(&g_writer_mutex);
+    g_writer_stop = true;
+    pthread_cond_signal(&g_writer_cond);
+    pthread_mutex_unlock(&g_writer_mutex);
+    pthread_join(g_writer_thread, NULL);
+}   // stopWriterThread
+
+// ----------------------------------------------------------------------------
+/** Waits until all messages queued so far are written.
+ */
+void Log::flushBuffers()
+{
+    pthread_mutex_lock(&g_writer_mutex);
+    if(g_writer_running && !pthread_equal(pthread_self(), g_writer_thread))
+    {
+        const long queued = g_num_queued;
+        while(g_writer_running && g_num_written<queued)
+            pthread_cond_wait(&g_written_cond, &g_writer_mutex);
+    }
+    pthread_mutex_unlock(&g_writer_mutex);
+}   // flushBuffers
+
+// ----------------------------------------------------------------------------
+/** Creates a rate limit.
+ *  \param max_per_second Maximum number of messages printed per second.
+ */
+Log::RateLimit::RateLimit(int max_per_second)
+{
+    m_period_start   = 0;
+    m_max_per_second = max_per_second;
+    m_count          = 0;
+    m_suppressed     = 0;
+}   // RateLimit
+
+// ----------------------------------------------------------------------------
+/** Returns true if a message can be printed now.
+ *  \param suppressed On return the number of suppressed messages that
+ *         should be reported with this message.
+ */
+bool Log::RateLimit::allow(int *suppressed)
+{
+    const uint64_t now = StkTime::getMonoTimeUs();
+    *suppressed = 0;
+    if(now - m_period_start >= 1000000)
+    {
+        m_period_start = now;
+        m_count        = 0;
+    }
+    if(m_count >= m_max_per_second)
+    {
+        m_suppressed++;
+        return false;
+    }
+    m_count++;
+    *suppressed  = m_suppressed;
+    m_suppressed = 0;
+    return true;
+}   // allow
 
 // ----------------------------------------------------------------------------
 /** This function opens the files that will contain the output.
@@ -233,6 +485,8 @@ void Log::openOutputFiles(const std::string &logout)
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
+    stopWriterThread();
     fclose(m_file_stdout);
+    m_file_stdout = NULL;
 } // closeOutputFiles
 
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string>
 
+#include "utils/types.hpp"
+
 #ifdef __GNUC__
 #  define VALIST __gnuc_va_list
 #else
@@ -61,11 +63,37 @@ private:
 
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
+    static void writeMessage(int level, const std::string &text);
+    static void *writerLoop(void *data);
 
 public:
+    /** Limits how often a message from one call site is printed, e.g. for
+     *  messages in network or physics updates:
+     *    static Log::RateLimit limit(10);
+     *    Log::verbose(limit, "Component", "Message %d", n);
+     *  At most the given number of messages is printed per second, the
+     *  number of suppressed messages is added to the next printed message.
+     *  The counts are not exact if one RateLimit is used from several
+     *  threads at the same time. */
+    class RateLimit
+    {
+    private:
+        /** Start of the current one second period. */
+        uint64_t  m_period_start;
+        /** Maximum number of messages per second. */
+        int       m_max_per_second;
+        /** Number of messages printed in the current period. */
+        int       m_count;
+        /** Number of messages suppressed since the last printed one. */
+        int       m_suppressed;
+    public:
+             RateLimit(int max_per_second);
+        bool allow(int *suppressed);
+    };   // RateLimit
 
     static void printMessage(int level, const char *component,
-                             const char *format, VALIST va_list);
+                             const char *format, VALIST va_list,
+                             int suppressed=0);
     // ------------------------------------------------------------------------
     /** A simple macro to define the various log functions. 
      *  Note that an assert is added so that a debugger is triggered
@@ -84,6 +112,23 @@ public:
             assert(false);                                           \
             exit(1);                                                 \
         }                                                            \
+    }                                                                \
+    static void NAME(RateLimit &limit, const char *component,        \
+                     const char *format, ...)                        \
+    {                                                                \
+        if(LEVEL < m_min_log_level) return;                          \
+        int suppressed;                                              \
+        if(!limit.allow(&suppressed)) return;                        \
+        va_list args;                                                \
+        va_start(args, format);                                      \
+        printMessage(LEVEL, component, format, args, suppressed);    \
+        va_end(args);                                                \
+                                                                     \
+        if (LEVEL == LL_FATAL)                                       \
+        {                                                            \
+            assert(false);                                           \
+            exit(1);                                                 \
+        }                                                            \
     }
     LOG(verbose, LL_VERBOSE);
     LOG(debug,   LL_DEBUG);
@@ -96,6 +141,12 @@ public:
 
     static void closeOutputFiles();
 
+    static void startWriterThread();
+
+    static void stopWriterThread();
+
+    static void flushBuffers();
+
     // ------------------------------------------------------------------------
     /** Defines the minimum log level to be displayed. */
     static void setLogLevel(int n)
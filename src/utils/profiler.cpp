@@ -20,8 +20,13 @@
 #include "guiengine/event_handler.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
+#include "utils/atomic.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
 #include <assert.h>
 #include <stack>
+#include <stdio.h>
+#include <string.h>
 #include <sstream>
 
 Profiler profiler;
@@ -35,142 +40,341 @@ Profiler profiler;
 
 #define TIME_DRAWN_MS 30.0f // the width of the profiler corresponds to TIME_DRAWN_MS milliseconds
 
-// --- Begin portable precise timer ---
-#ifdef WIN32
-    #include <windows.h>
-
-    static double _getTimeMilliseconds()
-    {
-        LARGE_INTEGER freq;
-        QueryPerformanceFrequency(&freq);
-        double perFreq = double(freq.QuadPart) / 1000.0;
-
-        LARGE_INTEGER timer;
-        QueryPerformanceCounter(&timer);
-        return double(timer.QuadPart) / perFreq;
-    }
-
-#else
-    #include <sys/time.h>
-    static double _getTimeMilliseconds()
-    {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        return double(tv.tv_sec * 1000) + (double(tv.tv_usec) / 1000.0);
-    }
-#endif
-// --- End portable precise timer ---
-
 //-----------------------------------------------------------------------------
 Profiler::Profiler()
 {
-    m_thread_infos.resize(1);    // TODO: monothread now, should support multithreading
+    m_num_threads = 0;
+    pthread_mutex_init(&m_threads_mutex, NULL);
+    pthread_mutex_init(&m_names_mutex, NULL);
+    pthread_key_create(&m_thread_key, &Profiler::releaseThreadInfo);
+    for(int i=0; i<MAX_NAMES; i++)
+        m_names[i].name = NULL;
     m_write_id = 0;
-    m_time_last_sync = _getTimeMilliseconds();
+    m_time_last_sync = StkTime::getMonoTimeUs();
     m_time_between_sync = 0.0;
     m_freeze_state = UNFROZEN;
+    m_collect_statistics = false;
+    m_statistics.resize(MAX_NAMES);
+    m_trace_fd = NULL;
+    m_trace_start = 0;
+    m_trace_written = 0;
+
+    // The profiler is created at static initialisation time, i.e. by the
+    // main thread.
+    registerThread("Main");
 }
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    for(int i=0; i<m_num_threads; i++)
+        delete m_thread_infos[i];
+    for(int i=0; i<MAX_NAMES; i++)
+        delete [] m_names[i].name;
+    pthread_key_delete(m_thread_key);
+    pthread_mutex_destroy(&m_threads_mutex);
+    pthread_mutex_destroy(&m_names_mutex);
 }
 
 //-----------------------------------------------------------------------------
-/// Push a new marker that starts now
-void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
+/// Called when a thread exits, so that its thread info can be reused
+void Profiler::releaseThreadInfo(void *data)
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
-        return;
+    ThreadInfo *ti = (ThreadInfo*)data;
+    Atomic::memoryBarrier();
+    ti->in_use = false;
+}
 
-    ThreadInfo& ti = getThreadInfo();
-    MarkerStack& markers_stack = ti.markers_stack[m_write_id];
-    double  start = _getTimeMilliseconds() - m_time_last_sync;
-    size_t  layer = markers_stack.size();
+//-----------------------------------------------------------------------------
+/// Returns the thread info of the calling thread, creating it if necessary
+Profiler::ThreadInfo* Profiler::getThreadInfo()
+{
+    ThreadInfo *ti = (ThreadInfo*)pthread_getspecific(m_thread_key);
+    if(ti)
+        return ti;
+    return createThreadInfo("Thread");
+}
 
-    // Add to the stack of current markers
-    markers_stack.push(Marker(start, -1.0, name, color, layer));
+//-----------------------------------------------------------------------------
+/// Assigns a thread info to the calling thread. A thread info of a thread
+/// that has exited is reused, otherwise a new one is created.
+/// Returns NULL if too many threads are used.
+Profiler::ThreadInfo* Profiler::createThreadInfo(const char *name)
+{
+    ThreadInfo *ti = NULL;
+    pthread_mutex_lock(&m_threads_mutex);
+    for(int i=0; i<m_num_threads; i++)
+    {
+        if(!m_thread_infos[i]->in_use)
+        {
+            ti = m_thread_infos[i];
+            break;
+        }
+    }
+    if(!ti && m_num_threads<MAX_THREADS)
+    {
+        ti = new ThreadInfo();
+        m_thread_infos[m_num_threads] = ti;
+        m_num_threads++;
+    }
+    if(ti)
+    {
+        // A reused info can still contain markers of its previous thread,
+        // these are discarded. The consumer holds m_threads_mutex while
+        // reading the ring, so the indices can be reset here.
+        ti->write_index = 0;
+        ti->read_index  = 0;
+        ti->dropped     = 0;
+        ti->depth       = 0;
+        ti->name        = name;
+        Atomic::memoryBarrier();
+        ti->in_use      = true;
+        pthread_setspecific(m_thread_key, ti);
+    }
+    pthread_mutex_unlock(&m_threads_mutex);
+
+    if(!ti)
+        Log::warn("Profiler", "Too many threads, '%s' is not profiled.",
+                  name);
+    return ti;
 }
 
 //-----------------------------------------------------------------------------
-/// Stop the last pushed marker
-void Profiler::popCpuMarker()
+/// Sets the name of the calling thread, which is shown in trace files.
+/// Threads that do not call this are still profiled, but named 'Thread'.
+void Profiler::registerThread(const char *name)
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
+    ThreadInfo *ti = (ThreadInfo*)pthread_getspecific(m_thread_key);
+    if(!ti)
+    {
+        createThreadInfo(name);
         return;
+    }
+    pthread_mutex_lock(&m_threads_mutex);
+    ti->name = name;
+    pthread_mutex_unlock(&m_threads_mutex);
+}
 
-    ThreadInfo&    ti = getThreadInfo();
-    assert(ti.markers_stack[m_write_id].size() > 0);
+//-----------------------------------------------------------------------------
+/// Returns the index of a marker name in the name table, adding it if
+/// necessary. The table is a hash table with linear probing to which names
+/// are only added, so looking up an existing name does not need a lock.
+/// Returns -1 if the table is full.
+int Profiler::getNameIndex(const char *name, const video::SColor &color)
+{
+    // FNV-1a hash
+    unsigned int hash = 2166136261u;
+    for(const char *c=name; *c; c++)
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
 
-    MarkerStack& markers_stack = ti.markers_stack[m_write_id];
-    MarkerList&  markers_done  = ti.markers_done[m_write_id];
+    bool locked = false;
+    for(int i=0; i<MAX_NAMES; i++)
+    {
+        int index = (hash+i) & (MAX_NAMES-1);
+        const char *entry = m_names[index].name;
+        if(!entry)
+        {
+            // Another thread might be adding a name in the same place, so
+            // check again with the lock held.
+            if(!locked)
+            {
+                pthread_mutex_lock(&m_names_mutex);
+                locked = true;
+                entry = m_names[index].name;
+            }
+            if(!entry)
+            {
+                char *copy = new char[strlen(name)+1];
+                strcpy(copy, name);
+                m_names[index].color = color;
+                // The name must only be visible once it is complete
+                Atomic::memoryBarrier();
+                m_names[index].name = copy;
+                pthread_mutex_unlock(&m_names_mutex);
+                return index;
+            }
+        }
+        if(strcmp(entry, name)==0)
+        {
+            if(locked)
+                pthread_mutex_unlock(&m_names_mutex);
+            return index;
+        }
+    }
+    if(locked)
+        pthread_mutex_unlock(&m_names_mutex);
+    return -1;
+}
 
-    // Update the date of end of the marker
-    Marker&     marker = markers_stack.top();
-    marker.end = _getTimeMilliseconds() - m_time_last_sync;
+//-----------------------------------------------------------------------------
+/// Push a new marker that starts now
+void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
+{
+    ThreadInfo *ti = getThreadInfo();
+    if(!ti)
+        return;
 
-    // Remove the marker from the stack and add it to the list of markers done
-    markers_done.push_front(marker);
-    markers_stack.pop();
+    // Deeper markers are ignored
+    if(ti->depth < MAX_DEPTH)
+    {
+        OpenMarker &marker = ti->markers_stack[ti->depth];
+        marker.name  = getNameIndex(name, color);
+        marker.start = StkTime::getMonoTimeUs();
+    }
+    ti->depth++;
 }
 
 //-----------------------------------------------------------------------------
-/// Swap buffering for the markers
-void Profiler::synchronizeFrame()
+/// Stop the last pushed marker
+void Profiler::popCpuMarker()
 {
-    // Don't do anything when frozen
-    if(m_freeze_state == FROZEN)
+    ThreadInfo *ti = getThreadInfo();
+    if(!ti)
         return;
+    assert(ti->depth > 0);
 
-    // Avoid using several times _getTimeMilliseconds(), which would yield different results
-    double now = _getTimeMilliseconds();
+    ti->depth--;
+    if(ti->depth >= MAX_DEPTH)
+        return;
 
-    // Swap buffers
-    int old_write_id = m_write_id;
-    m_write_id = !m_write_id;
+    const OpenMarker &marker = ti->markers_stack[ti->depth];
+    addRecord(ti, marker.start, StkTime::getMonoTimeUs(), marker.name,
+              ti->depth);
+}
 
-    // For each thread:
-    ThreadInfoList::iterator it_end = m_thread_infos.end();
-    for(ThreadInfoList::iterator it = m_thread_infos.begin() ; it != it_end ; it++)
+//-----------------------------------------------------------------------------
+/// Adds a finished marker to the ring buffer of a thread. Must only be
+/// called by the thread owning the ring buffer.
+void Profiler::addRecord(ThreadInfo *ti, uint64_t start, uint64_t end,
+                         int name, int layer)
+{
+    if(name<0)
+        return;
+    unsigned long write_index = ti->write_index;
+    if(write_index - ti->read_index >= (unsigned long)RING_SIZE)
     {
-        // Get the thread information
-        ThreadInfo& ti = *it;
+        // The consumer is too slow, drop the marker
+        ti->dropped++;
+        return;
+    }
+    MarkerRecord &record = ti->ring[write_index & (RING_SIZE-1)];
+    record.start = start;
+    record.end   = end;
+    record.name  = (uint16_t)name;
+    record.layer = (uint16_t)layer;
+    // The record must be complete before the consumer can see it
+    Atomic::memoryBarrier();
+    ti->write_index = write_index+1;
+}
 
-        MarkerList&  old_markers_done  = ti.markers_done[old_write_id];
-        MarkerStack& old_markers_stack = ti.markers_stack[old_write_id];
+//-----------------------------------------------------------------------------
+/// Empties the ring buffers of all threads, and adds the markers to the
+/// statistics, the trace and (if display is true) the markers of the current
+/// frame.
+void Profiler::collectMarkers(bool display)
+{
+    pthread_mutex_lock(&m_threads_mutex);
+    long num_threads = m_num_threads;
+    for(long i=0; i<num_threads; i++)
+    {
+        ThreadInfo *ti = m_thread_infos[i];
+        unsigned long write_index = ti->write_index;
+        // Read the records only after reading the write index
+        Atomic::memoryBarrier();
 
-        MarkerList&  new_markers_done  = ti.markers_done[m_write_id];
-        MarkerStack& new_markers_stack = ti.markers_stack[m_write_id];
+        MarkerList &markers_done = ti->markers_done[m_write_id];
+        for(unsigned long r=ti->read_index; r!=write_index; r++)
+        {
+            const MarkerRecord &record = ti->ring[r & (RING_SIZE-1)];
+            if(m_collect_statistics)
+            {
+                MarkerStatistics &stats = m_statistics[record.name];
+                double duration = (record.end - record.start)*0.001;
+                stats.total += duration;
+                stats.count++;
+                if(duration > stats.max)
+                    stats.max = duration;
+            }
+            if(!m_trace_file.empty())
+            {
+                TraceEvent event;
+                event.start  = record.start;
+                event.end    = record.end;
+                event.name   = record.name;
+                event.thread = (uint16_t)i;
+                m_trace.push_back(event);
+            }
+            if(display)
+            {
+                // Markers of other threads can have started before the
+                // last synchronisation.
+                double start = ((double)record.start
+                               -(double)m_time_last_sync)*0.001;
+                double end   = ((double)record.end
+                               -(double)m_time_last_sync)*0.001;
+                markers_done.push_back(Marker(start, end, record.name,
+                                              record.layer));
+            }
+        }
+        // Only release the slots after the records have been read
+        Atomic::memoryBarrier();
+        ti->read_index = write_index;
+    }   // for i < num_threads
+    pthread_mutex_unlock(&m_threads_mutex);
+
+    if(m_trace.size()>=TRACE_FLUSH_SIZE)
+        flushTrace();
+}
 
-        // Clear the containers for the new frame
-        new_markers_done.clear();
-        while(!new_markers_stack.empty())
-            new_markers_stack.pop();
+//-----------------------------------------------------------------------------
+/// Returns the accumulated time of each marker name
+Profiler::StatisticsMap Profiler::getStatistics()
+{
+    collectMarkers(false);
+    StatisticsMap result;
+    for(int i=0; i<MAX_NAMES; i++)
+    {
+        if(m_statistics[i].count>0)
+            result[m_names[i].name] = m_statistics[i];
+    }
+    return result;
+}
 
-        // Finish the markers in the stack of the previous frame
-        // and start them for the next frame.
+//-----------------------------------------------------------------------------
+/// Swap buffering for the markers
+void Profiler::synchronizeFrame()
+{
+    // Avoid using several times getMonoTimeUs(), which would yield different results
+    uint64_t now = StkTime::getMonoTimeUs();
 
-        // For each marker in the old stack:
-        while(!old_markers_stack.empty())
+    // Finish the markers still open in this thread for the current frame,
+    // and restart them for the next frame.
+    ThreadInfo *ti = getThreadInfo();
+    if(ti)
+    {
+        int depth = ti->depth < MAX_DEPTH ? ti->depth : MAX_DEPTH;
+        for(int i=depth-1; i>=0; i--)
         {
-            // - finish the marker for the previous frame and add it to the old "done" list
-            Marker& m = old_markers_stack.top();
-            m.end = now - m_time_last_sync;
-            old_markers_done.push_front(m);
-
-            // - start a new one for the new frame
-            Marker new_marker(0.0, -1.0, m.name.c_str(), m.color);
-            new_markers_stack.push(new_marker);
-
-            // - next iteration
-            old_markers_stack.pop();
+            OpenMarker &marker = ti->markers_stack[i];
+            addRecord(ti, marker.start, now, marker.name, i);
+            marker.start = now;
         }
     }
 
+    // Don't change the displayed frame when frozen
+    const bool frozen = m_freeze_state == FROZEN;
+    collectMarkers(!frozen);
+    if(frozen)
+        return;
+
+    // Swap buffers, and clear the containers for the new frame
+    m_write_id = !m_write_id;
+    long num_threads = m_num_threads;
+    for(long i=0; i<num_threads; i++)
+        m_thread_infos[i]->markers_done[m_write_id].clear();
+
     // Remember the date of last synchronization
-    m_time_between_sync = now - m_time_last_sync;
+    m_time_between_sync = (now - m_time_last_sync)*0.001;
     m_time_last_sync = now;
 
     // Freeze/unfreeze as needed
@@ -180,6 +384,97 @@ void Profiler::synchronizeFrame()
         m_freeze_state = UNFROZEN;
 }
 
+//-----------------------------------------------------------------------------
+/// Starts recording all markers for a trace file. The markers are appended
+/// to the file whenever enough of them are collected, and the file is
+/// completed by writeTrace().
+void Profiler::setTraceFile(const std::string &name)
+{
+    m_trace_file  = name;
+    m_trace_start = StkTime::getMonoTimeUs();
+}
+
+//-----------------------------------------------------------------------------
+/// Appends the recorded markers to the trace file (in the Chrome trace event
+/// format), opening it first if necessary.
+void Profiler::flushTrace()
+{
+    if(!m_trace_fd)
+    {
+        m_trace_fd = fopen(m_trace_file.c_str(), "w");
+        if(!m_trace_fd)
+        {
+            Log::error("Profiler", "Can't open '%s' for writing.",
+                       m_trace_file.c_str());
+            // Stop recording
+            m_trace_file = "";
+            m_trace.clear();
+            return;
+        }
+        fprintf(m_trace_fd,
+                "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    }
+
+    for(unsigned int i=0; i<m_trace.size(); i++)
+    {
+        const TraceEvent &event = m_trace[i];
+        // Skip markers that ended before the trace was started
+        if(event.end<m_trace_start)
+            continue;
+        std::string name = m_names[event.name].name;
+        std::string escaped;
+        for(unsigned int j=0; j<name.size(); j++)
+        {
+            if(name[j]=='"' || name[j]=='\\') escaped += '\\';
+            escaped += name[j];
+        }
+        uint64_t start = event.start>m_trace_start ? event.start
+                                                   : m_trace_start;
+        fprintf(m_trace_fd, "%s{\"name\": \"%s\", \"cat\": \"cpu\", "
+                "\"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %lu, "
+                "\"dur\": %lu}", m_trace_written>0 ? ",\n" : "",
+                escaped.c_str(), event.thread,
+                (unsigned long)(start-m_trace_start),
+                (unsigned long)(event.end-start));
+        m_trace_written++;
+    }
+    m_trace.clear();
+}
+
+//-----------------------------------------------------------------------------
+/// Writes the remaining markers and the thread names, and closes the trace
+/// file. Does nothing if no trace file was set.
+void Profiler::writeTrace()
+{
+    if(m_trace_file.empty())
+        return;
+    collectMarkers(false);
+    flushTrace();
+    if(!m_trace_fd)
+        return;
+
+    pthread_mutex_lock(&m_threads_mutex);
+    for(long i=0; i<m_num_threads; i++)
+    {
+        fprintf(m_trace_fd, "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                "\"pid\": 1, \"tid\": %ld, \"args\": {\"name\": \"%s\"}}",
+                m_trace_written>0 || i>0 ? ",\n" : "", i,
+                m_thread_infos[i]->name.c_str());
+        if(m_thread_infos[i]->dropped>0)
+            Log::warn("Profiler", "%lu markers of thread '%s' were lost.",
+                      m_thread_infos[i]->dropped,
+                      m_thread_infos[i]->name.c_str());
+    }
+    pthread_mutex_unlock(&m_threads_mutex);
+
+    fprintf(m_trace_fd, "\n]}\n");
+    fclose(m_trace_fd);
+    m_trace_fd = NULL;
+    Log::info("Profiler", "Wrote %u markers to '%s'.", m_trace_written,
+              m_trace_file.c_str());
+    m_trace_file = "";
+}
+
 //-----------------------------------------------------------------------------
 /// Draw the markers
 void Profiler::draw()
@@ -201,7 +496,7 @@ void Profiler::draw()
     const double y_offset    = (MARGIN_Y + LINE_HEIGHT)*screen_size.Height;
     const double line_height = LINE_HEIGHT*screen_size.Height;
 
-    size_t nb_thread_infos = m_thread_infos.size();
+    size_t nb_thread_infos = m_num_threads;
 
     const double factor = profiler_width / TIME_DRAWN_MS;
 
@@ -212,7 +507,7 @@ void Profiler::draw()
     for(size_t i=0 ; i < nb_thread_infos ; i++)
     {
         // Draw all markers
-        MarkerList& markers = m_thread_infos[i].markers_done[read_id];
+        MarkerList& markers = m_thread_infos[i]->markers_done[read_id];
 
         if(markers.empty())
             continue;
@@ -221,8 +516,8 @@ void Profiler::draw()
         for(MarkerList::const_iterator it = markers.begin() ; it != it_end ; it++)
         {
             const Marker&    m = *it;
-            assert(m.end >= 0.0);
-            core::rect<s32>    pos((s32)( x_offset + factor*m.start ),
+            double start = m.start > 0.0 ? m.start : 0.0;
+            core::rect<s32>    pos((s32)( x_offset + factor*start ),
                                    (s32)( y_offset + i*line_height ),
                                    (s32)( x_offset + factor*m.end ),
                                    (s32)( y_offset + (i+1)*line_height ));
@@ -231,7 +526,7 @@ void Profiler::draw()
             pos.UpperLeftCorner.Y  += m.layer;
             pos.LowerRightCorner.Y -= m.layer;
 
-            driver->draw2DRectangle(m.color, pos);
+            driver->draw2DRectangle(m_names[m.name].color, pos);
 
             // If the mouse cursor is over the marker, get its information
             if(pos.isPointInside(mouse_pos))
@@ -259,7 +554,7 @@ void Profiler::draw()
         {
             Marker& m = hovered_markers.top();
             std::ostringstream oss;
-            oss << m.name << " [" << (m.end-m.start) << " ms]" << std::endl;
+            oss << m_names[m.name].name << " [" << (m.end-m.start) << " ms]" << std::endl;
             text += oss.str().c_str();
             hovered_markers.pop();
         }
@@ -271,13 +566,7 @@ void Profiler::draw()
 /// Handle freeze/unfreeze
 void Profiler::onClick(const core::vector2di& mouse_pos)
 {
-    video::IVideoDriver*            driver = irr_driver->getVideoDriver();
-    const core::dimension2d<u32>&   screen_size = driver->getScreenSize();
-
-    core::rect<s32>background_rect((int)(MARGIN_X                      * screen_size.Width),
-                                   (int)(MARGIN_Y                      * screen_size.Height),
-                                   (int)((1.0-MARGIN_X)                * screen_size.Width),
-                                   (int)((MARGIN_Y + 3.0f*LINE_HEIGHT) * screen_size.Height));
+    core::rect<s32> background_rect = getBackgroundRect();
 
     if(!background_rect.isPointInside(mouse_pos))
         return;
@@ -306,13 +595,20 @@ void Profiler::onClick(const core::vector2di& mouse_pos)
 void Profiler::drawBackground()
 {
     video::IVideoDriver*            driver = irr_driver->getVideoDriver();
-    const core::dimension2d<u32>&   screen_size = driver->getScreenSize();
+    video::SColor   color(0xFF, 0xFF, 0xFF, 0xFF);
+    driver->draw2DRectangle(color, getBackgroundRect());
+}
 
-    core::rect<s32>background_rect((int)(MARGIN_X                      * screen_size.Width),
-                                   (int)(MARGIN_Y                      * screen_size.Height),
-                                   (int)((1.0-MARGIN_X)                * screen_size.Width),
-                                   (int)((MARGIN_Y + 3.0f*LINE_HEIGHT) * screen_size.Height));
+//-----------------------------------------------------------------------------
+/// Returns the area covered by the profiler, with one line for each thread
+core::rect<s32> Profiler::getBackgroundRect()
+{
+    video::IVideoDriver*            driver = irr_driver->getVideoDriver();
+    const core::dimension2d<u32>&   screen_size = driver->getScreenSize();
+    const float lines = 2.0f + m_num_threads;
 
-    video::SColor   color(0xFF, 0xFF, 0xFF, 0xFF);
-    driver->draw2DRectangle(color, background_rect);
+    return core::rect<s32>((int)(MARGIN_X                       * screen_size.Width),
+                           (int)(MARGIN_Y                       * screen_size.Height),
+                           (int)((1.0-MARGIN_X)                 * screen_size.Width),
+                           (int)((MARGIN_Y + lines*LINE_HEIGHT) * screen_size.Height));
 }
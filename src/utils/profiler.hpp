@@ -18,11 +18,14 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
+#include "utils/types.hpp"
+
 #include <irrlicht.h>
-#include <list>
-#include <vector>
-#include <stack>
+#include <map>
+#include <pthread.h>
+#include <stdio.h>
 #include <string>
+#include <vector>
 
 class Profiler;
 extern Profiler profiler;
@@ -41,56 +44,150 @@ extern Profiler profiler;
 
     #define PROFILER_DRAW() \
         profiler.draw()
+
+    #define PROFILER_REGISTER_THREAD(name) \
+        profiler.registerThread(name)
 #else
     #define PROFILER_PUSH_CPU_MARKER(name, r, g, b)
     #define PROFILER_POP_CPU_MARKER()
     #define PROFILER_SYNC_FRAME()
     #define PROFILER_DRAW()
+    #define PROFILER_REGISTER_THREAD(name)
 #endif
 
 using namespace irr;
 
 /**
   * \brief class that allows run-time graphical profiling through the use of markers
+  * Markers can be pushed and popped from any thread. Each thread writes its
+  * finished markers as small fixed-size records into its own ring buffer,
+  * which is emptied by the thread calling synchronizeFrame() (the main
+  * thread), so no lock is taken and nothing is allocated when a marker is
+  * pushed or popped. Marker names are interned into a table, and only
+  * their index is stored in a record.
+  * Besides drawing the last frame on screen, the profiler can accumulate
+  * statistics for each marker name, and record all markers to be written
+  * as a Chrome trace event file (which can be loaded in chrome://tracing
+  * or Perfetto), e.g. to profile a server without graphics.
   * \ingroup utils
   */
 class Profiler
 {
+public:
+    /** Accumulated time of all markers with the same name. */
+    struct MarkerStatistics
+    {
+        double        total;  // Total time in milliseconds
+        double        max;    // Longest single marker in milliseconds
+        unsigned int  count;  // Number of markers
+
+        MarkerStatistics() : total(0.0), max(0.0), count(0) {}
+    };
+    typedef std::map<std::string, MarkerStatistics> StatisticsMap;
+
 private:
+    /** Maximum number of threads that can be profiled at the same time. */
+    static const int MAX_THREADS = 32;
+
+    /** Maximum number of different marker names, must be a power of 2. */
+    static const int MAX_NAMES   = 1024;
+
+    /** Number of finished markers each thread can buffer between two
+     *  synchronizations, must be a power of 2. */
+    static const int RING_SIZE   = 4096;
+
+    /** Maximum nesting depth of markers. */
+    static const int MAX_DEPTH   = 32;
+
+    /** Number of trace events kept in memory before they are appended to
+     *  the trace file. */
+    static const unsigned int TRACE_FLUSH_SIZE = 16384;
+
+    /** A finished marker, as stored in the ring buffer of a thread. */
+    struct MarkerRecord
+    {
+        uint64_t  start;   // Start and end time in microseconds
+        uint64_t  end;
+        uint16_t  name;    // Index in m_names
+        uint16_t  layer;
+    };
+
+    /** A marker as drawn on screen. */
     struct Marker
     {
         double  start;  // Times of start and end, in milliseconds,
         double  end;    // relatively to the time of last synchronization
+        int     name;
         size_t  layer;
 
-        std::string     name;
-        video::SColor   color;
-
-        Marker(double start, double end, const char* name="N/A", const video::SColor& color=video::SColor(), size_t layer=0)
-            : start(start), end(end), layer(layer), name(name), color(color)
-        {
-        }
-
-        Marker(const Marker& ref)
-            : start(ref.start), end(ref.end), layer(ref.layer), name(ref.name), color(ref.color)
+        Marker(double start, double end, int name, size_t layer)
+            : start(start), end(end), name(name), layer(layer)
         {
         }
     };
 
-    typedef    std::list<Marker>   MarkerList;
-    typedef    std::stack<Marker>  MarkerStack;
+    typedef    std::vector<Marker>   MarkerList;
+
+    /** A marker that has been pushed but not popped yet. */
+    struct OpenMarker
+    {
+        uint64_t  start;
+        int       name;
+    };
 
     struct ThreadInfo
     {
-        MarkerList   markers_done[2];
-        MarkerStack  markers_stack[2];
+        // Only accessed by the thread itself:
+        OpenMarker     markers_stack[MAX_DEPTH];
+        int            depth;
+
+        // Single producer, single consumer ring buffer of finished markers
+        MarkerRecord   ring[RING_SIZE];
+        volatile unsigned long write_index;
+        volatile unsigned long read_index;
+
+        /** Number of markers that were lost because the ring was full. */
+        volatile unsigned long dropped;
+
+        /** True while a thread is using this info. */
+        volatile bool  in_use;
+
+        std::string    name;
+
+        // Only accessed by the consumer:
+        MarkerList     markers_done[2];
+    };
+
+    /** An entry in the table of interned marker names. */
+    struct NameEntry
+    {
+        char * volatile name;
+        video::SColor   color;
+    };
+
+    /** A marker recorded for the trace file. */
+    struct TraceEvent
+    {
+        uint64_t  start;
+        uint64_t  end;
+        uint16_t  name;
+        uint16_t  thread;
     };
 
-    typedef    std::vector<ThreadInfo>  ThreadInfoList;
+    /** All thread infos, only the first m_num_threads are used. */
+    ThreadInfo*     m_thread_infos[MAX_THREADS];
+    volatile long   m_num_threads;
+    pthread_mutex_t m_threads_mutex;
+
+    /** Key used to find the thread info of the current thread. */
+    pthread_key_t   m_thread_key;
+
+    /** Hash table of the interned names. */
+    NameEntry       m_names[MAX_NAMES];
+    pthread_mutex_t m_names_mutex;
 
-    ThreadInfoList  m_thread_infos;
     int             m_write_id;
-    double          m_time_last_sync;
+    uint64_t        m_time_last_sync;
     double          m_time_between_sync;
 
     // Handling freeze/unfreeze by clicking on the display
@@ -104,10 +201,41 @@ private:
 
     FreezeState     m_freeze_state;
 
+    /** True if the time of all markers should be accumulated. */
+    bool            m_collect_statistics;
+
+    /** The accumulated times for each marker name index. */
+    std::vector<MarkerStatistics> m_statistics;
+
+    /** If not empty, all markers are recorded and written to this file. */
+    std::string     m_trace_file;
+
+    /** The trace file, opened when the first markers are written. */
+    FILE           *m_trace_fd;
+
+    /** Time setTraceFile was called, all trace times are relative to it. */
+    uint64_t        m_trace_start;
+
+    /** Number of markers written to the trace file. */
+    unsigned int    m_trace_written;
+
+    /** Markers recorded for the trace file but not written yet. */
+    std::vector<TraceEvent> m_trace;
+
+    ThreadInfo* getThreadInfo();
+    ThreadInfo* createThreadInfo(const char *name);
+    int         getNameIndex(const char *name, const video::SColor &color);
+    void        addRecord(ThreadInfo *ti, uint64_t start, uint64_t end,
+                          int name, int layer);
+    void        collectMarkers(bool display);
+    void        flushTrace();
+    static void releaseThreadInfo(void *data);
+
 public:
     Profiler();
     virtual ~Profiler();
 
+    void    registerThread(const char *name);
     void    pushCpuMarker(const char* name="N/A", const video::SColor& color=video::SColor());
     void    popCpuMarker();
     void    synchronizeFrame();
@@ -116,10 +244,17 @@ public:
 
     void    onClick(const core::vector2di& mouse_pos);
 
+    /** Starts accumulating the time of all markers, e.g. for the
+     *  statistics written by ProfileWorld. */
+    void    enableStatistics() { m_collect_statistics = true; }
+    StatisticsMap getStatistics();
+
+    void    setTraceFile(const std::string &name);
+    void    writeTrace();
+
 protected:
-    // TODO: detect on which thread this is called to support multithreading
-    ThreadInfo& getThreadInfo() { return m_thread_infos[0]; }
     void        drawBackground();
+    core::rect<s32> getBackgroundRect();
 };
 
 #endif // PROFILER_HPP
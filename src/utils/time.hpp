@@ -28,9 +28,12 @@
 #else
 #  include <stdint.h>
 #  include <sys/time.h>
+#  include <time.h>
 #  include <unistd.h>
 #endif
 
+#include "utils/types.hpp"
+
 #include <string>
 #include <stdio.h>
 
@@ -88,6 +91,26 @@ public:
      */
     static double getRealTime(long startAt=0);
 
+    // ------------------------------------------------------------------------
+    /** Returns a monotonic time in microseconds, based on an arbitrary
+     *  epoch. Unlike getRealTime() this does not need the irrlicht device,
+     *  so it can be used from any thread (e.g. to measure network latency).
+     */
+    static uint64_t getMonoTimeUs()
+    {
+#ifdef WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (uint64_t)(counter.QuadPart / (double)frequency.QuadPart
+                          * 1000000.0);
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+#endif
+    }   // getMonoTimeUs
+
     // ------------------------------------------------------------------------
     /**
      * \brief Compare two different times.
@@ -0,0 +1,203 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+#include "config/user_config.hpp"
+#include "utils/atomic.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+WorkerPool *WorkerPool::m_worker_pool = NULL;
+
+// ----------------------------------------------------------------------------
+/** Creates the worker pool. The number of threads is taken from the
+ *  worker_threads user config parameter, by default one thread less than
+ *  the number of cores is used (since the main thread runs jobs, too).
+ */
+void WorkerPool::create()
+{
+    assert(!m_worker_pool);
+    int num_threads = UserConfigParams::m_worker_threads;
+    if(num_threads<0)
+    {
+#ifdef WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int cores = info.dwNumberOfProcessors;
+#else
+        int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        num_threads = cores>1 ? cores-1 : 0;
+    }
+    // More threads would only add overhead for the small jobs used.
+    if(num_threads>16) num_threads = 16;
+    m_worker_pool = new WorkerPool(num_threads);
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Stops all worker threads and destroys the pool. */
+void WorkerPool::destroy()
+{
+    delete m_worker_pool;
+    m_worker_pool = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_threads Number of threads to start.
+ */
+WorkerPool::WorkerPool(int num_threads)
+{
+    m_generation    = 0;
+    m_function      = NULL;
+    m_data          = NULL;
+    m_count         = 0;
+    m_next_job      = 0;
+    m_finished_jobs  = 0;
+    m_active_workers = 0;
+    m_abort          = false;
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_start_cond, NULL);
+    pthread_cond_init(&m_done_cond, NULL);
+
+    for(int i=0; i<num_threads; i++)
+    {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, &WorkerPool::mainLoop, this)!=0)
+        {
+            Log::warn("WorkerPool", "Could not create worker thread.");
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+    Log::info("WorkerPool", "Using %d worker threads.", (int)m_threads.size());
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+    for(unsigned int i=0; i<m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+    pthread_cond_destroy(&m_done_cond);
+    pthread_cond_destroy(&m_start_cond);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+/** The main loop of each worker thread: waits for a new set of jobs, and
+ *  then runs jobs until none are left.
+ *  \param obj Pointer to the worker pool.
+ */
+void *WorkerPool::mainLoop(void *obj)
+{
+    WorkerPool *pool = (WorkerPool*)obj;
+    PROFILER_REGISTER_THREAD("Worker");
+    long generation = 0;
+    pthread_mutex_lock(&pool->m_mutex);
+    while(true)
+    {
+        while(!pool->m_abort && pool->m_generation==generation)
+            pthread_cond_wait(&pool->m_start_cond, &pool->m_mutex);
+        if(pool->m_abort)
+            break;
+        generation = pool->m_generation;
+        pool->m_active_workers++;
+        pthread_mutex_unlock(&pool->m_mutex);
+        PROFILER_PUSH_CPU_MARKER("Worker jobs", 0x7F, 0x7F, 0x7F);
+        pool->runJobs();
+        PROFILER_POP_CPU_MARKER();
+        pthread_mutex_lock(&pool->m_mutex);
+        pool->m_active_workers--;
+        if(pool->m_active_workers==0)
+            pthread_cond_broadcast(&pool->m_done_cond);
+    }
+    pthread_mutex_unlock(&pool->m_mutex);
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Runs jobs of the current set until none are left. */
+void WorkerPool::runJobs()
+{
+    while(true)
+    {
+        long index = Atomic::increment(&m_next_job)-1;
+        if(index>=m_count)
+            return;
+        m_function((int)index, m_data);
+        if(Atomic::increment(&m_finished_jobs)==m_count)
+        {
+            pthread_mutex_lock(&m_mutex);
+            pthread_cond_broadcast(&m_done_cond);
+            pthread_mutex_unlock(&m_mutex);
+        }
+    }
+}   // runJobs
+
+// ----------------------------------------------------------------------------
+/** Calls f(i, data) for all i from 0 to count-1, distributed over the
+ *  worker threads and the calling thread. Returns when all calls are done.
+ *  The order in which jobs are run is undefined, so each job must only
+ *  write its own results.
+ *  \param count Number of jobs.
+ *  \param f The function to call.
+ *  \param data Pointer passed to each call.
+ */
+void WorkerPool::parallelFor(int count, JobFunction f, void *data)
+{
+    if(m_threads.empty() || count<2)
+    {
+        for(int i=0; i<count; i++)
+            f(i, data);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    // A worker that is still leaving runJobs from the previous call might
+    // already have claimed an index beyond the old count. Wait till all
+    // workers are done with the old set, otherwise that index could be
+    // checked against the new count and a job would be run twice.
+    while(m_active_workers>0)
+        pthread_cond_wait(&m_done_cond, &m_mutex);
+    m_function      = f;
+    m_data          = data;
+    m_count         = count;
+    m_finished_jobs = 0;
+    m_next_job      = 0;
+    m_generation++;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    runJobs();
+
+    pthread_mutex_lock(&m_mutex);
+    while(m_finished_jobs<m_count)
+        pthread_cond_wait(&m_done_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+}   // parallelFor
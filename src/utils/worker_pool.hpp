@@ -0,0 +1,101 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+/** A small pool of worker threads to run independent jobs in parallel,
+ *  e.g. one job per kart. The caller of parallelFor runs jobs as well, and
+ *  only returns once all jobs are done, so the results can be used
+ *  (committed) serially afterwards. Jobs must not modify any shared state.
+ *  The pool uses the 'simplified singleton' pattern: create() and
+ *  destroy() are called from main, get() returns NULL if no pool exists,
+ *  in which case parallelFor must not be used.
+ *  \ingroup utils
+ */
+class WorkerPool : public NoCopy
+{
+public:
+    /** The function type of a job: index is the job index (0 to count-1),
+     *  data is the pointer passed to parallelFor. */
+    typedef void (*JobFunction)(int index, void *data);
+
+private:
+    static WorkerPool *m_worker_pool;
+
+    /** The worker threads. */
+    std::vector<pthread_t> m_threads;
+
+    /** Protects the job data below, and is used with the conditions. */
+    pthread_mutex_t        m_mutex;
+
+    /** Signals the workers that a new set of jobs is available. */
+    pthread_cond_t         m_start_cond;
+
+    /** Signals the caller of parallelFor that all jobs are done. */
+    pthread_cond_t         m_done_cond;
+
+    /** Incremented for each call of parallelFor, so that workers can
+     *  detect new jobs. */
+    long                   m_generation;
+
+    /** The current job function and its data. */
+    JobFunction            m_function;
+    void                  *m_data;
+
+    /** Number of jobs in the current set. */
+    long                   m_count;
+
+    /** Index of the next job to run (atomically incremented). */
+    volatile long          m_next_job;
+
+    /** Number of jobs finished (atomically incremented). */
+    volatile long          m_finished_jobs;
+
+    /** Number of workers that have picked up a set of jobs and not yet
+     *  left runJobs. A new set is only published once this is 0, so a
+     *  worker can never claim an index of the old set against the count
+     *  of the new set. */
+    int                    m_active_workers;
+
+    /** Set when the pool is destroyed. */
+    bool                   m_abort;
+
+    static void *mainLoop(void *obj);
+    void         runJobs();
+
+         WorkerPool(int num_threads);
+        ~WorkerPool();
+public:
+    static void create();
+    static void destroy();
+    void        parallelFor(int count, JobFunction f, void *data);
+    // ------------------------------------------------------------------------
+    /** Returns the worker pool, or NULL if it was not created. */
+    static WorkerPool *get() { return m_worker_pool; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of worker threads (not counting the caller). */
+    unsigned int getNumThreads() const { return m_threads.size(); }
+};   // WorkerPool
+
+#endif
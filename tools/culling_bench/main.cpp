@@ -0,0 +1,402 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/** Benchmark for the batched frustum culling and level of detail selection
+ *  of LOD nodes. It either replays a scene file written by the game with
+ *  --culling-scene=FILE, or creates a track-like scene (objects along and
+ *  around an oval, with a camera driving along the oval). For each frustum
+ *  it compares the old per-node path of the scene manager and LODNode with
+ *  FrustumCuller. The reference is the default culling of the track objects
+ *  (EAC_BOX: compute the distance, loop over the levels, transform the
+ *  bounding box and test it against the bounding box of the frustum),
+ *  which LODNode now turns off for the nodes the culler has tested.
+ *  EAC_FRUSTUM_BOX (transform the frustum into the space of the node and
+ *  test the 8 corners of the box) is only used for karts and items, and
+ *  is shown for comparison. It prints the time per frustum and the number
+ *  of objects each test keeps, and checks that FrustumCuller does not cull
+ *  any object the exact per-node test keeps and that it selects the same
+ *  levels.
+ *
+ *  Usage: culling_bench [num_objects | scene_file] [frames]
+ */
+
+#include "graphics/frustum_culler.hpp"
+
+#include <matrix4.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+using namespace irr;
+
+/** An object as the scene manager sees it: a local bounding box and a
+ *  transformation, allocated separately like the scene nodes. */
+struct Object
+{
+    core::matrix4    m_transform;
+    core::aabbox3df  m_box;
+    std::vector<int> m_lod_distance2;
+    /** True if the object moves each frame, like a kart. */
+    bool             m_moving;
+    /** The transformation when the object was last passed to the culler,
+     *  LODNode only updates the culler data of objects that moved. */
+    core::matrix4    m_cull_transform;
+    bool             m_cull_dirty;
+};   // Object
+
+/** A camera position and its frustum. */
+struct Frustum
+{
+    scene::SViewFrustum m_frustum;
+    core::vector3df     m_position;
+    bool                m_orthogonal;
+};   // Frustum
+
+// ----------------------------------------------------------------------------
+/** Reads a scene file written by FrustumCuller. Returns false on error. */
+static bool readScene(const char *filename, std::vector<Object*> *objects,
+                      std::vector<Frustum> *frustums)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file) return false;
+
+    unsigned int n;
+    if (fscanf(file, "objects %u", &n) != 1)
+    {
+        fclose(file);
+        return false;
+    }
+    for (unsigned int i = 0; i < n; i++)
+    {
+        float v[9], d[FrustumCuller::MAX_LOD_LEVELS];
+        int num_levels;
+        if (fscanf(file, "%f %f %f %f %f %f %f %f %f %d", &v[0], &v[1], &v[2],
+                   &v[3], &v[4], &v[5], &v[6], &v[7], &v[8],
+                   &num_levels) != 10)
+            break;
+        for (unsigned int k = 0; k < FrustumCuller::MAX_LOD_LEVELS; k++)
+        {
+            if (fscanf(file, "%f", &d[k]) != 1) d[k] = -1.0f;
+        }
+        Object *object = new Object();
+        // The boxes are already in world space, stored as centre and
+        // half extent
+        const core::vector3df center(v[0], v[1], v[2]);
+        const core::vector3df extent(v[3], v[4], v[5]);
+        object->m_box = core::aabbox3df(center - extent, center + extent);
+        object->m_transform.makeIdentity();
+        object->m_moving     = false;
+        object->m_cull_dirty = true;
+        for (int k = 0; k < num_levels; k++)
+        {
+            object->m_lod_distance2.push_back(
+                k < (int)FrustumCuller::MAX_LOD_LEVELS ? (int)d[k] : 0);
+        }
+        objects->push_back(object);
+    }
+
+    Frustum f;
+    int orthogonal;
+    while (fscanf(file, " frustum %f %f %f %d", &f.m_position.X,
+                  &f.m_position.Y, &f.m_position.Z, &orthogonal) == 4)
+    {
+        f.m_orthogonal = orthogonal != 0;
+        for (unsigned int p = 0; p < scene::SViewFrustum::VF_PLANE_COUNT; p++)
+        {
+            core::plane3df &plane = f.m_frustum.planes[p];
+            if (fscanf(file, "%f %f %f %f", &plane.Normal.X, &plane.Normal.Y,
+                       &plane.Normal.Z, &plane.D) != 4)
+                break;
+        }
+        f.m_frustum.cameraPosition = f.m_position;
+        f.m_frustum.recalculateBoundingBox();
+        frustums->push_back(f);
+    }
+    fclose(file);
+    return objects->size() == n && frustums->size() > 0;
+}   // readScene
+
+// ----------------------------------------------------------------------------
+/** Creates objects along and around an oval of 300x150 m, like the track
+ *  objects, items and karts of a race, and a camera driving along it.
+ *  Every 50th object moves each frame. */
+static void createScene(unsigned int num_objects, int frames,
+                        std::vector<Object*> *objects,
+                        std::vector<Frustum> *frustums)
+{
+    srand(1);
+    for (unsigned int i = 0; i < num_objects; i++)
+    {
+        const float angle  = (rand() % 3600) * 0.1f * core::DEGTORAD;
+        const float offset = (rand() % 600) * 0.1f - 30.0f;
+        const float size   = 0.5f + (rand() % 100) * 0.05f;
+        Object *object = new Object();
+        object->m_transform.setTranslation(
+            core::vector3df((150.0f + offset) * cosf(angle),
+                            (rand() % 50) * 0.1f,
+                            (75.0f + offset) * sinf(angle)));
+        object->m_transform.setRotationDegrees(
+            core::vector3df(0, (float)(rand() % 360), 0));
+        object->m_box = core::aabbox3df(-size, 0, -size, size, 2*size, size);
+        object->m_moving     = i % 50 == 0;
+        object->m_cull_dirty = true;
+        // Between one and three levels, as in the track files
+        const int num_levels = 1 + rand() % 3;
+        for (int k = 0; k < num_levels; k++)
+        {
+            const int distance = 40 + 60*k + rand() % 40;
+            object->m_lod_distance2.push_back(distance*distance);
+        }
+        objects->push_back(object);
+    }
+
+    core::matrix4 projection;
+    projection.buildProjectionMatrixPerspectiveFovLH(core::PI / 2.5f,
+                                                     16.0f / 9.0f,
+                                                     1.0f, 1000.0f);
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const float angle = frame * 0.005f;
+        Frustum f;
+        f.m_position = core::vector3df(150.0f * cosf(angle), 2.0f,
+                                       75.0f * sinf(angle));
+        const core::vector3df dir(-150.0f * sinf(angle), 0,
+                                  75.0f * cosf(angle));
+        core::matrix4 view;
+        view.buildCameraLookAtMatrixLH(f.m_position, f.m_position + dir,
+                                       core::vector3df(0, 1, 0));
+        f.m_orthogonal = false;
+        f.m_frustum.cameraPosition = f.m_position;
+        f.m_frustum.setFrom(projection * view);
+        frustums->push_back(f);
+    }
+}   // createScene
+
+// ----------------------------------------------------------------------------
+/** The level of detail as selected by LODNode for a single node. */
+static int getLevel(const Object *object, float distance2, bool orthogonal)
+{
+    for (unsigned int n = 0; n < object->m_lod_distance2.size(); n++)
+    {
+        if (distance2 < object->m_lod_distance2[n])
+            return n;
+    }
+    if (orthogonal)
+        return object->m_lod_distance2.size() - 1;
+    return -1;
+}   // getLevel
+
+// ----------------------------------------------------------------------------
+/** The EAC_FRUSTUM_BOX test of the scene manager: true if all 8 corners of
+ *  the box are in front of one of the planes. */
+static bool isCulledFrustumBox(const Object *object,
+                               const scene::SViewFrustum &frustum)
+{
+    scene::SViewFrustum frust = frustum;
+    core::matrix4 inverse(object->m_transform,
+                          core::matrix4::EM4CONST_INVERSE);
+    frust.transform(inverse);
+
+    core::vector3df edges[8];
+    object->m_box.getEdges(edges);
+    for (unsigned int i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        bool box_in_frustum = false;
+        for (unsigned int j = 0; j < 8; j++)
+        {
+            if (frust.planes[i].classifyPointRelation(edges[j])
+                != core::ISREL3D_FRONT)
+            {
+                box_in_frustum = true;
+                break;
+            }
+        }
+        if (!box_in_frustum) return true;
+    }
+    return false;
+}   // isCulledFrustumBox
+
+// ----------------------------------------------------------------------------
+/** The exact test used to check the results: the transformed corners of the
+ *  box are tested against the world space planes. */
+static bool isCulledExact(const Object *object,
+                          const scene::SViewFrustum &frustum)
+{
+    core::vector3df edges[8];
+    object->m_box.getEdges(edges);
+    for (unsigned int j = 0; j < 8; j++)
+        object->m_transform.transformVect(edges[j]);
+    for (unsigned int i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        unsigned int outside = 0;
+        for (unsigned int j = 0; j < 8; j++)
+        {
+            // Allow for rounding errors of the transformations: a box
+            // that only touches a plane may be culled
+            if (frustum.planes[i].getDistanceTo(edges[j]) > -0.01f)
+                outside++;
+        }
+        if (outside == 8) return true;
+    }
+    return false;
+}   // isCulledExact
+
+// ----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    std::vector<Object*> objects;
+    std::vector<Frustum> frustums;
+    const int frames = argc > 2 ? atoi(argv[2]) : 2000;
+    if (argc > 1 && (argv[1][0] < '0' || argv[1][0] > '9'))
+    {
+        if (!readScene(argv[1], &objects, &frustums))
+        {
+            fprintf(stderr, "Can't read scene file '%s'.\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+    {
+        createScene(argc > 1 ? atoi(argv[1]) : 2000, frames, &objects,
+                    &frustums);
+    }
+
+    const unsigned int n = objects.size();
+    double time_box = 0, time_frustum_box = 0, time_culler = 0;
+    double time_cull = 0;
+    long visible_box = 0, visible_frustum_box = 0, visible_culler = 0;
+    long errors = 0;
+    std::vector<int> level(n);
+    FrustumCuller culler;
+    for (unsigned int f = 0; f < frustums.size(); f++)
+    {
+        const Frustum &frustum = frustums[f];
+        for (unsigned int i = 0; i < n; i++)
+        {
+            Object *object = objects[i];
+            if (!object->m_moving) continue;
+            object->m_transform.setTranslation(
+                object->m_transform.getTranslation()
+                + core::vector3df(0, f % 2 ? 0.01f : -0.01f, 0));
+        }
+
+        // Old path, default culling (EAC_BOX) of the track objects. This
+        // is the path the culler replaces.
+        clock_t start = clock();
+        const core::aabbox3df &frustum_box =
+            frustum.m_frustum.getBoundingBox();
+        for (unsigned int i = 0; i < n; i++)
+        {
+            const Object *object = objects[i];
+            const float distance2 = object->m_transform.getTranslation()
+                                  .getDistanceFromSQ(frustum.m_position);
+            level[i] = getLevel(object, distance2, frustum.m_orthogonal);
+            if (level[i] < 0) continue;
+            core::aabbox3df box = object->m_box;
+            object->m_transform.transformBoxEx(box);
+            if (box.intersectsWithBox(frustum_box))
+                visible_box++;
+        }
+        time_box += double(clock() - start) / CLOCKS_PER_SEC;
+
+        // Old path, EAC_FRUSTUM_BOX culling as used for karts and items,
+        // only for comparison
+        start = clock();
+        for (unsigned int i = 0; i < n; i++)
+        {
+            const Object *object = objects[i];
+            const float distance2 = object->m_transform.getTranslation()
+                                  .getDistanceFromSQ(frustum.m_position);
+            level[i] = getLevel(object, distance2, frustum.m_orthogonal);
+            if (level[i] < 0) continue;
+            if (!isCulledFrustumBox(object, frustum.m_frustum))
+                visible_frustum_box++;
+        }
+        time_frustum_box += double(clock() - start) / CLOCKS_PER_SEC;
+
+        // New path, including gathering the data as LODNode::cullNodes does:
+        // for objects that moved the box of each level is transformed, and
+        // their union is used
+        start = clock();
+        culler.resize(n);
+        for (unsigned int i = 0; i < n; i++)
+        {
+            Object *object = objects[i];
+            if (!object->m_cull_dirty &&
+                object->m_transform == object->m_cull_transform)
+                continue;
+            core::aabbox3df box = object->m_box;
+            object->m_transform.transformBoxEx(box);
+            for (unsigned int k = 1; k < object->m_lod_distance2.size(); k++)
+            {
+                core::aabbox3df level_box = object->m_box;
+                object->m_transform.transformBoxEx(level_box);
+                box.addInternalBox(level_box);
+            }
+            culler.setObject(i, box, object->m_transform.getTranslation(),
+                             object->m_lod_distance2);
+            object->m_cull_transform = object->m_transform;
+            object->m_cull_dirty     = false;
+        }
+        const clock_t start_cull = clock();
+        culler.cull(frustum.m_frustum, frustum.m_position,
+                    frustum.m_orthogonal);
+        time_cull += double(clock() - start_cull) / CLOCKS_PER_SEC;
+        time_culler += double(clock() - start) / CLOCKS_PER_SEC;
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            // LODNode selects the level itself if the culler can't
+            int culler_level = culler.getLevel(i);
+            if (culler_level == FrustumCuller::LEVEL_UNKNOWN)
+                culler_level = level[i];
+            if (culler_level >= 0 && culler.isInFrustum(i))
+                visible_culler++;
+
+            if (culler_level != level[i])
+                errors++;
+            else if (!culler.isInFrustum(i) &&
+                     !isCulledExact(objects[i], frustum.m_frustum))
+                errors++;
+        }
+    }
+
+    const double num_frustums = (double)frustums.size();
+    printf("%u objects, %u frustums\n", n, (unsigned int)frustums.size());
+    printf("                            time per frustum   visible objects\n");
+    printf("  old default, EAC_BOX      : %8.4f ms       %8.1f\n",
+           1000.0 * time_box / num_frustums, visible_box / num_frustums);
+    printf("  FrustumCuller             : %8.4f ms       %8.1f\n",
+           1000.0 * time_culler / num_frustums,
+           visible_culler / num_frustums);
+    printf("    of which cull()         : %8.4f ms\n",
+           1000.0 * time_cull / num_frustums);
+    printf("  speedup over EAC_BOX      : %8.2f\n",
+           time_culler > 0 ? time_box / time_culler : 0.0);
+    printf("  EAC_FRUSTUM_BOX (karts)   : %8.4f ms       %8.1f\n",
+           1000.0 * time_frustum_box / num_frustums,
+           visible_frustum_box / num_frustums);
+    printf("  errors                    : %ld\n", errors);
+
+    for (unsigned int i = 0; i < n; i++)
+        delete objects[i];
+    return errors ? 1 : 0;
+}   // main
@@ -0,0 +1,213 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/** Benchmark for the clustered light assignment used by the point light
+ *  pass. It creates an irrlicht device with the null driver, scatters
+ *  point lights over a track-sized area and moves a camera along an oval
+ *  through them. For each frame the lights are assigned to the clusters
+ *  of the camera. It prints the time per frame, the number of visible
+ *  lights, the number of lights the old renderer would have dropped (it
+ *  only rendered the nearest 16), and the number of point light draw
+ *  calls (batches). It also checks that every light whose centre is inside
+ *  the view frustum is in the cluster containing its centre, and that the
+ *  lights of each cluster are in the batches covering that cluster.
+ *
+ *  Usage: light_cluster_bench [num_lights] [frames]
+ */
+
+#include "graphics/light_cluster.hpp"
+
+#include <irrlicht.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+using namespace irr;
+
+// ----------------------------------------------------------------------------
+/** Checks that every light with its centre in the view frustum is in the
+ *  cluster that contains its centre. Returns the number of errors.
+ */
+static int checkClusters(const LightCluster &cluster,
+                         const core::matrix4 &view,
+                         const core::matrix4 &projection,
+                         float near_value, float far_value)
+{
+    int errors = 0;
+    for (unsigned int i = 0; i < cluster.getNumLights(); i++)
+    {
+        core::vector3df p = cluster.getPosition(i);
+        view.transformVect(p);
+        if (p.Z <= near_value || p.Z >= far_value) continue;
+        const float sx = p.X / p.Z * projection[0];
+        const float sy = p.Y / p.Z * projection[5];
+        if (fabsf(sx) >= 1.0f || fabsf(sy) >= 1.0f) continue;
+
+        const unsigned int x = (unsigned int)((sx + 1.0f) * 0.5f
+                                              * LightCluster::TILES_X);
+        const unsigned int y = (unsigned int)((sy + 1.0f) * 0.5f
+                                              * LightCluster::TILES_Y);
+        unsigned int slice = 0;
+        while (slice + 1 < LightCluster::DEPTH_SLICES &&
+               p.Z >= cluster.getSliceFar(slice))
+            slice++;
+
+        const unsigned int c = LightCluster::getClusterIndex(x, y, slice);
+        const unsigned int *lights = cluster.getClusterLights(c);
+        bool found = false;
+        for (unsigned int j = 0; j < cluster.getNumClusterLights(c); j++)
+        {
+            if (lights[j] == i) found = true;
+        }
+        if (!found) errors++;
+    }
+    return errors;
+}   // checkClusters
+
+// ----------------------------------------------------------------------------
+/** Checks that each light of each cluster is in exactly one batch that
+ *  covers the cluster, and that no batch has too many lights. Returns the
+ *  number of errors.
+ */
+static int checkBatches(const LightCluster &cluster)
+{
+    int errors = 0;
+    for (unsigned int b = 0; b < cluster.getNumBatches(); b++)
+    {
+        if (cluster.getBatch(b).m_num_lights > LightCluster::LIGHTS_PER_BATCH)
+            errors++;
+    }
+    for (unsigned int s = 0; s < LightCluster::DEPTH_SLICES; s++)
+    for (unsigned int y = 0; y < LightCluster::TILES_Y; y++)
+    for (unsigned int x = 0; x < LightCluster::TILES_X; x++)
+    {
+        const unsigned int c = LightCluster::getClusterIndex(x, y, s);
+        const unsigned int *lights = cluster.getClusterLights(c);
+        for (unsigned int i = 0; i < cluster.getNumClusterLights(c); i++)
+        {
+            int found = 0;
+            for (unsigned int b = 0; b < cluster.getNumBatches(); b++)
+            {
+                const LightCluster::Batch &batch = cluster.getBatch(b);
+                if (x < batch.m_first_x || x > batch.m_last_x ||
+                    y < batch.m_first_y || y > batch.m_last_y ||
+                    s < batch.m_first_slice || s > batch.m_last_slice)
+                    continue;
+                const unsigned int *batch_lights =
+                    cluster.getBatchLights(batch);
+                for (unsigned int j = 0; j < batch.m_num_lights; j++)
+                {
+                    if (batch_lights[j] == lights[i]) found++;
+                }
+            }
+            if (found != 1) errors++;
+        }
+    }
+    return errors;
+}   // checkBatches
+
+// ----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    const unsigned int num_lights = argc > 1 ? atoi(argv[1]) : 500;
+    const int frames              = argc > 2 ? atoi(argv[2]) : 2000;
+
+    IrrlichtDevice *device = createDevice(video::EDT_NULL);
+    scene::ISceneManager *scene_manager = device->getSceneManager();
+    scene::ICameraSceneNode *camera = scene_manager->addCameraSceneNode();
+    camera->setNearValue(1.0f);
+    camera->setFarValue(1000.0f);
+    camera->setAspectRatio(16.0f / 9.0f);
+
+    // Lights along and around an oval of 300x150 m, like on a track
+    srand(1);
+    std::vector<core::vector3df> positions, colors;
+    std::vector<float> energies;
+    for (unsigned int i = 0; i < num_lights; i++)
+    {
+        const float angle  = (rand() % 3600) * 0.1f * core::DEGTORAD;
+        const float offset = (rand() % 400) * 0.1f - 20.0f;
+        positions.push_back(core::vector3df((150.0f + offset) * cosf(angle),
+                                            (rand() % 100) * 0.1f,
+                                            (75.0f + offset) * sinf(angle)));
+        colors.push_back(core::vector3df((rand() % 100) * 0.01f,
+                                         (rand() % 100) * 0.01f,
+                                         (rand() % 100) * 0.01f));
+        energies.push_back(0.5f + (rand() % 50) * 0.1f);
+    }
+
+    LightCluster cluster;
+    double total_time = 0;
+    long total_visible = 0, total_dropped = 0, total_draws = 0;
+    int errors = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const float angle = frame * 0.005f;
+        const core::vector3df pos(150.0f * cosf(angle), 2.0f,
+                                  75.0f * sinf(angle));
+        const core::vector3df dir(-150.0f * sinf(angle), 0,
+                                  75.0f * cosf(angle));
+        camera->setPosition(pos);
+        camera->setTarget(pos + dir);
+        camera->updateAbsolutePosition();
+        camera->render();
+
+        const clock_t start = clock();
+        cluster.clearLights();
+        for (unsigned int i = 0; i < num_lights; i++)
+        {
+            cluster.addLight(positions[i],
+                             LightCluster::getLightRadius(energies[i]),
+                             colors[i], energies[i]);
+        }
+        cluster.assignLights(camera->getViewMatrix(),
+                             camera->getProjectionMatrix(),
+                             camera->getNearValue(), camera->getFarValue());
+        total_time += double(clock() - start) / CLOCKS_PER_SEC;
+
+        total_visible += cluster.getNumVisibleLights();
+        if (cluster.getNumVisibleLights() > LightCluster::LIGHTS_PER_BATCH)
+        {
+            total_dropped += cluster.getNumVisibleLights()
+                           - LightCluster::LIGHTS_PER_BATCH;
+        }
+        total_draws += cluster.getNumBatches();
+        errors += checkBatches(cluster);
+        errors += checkClusters(cluster, camera->getViewMatrix(),
+                                camera->getProjectionMatrix(),
+                                camera->getNearValue(),
+                                camera->getFarValue());
+    }
+
+    printf("%u lights, %d frames\n", num_lights, frames);
+    printf("  assignment time per frame : %.3f ms\n",
+           1000.0 * total_time / frames);
+    printf("  visible lights per frame  : %.1f\n",
+           double(total_visible) / frames);
+    printf("  dropped by old renderer   : %.1f\n",
+           double(total_dropped) / frames);
+    printf("  draw calls per frame      : %.1f\n",
+           double(total_draws) / frames);
+    printf("  errors                    : %d\n", errors);
+
+    device->drop();
+    return errors ? 1 : 0;
+}   // main
@@ -0,0 +1,125 @@
+#!/usr/bin/env python
+# Runs SuperTuxKart in profile mode for a fixed set of tracks and kart
+# counts and compares the results with a stored baseline.
+#
+# Usage:
+#   profile_regression.py [--exe=PATH] [--baseline=FILE] [--laps=N]
+#                         [--threshold=PERCENT] [--update-baseline]
+#
+# Each run is done with --no-graphics and --profile-output, and the
+# resulting JSON files are collected into one dictionary indexed by
+# 'track/num_karts'. With --update-baseline this dictionary is written to
+# the baseline file, otherwise each value is compared with the baseline,
+# and the script exits with 1 if any value is more than the threshold
+# worse than the baseline.
+################################################################################
+import json
+import optparse
+import os
+import subprocess
+import sys
+import tempfile
+
+# The matrix of tracks and number of karts to test.
+TRACKS     = ["lighthouse", "hacienda", "snowmountain", "zengarden"]
+NUM_KARTS  = [4, 8, 16]
+
+# Values for which a higher number is a regression. The phase values are
+# handled separately.
+METRICS    = ["frame_time_p50", "frame_time_p95", "frame_time_p99",
+              "physics_steps", "memory_high_water_mark_kb"]
+
+#-------------------------------------------------------------------------------
+def run(exe, track, num_karts, laps):
+    """
+    Runs one profile race and returns the parsed statistics.
+    """
+    handle, output = tempfile.mkstemp(suffix=".json")
+    os.close(handle)
+    cmd = [exe, "--no-graphics", "--track=%s" % track,
+           "--numkarts=%d" % num_karts, "--profile-laps=%d" % laps,
+           "--profile-output=%s" % output]
+    print("Running: %s" % " ".join(cmd))
+    try:
+        with open(os.devnull, "w") as null:
+            subprocess.check_call(cmd, stdout=null, stderr=null)
+        with open(output) as f:
+            return json.load(f)
+    finally:
+        os.remove(output)
+
+#-------------------------------------------------------------------------------
+def compare(name, old, new, threshold):
+    """
+    Prints and returns True if the new value is more than 'threshold'
+    percent worse than the old value. Values that were not finite are
+    written as null and are skipped.
+    """
+    if old is None or new is None or old <= 0 or new < 0:
+        return False
+    change = 100.0*(new-old)/old
+    if change > threshold:
+        print("  REGRESSION %-40s %12.3f -> %12.3f (%+.1f%%)"
+              % (name, old, new, change))
+        return True
+    return False
+
+#-------------------------------------------------------------------------------
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option("--exe", default="./supertuxkart",
+                      help="SuperTuxKart executable to test")
+    parser.add_option("--baseline", default="profile_baseline.json",
+                      help="File with the baseline results")
+    parser.add_option("--laps", type="int", default=1,
+                      help="Number of laps for each race")
+    parser.add_option("--threshold", type="float", default=10.0,
+                      help="Allowed slowdown in percent")
+    parser.add_option("--update-baseline", action="store_true",
+                      default=False,
+                      help="Store the results as new baseline")
+    options, args = parser.parse_args()
+
+    results = {}
+    for track in TRACKS:
+        for num_karts in NUM_KARTS:
+            key = "%s/%d" % (track, num_karts)
+            results[key] = run(options.exe, track, num_karts, options.laps)
+
+    if options.update_baseline:
+        with open(options.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print("Baseline written to '%s'." % options.baseline)
+        return 0
+
+    with open(options.baseline) as f:
+        baseline = json.load(f)
+
+    regression = False
+    for key in sorted(results.keys()):
+        if key not in baseline:
+            print("%s: not in baseline, skipped." % key)
+            continue
+        print("%s:" % key)
+        old = baseline[key]
+        new = results[key]
+        for metric in METRICS:
+            if metric in old and metric in new:
+                regression |= compare(metric, old[metric], new[metric],
+                                      options.threshold)
+        # The phases are compared using the average time per frame, since
+        # the number of frames can differ between runs.
+        for phase, value in new.get("phases", {}).items():
+            if phase in old.get("phases", {}):
+                regression |= compare("phase " + phase,
+                                      old["phases"][phase]["ms_per_frame"],
+                                      value["ms_per_frame"],
+                                      options.threshold)
+    if regression:
+        print("Performance regression detected.")
+        return 1
+    print("No regression detected.")
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
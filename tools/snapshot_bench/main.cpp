@@ -0,0 +1,180 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2014 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/** Benchmark for the kart snapshot encoding used by KartUpdateProtocol.
+ *  It simulates karts driving around an oval track, and encodes the
+ *  snapshots a server would send to one client at different update
+ *  rates. The client acknowledges snapshots with a configurable packet
+ *  loss. For each rate it prints the average number of bytes per kart per
+ *  tick for the old raw float encoding, for full quantized snapshots and
+ *  for delta-encoded snapshots, as well as the largest decoding error.
+ *
+ *  Usage: snapshot_bench [num_karts] [seconds] [loss_percent]
+ */
+
+#include "network/bit_packer.hpp"
+#include "network/kart_snapshot.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int HISTORY = 32;
+
+/** Position and rotation of a simulated kart at a given time. Karts drive
+ *  on an oval of 300x150 m with some height variation, each at its own
+ *  speed. A few karts are standing still (e.g. crashed or rescued). */
+static void getKart(int kart, float t, Vec3 *xyz, btQuaternion *q)
+{
+    if (kart % 7 == 6)
+        t = 0;
+    float speed = 20.0f + kart*1.5f;
+    float angle = t*speed/225.0f + kart*0.3f;
+    *xyz = Vec3(150.0f*cosf(angle), 5.0f*sinf(angle*3.0f),
+                75.0f*sinf(angle));
+    float heading = angle + 1.5708f;
+    float pitch   = 0.05f*cosf(angle*3.0f);
+    q->setEulerZYX(0, heading, pitch);
+}   // getKart
+
+// ----------------------------------------------------------------------------
+static void runBenchmark(int num_karts, int rate, float seconds, int loss)
+{
+    KartSnapshot sent[HISTORY], received[HISTORY];
+    bool received_valid[HISTORY];
+    for (int i = 0; i < HISTORY; i++)
+        received_valid[i] = false;
+    int acked = -1;
+    int ticks = (int)(seconds*rate);
+    long total_full = 0, total_delta = 0;
+    float max_pos_error = 0, max_rot_error = 0;
+    int delta_packets = 0;
+    srand(1234);
+
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        float t = tick / (float)rate;
+        uint16_t sequence = (uint16_t)tick;
+        KartSnapshot &snapshot = sent[sequence % HISTORY];
+        snapshot.setSequence(sequence);
+        snapshot.setNumKarts(num_karts);
+        for (int k = 0; k < num_karts; k++)
+        {
+            Vec3 xyz;
+            btQuaternion q;
+            getKart(k, t, &xyz, &q);
+            snapshot.set(k, xyz, q);
+        }
+
+        // Full snapshot, for comparison
+        NetworkString full;
+        full.af(t).ai16(sequence).ai8(0);
+        {
+            BitWriter writer(&full);
+            snapshot.encode(NULL, &writer);
+        }
+        total_full += full.size();
+
+        // Delta snapshot against the last acknowledged one
+        const KartSnapshot *baseline = NULL;
+        uint8_t distance = 0;
+        if (acked >= 0)
+        {
+            uint16_t d = sequence - (uint16_t)acked;
+            if (d > 0 && d < HISTORY)
+            {
+                baseline = &sent[acked % HISTORY];
+                distance = (uint8_t)d;
+            }
+        }
+        NetworkString ns;
+        ns.af(t).ai16(sequence).ai8(distance);
+        {
+            BitWriter writer(&ns);
+            snapshot.encode(baseline, &writer);
+        }
+        total_delta += ns.size();
+        if (baseline)
+            delta_packets++;
+
+        // Simulate the client: lost packets are neither decoded nor acked
+        if (rand() % 100 < loss)
+            continue;
+        const KartSnapshot *client_baseline = NULL;
+        if (distance > 0)
+        {
+            uint16_t b = sequence - distance;
+            if (!received_valid[b % HISTORY] ||
+                received[b % HISTORY].getSequence() != b)
+            {
+                printf("Error: missing baseline at tick %d\n", tick);
+                exit(1);
+            }
+            client_baseline = &received[b % HISTORY];
+        }
+        KartSnapshot decoded;
+        BitReader reader(ns, 7);
+        if (!decoded.decode(client_baseline, &reader))
+        {
+            printf("Error: decoding failed at tick %d\n", tick);
+            exit(1);
+        }
+        decoded.setSequence(sequence);
+        received[sequence % HISTORY] = decoded;
+        received_valid[sequence % HISTORY] = true;
+        for (int k = 0; k < num_karts; k++)
+        {
+            Vec3 xyz;
+            btQuaternion q;
+            getKart(k, t, &xyz, &q);
+            float pos_error = (decoded.getXYZ(k) - xyz).length();
+            if (pos_error > max_pos_error)
+                max_pos_error = pos_error;
+            float dot = fabsf(decoded.getRotation(k).dot(q));
+            float rot_error = 2.0f*acosf(dot > 1.0f ? 1.0f : dot);
+            if (rot_error > max_rot_error)
+                max_rot_error = rot_error;
+        }
+        // The ack arrives with the next client message
+        acked = sequence;
+    }
+
+    // Old format: world time, then 4 byte kart id + 7 floats per kart
+    float raw   = (4.0f + num_karts*32.0f) / num_karts;
+    float full  = total_full  / (float)ticks / num_karts;
+    float delta = total_delta / (float)ticks / num_karts;
+    printf("%3d Hz: raw %6.2f  quantized %6.2f  delta %6.2f bytes/kart/tick"
+           "  (%5.1f%% of raw, %6.0f bytes/s per client, %d%% delta)"
+           "  max error %.4f m %.3f deg\n",
+           rate, raw, full, delta, 100.0f*delta/raw, delta*num_karts*rate,
+           100*delta_packets/ticks, max_pos_error,
+           max_rot_error*180.0f/3.14159265f);
+}   // runBenchmark
+
+// ----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    int num_karts = argc > 1 ? atoi(argv[1]) : 8;
+    float seconds = argc > 2 ? (float)atof(argv[2]) : 120.0f;
+    int loss      = argc > 3 ? atoi(argv[3]) : 5;
+    printf("%d karts, %.0f s, %d%% packet loss\n", num_karts, seconds, loss);
+    const int rates[] = { 10, 20, 30, 60 };
+    for (unsigned int i = 0; i < sizeof(rates)/sizeof(rates[0]); i++)
+        runBenchmark(num_karts, rates[i], seconds, loss);
+    return 0;
+}   // main